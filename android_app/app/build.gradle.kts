@@ -37,6 +37,13 @@ android {
     buildFeatures {
         compose = true
     }
+    // libcheepsync_jni: the C sync core shared with the firmware (NativeSync.kt)
+    externalNativeBuild {
+        cmake {
+            path = file("src/main/cpp/CMakeLists.txt")
+            version = "3.22.1"
+        }
+    }
 }
 
 dependencies {
@@ -0,0 +1,120 @@
+package com.example.ble_sync_suite_app
+
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.ClockSync
+import com.example.ble_sync_suite_app.sync.Estimator
+import com.example.ble_sync_suite_app.sync.FitMode
+import com.example.ble_sync_suite_app.sync.KalmanSync
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Assume.assumeTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import kotlin.math.abs
+
+/**
+ * The C sync core through JNI against the Kotlin estimators on one sample stream: NativeCheepSync against
+ * CheepSync (INCREMENTAL) for each ported estimator, NativeKalmanSync against KalmanSync. On the device,
+ * because the APK's libcheepsync_jni is what runs there. Stamps are days into uptime and the stream spans
+ * several rebases, as in CheepSyncTest.
+ */
+@RunWith(AndroidJUnit4::class)
+class NativeSyncTest {
+
+    @Before
+    fun requireLibrary() {
+        assumeTrue("libcheepsync_jni not built for this ABI", NativeCheepSync.isAvailable)
+    }
+
+    @Test
+    fun nativeCheepSyncMatchesKotlin() {
+        for (estimator in listOf(Estimator.LEAST_SQUARES, Estimator.LOWER_ENVELOPE, Estimator.HUBER)) {
+            NativeCheepSync(estimator = estimator).use { native ->
+                compare("$estimator", CheepSync(mode = FitMode.INCREMENTAL, estimator = estimator), native)
+            }
+        }
+    }
+
+    @Test
+    fun nativeKalmanSyncMatchesKotlin() {
+        val kotlin = KalmanSync()
+        NativeKalmanSync().use { native ->
+            compare("Kalman", kotlin, native)
+            assertEquals("offset std dev", kotlin.offsetStdDevNs, native.offsetStdDevNs, kotlin.offsetStdDevNs * 1e-9)
+            assertEquals("skew std dev", kotlin.skewStdDevPpm, native.skewStdDevPpm, kotlin.skewStdDevPpm * 1e-9)
+        }
+    }
+
+    @Test
+    fun batchedAddMatchesSingleAdds() {
+        val beacon = LongArray(SAMPLES) { beaconUs(it) }
+        val receiver = delaysNs().let { delays -> LongArray(SAMPLES) { idealReceiverNs(it) + delays[it] } }
+        NativeCheepSync(estimator = Estimator.LOWER_ENVELOPE).use { batched ->
+            NativeCheepSync(estimator = Estimator.LOWER_ENVELOPE).use { single ->
+                batched.addSamples(beacon, receiver)
+                for (i in 0 until SAMPLES) single.addSample(beacon[i], receiver[i])
+                assertEquals(single.getFit(), batched.getFit())
+                assertEquals(single.sampleCount, batched.sampleCount)
+            }
+        }
+    }
+
+    private fun compare(name: String, kotlin: ClockSync, native: ClockSync) {
+        val delays = delaysNs()
+        for (i in 0 until SAMPLES) {
+            val receiverNs = idealReceiverNs(i) + delays[i]
+            kotlin.addSample(beaconUs(i), receiverNs)
+            native.addSample(beaconUs(i), receiverNs)
+
+            assertEquals("$name sample count at $i", kotlin.sampleCount, native.sampleCount)
+            assertEquals("$name hasFit at $i", kotlin.hasFit, native.hasFit)
+            if (!kotlin.hasFit) continue
+            val k = kotlin.getFit()
+            val n = native.getFit()
+            assertEquals("$name beacon epoch at $i", k.beaconEpochUs, n.beaconEpochUs)
+            assertEquals("$name receiver epoch at $i", k.receiverEpochNs, n.receiverEpochNs)
+            assertEquals("$name beta at $i", k.beta, n.beta, BETA_TOLERANCE)
+            assertEquals("$name alpha at $i", k.alpha, n.alpha, OFFSET_TOLERANCE_NS)
+            assertEquals("$name rms at $i", kotlin.rmsResidualMs, native.rmsResidualMs, RMS_TOLERANCE_MS)
+            val next = beaconUs(i + 1)
+            assertTrue("$name next sample at $i", abs(kotlin.mapBeaconToReceiverNs(next) - native.mapBeaconToReceiverNs(next)) <= 1)
+        }
+        kotlin.reset()
+        native.reset()
+        assertEquals("$name reset", kotlin.sampleCount, native.sampleCount)
+        assertEquals("$name reset", kotlin.hasFit, native.hasFit)
+    }
+
+    private fun beaconUs(i: Int): Long = BEACON_START_US + i * PERIOD_US
+
+    private fun idealReceiverNs(i: Int): Long = RECEIVER_START_NS + Math.round(TRUE_BETA * (i * PERIOD_US * 1000.0))
+
+    // Same LCG stream as CheepSyncTest: up to 1 ms of jitter, every OUTLIER_EVERY-th sample 20 ms late
+    private fun delaysNs(): LongArray {
+        var state = 0x2545F4914F6CDD1DL
+        return LongArray(SAMPLES) { i ->
+            state = state * 6364136223846793005L + 1442695040888963407L
+            val jitter = (state ushr 33) % JITTER_NS
+            if (i % OUTLIER_EVERY == OUTLIER_EVERY - 1) jitter + OUTLIER_NS else jitter
+        }
+    }
+
+    private companion object {
+        const val SAMPLES = 3000
+        const val PERIOD_US = 100_003L
+        const val BEACON_START_US = 2L * 86_400_000_000L
+        const val RECEIVER_START_NS = 3L * 86_400_000_000_000L
+        const val TRUE_BETA = 1.0 + 40e-6
+        const val JITTER_NS = 1_000_000L
+        const val OUTLIER_EVERY = 37
+        const val OUTLIER_NS = 20_000_000L
+
+        // Same arithmetic in both, bit for bit without FMA. Clang may contract a*b+c into one on arm64, which
+        // moves this stream by up to ~1e-13 in beta and ~0.006 ns in alpha; the bounds leave 10x over that
+        const val BETA_TOLERANCE = 1e-12
+        const val OFFSET_TOLERANCE_NS = 0.1
+        const val RMS_TOLERANCE_MS = 1e-6
+    }
+}
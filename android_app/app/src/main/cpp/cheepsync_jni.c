@@ -0,0 +1,251 @@
+// JNI binding: NativeCheepSync / NativeKalmanSync (Kotlin) over cheepsync.h. Each native object is one
+// heap-allocated state struct behind a jlong handle; the sync core itself never allocates.
+
+#include <jni.h>
+#include <stdlib.h>
+
+#include "cheepsync.h"
+
+#define NATIVE_CLASS_SYNC   "com/example/ble_sync_suite_app/NativeCheepSync"
+#define NATIVE_CLASS_KALMAN "com/example/ble_sync_suite_app/NativeKalmanSync"
+
+static inline cheepsync_t *sync_of(jlong handle)
+{
+    return (cheepsync_t *)(intptr_t)handle;
+}
+
+static inline cheepsync_kalman_t *kalman_of(jlong handle)
+{
+    return (cheepsync_kalman_t *)(intptr_t)handle;
+}
+
+// Fit as [alpha, beta] and [beaconEpochUs, receiverEpochNs]: the epochs stay exact as longs
+static void put_fit(JNIEnv *env, cheepsync_fit_t f, jdoubleArray d, jlongArray l)
+{
+    jdouble dv[2] = { f.alpha, f.beta };
+    jlong lv[2] = { f.beacon_epoch_us, f.receiver_epoch_ns };
+    (*env)->SetDoubleArrayRegion(env, d, 0, 2, dv);
+    (*env)->SetLongArrayRegion(env, l, 0, 2, lv);
+}
+
+/* ----- Sliding window ----- */
+
+static jlong sync_create(JNIEnv *env, jobject thiz, jint window, jint estimator)
+{
+    (void)env; (void)thiz;
+    cheepsync_t *s = malloc(sizeof(*s));
+    if (s == NULL || !cheepsync_init(s, window, (cheepsync_estimator_t)estimator)) {
+        free(s);
+        return 0;
+    }
+    return (jlong)(intptr_t)s;
+}
+
+static void sync_free(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    free(sync_of(handle));
+}
+
+static jint sync_window_max(JNIEnv *env, jobject thiz)
+{
+    (void)env; (void)thiz;
+    return CHEEPSYNC_WINDOW_MAX;
+}
+
+static void sync_add(JNIEnv *env, jobject thiz, jlong handle, jlong beacon_us, jlong receiver_ns)
+{
+    (void)env; (void)thiz;
+    cheepsync_add(sync_of(handle), beacon_us, receiver_ns);
+}
+
+// One crossing for a whole batch: the arrays are pinned (or copied) once, no JNI calls in between
+static void sync_add_all(JNIEnv *env, jobject thiz, jlong handle, jlongArray beacon_us, jlongArray receiver_ns, jint n)
+{
+    (void)thiz;
+    jlong *tb = (*env)->GetPrimitiveArrayCritical(env, beacon_us, NULL);
+    jlong *tr = tb == NULL ? NULL : (*env)->GetPrimitiveArrayCritical(env, receiver_ns, NULL);
+    if (tr != NULL) {
+        cheepsync_t *s = sync_of(handle);
+        for (jint i = 0; i < n; i++) {
+            cheepsync_add(s, tb[i], tr[i]);
+        }
+        (*env)->ReleasePrimitiveArrayCritical(env, receiver_ns, tr, JNI_ABORT);
+    }
+    if (tb != NULL) {
+        (*env)->ReleasePrimitiveArrayCritical(env, beacon_us, tb, JNI_ABORT);
+    }
+}
+
+static jlong sync_map(JNIEnv *env, jobject thiz, jlong handle, jlong beacon_us)
+{
+    (void)env; (void)thiz;
+    return cheepsync_map(sync_of(handle), beacon_us);
+}
+
+static jdouble sync_residual_ns(JNIEnv *env, jobject thiz, jlong handle, jlong beacon_us, jlong receiver_ns)
+{
+    (void)env; (void)thiz;
+    return cheepsync_residual_ns(sync_of(handle), beacon_us, receiver_ns);
+}
+
+static void sync_fit(JNIEnv *env, jobject thiz, jlong handle, jdoubleArray d, jlongArray l)
+{
+    (void)thiz;
+    put_fit(env, cheepsync_get_fit(sync_of(handle)), d, l);
+}
+
+static jdouble sync_rms_ns(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    return sync_of(handle)->rms_ns;
+}
+
+static jint sync_count(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    return sync_of(handle)->count;
+}
+
+static jboolean sync_has_fit(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    return sync_of(handle)->has_fit ? JNI_TRUE : JNI_FALSE;
+}
+
+static void sync_reset(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    cheepsync_reset(sync_of(handle));
+}
+
+/* ----- Kalman ----- */
+
+static jlong kalman_create(JNIEnv *env, jobject thiz, jdouble q_offset_ns, jdouble q_skew_ppm,
+                           jdouble measurement_ms, jdouble initial_skew_ppm)
+{
+    (void)env; (void)thiz;
+    cheepsync_kalman_t *k = malloc(sizeof(*k));
+    if (k == NULL) {
+        return 0;
+    }
+    cheepsync_kalman_init(k, q_offset_ns, q_skew_ppm, measurement_ms, initial_skew_ppm);
+    return (jlong)(intptr_t)k;
+}
+
+static void kalman_free(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    free(kalman_of(handle));
+}
+
+static void kalman_add(JNIEnv *env, jobject thiz, jlong handle, jlong beacon_us, jlong receiver_ns)
+{
+    (void)env; (void)thiz;
+    cheepsync_kalman_add(kalman_of(handle), beacon_us, receiver_ns);
+}
+
+static void kalman_add_all(JNIEnv *env, jobject thiz, jlong handle, jlongArray beacon_us, jlongArray receiver_ns, jint n)
+{
+    (void)thiz;
+    jlong *tb = (*env)->GetPrimitiveArrayCritical(env, beacon_us, NULL);
+    jlong *tr = tb == NULL ? NULL : (*env)->GetPrimitiveArrayCritical(env, receiver_ns, NULL);
+    if (tr != NULL) {
+        cheepsync_kalman_t *k = kalman_of(handle);
+        for (jint i = 0; i < n; i++) {
+            cheepsync_kalman_add(k, tb[i], tr[i]);
+        }
+        (*env)->ReleasePrimitiveArrayCritical(env, receiver_ns, tr, JNI_ABORT);
+    }
+    if (tb != NULL) {
+        (*env)->ReleasePrimitiveArrayCritical(env, beacon_us, tb, JNI_ABORT);
+    }
+}
+
+static jlong kalman_map(JNIEnv *env, jobject thiz, jlong handle, jlong beacon_us)
+{
+    (void)env; (void)thiz;
+    return cheepsync_kalman_map(kalman_of(handle), beacon_us);
+}
+
+static void kalman_fit(JNIEnv *env, jobject thiz, jlong handle, jdoubleArray d, jlongArray l)
+{
+    (void)thiz;
+    put_fit(env, cheepsync_kalman_get_fit(kalman_of(handle)), d, l);
+}
+
+// [rms ns, offset std dev ns, skew std dev ppm]
+static void kalman_quality(JNIEnv *env, jobject thiz, jlong handle, jdoubleArray out)
+{
+    (void)thiz;
+    const cheepsync_kalman_t *k = kalman_of(handle);
+    jdouble v[3] = { cheepsync_kalman_rms_ns(k), cheepsync_kalman_offset_stddev_ns(k), cheepsync_kalman_skew_stddev_ppm(k) };
+    (*env)->SetDoubleArrayRegion(env, out, 0, 3, v);
+}
+
+static jint kalman_count(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    return (jint)kalman_of(handle)->count;
+}
+
+static void kalman_reset(JNIEnv *env, jobject thiz, jlong handle)
+{
+    (void)env; (void)thiz;
+    cheepsync_kalman_reset(kalman_of(handle));
+}
+
+/* ----- Registration ----- */
+
+static const JNINativeMethod sync_methods[] = {
+    { "nativeCreate", "(II)J", (void *)sync_create },
+    { "nativeFree", "(J)V", (void *)sync_free },
+    { "nativeWindowMax", "()I", (void *)sync_window_max },
+    { "nativeAdd", "(JJJ)V", (void *)sync_add },
+    { "nativeAddAll", "(J[J[JI)V", (void *)sync_add_all },
+    { "nativeMap", "(JJ)J", (void *)sync_map },
+    { "nativeResidualNs", "(JJJ)D", (void *)sync_residual_ns },
+    { "nativeFit", "(J[D[J)V", (void *)sync_fit },
+    { "nativeRmsNs", "(J)D", (void *)sync_rms_ns },
+    { "nativeCount", "(J)I", (void *)sync_count },
+    { "nativeHasFit", "(J)Z", (void *)sync_has_fit },
+    { "nativeReset", "(J)V", (void *)sync_reset },
+};
+
+static const JNINativeMethod kalman_methods[] = {
+    { "nativeCreate", "(DDDD)J", (void *)kalman_create },
+    { "nativeFree", "(J)V", (void *)kalman_free },
+    { "nativeAdd", "(JJJ)V", (void *)kalman_add },
+    { "nativeAddAll", "(J[J[JI)V", (void *)kalman_add_all },
+    { "nativeMap", "(JJ)J", (void *)kalman_map },
+    { "nativeFit", "(J[D[J)V", (void *)kalman_fit },
+    { "nativeQuality", "(J[D)V", (void *)kalman_quality },
+    { "nativeCount", "(J)I", (void *)kalman_count },
+    { "nativeReset", "(J)V", (void *)kalman_reset },
+};
+
+static jint register_class(JNIEnv *env, const char *name, const JNINativeMethod *methods, jint n)
+{
+    jclass cls = (*env)->FindClass(env, name);
+    if (cls == NULL) {
+        return JNI_ERR;
+    }
+    jint rc = (*env)->RegisterNatives(env, cls, methods, n);
+    (*env)->DeleteLocalRef(env, cls);
+    return rc;
+}
+
+// Explicit registration: the package name's underscores would otherwise need _1-mangled symbol names
+JNIEXPORT jint JNI_OnLoad(JavaVM *vm, void *reserved)
+{
+    (void)reserved;
+    JNIEnv *env;
+    if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    if (register_class(env, NATIVE_CLASS_SYNC, sync_methods, sizeof(sync_methods) / sizeof(sync_methods[0])) != JNI_OK ||
+        register_class(env, NATIVE_CLASS_KALMAN, kalman_methods, sizeof(kalman_methods) / sizeof(kalman_methods[0])) != JNI_OK) {
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_6;
+}
@@ -0,0 +1,597 @@
+package com.example.ble_sync_suite_app
+
+// Beacon session: per-device state for one ESP32 (GATT handle, CheepSync fit, stats, packet history).
+
+import android.bluetooth.BluetoothGatt
+import android.os.SystemClock
+import android.util.Log
+import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.ClockSync
+import com.example.ble_sync_suite_app.sync.Estimator
+import com.example.ble_sync_suite_app.sync.LossStats
+import com.example.ble_sync_suite_app.sync.LossTracker
+import com.example.ble_sync_suite_app.sync.RoundTripEstimate
+import com.example.ble_sync_suite_app.sync.RoundTripSync
+import com.example.ble_sync_suite_app.sync.SeqEvent
+import com.example.ble_sync_suite_app.sync.SeriesPyramid
+import com.example.ble_sync_suite_app.sync.SyncFit
+import com.example.ble_sync_suite_app.sync.SyncStats
+import com.example.ble_sync_suite_app.sync.SyncStatsAccumulator
+import com.example.ble_sync_suite_app.sync.ThermalSkewCurve
+import com.example.ble_sync_suite_app.sync.ThermalSkewModel
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.atomic.AtomicReference
+
+/**
+ * One beacon. Created by BleManager when a connection is started (closed when it drops) or when a
+ * connectionless broadcast from it is first heard while scanning ([gatt] stays null).
+ *
+ * Threads: [submit] runs on this device's GATT callback thread, or the scan callback thread for a broadcast beacon; decode, fit and stats run on the
+ * shared pipeline thread; [packets] is only touched on the main thread (via [postToUi]).
+ */
+class BeaconSession internal constructor(
+    val address: String,
+    pipeline: PacketPipeline,
+    spillFile: File?,
+    /** Append every decoded packet (and the fit after it) to this session log; null to not record. */
+    recordFile: File?,
+    /** Where the settled fit is kept across connections (warm start); null to always start cold. */
+    private val syncCache: SyncCache?,
+    private val postToUi: (Runnable) -> Unit,
+    /** Main thread, once per batch after it is added to [packets], with the newest packet of the batch. */
+    private val onPacket: (BeaconSession, EspPacket) -> Unit,
+    /** Decode thread, after every fit or stats update (BleManager mirrors the primary session). */
+    private val onPublished: (BeaconSession) -> Unit
+) {
+    var name: String = "Unnamed"
+        internal set
+
+    /** Current GATT connection attempt or connection; null for broadcast and source-fed sessions. */
+    @Volatile
+    internal var link: GattLink? = null
+
+    /** GATT of [link], once connectGatt has returned it. */
+    val gatt: BluetoothGatt? get() = link?.gatt
+
+    // Late deliveries (retransmissions, scheduling) only ever add delay, so fit the minimum-delay envelope
+    private val cheepSync: ClockSync = CheepSync(windowSize = FIT_WINDOW_SIZE, estimator = Estimator.LOWER_ENVELOPE)
+
+    private val _cheepSyncAlpha = MutableStateFlow(0.0)
+    private val _cheepSyncBeta = MutableStateFlow(1.0)
+    val cheepSyncAlpha: StateFlow<Double> = _cheepSyncAlpha.asStateFlow()
+    val cheepSyncBeta: StateFlow<Double> = _cheepSyncBeta.asStateFlow()
+    private val _cheepSyncRmsResidualMs = MutableStateFlow(0.0)
+    val cheepSyncRmsResidualMs: StateFlow<Double> = _cheepSyncRmsResidualMs.asStateFlow()
+
+    /** Samples in the fit window behind [cheepSyncRmsResidualMs]; reported to the beacon's rate control. Any thread. */
+    @Volatile
+    var fitSampleCount: Int = 0
+        private set
+
+    private val _connParams = MutableStateFlow<EspConnParams?>(null)
+    /** Connection parameters the beacon reported after negotiation; null until known (or for broadcasts). */
+    val connParams: StateFlow<EspConnParams?> = _connParams.asStateFlow()
+
+    private val _diagnostics = MutableStateFlow<EspDiagnostics?>(null)
+    /** Latest firmware diagnostics snapshot polled from the beacon; null until read (or for broadcasts). */
+    val diagnostics: StateFlow<EspDiagnostics?> = _diagnostics.asStateFlow()
+
+    private val _detectorConfig = MutableStateFlow<EspDetectorConfig?>(null)
+    /** Onset detector settings and noise estimate read from the beacon; null without the detector characteristic. */
+    val detectorConfig: StateFlow<EspDetectorConfig?> = _detectorConfig.asStateFlow()
+
+    private val _capabilities = MutableStateFlow<EspCapabilities?>(null)
+    /** Stream layout the beacon last reported, with the format it sends this link; null on older firmware. */
+    val capabilities: StateFlow<EspCapabilities?> = _capabilities.asStateFlow()
+
+    /**
+     * Latest fit snapshot, or null until the window holds two samples (or a cached fit is applied).
+     * Safe to read from any thread.
+     */
+    @Volatile
+    var fit: SyncFit? = null
+        private set(value) {
+            field = value
+            mapping = PhoneMapping(value, null)
+        }
+
+    // What mapBeaconToPhoneNs maps through; replaced whole on every fit or thermal update (decode thread)
+    @Volatile
+    private var mapping = PhoneMapping(null, null)
+
+    // Warm start: the beacon's boot ID once diagnostics report it, and a cached fit for that boot waiting
+    // for the decode thread. There, warmFit stands in for the fit until this connection's window is full.
+    @Volatile
+    private var bootId: Long? = null
+    private val pendingWarmStart = AtomicReference<CachedSync?>(null)
+    private var warmFit: SyncFit? = null
+    private var warmMinResidualNs = Double.MAX_VALUE
+    // Set once fit comes from a full window of this connection; only such a fit is cached on close
+    @Volatile
+    private var fitSettled = false
+
+    // Session stats: O(1) per packet, published once per drained batch
+    private val syncStatsAccumulator = SyncStatsAccumulator()
+    private val _syncStats = MutableStateFlow(SyncStats())
+    val syncStats: StateFlow<SyncStats> = _syncStats.asStateFlow()
+
+    // Sequence accounting: O(1) per packet, published with the stats
+    private val lossTracker = LossTracker()
+    private val _lossStats = MutableStateFlow(LossStats())
+    /** Gaps, late arrivals, duplicates and burst lengths of the sensor stream since the last reset. */
+    val lossStats: StateFlow<LossStats> = _lossStats.asStateFlow()
+    // Beacon time of the newest accepted packet, to size gaps in time (decode thread only)
+    private var lastAcceptedTUs = EspPacket.UNKNOWN
+
+    /**
+     * Charts: residual (ms) and skew (ppm) of each fitted sample, against its beacon time, at every zoom level.
+     * Fed on the decode thread, queried from the UI (both synchronized).
+     */
+    val residualHistory = SeriesPyramid()
+    val skewHistory = SeriesPyramid()
+
+    /** Packet history: last 1000 in memory, older ones spill to disk. Main thread only. */
+    val packets = PacketStore(capacity = PacketStore.DEFAULT_CAPACITY, spillFile = spillFile)
+
+    // Written on the decode thread, closed from the main thread (SessionRecorder is synchronized)
+    private val recorder = recordFile?.let { SessionRecorder(it, address) }
+
+    // Two-way exchanges over the round-trip characteristic (decode thread only)
+    private val roundTripSync = RoundTripSync()
+    private val _roundTrip = MutableStateFlow(RoundTripEstimate())
+    /** Round-trip delay and midpoint fit; the one-way fit above is unaffected. */
+    val roundTrip: StateFlow<RoundTripEstimate> = _roundTrip.asStateFlow()
+
+    // Skew vs beacon temperature (thermal payloads only). The model outlives fit restarts: it describes the
+    // crystal, not this window. The temperature window pairs with the fit's samples (decode thread only).
+    private val thermalSkew = ThermalSkewModel()
+    private val windowTemperatureC = DoubleArray(FIT_WINDOW_SIZE)
+    private var windowTemperatureCount = 0
+    private var windowTemperatureNext = 0
+    private var windowTemperatureSum = 0.0
+    private val _beaconTemperatureC = MutableStateFlow(Double.NaN)
+    /** Latest die temperature the beacon reported (°C); NaN without thermal payloads. */
+    val beaconTemperatureC: StateFlow<Double> = _beaconTemperatureC.asStateFlow()
+    private val _thermalSkewCurve = MutableStateFlow<ThermalSkewCurve?>(null)
+    /** Skew vs temperature learned from this beacon's settled fits; null until the first observation. */
+    val thermalSkewCurve: StateFlow<ThermalSkewCurve?> = _thermalSkewCurve.asStateFlow()
+
+    // Acoustic events, mapped to phone time as they arrive (decode thread only until published)
+    private val eventBatch = ArrayList<MappedAcousticEvent>()
+    private val _acousticEvents = MutableStateFlow<List<MappedAcousticEvent>>(emptyList())
+    /** Most recent acoustic events (up to [MAX_ACOUSTIC_EVENTS]), oldest first; empty without the event characteristic. */
+    val acousticEvents: StateFlow<List<MappedAcousticEvent>> = _acousticEvents.asStateFlow()
+
+    // Timed payloads carry the send delay of the previous packet, so that packet is held until the next arrives.
+    private var pendingTimedSeq = EspPacket.UNKNOWN
+    private var pendingTimedTUs = 0L
+    private var pendingTimedReceivedAtNs = 0L
+
+    // A broadcast beacon repeats each sample on several advertising channels/events; keep the first sighting
+    private var lastBroadcastSeq = EspPacket.UNKNOWN
+
+    // Decode state (decode thread only). The lane hands over the same scratch array while the payload
+    // length holds, so the little-endian view is rebuilt only when the length changes.
+    private var payloadArray: ByteArray? = null
+    private var payloadView: ByteBuffer = ByteBuffer.allocate(0)
+    private var decodeReceivedAtNs = 0L
+    private var decodedPrevSeq = EspPacket.UNKNOWN
+    private var decodedPrevSendDelayUs = EspPacket.UNKNOWN
+
+    // Decoded packets waiting for the next batched UI post; a drained batch is swapped for the spare the
+    // main thread hands back once it has copied the previous one into [packets]
+    private var uiBatch = PacketBatch()
+    private val spareUiBatch = AtomicReference<PacketBatch?>(PacketBatch())
+    private val recordSink = EspRecordSink { seq, tUs, prevSeq, prevSendDelayUs ->
+        uiBatch.add(seq, tUs, decodeReceivedAtNs)
+        decodedPrevSeq = prevSeq
+        decodedPrevSendDelayUs = prevSendDelayUs
+    }
+
+    private val lane = pipeline.openLane(
+        process = { value, receivedAtNs -> processPayload(value, receivedAtNs) },
+        onDrained = { publishBatch() },
+        onReset = { resetSyncState() }
+    )
+
+    // Round-trip responses get their own small lane so they never mix with sensor payload decoding
+    private val roundTripLane = pipeline.openLane(
+        capacity = 16,
+        maxPayloadLen = ESP_RTT_RESPONSE_LEN,
+        process = { value, receivedAtNs -> processRoundTrip(value, receivedAtNs) },
+        onDrained = { _roundTrip.value = roundTripSync.estimate(); onPublished(this) },
+        onReset = { roundTripSync.reset(); _roundTrip.value = RoundTripEstimate() }
+    )
+
+    // Event notifications are rare and small; their own lane keeps them out of the sensor lane's batches
+    private val eventLane = pipeline.openLane(
+        capacity = 16,
+        process = { value, receivedAtNs -> processEvents(value, receivedAtNs) },
+        onDrained = { publishEvents() },
+        onReset = { eventBatch.clear(); _acousticEvents.value = emptyList() }
+    )
+
+    init {
+        postToUi(Runnable { packets.clear() })
+    }
+
+    /** Stage one of the receive path. Call from the GATT or scan callback with the already-stamped value. */
+    fun submit(value: ByteArray, receivedAtNs: Long): Boolean = lane.submit(value, receivedAtNs)
+
+    /** Record the connection parameters read or notified from the beacon (any thread). */
+    fun updateConnParams(params: EspConnParams?) {
+        _connParams.value = params
+        onPublished(this)
+    }
+
+    /** Record a diagnostics snapshot read from the beacon (any thread). */
+    fun updateDiagnostics(diagnostics: EspDiagnostics?) {
+        if (diagnostics == null) return
+        val previous = _diagnostics.value?.takeIf { it.bootId == diagnostics.bootId }
+        _diagnostics.value = diagnostics.copy(sleepSkewPpm = diagnostics.sleepSkewPpmSince(previous))
+        val id = diagnostics.bootId
+        if (id != null && id != bootId) {
+            bootId = id
+            syncCache?.load(address, id, SystemClock.elapsedRealtimeNanos(), System.currentTimeMillis())
+                ?.let { pendingWarmStart.set(it) }
+        }
+        onPublished(this)
+    }
+
+    /** Record the detector settings read from the beacon (any thread). */
+    fun updateDetectorConfig(config: EspDetectorConfig?) {
+        if (config == null) return
+        _detectorConfig.value = config
+        onPublished(this)
+    }
+
+    /** Record the capabilities read from the beacon, or null for none (any thread). */
+    fun updateCapabilities(caps: EspCapabilities?) {
+        _capabilities.value = caps
+        onPublished(this)
+    }
+
+    /** Stage one for a round-trip notification (GATT callback, already stamped). */
+    fun submitRoundTrip(value: ByteArray, receivedAtNs: Long): Boolean = roundTripLane.submit(value, receivedAtNs)
+
+    /** Stage one for an acoustic event notification (GATT callback, already stamped). */
+    fun submitEvents(value: ByteArray, receivedAtNs: Long): Boolean = eventLane.submit(value, receivedAtNs)
+
+    /** Restart the fit and stats (e.g. on reconnect). Applied on the decode thread. */
+    fun reset() {
+        // Re-check the boot ID on the next diagnostics read, so a warm start is tried again
+        bootId = null
+        lane.reset()
+        roundTripLane.reset()
+        eventLane.reset()
+    }
+
+    /** Detach from the pipeline, cache the fit if it settled, and flush the packet history's spill file. */
+    internal fun close() {
+        saveFit()
+        lane.close()
+        roundTripLane.close()
+        eventLane.close()
+        recorder?.close()
+        postToUi(Runnable { packets.close() })
+    }
+
+    /**
+     * Beacon time to phone time through the newest published fit (beacon time in ns before the first). Past the
+     * newest sample the skew follows the beacon's temperature, once a thermal curve is learned. Any thread, lock-free.
+     */
+    fun mapBeaconToPhoneNs(beaconTimeUs: Long): Long = mapping.map(beaconTimeUs)
+
+    /**
+     * [mapBeaconToPhoneNs] of beaconTimesUs[from until to] into the same indices of [out], all through one snapshot
+     * even while the fit updates. Any thread, no allocation.
+     */
+    fun mapBeaconToPhoneNs(beaconTimesUs: LongArray, out: LongArray, from: Int = 0, to: Int = beaconTimesUs.size) =
+        mapping.map(beaconTimesUs, out, from, to)
+
+    // Runs on the decode thread (via lane.reset) so it never races updateCheepSync.
+    private fun resetSyncState() {
+        uiBatch.clear()
+        cheepSync.reset()
+        pendingTimedSeq = EspPacket.UNKNOWN
+        lastBroadcastSeq = EspPacket.UNKNOWN
+        fit = null
+        warmFit = null
+        fitSettled = false
+        _cheepSyncAlpha.value = 0.0
+        _cheepSyncBeta.value = 1.0
+        _cheepSyncRmsResidualMs.value = 0.0
+        fitSampleCount = 0
+        resetWindowTemperature()
+        _beaconTemperatureC.value = Double.NaN
+        residualHistory.reset()
+        skewHistory.reset()
+        syncStatsAccumulator.reset()
+        _syncStats.value = SyncStats()
+        lossTracker.reset()
+        lastAcceptedTUs = EspPacket.UNKNOWN
+        _lossStats.value = LossStats()
+        onPublished(this)
+    }
+
+    /**
+     * Add a (tb, Tr) sample and recompute α, β via least-squares over a sliding window.
+     *
+     * This matches the paper’s “continuous skew adjustments over a measurement window”
+     * using linear regression for frequency (β) and phase/offset (α).
+     */
+    private fun updateCheepSync(seq: Long, tUs: Long, receivedAtNs: Long, prevSeq: Long, prevSendDelayUs: Long) {
+        if (prevSeq == EspPacket.UNKNOWN) {
+            addFitSample(tUs, receivedAtNs)
+        } else {
+            // Timed payload: shift the previous sample's beacon time to when it left the beacon's host stack
+            val heldSeq = pendingTimedSeq
+            val heldTUs = pendingTimedTUs
+            val heldReceivedAtNs = pendingTimedReceivedAtNs
+            pendingTimedSeq = seq
+            pendingTimedTUs = tUs
+            pendingTimedReceivedAtNs = receivedAtNs
+            if (heldSeq == EspPacket.UNKNOWN || heldSeq != prevSeq || prevSendDelayUs == EspPacket.UNKNOWN) return
+            addFitSample(heldTUs + prevSendDelayUs, heldReceivedAtNs)
+        }
+        _cheepSyncAlpha.value = cheepSync.alpha
+        _cheepSyncBeta.value = cheepSync.beta
+        _cheepSyncRmsResidualMs.value = cheepSync.rmsResidualMs
+        fitSampleCount = cheepSync.sampleCount
+    }
+
+    // After the fit has taken the newest record: pair the window's mean temperature with its β once the
+    // window is this connection's own, then carry the fit past tUs at β of the current temperature.
+    private fun updateThermalSkew(tUs: Long, temperatureC: Double) {
+        if (windowTemperatureCount == FIT_WINDOW_SIZE) windowTemperatureSum -= windowTemperatureC[windowTemperatureNext]
+        else windowTemperatureCount++
+        windowTemperatureC[windowTemperatureNext] = temperatureC
+        windowTemperatureSum += temperatureC
+        windowTemperatureNext = (windowTemperatureNext + 1) % FIT_WINDOW_SIZE
+        if (fitSettled && warmFit == null && windowTemperatureCount == FIT_WINDOW_SIZE) {
+            thermalSkew.add(windowTemperatureSum / FIT_WINDOW_SIZE, cheepSync.beta)
+        }
+        val f = fit
+        val curve = thermalSkew.curve()
+        // The fit carried past its newest sample at β of the latest temperature
+        mapping = PhoneMapping(f, if (f != null && curve != null && curve.degree > 0) curve.extrapolate(f, tUs, temperatureC) else null)
+    }
+
+    private fun resetWindowTemperature() {
+        windowTemperatureCount = 0
+        windowTemperatureNext = 0
+        windowTemperatureSum = 0.0
+        mapping = PhoneMapping(fit, null)
+    }
+
+    private fun addFitSample(tUs: Long, receivedAtNs: Long) {
+        cheepSync.addSample(tUs, receivedAtNs)
+        val warm = warmFit
+        if (warm != null && cheepSync.sampleCount < FIT_WINDOW_SIZE) {
+            // Keep the cached skew and move the offset down to the earliest arrival since reconnect: the
+            // cached line was the lower envelope, so that shift is how far the offset drifted meanwhile.
+            val residualNs = (receivedAtNs - warm.mapBeaconToReceiverNs(tUs)).toDouble()
+            if (residualNs < warmMinResidualNs) {
+                warmMinResidualNs = residualNs
+                fit = warm.copy(alpha = warm.alpha + residualNs)
+            }
+            return
+        }
+        warmFit = null
+        if (cheepSync.hasFit) fit = cheepSync.getFit()
+        if (cheepSync.sampleCount >= FIT_WINDOW_SIZE) fitSettled = true
+    }
+
+    // Decode thread. Not once this connection has its own full window: that beats a cached one.
+    private fun applyWarmStart(entry: CachedSync) {
+        if (fitSettled) return
+        warmFit = entry.fit
+        warmMinResidualNs = Double.MAX_VALUE
+        fit = entry.fit
+        Log.i(
+            "ESP32",
+            "[$address] Warm start from cached fit (${entry.sampleCount} samples, rms %.3f ms)".format(entry.rmsResidualMs)
+        )
+    }
+
+    // Main thread, on close. fitSettled means the fit is a full window of this boot's samples.
+    private fun saveFit() {
+        val cache = syncCache ?: return
+        val id = bootId ?: return
+        val f = fit
+        if (!fitSettled || f == null) return
+        cache.store(
+            address,
+            CachedSync(
+                bootId = id,
+                fit = f,
+                rmsResidualMs = _cheepSyncRmsResidualMs.value,
+                sampleCount = FIT_WINDOW_SIZE,
+                savedAtElapsedNs = SystemClock.elapsedRealtimeNanos(),
+                savedAtWallMs = System.currentTimeMillis()
+            )
+        )
+    }
+
+    // Stage two of the receive path (decode thread): decode straight into the UI batch columns, then fit,
+    // accumulate stats and record from there. No per-packet objects.
+    private fun processPayload(value: ByteArray, receivedAtNs: Long) {
+        if (value !== payloadArray) {
+            payloadArray = value
+            payloadView = ByteBuffer.wrap(value).order(ByteOrder.LITTLE_ENDIAN)
+        }
+        pendingWarmStart.getAndSet(null)?.let { applyWarmStart(it) }
+        val first = uiBatch.size
+        decodeReceivedAtNs = receivedAtNs
+        decodedPrevSeq = EspPacket.UNKNOWN
+        decodedPrevSendDelayUs = EspPacket.UNKNOWN
+        if (decodeEspPayloadInto(payloadView, recordSink) == 0) {
+            // A relay advertises unsynced until it has a parent: expected, and on every advertisement
+            if (!isEspUnsyncedRootTime(payloadView)) {
+                Log.w("ESP32", "[$address] Unrecognized payload (${value.size} bytes)")
+            }
+            return
+        }
+        val version = value[0].toInt() and 0xFF
+        if ((version == ESP_PAYLOAD_VERSION_BEACON && value.size == ESP_BEACON_PAYLOAD_LEN) ||
+            (version == ESP_PAYLOAD_VERSION_ROOT_TIME && value.size == ESP_ROOT_TIME_PAYLOAD_LEN)
+        ) {
+            val seq = uiBatch.seqAt(first)
+            if (seq == lastBroadcastSeq) {
+                uiBatch.truncate(first)
+                return
+            }
+            lastBroadcastSeq = seq
+        }
+
+        // Sequence accounting; duplicates are compacted out so they reach neither the fit, the stats nor the UI
+        var kept = first
+        var newestKept = true
+        for (i in first until uiBatch.size) {
+            val seq = uiBatch.seqAt(i)
+            val tUs = uiBatch.tUsAt(i)
+            when (lossTracker.add(seq)) {
+                SeqEvent.DUPLICATE -> {
+                    newestKept = false
+                    continue
+                }
+                // Beacon rebooted (or its counter restarted): the old fit describes another clock epoch
+                SeqEvent.RESTART -> {
+                    restartFit()
+                    // New clock epoch: beacon times start over, and the charts are keyed by them
+                    residualHistory.reset()
+                    skewHistory.reset()
+                }
+                // A long outage: the window's samples predate drift the fit can no longer follow
+                SeqEvent.GAP -> if (lastAcceptedTUs != EspPacket.UNKNOWN && tUs - lastAcceptedTUs > STALE_FIT_GAP_US) {
+                    Log.i("ESP32", "[$address] ${lossTracker.lastGapLength} packets lost, restarting fit")
+                    restartFit()
+                }
+                else -> {}
+            }
+            if (kept != i) uiBatch.set(kept, seq, tUs, receivedAtNs)
+            kept++
+            newestKept = true
+            if (tUs > lastAcceptedTUs) lastAcceptedTUs = tUs
+        }
+        uiBatch.truncate(kept)
+        if (kept == first) return
+
+        // Only the newest record is stamped right before the send, so only it pairs with receivedAtNs
+        // (not if the newest was a duplicate: another copy already carried its stamp).
+        val last = kept - 1
+        if (newestKept) {
+            updateCheepSync(uiBatch.seqAt(last), uiBatch.tUsAt(last), receivedAtNs, decodedPrevSeq, decodedPrevSendDelayUs)
+            fit?.let { f ->
+                val tUs = uiBatch.tUsAt(last)
+                residualHistory.add(tUs, (receivedAtNs - f.mapBeaconToReceiverNs(tUs)) / 1_000_000.0)
+                skewHistory.add(tUs, (f.beta - 1.0) * 1e6)
+            }
+            val temperatureC = espPayloadTemperatureC(payloadView)
+            if (!temperatureC.isNaN()) {
+                updateThermalSkew(uiBatch.tUsAt(last), temperatureC)
+                _beaconTemperatureC.value = temperatureC
+            }
+        }
+        val alpha = cheepSync.alpha
+        val beta = cheepSync.beta
+        val r = recorder
+        for (i in first..last) {
+            val seq = uiBatch.seqAt(i)
+            val tUs = uiBatch.tUsAt(i)
+            r?.record(seq, tUs, receivedAtNs, if (i == last) fit else null)
+            syncStatsAccumulator.add(seq, tUs, receivedAtNs, alpha, beta)
+        }
+    }
+
+    // Keep the stats and history; only the fit starts over
+    private fun restartFit() {
+        cheepSync.reset()
+        fitSampleCount = 0
+        resetWindowTemperature()
+        pendingTimedSeq = EspPacket.UNKNOWN
+        fit = null
+        warmFit = null
+        fitSettled = false
+    }
+
+    private fun processRoundTrip(value: ByteArray, receivedAtNs: Long) {
+        val rt = decodeEspRoundTrip(value, receivedAtNs) ?: return
+        if (!roundTripSync.addExchange(rt.phoneSendNs, rt.beaconRxUs, rt.beaconTxUs, rt.phoneRxNs)) {
+            Log.w("ESP32", "[$address] Inconsistent round trip dropped")
+        }
+    }
+
+    private fun processEvents(value: ByteArray, receivedAtNs: Long) {
+        val events = decodeEspAcousticEvents(value, receivedAtNs)
+        if (events.isEmpty()) {
+            Log.w("ESP32", "[$address] Unrecognized event payload (${value.size} bytes)")
+            return
+        }
+        // The fit is only as good as it is now; a later refit does not move events already mapped
+        val f = fit
+        for (e in events) eventBatch.add(MappedAcousticEvent(e, f?.mapBeaconToReceiverNs(e.tUs)))
+    }
+
+    private fun publishEvents() {
+        if (eventBatch.isEmpty()) return
+        _acousticEvents.value = (_acousticEvents.value + eventBatch).takeLast(MAX_ACOUSTIC_EVENTS)
+        eventBatch.clear()
+        onPublished(this)
+    }
+
+    // One StateFlow write and one UI post per drained batch, not per packet.
+    private fun publishBatch() {
+        _syncStats.value = syncStatsAccumulator.snapshot()
+        _lossStats.value = lossTracker.snapshot()
+        _thermalSkewCurve.value = thermalSkew.curve()
+        onPublished(this)
+        if (uiBatch.size == 0) return
+        val batch = uiBatch
+        // Main thread still copying the last one: start another rather than wait
+        uiBatch = spareUiBatch.getAndSet(null) ?: PacketBatch()
+        postToUi(Runnable {
+            packets.addAll(batch)
+            val newest = batch.size - 1
+            onPacket(this, EspPacket(batch.seqAt(newest), batch.tUsAt(newest), batch.receivedAtNsAt(newest)))
+            batch.clear()
+            spareUiBatch.set(batch)
+        })
+    }
+
+    companion object {
+        const val MAX_ACOUSTIC_EVENTS = 50
+        /** Gap in beacon time after which the fit window is considered stale and restarted. */
+        const val STALE_FIT_GAP_US = 30_000_000L
+        private const val FIT_WINDOW_SIZE = CheepSync.DEFAULT_WINDOW_SIZE
+    }
+}
+
+// The fit, and past its newest sample the thermal extension of that same fit. Immutable and published as one
+// reference, so a reader never pairs one update's fit with another's extension, nor sees a fit mid-update.
+private class PhoneMapping(fit: SyncFit?, private val thermal: SyncFit?) {
+    private val fit = fit ?: UNMAPPED
+
+    fun map(beaconTimeUs: Long): Long =
+        if (thermal != null && beaconTimeUs > thermal.beaconEpochUs) thermal.mapBeaconToReceiverNs(beaconTimeUs)
+        else fit.mapBeaconToReceiverNs(beaconTimeUs)
+
+    fun map(beaconTimesUs: LongArray, out: LongArray, from: Int, to: Int) {
+        if (thermal == null) {
+            fit.mapBeaconToReceiverNs(beaconTimesUs, out, from, to)
+            return
+        }
+        require(from in 0..to && to <= beaconTimesUs.size && to <= out.size) { "range $from..$to outside the arrays" }
+        for (i in from until to) out[i] = map(beaconTimesUs[i])
+    }
+
+    private companion object {
+        // No fit yet: beacon time, in ns
+        val UNMAPPED = SyncFit(alpha = 0.0, beta = 1.0)
+    }
+}
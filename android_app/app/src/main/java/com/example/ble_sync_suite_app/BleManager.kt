@@ -1,6 +1,6 @@
 package com.example.ble_sync_suite_app
 
-// BLE Manager: BLE scan, connect, GATT, and CheepSync. Sync math is in sync/CheepSync.kt.
+// BLE Manager: BLE scan, connect, GATT, and one BeaconSession per connected beacon. Sync math is in sync/CheepSync.kt.
 
 import android.annotation.SuppressLint
 import android.bluetooth.BluetoothDevice
@@ -10,69 +10,346 @@ import android.bluetooth.BluetoothGattCharacteristic
 import android.bluetooth.BluetoothGattDescriptor
 import android.bluetooth.BluetoothManager
 import android.bluetooth.BluetoothProfile
+import android.bluetooth.BluetoothStatusCodes
 import android.bluetooth.le.BluetoothLeScanner
 import android.bluetooth.le.ScanCallback
+import android.bluetooth.le.ScanFilter
 import android.bluetooth.le.ScanResult
 import android.bluetooth.le.ScanSettings
 import android.content.Context
 import android.os.Build
 import android.os.Handler
 import android.os.Looper
+import android.os.ParcelUuid
 import android.os.SystemClock
 import android.util.Log
 import android.widget.Toast
-import androidx.activity.ComponentActivity
 import androidx.annotation.RequiresPermission
-import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.LossStats
+import com.example.ble_sync_suite_app.sync.RoundTripEstimate
+import com.example.ble_sync_suite_app.sync.SeriesPyramid
+import com.example.ble_sync_suite_app.sync.SyncStats
+import com.example.ble_sync_suite_app.sync.ThermalSkewCurve
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
-
+import java.io.File
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Owned by SyncService, so connections, decode and fit outlive the activity (screen off, UI in the
+ * background). The UI reads the StateFlows below and attaches a [Listener] while it is shown.
+ */
 class BleManager(
-    private val activity: ComponentActivity,
+    private val context: Context,
     private val hasScanPermission: () -> Boolean,
-    private val hasConnectPermission: () -> Boolean,
-    private val onDeviceFound: (String) -> Unit,
-    private val onConnected: (String) -> Unit,
-    private val onDisconnected: () -> Unit,
-    private val onCharacteristicsDiscovered: (List<CharacteristicInfo>) -> Unit,
-    private val onPacketReceived: (EspPacket) -> Unit
+    private val hasConnectPermission: () -> Boolean
 ) {
-    private val bluetoothManager = activity.getSystemService(Context.BLUETOOTH_SERVICE) as? BluetoothManager
+    /** UI hooks, all called on the main thread. Every method is optional. */
+    interface Listener {
+        /** At most every SCAN_UI_INTERVAL_MS while scanning: every device heard, strongest first. */
+        fun onDevicesUpdated(devices: List<ScannedDevice>) {}
+        fun onConnected(name: String) {}
+        /** The last session closed. */
+        fun onDisconnected() {}
+        fun onCharacteristicsDiscovered(list: List<CharacteristicInfo>) {}
+        /** Newest packet of each batch from the primary session. */
+        fun onPacketReceived(packet: EspPacket) {}
+    }
+
+    /** Attached by the activity while it exists; null while no UI is shown (the service keeps running). Main thread. */
+    var listener: Listener? = null
+
+    // Main-thread work (packet history, UI hooks) goes through the looper, not an activity
+    private val mainHandler = Handler(Looper.getMainLooper())
+
+    private val bluetoothManager = context.getSystemService(Context.BLUETOOTH_SERVICE) as? BluetoothManager
     private val bluetoothAdapter = bluetoothManager?.adapter
     private var bluetoothLeScanner: BluetoothLeScanner? = null
 
-    var bluetoothGatt: BluetoothGatt? = null
-        private set
+    // One session per connected beacon (address → session). Decode/fit for all of them share one pipeline thread.
+    private val pipeline = PacketPipeline()
+    private val sessions = ConcurrentHashMap<String, BeaconSession>()
+    // Last settled fit per beacon, so a reconnect without a beacon reboot starts warm
+    private val syncCache = SyncCache(File(context.filesDir, "sync_cache"))
+    private val _connectedSessions = MutableStateFlow<List<BeaconSession>>(emptyList())
+    /** Sessions that are connecting, connected, or heard broadcasting (connectionless), in order of creation. */
+    val connectedSessions: StateFlow<List<BeaconSession>> = _connectedSessions.asStateFlow()
+
+    // The session the single-device screens follow: the most recently connected one.
+    @Volatile
+    private var primaryAddress: String? = null
+    private val primary: BeaconSession? get() = primaryAddress?.let { sessions[it] }
 
-    // CheepSync: delegated to sync.CheepSync (standalone module, no BLE dependency)
-    private val cheepSync = CheepSync(windowSize = CheepSync.DEFAULT_WINDOW_SIZE)
+    /** GATT of the primary session (the one the data/stats screens show). */
+    val bluetoothGatt: BluetoothGatt? get() = primary?.gatt
 
+    // Mirrors of the primary session's flows, so the single-device screens need not switch flows.
     private val _cheepSyncAlpha = MutableStateFlow(0.0)
     private val _cheepSyncBeta = MutableStateFlow(1.0)
     val cheepSyncAlpha: StateFlow<Double> = _cheepSyncAlpha.asStateFlow()
     val cheepSyncBeta: StateFlow<Double> = _cheepSyncBeta.asStateFlow()
     private val _cheepSyncRmsResidualMs = MutableStateFlow(0.0)
     val cheepSyncRmsResidualMs: StateFlow<Double> = _cheepSyncRmsResidualMs.asStateFlow()
+    private val _syncStats = MutableStateFlow(SyncStats())
+    val syncStats: StateFlow<SyncStats> = _syncStats.asStateFlow()
+    private val _connParams = MutableStateFlow<EspConnParams?>(null)
+    /** Negotiated connection parameters of the primary session, as reported by the beacon. */
+    val connParams: StateFlow<EspConnParams?> = _connParams.asStateFlow()
+
+    private val _roundTrip = MutableStateFlow(RoundTripEstimate())
+    /** Round-trip estimate of the primary session. */
+    val roundTrip: StateFlow<RoundTripEstimate> = _roundTrip.asStateFlow()
+
+    private val _diagnostics = MutableStateFlow<EspDiagnostics?>(null)
+    /** Firmware diagnostics of the primary session (polled every DIAGNOSTICS_POLL_TICKS round-trip ticks). */
+    val diagnostics: StateFlow<EspDiagnostics?> = _diagnostics.asStateFlow()
+
+    private val _acousticEvents = MutableStateFlow<List<MappedAcousticEvent>>(emptyList())
+    /** Recent acoustic events of the primary session, on the phone clock. */
+    val acousticEvents: StateFlow<List<MappedAcousticEvent>> = _acousticEvents.asStateFlow()
+
+    private val _lossStats = MutableStateFlow(LossStats())
+    /** Sequence gaps, late arrivals and duplicates of the primary session's sensor stream. */
+    val lossStats: StateFlow<LossStats> = _lossStats.asStateFlow()
+
+    private val _detectorConfig = MutableStateFlow<EspDetectorConfig?>(null)
+    /** Onset detector settings of the primary session; null if its firmware has no detector characteristic. */
+    val detectorConfig: StateFlow<EspDetectorConfig?> = _detectorConfig.asStateFlow()
+
+    private val _capabilities = MutableStateFlow<EspCapabilities?>(null)
+    /** Stream layout and negotiated format of the primary session; null if its firmware predates capabilities. */
+    val capabilities: StateFlow<EspCapabilities?> = _capabilities.asStateFlow()
+
+    private val _residualHistory = MutableStateFlow<SeriesPyramid?>(null)
+    /** Residual chart history of the primary session (the same object while it stays primary). */
+    val residualHistory: StateFlow<SeriesPyramid?> = _residualHistory.asStateFlow()
+
+    private val _skewHistory = MutableStateFlow<SeriesPyramid?>(null)
+    /** Skew chart history of the primary session. */
+    val skewHistory: StateFlow<SeriesPyramid?> = _skewHistory.asStateFlow()
+
+    private val _beaconTemperatureC = MutableStateFlow(Double.NaN)
+    /** Die temperature the primary session's beacon last reported (°C); NaN without thermal payloads. */
+    val beaconTemperatureC: StateFlow<Double> = _beaconTemperatureC.asStateFlow()
+
+    private val _thermalSkewCurve = MutableStateFlow<ThermalSkewCurve?>(null)
+    /** Skew vs temperature learned for the primary session's beacon. */
+    val thermalSkewCurve: StateFlow<ThermalSkewCurve?> = _thermalSkewCurve.asStateFlow()
+
+    private fun mirrorIfPrimary(session: BeaconSession) {
+        if (session.address != primaryAddress) return
+        _cheepSyncAlpha.value = session.cheepSyncAlpha.value
+        _cheepSyncBeta.value = session.cheepSyncBeta.value
+        _cheepSyncRmsResidualMs.value = session.cheepSyncRmsResidualMs.value
+        _syncStats.value = session.syncStats.value
+        _lossStats.value = session.lossStats.value
+        _connParams.value = session.connParams.value
+        _roundTrip.value = session.roundTrip.value
+        _diagnostics.value = session.diagnostics.value
+        _acousticEvents.value = session.acousticEvents.value
+        _detectorConfig.value = session.detectorConfig.value
+        _capabilities.value = session.capabilities.value
+        _residualHistory.value = session.residualHistory
+        _skewHistory.value = session.skewHistory
+        _beaconTemperatureC.value = session.beaconTemperatureC.value
+        _thermalSkewCurve.value = session.thermalSkewCurve.value
+    }
+
+    private fun setPrimary(session: BeaconSession?) {
+        primaryAddress = session?.address
+        if (session != null) {
+            mirrorIfPrimary(session)
+        } else {
+            _cheepSyncAlpha.value = 0.0
+            _cheepSyncBeta.value = 1.0
+            _cheepSyncRmsResidualMs.value = 0.0
+            _syncStats.value = SyncStats()
+            _lossStats.value = LossStats()
+            _connParams.value = null
+            _roundTrip.value = RoundTripEstimate()
+            _diagnostics.value = null
+            _acousticEvents.value = emptyList()
+            _detectorConfig.value = null
+            _capabilities.value = null
+            _residualHistory.value = null
+            _skewHistory.value = null
+            _beaconTemperatureC.value = Double.NaN
+            _thermalSkewCurve.value = null
+        }
+    }
 
-    private fun resetCheepSync() {
-        cheepSync.reset()
-        _cheepSyncAlpha.value = 0.0
-        _cheepSyncBeta.value = 1.0
-        _cheepSyncRmsResidualMs.value = 0.0
+    /** Session for a beacon address, or null if not connected. */
+    fun session(address: String): BeaconSession? = sessions[address]
+
+    // makePrimary=false for broadcast beacons heard while scanning, so they do not take over the screens
+    private fun openSession(address: String, makePrimary: Boolean = true): BeaconSession {
+        sessions[address]?.let { if (makePrimary) setPrimary(it); return it }
+        val session = BeaconSession(
+            address = address,
+            pipeline = pipeline,
+            spillFile = File(context.cacheDir, "packet_history_${address.replace(":", "")}.bin"),
+            recordFile = newRecordingFile(address),
+            syncCache = syncCache,
+            postToUi = { mainHandler.post(it) },
+            onPacket = { s, packet -> if (s.address == primaryAddress) listener?.onPacketReceived(packet) },
+            onPublished = { mirrorIfPrimary(it) }
+        )
+        sessions[address] = session
+        _connectedSessions.value = _connectedSessions.value + session
+        if (makePrimary || primaryAddress == null) setPrimary(session)
+        return session
+    }
+
+    /** Directory holding session captures (SessionLog format, one file per session). */
+    val recordingsDir: File get() = File(context.filesDir, "sessions")
+
+    // New capture file for a session; prunes the oldest so at most MAX_RECORDINGS are kept
+    private fun newRecordingFile(address: String): File? {
+        val dir = recordingsDir
+        if (!dir.isDirectory && !dir.mkdirs()) {
+            Log.e("BLE", "Cannot create $dir; session not recorded")
+            return null
+        }
+        dir.listFiles { f -> f.name.endsWith(RECORDING_SUFFIX) }
+            ?.sortedBy { it.lastModified() }
+            ?.dropLast(MAX_RECORDINGS - 1)
+            ?.forEach { it.delete() }
+        return File(dir, "${address.replace(":", "")}_${System.currentTimeMillis()}$RECORDING_SUFFIX")
     }
 
+    // Exports run one capture at a time on their own low-priority thread
+    private val exporter = SessionExporter()
+
+    /** Where exports are written: app-specific external storage (adb pull or MTP, no permission), else internal. */
+    val exportsDir: File get() = context.getExternalFilesDir(EXPORTS_DIR) ?: File(context.filesDir, EXPORTS_DIR)
+
     /**
-     * Add a (tb, Tr) sample and recompute α, β via least-squares over a sliding window.
-     *
-     * This matches the paper’s “continuous skew adjustments over a measurement window”
-     * using linear regression for frequency (β) and phase/offset (α). :contentReference[oaicite:2]{index=2}
+     * Export every capture in [recordingsDir] as [format] into [exportsDir], in the background. Captures
+     * already exported since they last changed are skipped; sessions still recording export what is on disk.
+     * [onDone] runs on the main thread with how many captures are now exported, and how many there were.
+     */
+    fun exportRecordings(format: ExportFormat, onDone: (exported: Int, total: Int) -> Unit) {
+        val dir = exportsDir
+        val captures = recordingsDir.listFiles { f -> f.name.endsWith(RECORDING_SUFFIX) }?.toList().orEmpty()
+        val pending = captures.filter { c -> format.fileFor(c, dir).let { !it.exists() || it.lastModified() < c.lastModified() } }
+        val exported = AtomicInteger(captures.size - pending.size)
+        if (pending.isEmpty()) {
+            mainHandler.post { onDone(exported.get(), captures.size) }
+            return
+        }
+        val remaining = AtomicInteger(pending.size)
+        for (capture in pending) {
+            exporter.submit(capture, dir, format) { file, e ->
+                if (file != null) exported.incrementAndGet() else Log.w("BLE", "Export of ${capture.name} failed", e)
+                if (remaining.decrementAndGet() == 0) mainHandler.post { onDone(exported.get(), captures.size) }
+            }
+        }
+    }
+
+    // Periodic GATT ops on the main looper: a round-trip request per session every ROUND_TRIP_PERIOD_MS, and
+    // every DIAGNOSTICS_POLL_TICKS ticks a diagnostics read half a period later, clear of the write. Every
+    // RATE_FEEDBACK_TICKS ticks, on another tick, the fit quality goes to the rate-control characteristic instead.
+    // Both are offered to the link's op queue and skip a turn while it is busy, rather than queue up stale.
+    // Posted with the session as token: Handler matches tokens by identity, which address strings do not keep.
+    private val roundTripHandler = Handler(Looper.getMainLooper())
+
+    @SuppressLint("MissingPermission")
+    private fun startRoundTrips(address: String) {
+        val session = sessions[address] ?: return
+        val tick = object : Runnable {
+            private var ticks = 0L
+
+            override fun run() {
+                if (sessions[address] !== session) return
+                // A new link restarts the ticker when its setup is done
+                val link = session.link ?: return
+                if (link.state != LinkState.READY) return
+                val ops = link.ops ?: return
+                val handles = link.handles ?: return
+                // Older firmware without round trips: still tick, for the diagnostics poll
+                if (hasConnectPermission()) handles.roundTrip?.let { ops.offer(roundTripRequestOp(it)) }
+                val tick = ticks++
+                if (tick % DIAGNOSTICS_POLL_TICKS == 0L) {
+                    roundTripHandler.postAtTime({
+                        if (session.link === link && hasConnectPermission()) handles.diagnostics?.let { ops.offer(readOp(it)) }
+                    }, session, SystemClock.uptimeMillis() + ROUND_TRIP_PERIOD_MS / 2)
+                } else if (tick % RATE_FEEDBACK_TICKS == 1L) {
+                    handles.rateControl?.let { rate ->
+                        roundTripHandler.postAtTime({
+                            if (session.link === link && hasConnectPermission()) ops.offer(rateFeedbackOp(rate, session))
+                        }, session, SystemClock.uptimeMillis() + ROUND_TRIP_PERIOD_MS / 2)
+                    }
+                }
+                // Re-post under the session token so closeSession's removeCallbacksAndMessages stops it
+                roundTripHandler.postAtTime(this, session, SystemClock.uptimeMillis() + ROUND_TRIP_PERIOD_MS)
+            }
+        }
+        roundTripHandler.removeCallbacksAndMessages(session)
+        roundTripHandler.postAtTime(tick, session, SystemClock.uptimeMillis())
+    }
+
+    // Stamp t1 as late as possible: when the queue issues the write, not when it is offered.
+    // Write-without-response so no ATT response sits on the path.
+    @SuppressLint("MissingPermission")
+    private fun roundTripRequestOp(rtt: BluetoothGattCharacteristic) = GattOp(GattOp.Kind.WRITE, rtt.uuid, { gatt ->
+        val value = encodeEspRoundTripRequest(SystemClock.elapsedRealtimeNanos())
+        writeCharacteristicValue(gatt, rtt, value, BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE)
+    })
+
+    // The fit as of issuing, not offering. Firmware without SENSOR_ADAPTIVE_RATE has no such characteristic.
+    @SuppressLint("MissingPermission")
+    private fun rateFeedbackOp(rate: BluetoothGattCharacteristic, session: BeaconSession) =
+        GattOp(GattOp.Kind.WRITE, rate.uuid, { gatt ->
+            val value = encodeEspRateFeedback(session.cheepSyncRmsResidualMs.value, session.fitSampleCount)
+            writeCharacteristicValue(gatt, rate, value, BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE)
+        })
+
+    // The beacon refuses formats it does not have; the stream then stays in its default
+    @SuppressLint("MissingPermission")
+    private fun selectFormatOp(session: BeaconSession, caps: BluetoothGattCharacteristic, format: Int) =
+        GattOp(GattOp.Kind.WRITE, caps.uuid, { gatt ->
+            writeCharacteristicValue(gatt, caps, byteArrayOf(format.toByte()), BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT)
+        }) { status ->
+            if (status == BluetoothGatt.GATT_SUCCESS) Log.i("BLE", "[${session.address}] Sensor format ${espFormatName(format)}")
+            else Log.w("BLE", "[${session.address}] Sensor format ${espFormatName(format)} refused (status $status)")
+        }
+
+    // Result arrives in onCharacteristicRead
+    @SuppressLint("MissingPermission")
+    private fun readOp(char: BluetoothGattCharacteristic) =
+        GattOp(GattOp.Kind.READ, char.uuid, { gatt -> gatt.readCharacteristic(char) })
+
+    // setCharacteristicNotification is local; the CCCD write is what the queue waits for
+    @SuppressLint("MissingPermission")
+    private fun notificationsOp(char: BluetoothGattCharacteristic, enable: Boolean = true): GattOp? {
+        val cccd = char.getDescriptor(CLIENT_CONFIG_DESCRIPTOR_UUID) ?: return null
+        val value = if (enable) BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE else BluetoothGattDescriptor.DISABLE_NOTIFICATION_VALUE
+        return GattOp(GattOp.Kind.DESCRIPTOR_WRITE, char.uuid, { gatt ->
+            gatt.setCharacteristicNotification(char, enable) && writeClientConfigValue(gatt, cccd, value)
+        }) { status ->
+            if (status != BluetoothGatt.GATT_SUCCESS) Log.e("BLE", "Descriptor write for ${char.uuid} failed (status $status)")
+        }
+    }
+
+    private fun closeSession(address: String) {
+        val session = sessions.remove(address) ?: return
+        roundTripHandler.removeCallbacksAndMessages(session)
+        session.link?.close()
+        session.close()
+        _connectedSessions.value = _connectedSessions.value - session
+        if (address == primaryAddress) setPrimary(_connectedSessions.value.lastOrNull())
+    }
+
+    /**
+     * Map a timestamp from beacon [fromAddress]'s clock to beacon [toAddress]'s clock through the phone timeline.
+     * Returns null if either beacon is not connected or does not have a fit yet.
      */
-    private fun updateCheepSync(packet: EspPacket) {
-        cheepSync.addSample(packet.tUs, packet.receivedAtNs)
-        _cheepSyncAlpha.value = cheepSync.alpha
-        _cheepSyncBeta.value = cheepSync.beta
-        _cheepSyncRmsResidualMs.value = cheepSync.rmsResidualMs
+    fun mapBeaconToBeaconUs(fromAddress: String, beaconTimeUs: Long, toAddress: String): Long? {
+        val from = sessions[fromAddress]?.fit ?: return null
+        val to = sessions[toAddress]?.fit ?: return null
+        return from.mapToBeaconUs(beaconTimeUs, to)
     }
 
     /**
@@ -80,29 +357,89 @@ class BleManager(
      *   T_hat_phone_ns = α + β * tb_ns
      *
      * This is the “use the estimated skew+offset to coordinate time” step. :contentReference[oaicite:3]{index=3}
+     * Uses the primary session's fit; see [session] for a specific beacon.
      */
     fun mapBeaconToPhoneNs(beaconTimeUs: Long): Long =
-        cheepSync.mapBeaconToReceiverNs(beaconTimeUs)
+        primary?.mapBeaconToPhoneNs(beaconTimeUs) ?: beaconTimeUs * 1000
+
+    /** Batch form of [mapBeaconToPhoneNs]: beaconTimesUs[from until to] into [out], through one fit snapshot. Any thread. */
+    fun mapBeaconToPhoneNs(beaconTimesUs: LongArray, out: LongArray, from: Int = 0, to: Int = beaconTimesUs.size) {
+        val session = primary
+        if (session != null) {
+            session.mapBeaconToPhoneNs(beaconTimesUs, out, from, to)
+        } else {
+            for (i in from until to) out[i] = beaconTimesUs[i] * 1000
+        }
+    }
 
     /**
      * Convenience: estimate current one-way delay-like residual for the most recent packet.
      * (Not the paper’s low-level event “best fit” selection; just a sanity metric.)
      */
     fun estimateLatestResidualMs(packet: EspPacket): Double =
-        cheepSync.residualMs(packet.tUs, packet.receivedAtNs)
+        (packet.receivedAtNs - mapBeaconToPhoneNs(packet.tUs)) / 1_000_000.0
 
     // -----------------------------
     // BLE scanning
     // -----------------------------
+    // Scan callbacks arrive on the main thread. Reports only update the index; the UI gets a snapshot at most
+    // every SCAN_UI_INTERVAL_MS, however many advertisers are nearby.
+    private val scanIndex = ScanIndex()
+    private val scanUiHandler = Handler(Looper.getMainLooper())
+    private var scanPublishPending = false
+    private val publishScanResults = Runnable {
+        scanPublishPending = false
+        if (scanIndex.dirty) listener?.onDevicesUpdated(scanIndex.snapshot())
+    }
+
     private val bleScanCallback = object : ScanCallback() {
-        @SuppressLint("MissingPermission")
         override fun onScanResult(callbackType: Int, result: ScanResult) {
             super.onScanResult(callbackType, result)
             if (!hasConnectPermission()) return
-            val name = result.device.name ?: "Unnamed"
-            val addr = result.device.address
-            val display = "$name [$addr]"
-            activity.runOnUiThread { onDeviceFound(display) }
+            onReport(result)
+            scheduleScanPublish()
+        }
+
+        // ESP32_BATCHED: the controller's batch, oldest first
+        override fun onBatchScanResults(results: MutableList<ScanResult>) {
+            super.onBatchScanResults(results)
+            if (!hasConnectPermission()) return
+            for (result in results) onReport(result)
+            scheduleScanPublish()
+        }
+
+        @SuppressLint("MissingPermission")
+        private fun onReport(result: ScanResult) {
+            val name = result.scanRecord?.deviceName ?: result.device.name
+            val address = result.device.address
+            scanIndex.update(address, name, result.rssi, result.timestampNanos)
+            submitBroadcast(result, name ?: ScanIndex.UNNAMED)
+        }
+
+        private fun scheduleScanPublish() {
+            if (scanPublishPending) return
+            scanPublishPending = true
+            scanUiHandler.postDelayed(publishScanResults, SCAN_UI_INTERVAL_MS)
+        }
+
+        // Connectionless beacon: the sample rides in manufacturer data; timestampNanos is the
+        // controller's receive time on the elapsedRealtimeNanos base, so it pairs with tUs directly.
+        private fun submitBroadcast(result: ScanResult, name: String) {
+            val mfg = result.scanRecord?.getManufacturerSpecificData(ESP_BEACON_COMPANY_ID) ?: return
+            val expectedSize = when (mfg.firstOrNull()?.toInt()?.and(0xFF)) {
+                ESP_PAYLOAD_VERSION_BEACON -> ESP_BEACON_PAYLOAD_LEN
+                ESP_PAYLOAD_VERSION_ROOT_TIME -> ESP_ROOT_TIME_PAYLOAD_LEN
+                else -> return
+            }
+            if (mfg.size != expectedSize) return
+            // A relay that lost its parent advertises its own clock: nothing to fit until it has one again
+            if (expectedSize == ESP_ROOT_TIME_PAYLOAD_LEN && (mfg[1].toInt() and 0xFF) == ESP_ROOT_TIME_HOP_UNSYNCED) return
+            val address = result.device.address
+            if (!sessions.containsKey(address) && sessions.size >= MAX_SESSIONS) return
+            val session = openSession(address, makePrimary = false)
+            if (session.gatt != null) return // a connected session is fed by its own GATT thread
+            session.name = name
+            session.submit(mfg, result.timestampNanos)
         }
 
         override fun onScanFailed(errorCode: Int) {
@@ -112,147 +449,336 @@ class BleManager(
     }
 
     // ----- GATT callbacks: connection lifecycle and characteristic notifications -----
+    // Connection state machine (LinkState): CONNECTING → SETTING_UP (MTU, discovery, subscriptions, queued
+    // one after another) → READY. A drop the app did not ask for reconnects straight away, keeping the
+    // session (and its fit), up to MAX_RECONNECT_ATTEMPTS times; a replaced link (connectToDevice on an open
+    // address) waits for its disconnect to be reported before the new one is opened.
     private val gattCallback = object : BluetoothGattCallback() {
 
+        // The link this gatt belongs to, or null for a stale gatt (closed or replaced)
+        private fun linkOf(gatt: BluetoothGatt): GattLink? {
+            val link = sessions[gatt.device.address]?.link ?: return null
+            val own = link.gatt
+            if (own == null) {
+                // Callback beat connectGatt's return value to the assignment
+                link.gatt = gatt
+                return link
+            }
+            return if (own === gatt) link else null
+        }
+
+        private fun opsOf(gatt: BluetoothGatt): GattOpQueue? = linkOf(gatt)?.ops
+
         @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
         @SuppressLint("MissingPermission")
         override fun onConnectionStateChange(gatt: BluetoothGatt, status: Int, newState: Int) {
-            if (status != BluetoothGatt.GATT_SUCCESS) {
-                Log.e("BLE", "GATT failed status=$status")
-                activity.runOnUiThread {
-                    Toast.makeText(activity, "Lost connection", Toast.LENGTH_SHORT).show()
-                }
+            val address = gatt.device.address
+            val session = sessions[address]
+            val link = linkOf(gatt)
+            if (session == null || link == null) {
                 gatt.close()
                 return
             }
 
-            when (newState) {
-                BluetoothProfile.STATE_CONNECTED -> {
-                    val name = gatt.device.name ?: "Unnamed"
-                    activity.runOnUiThread {
-                        Toast.makeText(activity, "Connected to $name", Toast.LENGTH_SHORT).show()
-                        onConnected(name)
-                    }
-                    gatt.requestMtu(247)
-                    gatt.discoverServices()
+            if (status == BluetoothGatt.GATT_SUCCESS && newState == BluetoothProfile.STATE_CONNECTED) {
+                if (!link.advance(LinkState.SETTING_UP)) return
+                val name = gatt.device.name ?: "Unnamed"
+                session.name = name
+                setPrimary(session)
+                mainHandler.post {
+                    Toast.makeText(context, "Connected to $name", Toast.LENGTH_SHORT).show()
+                    listener?.onConnected(name)
                 }
-
-                BluetoothProfile.STATE_DISCONNECTED -> {
-                    resetCheepSync()
-                    activity.runOnUiThread {
-                        Toast.makeText(activity, "Disconnected", Toast.LENGTH_SHORT).show()
-                        onDisconnected()
-                    }
-                    gatt.close()
-                    bluetoothGatt = null
+                // Short connection interval (~11-15 ms): notify-to-receive spread follows the interval
+                gatt.requestConnectionPriority(BluetoothGatt.CONNECTION_PRIORITY_HIGH)
+                val ops = GattOpQueue(gatt)
+                link.ops = ops
+                ops.enqueue(GattOp(GattOp.Kind.MTU, null, { it.requestMtu(REQUESTED_MTU) }))
+                ops.enqueue(GattOp(GattOp.Kind.DISCOVER, null, { it.discoverServices() }) { discoveryStatus ->
+                    onSetupDiscovered(session, link, gatt, discoveryStatus)
+                })
+                return
+            }
+            if (newState == BluetoothProfile.STATE_CONNECTED) return // connected with an error status: wait for the drop
+            if (status != BluetoothGatt.GATT_SUCCESS) Log.e("BLE", "[$address] GATT failed status=$status")
+
+            val was = link.close() ?: return
+            // A link that made it to READY worked: its drop starts the attempt count afresh
+            val attempts = if (was == LinkState.READY) 0 else link.reconnectAttempts
+            when {
+                was == LinkState.REPLACING -> connectLink(session, link.device)
+                // Not asked for (supervision timeout, connect failure): try again at once, same session
+                status != BluetoothGatt.GATT_SUCCESS && attempts < MAX_RECONNECT_ATTEMPTS -> {
+                    Log.i("BLE", "[$address] Reconnecting (attempt ${attempts + 1})")
+                    connectLink(session, link.device, attempts + 1)
                 }
-
-                else -> Log.w("BLE", "Unknown state: $newState")
+                else -> endSession(address, if (status != BluetoothGatt.GATT_SUCCESS) "Lost connection" else "Disconnected")
             }
         }
 
-        // Called when the ESP32 characteristic sends a notification (each packet).
-        // Packet layout: 4 bytes seq (u32 LE), 8 bytes tUs (u64 LE). We add receivedAtNs on the phone.
-        override fun onCharacteristicChanged(gatt: BluetoothGatt, characteristic: BluetoothGattCharacteristic) {
-            if (characteristic.uuid != ESP32_CHAR_UUID) return
-
-            @Suppress("DEPRECATION")
-            val value = characteristic.value ?: return
-            if (value.size < 12) return
-
-            try {
-                val packet = EspPacket(
-                    seq = u32LE(value, 0),
-                    tUs = u64LE(value, 4),
-                    receivedAtNs = SystemClock.elapsedRealtimeNanos()
-                )
-
-                updateCheepSync(packet)
+        override fun onMtuChanged(gatt: BluetoothGatt, mtu: Int, status: Int) {
+            opsOf(gatt)?.complete(GattOp.Kind.MTU, null, status)
+        }
 
-                activity.runOnUiThread { onPacketReceived(packet) }
-            } catch (e: Exception) {
-                Log.e("ESP32", "Decode error", e)
-            }
+        override fun onServicesDiscovered(gatt: BluetoothGatt, status: Int) {
+            opsOf(gatt)?.complete(GattOp.Kind.DISCOVER, null, status)
         }
 
         override fun onDescriptorWrite(gatt: BluetoothGatt, descriptor: BluetoothGattDescriptor, status: Int) {
-            if (status != BluetoothGatt.GATT_SUCCESS) Log.e("BLE", "Descriptor write failed")
+            opsOf(gatt)?.complete(GattOp.Kind.DESCRIPTOR_WRITE, descriptor.characteristic.uuid, status)
         }
 
-        // After connection: find ESP32 service/characteristic, enable notifications, report to UI.
-        @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
-        @SuppressLint("MissingPermission")
-        override fun onServicesDiscovered(gatt: BluetoothGatt, status: Int) {
-            super.onServicesDiscovered(gatt, status)
-            if (status != BluetoothGatt.GATT_SUCCESS) return
+        override fun onCharacteristicWrite(gatt: BluetoothGatt, characteristic: BluetoothGattCharacteristic, status: Int) {
+            opsOf(gatt)?.complete(GattOp.Kind.WRITE, characteristic.uuid, status)
+        }
 
-            gatt.getService(ESP32_SERVICE_UUID)?.getCharacteristic(ESP32_CHAR_UUID)?.let { tx ->
-                gatt.setCharacteristicNotification(tx, true)
-                tx.getDescriptor(CLIENT_CONFIG_DESCRIPTOR_UUID)?.let { cccd ->
-                    writeClientConfigValue(gatt, cccd, BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE)
-                }
+        // Called when the ESP32 characteristic sends a notification (each packet), in the format negotiated at
+        // setup or the firmware default: decodeEspPayloadInto tells them apart. We add receivedAtNs on the phone.
+        // API 33+ hands the value over directly, instead of through the characteristic's shared value field.
+        override fun onCharacteristicChanged(gatt: BluetoothGatt, characteristic: BluetoothGattCharacteristic, value: ByteArray) {
+            onNotification(gatt, characteristic, value, SystemClock.elapsedRealtimeNanos())
+        }
 
-                val props = tx.properties
-                val propsList = buildList {
-                    if (props and BluetoothGattCharacteristic.PROPERTY_READ != 0) add("READ")
-                    if (props and BluetoothGattCharacteristic.PROPERTY_WRITE != 0) add("WRITE")
-                    if (props and BluetoothGattCharacteristic.PROPERTY_NOTIFY != 0) add("NOTIFY")
-                    if (props and BluetoothGattCharacteristic.PROPERTY_INDICATE != 0) add("INDICATE")
-                }.joinToString()
-
-                val info = CharacteristicInfo(
-                    ESP32_SERVICE_UUID,
-                    standardServiceNames[ESP32_SERVICE_UUID] ?: "Environmental Sensing",
-                    tx.uuid,
-                    "ESP32 Sensor Data",
-                    propsList
-                )
+        // Before API 33 only this overload is called
+        @Deprecated("Replaced by the value overload on API 33")
+        override fun onCharacteristicChanged(gatt: BluetoothGatt, characteristic: BluetoothGattCharacteristic) {
+            val receivedAtNs = SystemClock.elapsedRealtimeNanos()
+            @Suppress("DEPRECATION")
+            val value = characteristic.value ?: return
+            onNotification(gatt, characteristic, value, receivedAtNs)
+        }
 
-                activity.runOnUiThread { onCharacteristicsDiscovered(listOf(info)) }
-            } ?: Log.e("BLE", "ESP32 characteristic not found")
+        // The lanes copy value into their own slots, so it may be the stack's array
+        private fun onNotification(gatt: BluetoothGatt, characteristic: BluetoothGattCharacteristic, value: ByteArray, receivedAtNs: Long) {
+            when (characteristic.uuid) {
+                ESP32_CHAR_UUID -> sessions[gatt.device.address]?.submit(value, receivedAtNs)
+                ESP32_CONN_CHAR_UUID -> sessions[gatt.device.address]?.updateConnParams(decodeEspConnParams(value))
+                ESP32_RTT_CHAR_UUID -> sessions[gatt.device.address]?.submitRoundTrip(value, receivedAtNs)
+                ESP32_EVENT_CHAR_UUID -> sessions[gatt.device.address]?.submitEvents(value, receivedAtNs)
+            }
         }
 
         override fun onCharacteristicRead(gatt: BluetoothGatt, characteristic: BluetoothGattCharacteristic, status: Int) {
             if (status == BluetoothGatt.GATT_SUCCESS) {
                 @Suppress("DEPRECATION")
                 val bytes = characteristic.value
-                readValues[characteristic.uuid] =
-                    bytes?.joinToString(" ") { it.toUByte().toString() } ?: "null"
+                val session = sessions[gatt.device.address]
+                when (characteristic.uuid) {
+                    ESP32_CONN_CHAR_UUID -> {
+                        if (bytes != null) session?.updateConnParams(decodeEspConnParams(bytes))
+                        readValues[characteristic.uuid] = bytes?.joinToString(" ") { it.toUByte().toString() } ?: "null"
+                    }
+                    ESP32_DETECTOR_CHAR_UUID -> if (bytes != null) session?.updateDetectorConfig(decodeEspDetectorConfig(bytes))
+                    ESP32_CAPS_CHAR_UUID -> if (bytes != null) session?.updateCapabilities(decodeEspCapabilities(bytes))
+                    // Polled: keep readValues for the UI's manual reads
+                    ESP32_DIAG_CHAR_UUID -> if (bytes != null) session?.updateDiagnostics(decodeEspDiagnostics(bytes))
+                    else -> readValues[characteristic.uuid] = bytes?.joinToString(" ") { it.toUByte().toString() } ?: "null"
+                }
+            }
+            opsOf(gatt)?.complete(GattOp.Kind.READ, characteristic.uuid, status)
+        }
+    }
+
+    // Discovery done: resolve the ESP32 characteristics once for this link, report the sensor one to the UI,
+    // negotiate the sensor format, then queue the subscriptions and initial reads.
+    @SuppressLint("MissingPermission")
+    private fun onSetupDiscovered(session: BeaconSession, link: GattLink, gatt: BluetoothGatt, status: Int) {
+        if (status != BluetoothGatt.GATT_SUCCESS) {
+            Log.e("BLE", "[${session.address}] Service discovery failed (status $status)")
+            failSetup(session, link, retry = true)
+            return
+        }
+        val handles = GattHandles.resolve(gatt) ?: run {
+            // Not our firmware (or not yet flashed): reconnecting would find the same table
+            Log.e("BLE", "[${session.address}] ESP32 characteristic not found")
+            failSetup(session, link, retry = false)
+            return
+        }
+        link.handles = handles
+        mainHandler.post { listener?.onCharacteristicsDiscovered(listOf(characteristicInfo(handles.sensor))) }
+
+        val ops = link.ops ?: return
+        // Capabilities first, so the first notification after subscribing is already in the chosen format.
+        // The read callback has updated the session by the time onDone runs; the queue is empty then.
+        val caps = handles.capabilities
+        session.updateCapabilities(null)  // a previous link's, possibly another firmware
+        if (caps == null) {
+            enqueueSubscriptions(session, link, handles, ops)
+            return
+        }
+        ops.enqueue(GattOp(GattOp.Kind.READ, caps.uuid, { gatt -> gatt.readCharacteristic(caps) }) { status ->
+            val format = if (status == BluetoothGatt.GATT_SUCCESS) session.capabilities.value?.let(::chooseEspSensorFormat) else null
+            if (format != null) {
+                ops.enqueue(selectFormatOp(session, caps, format))
+                ops.enqueue(readOp(caps))  // what the beacon actually sends now
             }
+            enqueueSubscriptions(session, link, handles, ops)
+        })
+    }
+
+    // Setup cannot finish on this link: tear it down rather than leave it in SETTING_UP, and reconnect the way
+    // an unrequested drop does if [retry] and attempts remain; otherwise end the session.
+    @SuppressLint("MissingPermission")
+    private fun failSetup(session: BeaconSession, link: GattLink, retry: Boolean) {
+        try { link.gatt?.disconnect() } catch (_: SecurityException) {}
+        // Null: a drop got there first and already decided what follows
+        val was = link.close() ?: return
+        val attempts = link.reconnectAttempts
+        when {
+            was == LinkState.REPLACING -> connectLink(session, link.device)
+            retry && attempts < MAX_RECONNECT_ATTEMPTS -> {
+                Log.i("BLE", "[${session.address}] Reconnecting (attempt ${attempts + 1})")
+                connectLink(session, link.device, attempts + 1)
+            }
+            else -> endSession(session.address, "Setup failed")
+        }
+    }
+
+    // Drop [address]'s session and tell the user why; the listener hears about it once no session is left
+    private fun endSession(address: String, message: String) {
+        closeSession(address)
+        val last = sessions.isEmpty()
+        mainHandler.post {
+            Toast.makeText(context, message, Toast.LENGTH_SHORT).show()
+            if (last) listener?.onDisconnected()
         }
     }
 
-    // ----- Helper: write CCCD so the server knows we want notifications (Android API version differences) -----
+    // Subscribe before reading the connection parameters: they may have been negotiated before we subscribed
+    private fun enqueueSubscriptions(session: BeaconSession, link: GattLink, handles: GattHandles, ops: GattOpQueue) {
+        notificationsOp(handles.sensor)?.let(ops::enqueue)
+        handles.connParams?.let { conn ->
+            notificationsOp(conn)?.let(ops::enqueue)
+            ops.enqueue(readOp(conn))
+        }
+        handles.roundTrip?.let { rtt -> notificationsOp(rtt)?.let(ops::enqueue) }
+        // Only SENSOR_ACOUSTIC_EVENTS firmware has the event and detector characteristics
+        handles.events?.let { event -> notificationsOp(event)?.let(ops::enqueue) }
+        handles.detector?.let { detector -> ops.enqueue(readOp(detector)) }
+        ops.enqueue(GattOp.local {
+            if (link.advance(LinkState.READY)) startRoundTrips(session.address)
+        })
+    }
+
+    private fun characteristicInfo(char: BluetoothGattCharacteristic): CharacteristicInfo {
+        val props = char.properties
+        val propsList = buildList {
+            if (props and BluetoothGattCharacteristic.PROPERTY_READ != 0) add("READ")
+            if (props and BluetoothGattCharacteristic.PROPERTY_WRITE != 0) add("WRITE")
+            if (props and BluetoothGattCharacteristic.PROPERTY_NOTIFY != 0) add("NOTIFY")
+            if (props and BluetoothGattCharacteristic.PROPERTY_INDICATE != 0) add("INDICATE")
+        }.joinToString()
+        return CharacteristicInfo(
+            ESP32_SERVICE_UUID,
+            standardServiceNames[ESP32_SERVICE_UUID] ?: "Environmental Sensing",
+            char.uuid,
+            "ESP32 Sensor Data",
+            propsList
+        )
+    }
+
+    /**
+     * Send new onset detector settings to the primary beacon ([config]'s noise fields are ignored). The beacon
+     * applies and persists them; [detectorConfig] updates once they are read back. False if the primary beacon
+     * is not connected or has no detector characteristic.
+     */
+    @SuppressLint("MissingPermission")
+    fun writeDetectorConfig(config: EspDetectorConfig): Boolean {
+        if (!hasConnectPermission()) return false
+        val link = primary?.link ?: return false
+        val ops = link.ops ?: return false
+        val char = link.handles?.detector ?: return false
+        val value = encodeEspDetectorConfig(config)
+        ops.enqueue(GattOp(GattOp.Kind.WRITE, char.uuid, { gatt ->
+            writeCharacteristicValue(gatt, char, value, BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT)
+        }) { status ->
+            if (status != BluetoothGatt.GATT_SUCCESS) Log.e("BLE", "Detector config rejected (status $status)")
+        })
+        // Read back either way, so the UI shows what the beacon actually applied
+        ops.enqueue(readOp(char))
+        return true
+    }
+
+    // ----- Helpers: descriptor and characteristic writes (Android API version differences) -----
+    // Both return whether the stack accepted the operation; the result arrives in the callback.
     @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
     @SuppressLint("MissingPermission")
-    private fun writeClientConfigValue(gatt: BluetoothGatt, descriptor: BluetoothGattDescriptor, value: ByteArray) {
-        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
-            gatt.writeDescriptor(descriptor, value)
+    private fun writeClientConfigValue(gatt: BluetoothGatt, descriptor: BluetoothGattDescriptor, value: ByteArray): Boolean {
+        return if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            gatt.writeDescriptor(descriptor, value) == BluetoothStatusCodes.SUCCESS
         } else {
             @Suppress("DEPRECATION")
             runCatching {
                 descriptor.javaClass.getMethod("setValue", ByteArray::class.java).invoke(descriptor, value)
                 gatt.writeDescriptor(descriptor)
-            }.onFailure { Log.e("BLE", "Legacy descriptor write failed", it) }
+            }.onFailure { Log.e("BLE", "Legacy descriptor write failed", it) }.getOrDefault(false)
+        }
+    }
+
+    @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
+    @SuppressLint("MissingPermission")
+    private fun writeCharacteristicValue(gatt: BluetoothGatt, char: BluetoothGattCharacteristic, value: ByteArray, writeType: Int): Boolean {
+        return if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            gatt.writeCharacteristic(char, value, writeType) == BluetoothStatusCodes.SUCCESS
+        } else {
+            @Suppress("DEPRECATION")
+            run {
+                char.writeType = writeType
+                char.value = value
+                gatt.writeCharacteristic(char)
+            }
         }
     }
 
     // ----- Public BLE controls (called from MainActivity / UI) -----
+    /**
+     * Start (or restart with a new [mode]) a scan. The device list starts empty; see [ScanMode] for the
+     * filter and batching tradeoffs.
+     */
     @SuppressLint("MissingPermission")
-    fun startBleScan() {
+    fun startBleScan(mode: ScanMode = ScanMode.ESP32) {
         if (!hasScanPermission()) {
-            Toast.makeText(activity, "Scan permission not granted", Toast.LENGTH_SHORT).show()
+            Toast.makeText(context, "Scan permission not granted", Toast.LENGTH_SHORT).show()
             return
         }
         val scanner = bluetoothAdapter?.bluetoothLeScanner ?: run {
-            Toast.makeText(activity, "BLE scanner unavailable", Toast.LENGTH_SHORT).show()
+            Toast.makeText(context, "BLE scanner unavailable", Toast.LENGTH_SHORT).show()
             return
         }
-        scanner.startScan(
-            null,
-            ScanSettings.Builder().setScanMode(ScanSettings.SCAN_MODE_LOW_LATENCY).build(),
-            bleScanCallback
+        scanner.stopScan(bleScanCallback)
+        scanUiHandler.removeCallbacks(publishScanResults)
+        scanPublishPending = false
+        scanIndex.clear()
+        listener?.onDevicesUpdated(scanIndex.snapshot())
+
+        // Filters are ORed: a connectable beacon advertises the service, a connectionless one only its payload
+        val filters = if (mode == ScanMode.ALL) null else listOf(
+            ScanFilter.Builder().setServiceUuid(ParcelUuid(ESP32_SERVICE_UUID)).build(),
+            ScanFilter.Builder()
+                .setManufacturerData(
+                    ESP_BEACON_COMPANY_ID,
+                    byteArrayOf(ESP_PAYLOAD_VERSION_BEACON.toByte()),
+                    byteArrayOf(0xFF.toByte())
+                )
+                .build(),
+            ScanFilter.Builder()
+                .setManufacturerData(
+                    ESP_BEACON_COMPANY_ID,
+                    byteArrayOf(ESP_PAYLOAD_VERSION_ROOT_TIME.toByte()),
+                    byteArrayOf(0xFF.toByte())
+                )
+                .build()
         )
+        val settings = ScanSettings.Builder().setScanMode(ScanSettings.SCAN_MODE_LOW_LATENCY)
+        if (mode == ScanMode.ESP32_BATCHED && bluetoothAdapter?.isOffloadedScanBatchingSupported == true) {
+            settings.setReportDelay(SCAN_REPORT_DELAY_MS)
+        }
+        // Extended advertising too (firmware SENSOR_PERIODIC_ADV mirrors its periodic train there): periodic
+        // sync itself is not public API, so the extended set is what an app can receive
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O && bluetoothAdapter?.isLeExtendedAdvertisingSupported == true) {
+            settings.setLegacy(false).setPhy(ScanSettings.PHY_LE_ALL_SUPPORTED)
+        }
+        scanner.startScan(filters, settings.build(), bleScanCallback)
         bluetoothLeScanner = scanner
     }
 
@@ -260,25 +786,20 @@ class BleManager(
     fun stopBleScan() {
         if (!hasScanPermission()) return
         (bluetoothLeScanner ?: bluetoothAdapter?.bluetoothLeScanner)?.stopScan(bleScanCallback)
+        // Hand over what the last interval collected; nothing more arrives after this
+        scanUiHandler.removeCallbacks(publishScanResults)
+        publishScanResults.run()
     }
 
-    /** Enable or disable BLE notifications for a characteristic (e.g. ESP32 data stream). */
+    /** Enable or disable BLE notifications for a characteristic (e.g. ESP32 data stream). Queued on the primary link. */
     @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
     @SuppressLint("MissingPermission")
     fun setNotificationsForCharacteristic(info: CharacteristicInfo, enable: Boolean): Boolean {
-        val gatt = bluetoothGatt ?: return false
-        val char = gatt.getService(info.serviceUuid)?.getCharacteristic(info.charUuid) ?: return false
+        val link = primary?.link ?: return false
+        val ops = link.ops ?: return false
+        val char = link.gatt?.getService(info.serviceUuid)?.getCharacteristic(info.charUuid) ?: return false
         if (char.properties and BluetoothGattCharacteristic.PROPERTY_NOTIFY == 0) return false
-
-        gatt.setCharacteristicNotification(char, enable)
-        char.getDescriptor(CLIENT_CONFIG_DESCRIPTOR_UUID)?.let { desc ->
-            writeClientConfigValue(
-                gatt,
-                desc,
-                if (enable) BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE
-                else BluetoothGattDescriptor.DISABLE_NOTIFICATION_VALUE
-            )
-        }
+        ops.enqueue(notificationsOp(char, enable) ?: return false)
         return true
     }
 
@@ -286,39 +807,131 @@ class BleManager(
     @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
     @SuppressLint("MissingPermission")
     fun readCharacteristicOnce(charUuid: java.util.UUID, serviceUuid: java.util.UUID) {
-        bluetoothGatt?.getService(serviceUuid)?.getCharacteristic(charUuid)?.let { char ->
-            val ok = bluetoothGatt!!.readCharacteristic(char)
-            Log.i("BLE", if (ok) "Read initiated" else "Read failed")
+        val link = primary?.link
+        val ops = link?.ops ?: run {
+            Log.e("BLE", "Not connected")
+            return
+        }
+        link.gatt?.getService(serviceUuid)?.getCharacteristic(charUuid)?.let { char ->
+            ops.enqueue(GattOp(GattOp.Kind.READ, char.uuid, { it.readCharacteristic(char) }) { status ->
+                Log.i("BLE", if (status == BluetoothGatt.GATT_SUCCESS) "Read done" else "Read failed (status $status)")
+            })
         } ?: Log.e("BLE", "Characteristic not found")
     }
 
-    /** Connect to a BLE device by address. Stops scan, clears previous GATT, then connectGatt. */
+    /**
+     * Connect to a BLE device by address. Stops scan, then connectGatt. Other beacons stay connected;
+     * the new one becomes the primary session. Reconnecting to an already-open address resets its fit,
+     * and opens the new link as soon as the stack reports the old one down.
+     */
     @RequiresPermission(PERMISSION_BLUETOOTH_CONNECT)
     @SuppressLint("MissingPermission")
     fun connectToDevice(address: String) {
         if (!hasConnectPermission()) {
-            Toast.makeText(activity, "Permission denied", Toast.LENGTH_SHORT).show()
+            Toast.makeText(context, "Permission denied", Toast.LENGTH_SHORT).show()
+            return
+        }
+        if (!sessions.containsKey(address) && sessions.size >= MAX_SESSIONS) {
+            Toast.makeText(context, "Already connected to $MAX_SESSIONS beacons", Toast.LENGTH_SHORT).show()
             return
         }
 
         stopBleScan()
-        bluetoothGatt?.close()
-        bluetoothGatt = null
-        resetCheepSync()
-
+        val session = openSession(address)
+        session.reset()
         val device = bluetoothAdapter!!.getRemoteDevice(address)
-        Handler(Looper.getMainLooper()).postDelayed({
-            bluetoothGatt = device.connectGatt(activity, false, gattCallback, BluetoothDevice.TRANSPORT_LE)
-            Toast.makeText(activity, "Connecting to $address", Toast.LENGTH_SHORT).show()
-        }, 750)
+        Toast.makeText(context, "Connecting to $address", Toast.LENGTH_SHORT).show()
+
+        val old = session.link
+        val oldGatt = old?.gatt
+        if (old == null || oldGatt == null || !old.advance(LinkState.REPLACING)) {
+            old?.close()
+            connectLink(session, device)
+            return
+        }
+        // connectGatt right after close() can race the stack's teardown of the old link (what a fixed delay
+        // used to cover); disconnect and let onConnectionStateChange open the new one
+        old.ops?.close()
+        oldGatt.disconnect()
+        roundTripHandler.postAtTime({
+            // A link that never came up may not report its disconnect
+            if (session.link === old && old.close() != null) connectLink(session, device)
+        }, session, SystemClock.uptimeMillis() + DISCONNECT_TIMEOUT_MS)
+    }
+
+    // Open a new link for [session], replacing whatever link it had (already closed by the caller)
+    @SuppressLint("MissingPermission")
+    private fun connectLink(session: BeaconSession, device: BluetoothDevice, reconnectAttempts: Int = 0) {
+        if (sessions[session.address] !== session) return
+        val link = GattLink(device, reconnectAttempts)
+        session.link = link
+        val gatt = device.connectGatt(context, false, gattCallback, BluetoothDevice.TRANSPORT_LE) ?: run {
+            Log.e("BLE", "[${session.address}] connectGatt failed")
+            link.close()
+            return
+        }
+        if (link.gatt == null) link.gatt = gatt
+    }
+
+    /** Stop the decode thread. Call when the owner is destroyed. */
+    fun shutdown() {
+        for (source in sources.values) source.stop()
+        sources.clear()
+        pipeline.shutdown()
+        syncCache.close()
+        // Exports already queued still finish
+        exporter.shutdown()
     }
 
-    /** Disconnect and close GATT; reset CheepSync state. */
+    // Attached packet sources by address (synthetic beacons, replays)
+    private val sources = ConcurrentHashMap<String, PacketSource>()
+
+    /**
+     * Drive a session from [source] instead of a GATT connection (load tests, replays) and make it primary.
+     * Returns false if that address already has a session: its lane accepts a single producer.
+     */
+    fun attachSource(source: PacketSource): Boolean {
+        if (sessions.containsKey(source.address) || sessions.size >= MAX_SESSIONS) return false
+        val session = openSession(source.address)
+        session.name = source.name
+        sources[source.address] = source
+        source.start { value, receivedAtNs -> session.submit(value, receivedAtNs) }
+        mainHandler.post { listener?.onConnected(source.name) }
+        return true
+    }
+
+    /** Disconnect and close one beacon's GATT (or stop its packet source) and drop its session. */
     @SuppressLint("MissingPermission")
+    fun disconnect(address: String) {
+        sources.remove(address)?.stop()
+        val session = sessions[address] ?: return
+        try { session.gatt?.disconnect() } catch (_: SecurityException) {}
+        closeSession(address)
+    }
+
+    /** Disconnect every beacon. */
     fun disconnect() {
-        try { bluetoothGatt?.disconnect() } catch (_: SecurityException) {}
-        try { bluetoothGatt?.close() } catch (_: SecurityException) {}
-        bluetoothGatt = null
-        resetCheepSync()
+        for (address in sessions.keys.toList()) disconnect(address)
+    }
+
+    companion object {
+        /** Concurrent beacon connections; Android stacks typically allow 7–8 LE links. */
+        const val MAX_SESSIONS = 8
+        /** Immediate reconnects after a drop the app did not ask for, before the session is closed. */
+        const val MAX_RECONNECT_ATTEMPTS = 3
+        /** How long a replaced link is given to report its disconnect before the next one is opened anyway. */
+        const val DISCONNECT_TIMEOUT_MS = 1_000L
+        const val REQUESTED_MTU = 247
+        /** Controller-side batching interval of ScanMode.ESP32_BATCHED. */
+        const val SCAN_REPORT_DELAY_MS = 1_000L
+        /** Upper bound on how often the scanner list is refreshed. */
+        const val SCAN_UI_INTERVAL_MS = 500L
+        const val ROUND_TRIP_PERIOD_MS = 1000L
+        const val DIAGNOSTICS_POLL_TICKS = 5L
+        /** Within the firmware's SENSOR_RATE_FEEDBACK_TIMEOUT_MS (30 s by default), with ticks to spare. */
+        const val RATE_FEEDBACK_TICKS = 5L
+        const val MAX_RECORDINGS = 20
+        const val RECORDING_SUFFIX = ".bssl"
+        const val EXPORTS_DIR = "exports"
     }
 }
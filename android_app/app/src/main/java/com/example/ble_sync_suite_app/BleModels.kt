@@ -1,6 +1,8 @@
 package com.example.ble_sync_suite_app
 
 import androidx.compose.runtime.mutableStateMapOf
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import java.util.UUID
 
 // =============================================================================
@@ -8,13 +10,178 @@ import java.util.UUID
 // =============================================================================
 
 // ----- Data classes -----
-/** One ESP32 BLE packet: sequence number, beacon time in μs, and phone receive time in ns (set when received). */
+/**
+ * One ESP32 BLE packet: sequence number, beacon time in μs, and phone receive time in ns (set when received).
+ * Timed payloads also report, for the previous packet (prevSeq), how long it took on the beacon from
+ * capture to leaving the host stack (prevSendDelayUs). prevSeq is UNKNOWN for other formats;
+ * prevSendDelayUs is also UNKNOWN when the beacon had no delay to report.
+ */
 data class EspPacket(
     val seq: Long,
     val tUs: Long,
+    val receivedAtNs: Long,
+    val prevSeq: Long = UNKNOWN,
+    val prevSendDelayUs: Long = UNKNOWN
+) {
+    companion object {
+        const val UNKNOWN = -1L
+    }
+}
+
+/**
+ * Connection parameters the ESP32 reports after negotiation (connection-parameter characteristic).
+ * Raw units as on the air: interval in 1.25 ms, latency in connection events, timeout in 10 ms.
+ */
+data class EspConnParams(
+    val intervalUnits: Int,
+    val latency: Int,
+    val timeoutUnits: Int
+) {
+    val intervalMs: Double get() = intervalUnits * 1.25
+    val timeoutMs: Int get() = timeoutUnits * 10
+}
+
+/**
+ * One decoded round-trip exchange: phone send/receive (elapsedRealtimeNanos) around the ESP32's
+ * receive/send (esp_timer μs). Feed to sync.RoundTripSync.addExchange.
+ */
+data class EspRoundTrip(
+    val phoneSendNs: Long,
+    val beaconRxUs: Long,
+    val beaconTxUs: Long,
+    val phoneRxNs: Long
+)
+
+/**
+ * ESP32 firmware diagnostics (diagnostics characteristic), cumulative since beacon boot; diff two
+ * snapshots over [tUs] for rates. Send figures cover esp_ble_gatts_send_indicate() for the sensor
+ * notification; wake-ups are the notify task's lateness against its vTaskDelayUntil schedule.
+ */
+data class EspDiagnostics(
+    val tUs: Long,
+    val sendCalls: Long,
+    val sendFailures: Long,
+    val sendMaxUs: Long,
+    /** Call counts per log2 latency bucket: [0] < 2 μs, [i] in [2^i, 2^(i+1)) μs, last is open-ended. */
+    val sendLatencyBuckets: List<Long>,
+    /** Failed calls per esp_err_t code (the first few distinct codes seen). */
+    val sendErrors: Map<Int, Long>,
+    val congestEvents: Long,
+    val congestedMs: Long,
+    val wakeCount: Long,
+    val wakeLateMaxUs: Long,
+    val wakeLateSumUs: Long,
+    val freeHeapBytes: Long,
+    val minFreeHeapBytes: Long,
+    /** Samples the notify scheduler dropped from a connection's queue (congestion outlasted the queue or MTU). */
+    val queueDropped: Long = 0,
+    /** Samples that waited for a congested link and arrived batched with a later one. */
+    val queueCoalesced: Long = 0,
+    /** Random ID the beacon drew at boot (version 3); a change means it rebooted. Null from older firmware. */
+    val bootId: Long? = null,
+    /** Tolerance of the clock t_us runs on while the beacon is in light sleep (version 4); 0 if it never sleeps. */
+    val sleepClockPpm: Int = 0,
+    /** Time the beacon spent in light sleep since boot (version 4, wraps at 2^32 ms); valid if [sleepCounted]. */
+    val sleptMs: Long = 0,
+    val sleepCounted: Boolean = false,
+    /**
+     * Skew light sleep may have added to t_us since the previous snapshot ([sleepSkewPpmSince]), in ppm;
+     * filled in by the session. A fit's skew uncertainty should be widened by this much.
+     */
+    val sleepSkewPpm: Double = 0.0
+) {
+    val wakeLateMeanUs: Double get() = if (wakeCount == 0L) 0.0 else wakeLateSumUs.toDouble() / wakeCount
+
+    /**
+     * Worst-case extra skew (ppm) on t_us between [earlier] and this snapshot: the sleep clock's tolerance,
+     * weighted by the share of that time spent asleep. The whole tolerance when that share is unknown.
+     */
+    fun sleepSkewPpmSince(earlier: EspDiagnostics?): Double {
+        if (sleepClockPpm == 0) return 0.0
+        if (!sleepCounted || earlier == null || !earlier.sleepCounted || tUs <= earlier.tUs) return sleepClockPpm.toDouble()
+        val sleptUs = ((sleptMs - earlier.sleptMs) and 0xFFFF_FFFFL) * 1000.0
+        return sleepClockPpm * (sleptUs / (tUs - earlier.tUs)).coerceIn(0.0, 1.0)
+    }
+
+    /**
+     * Upper edge (μs) of the bucket holding the [q] quantile of send latency (the open-ended last
+     * bucket reports its lower edge); 0 before any send.
+     */
+    fun sendLatencyQuantileUs(q: Double): Long {
+        val total = sendLatencyBuckets.sum()
+        if (total == 0L) return 0
+        var seen = 0L
+        for ((i, n) in sendLatencyBuckets.withIndex()) {
+            seen += n
+            if (seen >= q * total) return if (i == sendLatencyBuckets.lastIndex) 1L shl i else 1L shl (i + 1)
+        }
+        return 1L shl sendLatencyBuckets.lastIndex
+    }
+}
+
+/**
+ * One acoustic onset from the event characteristic (firmware built with SENSOR_ACOUSTIC_EVENTS).
+ * [seq] counts events since beacon boot, so a jump means events were lost; [tUs] is the onset in beacon
+ * time (esp_timer μs, the clock the sync stream samples); [peak] is the 24-bit peak |sample|.
+ * [timingUncertain]: a capture overrun raced the onset, so tUs may be one DMA buffer off.
+ */
+data class EspAcousticEvent(
+    val seq: Long,
+    val tUs: Long,
+    val peak: Long,
+    val timingUncertain: Boolean,
     val receivedAtNs: Long
 )
 
+/**
+ * An acoustic event placed on the phone clock (elapsedRealtimeNanos) through the session's fit as it
+ * was when the event arrived; [phoneTimeNs] is null if there was no fit yet.
+ */
+data class MappedAcousticEvent(
+    val event: EspAcousticEvent,
+    val phoneTimeNs: Long?
+)
+
+/**
+ * Onset detector settings and its current noise estimate (detector characteristic, SENSOR_ACOUSTIC_EVENTS
+ * firmware). An onset fires when the envelope exceeds max([minLevel], floor + k·sigma) and the detector re-arms
+ * [holdMs] later once it is back under floor + release·sigma; the floor and sigma are learned over about [floorMs].
+ * [noiseFloor] and [noiseSigma] are read-only (24-bit sample units); a write carries the settings only.
+ */
+data class EspDetectorConfig(
+    val kX10: Int,
+    val releaseX10: Int,
+    val minLevel: Long,
+    val holdMs: Int,
+    val floorMs: Int,
+    val noiseFloor: Long = 0,
+    val noiseSigma: Long = 0
+) {
+    val k: Double get() = kX10 / 10.0
+    val release: Double get() = releaseX10 / 10.0
+}
+
+/**
+ * How the beacon's sensor stream is laid out (capabilities characteristic). [format] is the payload version this
+ * connection receives ([ESP_PAYLOAD_VERSION_LEGACY] for the 12-byte payload) and [formatMask] has bit v set for
+ * each version v it may switch to. [batchSize] records share a batched notification, up to [queueLength] when a
+ * backlog coalesces; timestamps are in [timestampUnit] ([ESP_CAPS_UNIT_US_BOOT]). [features]: ESP_CAPS_FEATURE_*.
+ */
+data class EspCapabilities(
+    val version: Int,
+    val format: Int,
+    val recordLen: Int,
+    val batchSize: Int,
+    val queueLength: Int,
+    val timestampUnit: Int,
+    val formatMask: Int,
+    val features: Int,
+    val periodUs: Long
+) {
+    fun supportsFormat(version: Int): Boolean = version in 0..15 && formatMask and (1 shl version) != 0
+    fun hasFeature(flag: Int): Boolean = features and flag != 0
+}
+
 /** BLE characteristic metadata for UI (service/char UUID, name, properties string). */
 data class CharacteristicInfo(
     val serviceUuid: UUID,
@@ -34,6 +201,20 @@ val CLIENT_CONFIG_DESCRIPTOR_UUID = UUID.fromString("00002902-0000-1000-8000-008
 /** Custom service/characteristic used by the ESP32 for streaming (seq + tUs). */
 val ESP32_SERVICE_UUID = UUID.fromString("0000181a-0000-1000-8000-00805f9b34fb")
 val ESP32_CHAR_UUID = UUID.fromString("0015a1a1-1212-efde-1523-785feabcd123")
+/** Negotiated connection parameters (READ + NOTIFY): [interval:u16][latency:u16][timeout:u16] LE. */
+val ESP32_CONN_CHAR_UUID = UUID.fromString("0015a1a2-1212-efde-1523-785feabcd123")
+/** Round trip: write [phoneSendNs:u64], notified [phoneSendNs:u64 echo][rxUs:u64][turnaroundUs:u32] LE. */
+val ESP32_RTT_CHAR_UUID = UUID.fromString("0015a1a3-1212-efde-1523-785feabcd123")
+/** Firmware diagnostics (READ, polled); layout in decodeEspDiagnostics. */
+val ESP32_DIAG_CHAR_UUID = UUID.fromString("0015a1a4-1212-efde-1523-785feabcd123")
+/** Acoustic events (READ + NOTIFY), only on SENSOR_ACOUSTIC_EVENTS firmware; layout in decodeEspAcousticEvents. */
+val ESP32_EVENT_CHAR_UUID = UUID.fromString("0015a1a5-1212-efde-1523-785feabcd123")
+/** Onset detector settings (READ + WRITE), only on SENSOR_ACOUSTIC_EVENTS firmware; layout in decodeEspDetectorConfig. */
+val ESP32_DETECTOR_CHAR_UUID = UUID.fromString("0015a1a6-1212-efde-1523-785feabcd123")
+/** Fit feedback (WRITE), only on SENSOR_ADAPTIVE_RATE firmware; layout in encodeEspRateFeedback. */
+val ESP32_RATE_CHAR_UUID = UUID.fromString("0015a1a7-1212-efde-1523-785feabcd123")
+/** Capabilities (READ + WRITE), absent on older firmware; layout in decodeEspCapabilities, a 1-byte write selects the format. */
+val ESP32_CAPS_CHAR_UUID = UUID.fromString("0015a1a8-1212-efde-1523-785feabcd123")
 
 val standardServiceNames = mapOf(
     UUID.fromString("00001800-0000-1000-8000-00805f9b34fb") to "Generic Access",
@@ -53,21 +234,416 @@ val standardCharacteristicNames = mapOf(
 /** Last read value per characteristic UUID (for UI "Read" button). */
 val readValues = mutableStateMapOf<UUID, String>()
 
+// ----- ESP32 payload formats (keep in sync with esp32_ble/components/sensor_protocol/include/sensor_payload.h) -----
+/** Legacy single-sample payload: [seq:u32][tUs:u64], no header. */
+const val ESP_LEGACY_PAYLOAD_LEN = 12
+/** Format ID of the legacy payload in [EspCapabilities]; never on the wire (the payload has no version byte). */
+const val ESP_PAYLOAD_VERSION_LEGACY = 0x00
+/** Batched payload: [version:u8 = 1][count:u8] then count × [seq:u32][tUs:u64]. */
+const val ESP_PAYLOAD_VERSION_BATCH = 0x01
+const val ESP_BATCH_HEADER_LEN = 2
+const val ESP_RECORD_LEN = 12
+/** Timed payload: [version:u8 = 2][flags:u8][seq:u32][tUs:u64][prevSeq:u32][prevSendDelayUs:u32]. */
+const val ESP_PAYLOAD_VERSION_TIMED = 0x02
+const val ESP_TIMED_PAYLOAD_LEN = 22
+/** Timed-payload flag bits: where prevSendDelayUs was measured. Neither set = no delay for prevSeq. */
+const val ESP_TIMED_FLAG_DELAY_CONF = 0x01
+const val ESP_TIMED_FLAG_DELAY_CALL = 0x02
+/**
+ * Broadcast payload, sent connectionless in advertising manufacturer data (company [ESP_BEACON_COMPANY_ID])
+ * rather than as a notification: [version:u8 = 3][seq:u32][tUs:u64].
+ */
+const val ESP_PAYLOAD_VERSION_BEACON = 0x03
+const val ESP_BEACON_PAYLOAD_LEN = 13
+const val ESP_BEACON_COMPANY_ID = 0xFFFF
+/**
+ * Delta payload: [version:u8 = 5][count:u8][periodUs:u32][seq:u32][tUs:u64] then count - 1 varints. Record i
+ * is seq + i, at the previous record's tUs + periodUs + the zigzag-decoded LEB128 varint i.
+ */
+const val ESP_PAYLOAD_VERSION_DELTA = 0x05
+const val ESP_DELTA_HEADER_LEN = 18
+/**
+ * Root-time broadcast (firmware SENSOR_TIME_ROLE), in manufacturer data like [ESP_PAYLOAD_VERSION_BEACON]:
+ * [version:u8 = 6][hop:u8][seq:u32][tUs:u64][errUs:u16]. tUs is the root beacon's clock, converted hop by hop by
+ * the relays, so every beacon of one tree fits onto the same timeline. Hop [ESP_ROOT_TIME_HOP_UNSYNCED]: a relay
+ * without a parent, whose tUs is not root time.
+ */
+const val ESP_PAYLOAD_VERSION_ROOT_TIME = 0x06
+const val ESP_ROOT_TIME_PAYLOAD_LEN = 16
+const val ESP_ROOT_TIME_HOP_UNSYNCED = 0xFF
+/**
+ * Thermal payload (firmware SENSOR_TEMPERATURE): [version:u8 = 7][count:u8][tempCdeg:i16] then count × [seq:u32][tUs:u64].
+ * tempCdeg is the beacon's die temperature in centi-degrees C when the payload was built; [ESP_TEMPERATURE_UNKNOWN] = none.
+ */
+const val ESP_PAYLOAD_VERSION_THERMAL = 0x07
+const val ESP_THERMAL_HEADER_LEN = 4
+const val ESP_TEMPERATURE_UNKNOWN = Short.MIN_VALUE.toInt()
+
+/**
+ * Walk a delta payload (the first [length] bytes of [value]) without allocating: [onRecord] gets each
+ * record's (seq, tUs), oldest first. The varints are bounds-checked before the first call, so a truncated
+ * value yields no records. Returns the record count, or -1 for another version or a truncated value.
+ */
+inline fun forEachEspDeltaRecord(
+    value: ByteArray,
+    length: Int = value.size,
+    onRecord: (seq: Long, tUs: Long) -> Unit
+): Int {
+    if (length < ESP_DELTA_HEADER_LEN || (value[0].toInt() and 0xFF) != ESP_PAYLOAD_VERSION_DELTA) return -1
+    val count = value[1].toInt() and 0xFF
+    if (count == 0) return -1
+    var offset = ESP_DELTA_HEADER_LEN
+    for (i in 1 until count) {
+        do {
+            if (offset >= length) return -1
+        } while (value[offset++] < 0) // high bit set: continuation byte
+    }
+
+    val periodUs = u32LE(value, 2)
+    var seq = u32LE(value, 6)
+    var tUs = u64LE(value, 10)
+    onRecord(seq, tUs)
+    offset = ESP_DELTA_HEADER_LEN
+    for (i in 1 until count) {
+        var zigzag = 0L
+        var shift = 0
+        do {
+            val b = value[offset++].toInt()
+            zigzag = zigzag or ((b and 0x7F).toLong() shl shift)
+            shift += 7
+        } while (b < 0)
+        tUs += periodUs + ((zigzag ushr 1) xor -(zigzag and 1))
+        seq = (seq + 1) and 0xFFFF_FFFFL
+        onRecord(seq, tUs)
+    }
+    return count
+}
+
+/** Write a legacy payload ([seq:u32][tUs:u64] LE) into [out] (at least [ESP_LEGACY_PAYLOAD_LEN] bytes). */
+fun encodeEspLegacyPayload(seq: Long, tUs: Long, out: ByteArray) {
+    for (i in 0 until 4) out[i] = (seq ushr (8 * i)).toByte()
+    for (i in 0 until 8) out[4 + i] = (tUs ushr (8 * i)).toByte()
+}
+
+/** Receives the records of one notification from [decodeEspPayloadInto], oldest first, as primitives. */
+fun interface EspRecordSink {
+    /** [prevSeq] and [prevSendDelayUs] as in EspPacket: UNKNOWN except for timed payloads. */
+    fun onRecord(seq: Long, tUs: Long, prevSeq: Long, prevSendDelayUs: Long)
+}
+
+/**
+ * Decode one ESP32 notification without allocating. [view] is a little-endian ByteBuffer wrapping the
+ * payload array (ByteBuffer.wrap, so positions 0 until limit are the value); only absolute reads are used,
+ * so one view can be kept per payload array. Each record goes to [sink], oldest first.
+ * A 12-byte value is the legacy format; anything else is dispatched on its version byte.
+ * Broadcast manufacturer data (company ID stripped) decodes through here too.
+ * Returns the record count: 0 for unknown versions or truncated values.
+ */
+fun decodeEspPayloadInto(view: ByteBuffer, sink: EspRecordSink): Int {
+    val size = view.limit()
+    val unknown = EspPacket.UNKNOWN
+    if (size == ESP_LEGACY_PAYLOAD_LEN) {
+        sink.onRecord(view.u32(0), view.getLong(4), unknown, unknown)
+        return 1
+    }
+    if (size < ESP_BATCH_HEADER_LEN) return 0
+
+    return when (view.get(0).toInt() and 0xFF) {
+        ESP_PAYLOAD_VERSION_BATCH -> {
+            val count = view.get(1).toInt() and 0xFF
+            if (size < ESP_BATCH_HEADER_LEN + count * ESP_RECORD_LEN) return 0
+            for (i in 0 until count) {
+                val offset = ESP_BATCH_HEADER_LEN + i * ESP_RECORD_LEN
+                sink.onRecord(view.u32(offset), view.getLong(offset + 4), unknown, unknown)
+            }
+            count
+        }
+        ESP_PAYLOAD_VERSION_THERMAL -> {
+            val count = view.get(1).toInt() and 0xFF
+            if (size < ESP_THERMAL_HEADER_LEN + count * ESP_RECORD_LEN) return 0
+            for (i in 0 until count) {
+                val offset = ESP_THERMAL_HEADER_LEN + i * ESP_RECORD_LEN
+                sink.onRecord(view.u32(offset), view.getLong(offset + 4), unknown, unknown)
+            }
+            count
+        }
+        ESP_PAYLOAD_VERSION_TIMED -> {
+            if (size < ESP_TIMED_PAYLOAD_LEN) return 0
+            val flags = view.get(1).toInt() and 0xFF
+            val hasDelay = flags and (ESP_TIMED_FLAG_DELAY_CONF or ESP_TIMED_FLAG_DELAY_CALL) != 0
+            sink.onRecord(view.u32(2), view.getLong(6), view.u32(14), if (hasDelay) view.u32(18) else unknown)
+            1
+        }
+        ESP_PAYLOAD_VERSION_BEACON -> {
+            if (size < ESP_BEACON_PAYLOAD_LEN) return 0
+            sink.onRecord(view.u32(1), view.getLong(5), unknown, unknown)
+            1
+        }
+        ESP_PAYLOAD_VERSION_ROOT_TIME -> {
+            // An unsynced relay's own clock would corrupt a root-time fit: skip it until it has a parent
+            if (size < ESP_ROOT_TIME_PAYLOAD_LEN || (view.get(1).toInt() and 0xFF) == ESP_ROOT_TIME_HOP_UNSYNCED) return 0
+            sink.onRecord(view.u32(2), view.getLong(6), unknown, unknown)
+            1
+        }
+        ESP_PAYLOAD_VERSION_DELTA -> {
+            // Varints are byte-serial anyway, so walk the backing array directly
+            forEachEspDeltaRecord(view.array(), size) { seq, tUs -> sink.onRecord(seq, tUs, unknown, unknown) }
+                .coerceAtLeast(0)
+        }
+        else -> 0
+    }
+}
+
+/** A well-formed root-time frame from a relay without a parent: valid, but carries no root-time record. */
+fun isEspUnsyncedRootTime(view: ByteBuffer): Boolean =
+    view.limit() >= ESP_ROOT_TIME_PAYLOAD_LEN &&
+        (view.get(0).toInt() and 0xFF) == ESP_PAYLOAD_VERSION_ROOT_TIME &&
+        (view.get(1).toInt() and 0xFF) == ESP_ROOT_TIME_HOP_UNSYNCED
+
+/**
+ * [decodeEspPayloadInto] collected into packets, all stamped with the same phone receive time.
+ * Allocates per record; the receive path uses the sink form. Empty for unknown versions or truncated values.
+ */
+fun decodeEspPayload(value: ByteArray, receivedAtNs: Long): List<EspPacket> {
+    val packets = ArrayList<EspPacket>()
+    decodeEspPayloadInto(ByteBuffer.wrap(value).order(ByteOrder.LITTLE_ENDIAN)) { seq, tUs, prevSeq, prevSendDelayUs ->
+        packets.add(EspPacket(seq, tUs, receivedAtNs, prevSeq, prevSendDelayUs))
+    }
+    return packets
+}
+
+/** The beacon temperature (°C) a thermal payload carries, or NaN for other payloads and unknown readings. */
+fun espPayloadTemperatureC(view: ByteBuffer): Double {
+    if (view.limit() < ESP_THERMAL_HEADER_LEN || view.limit() == ESP_LEGACY_PAYLOAD_LEN) return Double.NaN
+    if ((view.get(0).toInt() and 0xFF) != ESP_PAYLOAD_VERSION_THERMAL) return Double.NaN
+    val cdeg = view.getShort(2).toInt()
+    return if (cdeg == ESP_TEMPERATURE_UNKNOWN) Double.NaN else cdeg / 100.0
+}
+
+private fun ByteBuffer.u32(index: Int): Long = getInt(index).toLong() and 0xFFFF_FFFFL
+
+/** Event payload: [version:u8 = 4][count:u8] then count × [seq:u32][tUs:u64][peak:u32][flags:u8]. */
+const val ESP_PAYLOAD_VERSION_EVENTS = 0x04
+const val ESP_EVENT_RECORD_LEN = 17
+const val ESP_EVENT_FLAG_GAP = 0x01
+
+/** Decode an event notification, oldest first. Empty for another version or a truncated value. */
+fun decodeEspAcousticEvents(value: ByteArray, receivedAtNs: Long): List<EspAcousticEvent> {
+    if (value.size < ESP_BATCH_HEADER_LEN || (value[0].toInt() and 0xFF) != ESP_PAYLOAD_VERSION_EVENTS) return emptyList()
+    val count = value[1].toInt() and 0xFF
+    if (value.size < ESP_BATCH_HEADER_LEN + count * ESP_EVENT_RECORD_LEN) return emptyList()
+    return List(count) { i ->
+        val offset = ESP_BATCH_HEADER_LEN + i * ESP_EVENT_RECORD_LEN
+        EspAcousticEvent(
+            seq = u32LE(value, offset),
+            tUs = u64LE(value, offset + 4),
+            peak = u32LE(value, offset + 12),
+            timingUncertain = (value[offset + 16].toInt() and ESP_EVENT_FLAG_GAP) != 0,
+            receivedAtNs = receivedAtNs
+        )
+    }
+}
+
+const val ESP_DETECTOR_CONFIG_VERSION = 0x01
+const val ESP_DETECTOR_WRITE_LEN = 13
+const val ESP_DETECTOR_CONFIG_LEN = 21
+
+/**
+ * Decode the detector characteristic (esp32 acoustic_events.h), little-endian:
+ * [version:u8 = 1][kX10:u16][releaseX10:u16][minLevel:u32][holdMs:u16][floorMs:u16][noiseFloor:u32][noiseSigma:u32].
+ * Null for another version or a truncated value.
+ */
+fun decodeEspDetectorConfig(value: ByteArray): EspDetectorConfig? {
+    if (value.size < ESP_DETECTOR_CONFIG_LEN || (value[0].toInt() and 0xFF) != ESP_DETECTOR_CONFIG_VERSION) return null
+    return EspDetectorConfig(
+        kX10 = u16LE(value, 1),
+        releaseX10 = u16LE(value, 3),
+        minLevel = u32LE(value, 5),
+        holdMs = u16LE(value, 9),
+        floorMs = u16LE(value, 11),
+        noiseFloor = u32LE(value, 13),
+        noiseSigma = u32LE(value, 17)
+    )
+}
+
+/** Detector write value: the first ESP_DETECTOR_WRITE_LEN bytes of the layout above (settings, no noise estimate). */
+fun encodeEspDetectorConfig(config: EspDetectorConfig): ByteArray {
+    val out = ByteArray(ESP_DETECTOR_WRITE_LEN)
+    fun put(offset: Int, v: Long, bytes: Int) {
+        for (i in 0 until bytes) out[offset + i] = (v ushr (8 * i)).toByte()
+    }
+    out[0] = ESP_DETECTOR_CONFIG_VERSION.toByte()
+    put(1, config.kX10.toLong(), 2)
+    put(3, config.releaseX10.toLong(), 2)
+    put(5, config.minLevel, 4)
+    put(9, config.holdMs.toLong(), 2)
+    put(11, config.floorMs.toLong(), 2)
+    return out
+}
+
+const val ESP_CONN_PARAMS_LEN = 6
+
+/** Decode the connection-parameter characteristic; null if truncated or not yet negotiated (all zero). */
+fun decodeEspConnParams(value: ByteArray): EspConnParams? {
+    if (value.size < ESP_CONN_PARAMS_LEN) return null
+    val params = EspConnParams(u16LE(value, 0), u16LE(value, 2), u16LE(value, 4))
+    return if (params.intervalUnits == 0) null else params
+}
+
+const val ESP_RTT_REQUEST_LEN = 8
+const val ESP_RTT_RESPONSE_LEN = 20
+
+const val ESP_RATE_FEEDBACK_LEN = 6
+
+/**
+ * Rate-control write value, little-endian: [rmsUs:u32][samples:u16], the fit residual and the samples it rests on.
+ * The beacon drops to its maintenance rate once every receiver reports a settled fit. Both saturate.
+ */
+fun encodeEspRateFeedback(rmsResidualMs: Double, sampleCount: Int): ByteArray {
+    val rmsUs = (rmsResidualMs * 1000.0).coerceIn(0.0, 4_294_967_295.0).toLong()
+    val samples = sampleCount.coerceIn(0, 0xFFFF).toLong()
+    val out = ByteArray(ESP_RATE_FEEDBACK_LEN)
+    for (i in 0 until 4) out[i] = (rmsUs ushr (8 * i)).toByte()
+    for (i in 0 until 2) out[4 + i] = (samples ushr (8 * i)).toByte()
+    return out
+}
+
+const val ESP_CAPS_VERSION_MIN = 0x01
+const val ESP_CAPS_LEN = 14
+/** Timestamp unit: esp_timer microseconds since boot. */
+const val ESP_CAPS_UNIT_US_BOOT = 0x00
+const val ESP_CAPS_FEATURE_EVENTS = 0x0001
+const val ESP_CAPS_FEATURE_ADAPTIVE_RATE = 0x0002
+const val ESP_CAPS_FEATURE_TEMPERATURE = 0x0004
+const val ESP_CAPS_FEATURE_LOW_POWER = 0x0008
+const val ESP_CAPS_FEATURE_TIMER = 0x0010
+
+/**
+ * Decode the capabilities characteristic, little-endian: [capsVersion:u8][format:u8][recordLen:u8][batchSize:u8]
+ * [queueLength:u8][timestampUnit:u8][formats:u16][features:u16][periodUs:u32]. Later versions may append fields.
+ * Null if truncated.
+ */
+fun decodeEspCapabilities(value: ByteArray): EspCapabilities? {
+    if (value.size < ESP_CAPS_LEN || (value[0].toInt() and 0xFF) < ESP_CAPS_VERSION_MIN) return null
+    return EspCapabilities(
+        version = value[0].toInt() and 0xFF,
+        format = value[1].toInt() and 0xFF,
+        recordLen = value[2].toInt() and 0xFF,
+        batchSize = value[3].toInt() and 0xFF,
+        queueLength = value[4].toInt() and 0xFF,
+        timestampUnit = value[5].toInt() and 0xFF,
+        formatMask = u16LE(value, 6),
+        features = u16LE(value, 8),
+        periodUs = u32LE(value, 10)
+    )
+}
+
+/**
+ * The sensor format to switch [caps]'s connection to, or null to keep the one it has. Densest first: delta, then
+ * batch, but only where several records share a notification (a batch size of 1 asks for per-sample latency) and
+ * only away from a format that carries more than records (timed: send delay, thermal: temperature). Streams
+ * this decoder cannot read (another record size or timestamp unit) are left alone.
+ */
+fun chooseEspSensorFormat(caps: EspCapabilities): Int? {
+    if (caps.recordLen != ESP_RECORD_LEN || caps.timestampUnit != ESP_CAPS_UNIT_US_BOOT) return null
+    if (caps.format == ESP_PAYLOAD_VERSION_TIMED || caps.format == ESP_PAYLOAD_VERSION_THERMAL) return null
+    if (caps.batchSize < 2) return null
+    val best = listOf(ESP_PAYLOAD_VERSION_DELTA, ESP_PAYLOAD_VERSION_BATCH).firstOrNull(caps::supportsFormat) ?: return null
+    return best.takeIf { it != caps.format }
+}
+
+/** Short name of a sensor payload version, for logs and the UI. */
+fun espFormatName(version: Int): String = when (version) {
+    ESP_PAYLOAD_VERSION_LEGACY -> "legacy"
+    ESP_PAYLOAD_VERSION_BATCH -> "batch"
+    ESP_PAYLOAD_VERSION_TIMED -> "timed"
+    ESP_PAYLOAD_VERSION_DELTA -> "delta"
+    ESP_PAYLOAD_VERSION_THERMAL -> "thermal"
+    else -> "0x%02x".format(version)
+}
+
+/** Round-trip request value: the phone's send time, echoed back unchanged by the ESP32. */
+fun encodeEspRoundTripRequest(phoneSendNs: Long): ByteArray =
+    ByteArray(ESP_RTT_REQUEST_LEN) { i -> (phoneSendNs ushr (8 * i)).toByte() }
+
+/** Decode a round-trip notification received at [receivedAtNs]; null if truncated. */
+fun decodeEspRoundTrip(value: ByteArray, receivedAtNs: Long): EspRoundTrip? {
+    if (value.size < ESP_RTT_RESPONSE_LEN) return null
+    val rxUs = u64LE(value, 8)
+    return EspRoundTrip(
+        phoneSendNs = u64LE(value, 0),
+        beaconRxUs = rxUs,
+        beaconTxUs = rxUs + u32LE(value, 16),
+        phoneRxNs = receivedAtNs
+    )
+}
+
+const val ESP_DIAG_VERSION_MIN = 0x01
+const val ESP_DIAG_VERSION = 0x04
+const val ESP_DIAG_POWER_FLAG_SLEEP_COUNTED = 0x02
+const val ESP_DIAG_HEADER_LEN = 56
+
+/**
+ * Decode the diagnostics characteristic (esp32 diagnostics.h), little-endian:
+ * [version:u8][bucketCount:u8][errSlotCount:u8][reserved][tUs:u64][sendCalls:u32][sendFailures:u32]
+ * [sendMaxUs:u32][congestEvents:u32][congestedMs:u32][wakeCount:u32][wakeLateMaxUs:u32][wakeLateSumUs:u64]
+ * [freeHeap:u32][minFreeHeap:u32], then bucketCount x u32, then errSlotCount x [err:i32][count:u32],
+ * then (version 2) [queueDropped:u32][queueCoalesced:u32], then (version 3) [bootId:u32],
+ * then (version 4) [sleepClockPpm:u16][powerFlags:u8][reserved][sleptMs:u32].
+ * Null for an unknown version or a truncated value.
+ */
+fun decodeEspDiagnostics(value: ByteArray): EspDiagnostics? {
+    if (value.size < ESP_DIAG_HEADER_LEN) return null
+    val version = value[0].toInt() and 0xFF
+    if (version < ESP_DIAG_VERSION_MIN || version > ESP_DIAG_VERSION) return null
+    val buckets = value[1].toInt() and 0xFF
+    val errSlots = value[2].toInt() and 0xFF
+    val errOffset = ESP_DIAG_HEADER_LEN + buckets * 4
+    val queueOffset = errOffset + errSlots * 8
+    val tailLen = when {
+        version >= 4 -> 20
+        version >= 3 -> 12
+        version >= 2 -> 8
+        else -> 0
+    }
+    if (value.size < queueOffset + tailLen) return null
+    val errors = LinkedHashMap<Int, Long>()
+    for (i in 0 until errSlots) {
+        val count = u32LE(value, errOffset + i * 8 + 4)
+        if (count > 0) errors[u32LE(value, errOffset + i * 8).toInt()] = count
+    }
+    return EspDiagnostics(
+        tUs = u64LE(value, 4),
+        sendCalls = u32LE(value, 12),
+        sendFailures = u32LE(value, 16),
+        sendMaxUs = u32LE(value, 20),
+        sendLatencyBuckets = List(buckets) { i -> u32LE(value, ESP_DIAG_HEADER_LEN + i * 4) },
+        sendErrors = errors,
+        congestEvents = u32LE(value, 24),
+        congestedMs = u32LE(value, 28),
+        wakeCount = u32LE(value, 32),
+        wakeLateMaxUs = u32LE(value, 36),
+        wakeLateSumUs = u64LE(value, 40),
+        freeHeapBytes = u32LE(value, 48),
+        minFreeHeapBytes = u32LE(value, 52),
+        queueDropped = if (version >= 2) u32LE(value, queueOffset) else 0,
+        queueCoalesced = if (version >= 2) u32LE(value, queueOffset + 4) else 0,
+        bootId = if (version >= 3) u32LE(value, queueOffset + 8) else null,
+        sleepClockPpm = if (version >= 4) u16LE(value, queueOffset + 12) else 0,
+        sleptMs = if (version >= 4) u32LE(value, queueOffset + 16) else 0,
+        sleepCounted = version >= 4 && (value[queueOffset + 14].toInt() and ESP_DIAG_POWER_FLAG_SLEEP_COUNTED) != 0
+    )
+}
+
 // ----- Byte parsing (little-endian) -----
+/** Read 2 bytes as unsigned 16-bit little-endian. */
+fun u16LE(bytes: ByteArray, offset: Int): Int =
+    (bytes[offset].toInt() and 0xFF) or ((bytes[offset + 1].toInt() and 0xFF) shl 8)
+
 /** Read 4 bytes as unsigned 32-bit little-endian. */
 fun u32LE(bytes: ByteArray, offset: Int): Long =
-    ((bytes[offset].toUByte().toLong() and 0xFF) shl 0) or
-            ((bytes[offset + 1].toUByte().toLong() and 0xFF) shl 8) or
-            ((bytes[offset + 2].toUByte().toLong() and 0xFF) shl 16) or
-            ((bytes[offset + 3].toUByte().toLong() and 0xFF) shl 24)
+    (u16LE(bytes, offset).toLong()) or (u16LE(bytes, offset + 2).toLong() shl 16)
 
-/** Read 8 bytes as unsigned 64-bit little-endian. */
+/** Read 8 bytes as 64-bit little-endian (beacon times never reach the sign bit). */
 fun u64LE(bytes: ByteArray, offset: Int): Long =
-    ((bytes[offset].toUByte().toLong() and 0xFF) shl 0) or
-            ((bytes[offset + 1].toUByte().toLong() and 0xFF) shl 8) or
-            ((bytes[offset + 2].toUByte().toLong() and 0xFF) shl 16) or
-            ((bytes[offset + 3].toUByte().toLong() and 0xFF) shl 24) or
-            ((bytes[offset + 4].toUByte().toLong() and 0xFF) shl 32) or
-            ((bytes[offset + 5].toUByte().toLong() and 0xFF) shl 40) or
-            ((bytes[offset + 6].toUByte().toLong() and 0xFF) shl 48) or
-            ((bytes[offset + 7].toUByte().toLong() and 0xFF) shl 56)
+    u32LE(bytes, offset) or (u32LE(bytes, offset + 4) shl 32)
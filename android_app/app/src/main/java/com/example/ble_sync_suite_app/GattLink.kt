@@ -0,0 +1,216 @@
+package com.example.ble_sync_suite_app
+
+// GATT link: one BluetoothGatt's connection state, the ESP32 characteristics resolved after discovery, and
+// the queue that runs its operations one at a time (Android allows one outstanding operation per connection).
+
+import android.annotation.SuppressLint
+import android.bluetooth.BluetoothDevice
+import android.bluetooth.BluetoothGatt
+import android.bluetooth.BluetoothGattCharacteristic
+import android.os.Handler
+import android.os.Looper
+import android.os.SystemClock
+import android.util.Log
+import java.util.UUID
+
+/** Where a [GattLink] is in its life. Transitions happen on GATT callback threads and the main thread. */
+internal enum class LinkState {
+    /** connectGatt issued; waiting for STATE_CONNECTED. */
+    CONNECTING,
+    /** Connected; MTU, discovery and subscriptions run through [GattLink.ops]. */
+    SETTING_UP,
+    /** Setup done: periodic operations (round trips, diagnostics) may be queued. */
+    READY,
+    /** disconnect() issued so that a new link can be opened once the stack reports this one down. */
+    REPLACING,
+    /** gatt closed; nothing more happens on this link. */
+    CLOSED
+}
+
+/** ESP32 service characteristics, looked up once per link. Optional ones are null on firmware without them. */
+internal class GattHandles(
+    val sensor: BluetoothGattCharacteristic,
+    val connParams: BluetoothGattCharacteristic?,
+    val roundTrip: BluetoothGattCharacteristic?,
+    val diagnostics: BluetoothGattCharacteristic?,
+    val events: BluetoothGattCharacteristic?,
+    val detector: BluetoothGattCharacteristic?,
+    val rateControl: BluetoothGattCharacteristic?,
+    val capabilities: BluetoothGattCharacteristic?
+) {
+    companion object {
+        /** Null if discovery did not find the ESP32 service or its sensor characteristic. */
+        fun resolve(gatt: BluetoothGatt): GattHandles? {
+            val service = gatt.getService(ESP32_SERVICE_UUID) ?: return null
+            return GattHandles(
+                sensor = service.getCharacteristic(ESP32_CHAR_UUID) ?: return null,
+                connParams = service.getCharacteristic(ESP32_CONN_CHAR_UUID),
+                roundTrip = service.getCharacteristic(ESP32_RTT_CHAR_UUID),
+                diagnostics = service.getCharacteristic(ESP32_DIAG_CHAR_UUID),
+                events = service.getCharacteristic(ESP32_EVENT_CHAR_UUID),
+                detector = service.getCharacteristic(ESP32_DETECTOR_CHAR_UUID),
+                rateControl = service.getCharacteristic(ESP32_RATE_CHAR_UUID),
+                capabilities = service.getCharacteristic(ESP32_CAPS_CHAR_UUID)
+            )
+        }
+    }
+}
+
+/**
+ * One connection attempt to [device] and, once it is up, the connection itself. A reconnect opens a new
+ * link; [reconnectAttempts] carries over so a beacon out of range is eventually given up on.
+ */
+internal class GattLink(val device: BluetoothDevice, val reconnectAttempts: Int = 0) {
+    /** Set right after connectGatt returns (a callback that beats it adopts its gatt, see BleManager). */
+    @Volatile
+    var gatt: BluetoothGatt? = null
+
+    @Volatile
+    var state: LinkState = LinkState.CONNECTING
+        private set
+
+    /** Created on STATE_CONNECTED; null while connecting. */
+    @Volatile
+    var ops: GattOpQueue? = null
+
+    /** Resolved after discovery; null until then. */
+    @Volatile
+    var handles: GattHandles? = null
+
+    /** Move to [to] unless the link was closed or is being replaced: both only end in [close]. */
+    @Synchronized
+    fun advance(to: LinkState): Boolean {
+        if (state == LinkState.CLOSED || state == LinkState.REPLACING) return false
+        state = to
+        return true
+    }
+
+    /** Drop queued operations and close the gatt. Returns the state it was in, or null if it was already closed. */
+    @SuppressLint("MissingPermission")
+    fun close(): LinkState? {
+        val was = synchronized(this) {
+            if (state == LinkState.CLOSED) return null
+            state.also { state = LinkState.CLOSED }
+        }
+        ops?.close()
+        try { gatt?.close() } catch (_: SecurityException) {}
+        return was
+    }
+}
+
+/** One GATT operation for [GattOpQueue]. */
+internal class GattOp(
+    val kind: Kind,
+    /** Characteristic the completion callback names (for DESCRIPTOR_WRITE, the descriptor's characteristic). */
+    val uuid: UUID?,
+    /** Start the operation; false if the stack refused it. Runs when the operation reaches the queue head. */
+    val issue: (BluetoothGatt) -> Boolean,
+    /** Completion: a GATT status, or [GattOpQueue.STATUS_NOT_ISSUED] / [GattOpQueue.STATUS_TIMEOUT]. */
+    val onDone: (Int) -> Unit = {}
+) {
+    enum class Kind { MTU, DISCOVER, READ, WRITE, DESCRIPTOR_WRITE, LOCAL }
+
+    companion object {
+        /** Runs [action] in queue order without touching the link (e.g. "setup finished"). */
+        fun local(action: () -> Unit) = GattOp(Kind.LOCAL, null, { true }, { action() })
+    }
+}
+
+/**
+ * Runs [GattOp]s on [gatt] strictly one after another: the next is issued when the callback for the one in
+ * flight arrives ([complete]), when the stack refuses it, or after [timeoutMs] without an answer.
+ * Callable from any thread; [GattOp.issue] and [GattOp.onDone] run on whichever thread advanced the queue.
+ */
+internal class GattOpQueue(
+    private val gatt: BluetoothGatt,
+    private val timeoutMs: Long = DEFAULT_TIMEOUT_MS
+) {
+    private val handler = Handler(Looper.getMainLooper())
+    private val pending = ArrayDeque<GattOp>()
+    private var inFlight: GattOp? = null
+    private var closed = false
+
+    fun enqueue(op: GattOp) {
+        synchronized(this) {
+            if (closed) return
+            pending.addLast(op)
+        }
+        next()
+    }
+
+    /** Enqueue [op] only if the queue is idle: periodic operations skip a turn rather than pile up. */
+    fun offer(op: GattOp): Boolean {
+        synchronized(this) {
+            if (closed || inFlight != null || pending.isNotEmpty()) return false
+            pending.addLast(op)
+        }
+        next()
+        return true
+    }
+
+    /** From the BluetoothGattCallback method for [kind]. Ignored unless it answers the operation in flight. */
+    fun complete(kind: GattOp.Kind, uuid: UUID?, status: Int) {
+        val op = synchronized(this) {
+            val op = inFlight
+            if (op == null || op.kind != kind || op.uuid != uuid) return
+            inFlight = null
+            op
+        }
+        handler.removeCallbacksAndMessages(op)
+        op.onDone(status)
+        next()
+    }
+
+    /** Drop everything queued; later completions are ignored. */
+    fun close() {
+        synchronized(this) {
+            closed = true
+            pending.clear()
+            inFlight = null
+        }
+        handler.removeCallbacksAndMessages(null)
+    }
+
+    private fun next() {
+        while (true) {
+            val op = synchronized(this) {
+                if (closed || inFlight != null) return
+                val op = pending.removeFirstOrNull() ?: return
+                if (op.kind != GattOp.Kind.LOCAL) inFlight = op
+                op
+            }
+            if (op.kind == GattOp.Kind.LOCAL) {
+                op.onDone(BluetoothGatt.GATT_SUCCESS)
+                continue
+            }
+            // Armed before issuing, so a completion racing onto another thread always finds it to cancel
+            handler.postAtTime({ timedOut(op) }, op, SystemClock.uptimeMillis() + timeoutMs)
+            val issued = try { op.issue(gatt) } catch (_: SecurityException) { false }
+            if (issued) return
+            handler.removeCallbacksAndMessages(op)
+            synchronized(this) {
+                if (inFlight !== op) return
+                inFlight = null
+            }
+            op.onDone(STATUS_NOT_ISSUED)
+        }
+    }
+
+    private fun timedOut(op: GattOp) {
+        synchronized(this) {
+            if (inFlight !== op) return
+            inFlight = null
+        }
+        Log.w("BLE", "[${gatt.device.address}] GATT ${op.kind} ${op.uuid ?: ""} timed out")
+        op.onDone(STATUS_TIMEOUT)
+        next()
+    }
+
+    companion object {
+        /** The stack refused to start the operation (busy, not connected, or missing permission). */
+        const val STATUS_NOT_ISSUED = -1
+        /** No callback within the timeout; the queue moved on. */
+        const val STATUS_TIMEOUT = -2
+        const val DEFAULT_TIMEOUT_MS = 5_000L
+    }
+}
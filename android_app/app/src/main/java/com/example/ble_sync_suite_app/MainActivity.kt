@@ -1,13 +1,17 @@
 package com.example.ble_sync_suite_app
 
-// Main entry: permissions, navigation (welcome -> menu -> scanner -> data -> sync stats), BleManager wiring.
+// Main entry: permissions, navigation (welcome -> menu -> scanner -> data -> sync stats), binding to SyncService.
 
 import android.Manifest
 import android.annotation.SuppressLint
+import android.content.ComponentName
 import android.content.Context
+import android.content.Intent
+import android.content.ServiceConnection
 import android.content.pm.PackageManager
 import android.os.Build
 import android.os.Bundle
+import android.os.IBinder
 import android.util.Log
 import android.widget.Toast
 import androidx.activity.ComponentActivity
@@ -21,7 +25,6 @@ import androidx.compose.runtime.getValue
 import androidx.compose.runtime.mutableStateListOf
 import androidx.compose.runtime.mutableStateOf
 import androidx.compose.runtime.setValue
-import androidx.compose.runtime.snapshots.SnapshotStateList
 import androidx.core.content.ContextCompat
 import com.example.ble_sync_suite_app.ui.screens.DataDisplayScreen
 import com.example.ble_sync_suite_app.ui.screens.GraphScreen
@@ -44,10 +47,9 @@ class MainActivity : ComponentActivity() {
     private var isScanning by mutableStateOf(false)
     private var searchQuery by mutableStateOf("")
     private var connectedDeviceName by mutableStateOf("")
-    private val scannedDevices: SnapshotStateList<String> = mutableStateListOf()
+    private var scannedDevices by mutableStateOf<List<ScannedDevice>>(emptyList())
+    private var scanMode by mutableStateOf(ScanMode.ESP32)
     private val characteristicInfoList = mutableStateListOf<CharacteristicInfo>()
-    /** Kept for the Sync statistics screen (GraphScreen); capped at 1000. */
-    private val esp32PacketHistory = mutableStateListOf<EspPacket>()
     private val _latestEspPacket = kotlinx.coroutines.flow.MutableStateFlow<EspPacket?>(null)
     val latestEspPacket = _latestEspPacket.asStateFlow()
 
@@ -56,6 +58,8 @@ class MainActivity : ComponentActivity() {
     private fun permissionsToRequest(): Array<String> {
         val required = mutableListOf(Manifest.permission.ACCESS_FINE_LOCATION, Manifest.permission.ACCESS_COARSE_LOCATION)
         if (isAtLeastS) required += listOf(PERMISSION_BLUETOOTH_SCAN, PERMISSION_BLUETOOTH_CONNECT)
+        // Android 13+: without it the sync service's notification is hidden (the service still runs)
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) required += Manifest.permission.POST_NOTIFICATIONS
         return required.toTypedArray()
     }
     private fun hasConnectPermission(context: Context = this) =
@@ -63,7 +67,41 @@ class MainActivity : ComponentActivity() {
     private fun hasScanPermission() =
         !isAtLeastS || ContextCompat.checkSelfPermission(this, PERMISSION_BLUETOOTH_SCAN) == PackageManager.PERMISSION_GRANTED
 
+    /** Owned by SyncService; set once bound, and outlives this activity while a session is open. */
     private lateinit var bleManager: BleManager
+    private var serviceBound = false
+
+    private val managerListener = object : BleManager.Listener {
+        override fun onDevicesUpdated(devices: List<ScannedDevice>) { scannedDevices = devices }
+        override fun onConnected(name: String) {
+            connectedDeviceName = name
+            showScannerScreen = false
+            showDataScreen = true
+        }
+        override fun onDisconnected() {
+            isScanning = false
+            showDataScreen = false
+            showGraphScreen = false
+            showScannerScreen = false
+            showMainMenu = true
+        }
+        override fun onCharacteristicsDiscovered(list: List<CharacteristicInfo>) {
+            characteristicInfoList.clear()
+            characteristicInfoList.addAll(list)
+        }
+        override fun onPacketReceived(packet: EspPacket) { _latestEspPacket.value = packet }
+    }
+
+    private val serviceConnection = object : ServiceConnection {
+        override fun onServiceConnected(name: ComponentName, service: IBinder) {
+            val firstBind = !::bleManager.isInitialized
+            bleManager = (service as SyncService.LocalBinder).manager
+            bleManager.listener = managerListener
+            if (firstBind) showUi()
+        }
+        // Same process: only if it crashed, which takes this activity with it
+        override fun onServiceDisconnected(name: ComponentName) {}
+    }
 
     /** If user had asked to scan before permission was granted, start scan after grant. */
     private val permissionLauncher = registerForActivityResult(ActivityResultContracts.RequestMultiplePermissions()) { results ->
@@ -72,10 +110,10 @@ class MainActivity : ComponentActivity() {
             startScanWhenPermissionGranted = false
         } else {
             Toast.makeText(this, "All permissions granted!", Toast.LENGTH_SHORT).show()
-            if (startScanWhenPermissionGranted && hasScanPermission()) {
+            if (startScanWhenPermissionGranted && hasScanPermission() && ::bleManager.isInitialized) {
                 startScanWhenPermissionGranted = false
                 isScanning = true
-                bleManager.startBleScan()
+                bleManager.startBleScan(scanMode)
             } else startScanWhenPermissionGranted = false
         }
     }
@@ -91,33 +129,19 @@ class MainActivity : ComponentActivity() {
             return
         }
 
-        bleManager = BleManager(
-            activity = this,
-            hasScanPermission = { hasScanPermission() },
-            hasConnectPermission = { hasConnectPermission() },
-            onDeviceFound = { display -> if (!scannedDevices.contains(display)) scannedDevices.add(display) },
-            onConnected = { name ->
-                connectedDeviceName = name
-                showScannerScreen = false
-                showDataScreen = true
-            },
-            onDisconnected = {
-                isScanning = false
-                showDataScreen = false
-                showGraphScreen = false
-                showScannerScreen = false
-                showMainMenu = true
-            },
-            onCharacteristicsDiscovered = { list ->
-                characteristicInfoList.clear()
-                characteristicInfoList.addAll(list)
-            },
-            onPacketReceived = { packet ->
-                _latestEspPacket.value = packet
-                esp32PacketHistory.add(packet)
-                if (esp32PacketHistory.size > 1000) esp32PacketHistory.removeAt(0)
-            }
-        )
+        // The service owns the BleManager so that sessions keep running without this activity
+        serviceBound = bindService(Intent(this, SyncService::class.java), serviceConnection, Context.BIND_AUTO_CREATE)
+        if (!serviceBound) Log.e("BLE", "Cannot bind SyncService")
+        requestPermissionsModernWay()
+    }
+
+    /** Set up the UI once the service hands over its BleManager; a capture still running resumes on its data screen. */
+    private fun showUi() {
+        if (bleManager.connectedSessions.value.isNotEmpty()) {
+            showWelcomeScreen = false
+            connectedDeviceName = bleManager.connectedSessions.value.first().name
+            showDataScreen = true
+        }
 
         // Compose UI: single when over which screen to show (order matters; first match wins)
         setContent {
@@ -127,9 +151,18 @@ class MainActivity : ComponentActivity() {
                         showWelcomeScreen -> WelcomeScreen { showWelcomeScreen = false; showMainMenu = true }
                         showGraphScreen -> GraphScreen(
                             onBack = { showGraphScreen = false },
-                            packets = esp32PacketHistory.toList(),
-                            cheepSyncAlpha = bleManager.cheepSyncAlpha,
-                            cheepSyncBeta = bleManager.cheepSyncBeta
+                            syncStats = bleManager.syncStats,
+                            lossStats = bleManager.lossStats,
+                            connParams = bleManager.connParams,
+                            roundTrip = bleManager.roundTrip,
+                            diagnostics = bleManager.diagnostics,
+                            acousticEvents = bleManager.acousticEvents,
+                            detectorConfig = bleManager.detectorConfig,
+                            beaconTemperatureC = bleManager.beaconTemperatureC,
+                            thermalSkewCurve = bleManager.thermalSkewCurve,
+                            residualHistory = bleManager.residualHistory,
+                            skewHistory = bleManager.skewHistory,
+                            capabilities = bleManager.capabilities
                         )
                         showDataScreen -> DataDisplayScreen(
                             deviceName = connectedDeviceName,
@@ -159,21 +192,26 @@ class MainActivity : ComponentActivity() {
                             isScanning = isScanning,
                             searchQuery = searchQuery,
                             scannedDevices = scannedDevices,
+                            scanMode = scanMode,
                             onBack = { bleManager.stopBleScan(); isScanning = false; showScannerScreen = false; showMainMenu = true },
                             onScanToggle = { toggled ->
                                 if (toggled) {
-                                    scannedDevices.clear()
+                                    scannedDevices = emptyList()
                                     ensureScanPermission {
                                         isScanning = true
-                                        bleManager.startBleScan()
+                                        bleManager.startBleScan(scanMode)
                                     }
                                     if (!hasScanPermission()) isScanning = false
                                 } else {
                                     isScanning = false
                                     bleManager.stopBleScan()
-                                    scannedDevices.clear()
+                                    scannedDevices = emptyList()
                                 }
                             },
+                            onScanModeChanged = { mode ->
+                                scanMode = mode
+                                if (isScanning && hasScanPermission()) bleManager.startBleScan(mode)
+                            },
                             onQueryChanged = { searchQuery = it },
                             onDeviceClick = { address, name ->
                                 if (hasConnectPermission()) {
@@ -187,13 +225,30 @@ class MainActivity : ComponentActivity() {
                                 } else Toast.makeText(this, "Bluetooth permission not granted", Toast.LENGTH_SHORT).show()
                             }
                         )
-                        else -> MainMenuScreen { showMainMenu = false; showScannerScreen = true }
+                        else -> MainMenuScreen(
+                            onConnectToDevice = { showMainMenu = false; showScannerScreen = true },
+                            onSimulateBeacon = {
+                                if (bleManager.attachSource(SyntheticPacketSource())) showMainMenu = false
+                                else Toast.makeText(this, "Synthetic beacon already running", Toast.LENGTH_SHORT).show()
+                            },
+                            onExportRecordings = { format ->
+                                bleManager.exportRecordings(format) { exported, total ->
+                                    val msg = if (total == 0) "No recorded sessions" else "Exported $exported of $total sessions to ${bleManager.exportsDir}"
+                                    Toast.makeText(this, msg, Toast.LENGTH_LONG).show()
+                                }
+                            }
+                        )
                     }
                 }
             }
         }
+    }
 
-        requestPermissionsModernWay()
+    override fun onDestroy() {
+        super.onDestroy()
+        // Sessions stay with the service; it stops itself once the last one closes and nothing is bound
+        if (::bleManager.isInitialized) bleManager.listener = null
+        if (serviceBound) unbindService(serviceConnection)
     }
 
     /** Request any missing permissions; show toast if all already granted. */
@@ -0,0 +1,171 @@
+package com.example.ble_sync_suite_app
+
+// Native sync: the C sync core (esp32_ble/components/cheepsync) behind ClockSync, through libcheepsync_jni.
+// Lives outside sync/ so that folder stays stdlib-only for sync-bench and drag-and-drop use.
+
+import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.ClockSync
+import com.example.ble_sync_suite_app.sync.Estimator
+import com.example.ble_sync_suite_app.sync.KalmanSync
+import com.example.ble_sync_suite_app.sync.SyncFit
+
+private object NativeSyncLibrary {
+    /** False where the library is missing (an ABI the APK was not built for, or plain JVM code). */
+    val loaded: Boolean = try {
+        System.loadLibrary("cheepsync_jni")
+        true
+    } catch (_: UnsatisfiedLinkError) {
+        false
+    }
+}
+
+/**
+ * [CheepSync] in C: same window, same INCREMENTAL arithmetic, so the two agree sample for sample to rounding
+ * (NativeSyncTest, on the device).
+ * LEAST_SQUARES, LOWER_ENVELOPE and HUBER only. Each call is one JNI crossing; feed batches through
+ * [addSamples] at high rates. Holds a native state: [close] it (not thread-safe, like CheepSync).
+ */
+class NativeCheepSync(
+    windowSize: Int = CheepSync.DEFAULT_WINDOW_SIZE,
+    val estimator: Estimator = Estimator.LEAST_SQUARES
+) : ClockSync, AutoCloseable {
+    private var handle: Long
+    private val fitD = DoubleArray(2)
+    private val fitL = LongArray(2)
+
+    init {
+        check(isAvailable) { "libcheepsync_jni is not available" }
+        require(estimator != Estimator.RANSAC) { "RANSAC is not in the native core" }
+        handle = nativeCreate(windowSize, estimator.ordinal)
+        require(handle != 0L) { "windowSize must be 1..${nativeWindowMax()}, was $windowSize" }
+    }
+
+    override val alpha: Double get() = getFit().absoluteAlpha
+    override val beta: Double get() = getFit().beta
+    override val rmsResidualMs: Double get() = nativeRmsNs(live()) / 1_000_000.0
+    override val sampleCount: Int get() = nativeCount(live())
+    override val hasFit: Boolean get() = nativeHasFit(live())
+
+    override fun addSample(beaconTimeUs: Long, receiverTimeNs: Long) = nativeAdd(live(), beaconTimeUs, receiverTimeNs)
+
+    /** The first [count] pairs, oldest first, in one native call. */
+    fun addSamples(beaconTimesUs: LongArray, receiverTimesNs: LongArray, count: Int = beaconTimesUs.size) {
+        require(count in 0..minOf(beaconTimesUs.size, receiverTimesNs.size)) { "count $count exceeds the arrays" }
+        nativeAddAll(live(), beaconTimesUs, receiverTimesNs, count)
+    }
+
+    override fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long = nativeMap(live(), beaconTimeUs)
+
+    override fun residualMs(beaconTimeUs: Long, receiverTimeNs: Long): Double =
+        nativeResidualNs(live(), beaconTimeUs, receiverTimeNs) / 1_000_000.0
+
+    override fun getFit(): SyncFit {
+        nativeFit(live(), fitD, fitL)
+        return SyncFit(alpha = fitD[0], beta = fitD[1], beaconEpochUs = fitL[0], receiverEpochNs = fitL[1])
+    }
+
+    override fun reset() = nativeReset(live())
+
+    override fun close() {
+        if (handle != 0L) nativeFree(handle)
+        handle = 0L
+    }
+
+    private fun live(): Long {
+        check(handle != 0L) { "NativeCheepSync is closed" }
+        return handle
+    }
+
+    private external fun nativeCreate(windowSize: Int, estimator: Int): Long
+    private external fun nativeFree(handle: Long)
+    private external fun nativeWindowMax(): Int
+    private external fun nativeAdd(handle: Long, beaconTimeUs: Long, receiverTimeNs: Long)
+    private external fun nativeAddAll(handle: Long, beaconTimesUs: LongArray, receiverTimesNs: LongArray, count: Int)
+    private external fun nativeMap(handle: Long, beaconTimeUs: Long): Long
+    private external fun nativeResidualNs(handle: Long, beaconTimeUs: Long, receiverTimeNs: Long): Double
+    private external fun nativeFit(handle: Long, doubles: DoubleArray, longs: LongArray)
+    private external fun nativeRmsNs(handle: Long): Double
+    private external fun nativeCount(handle: Long): Int
+    private external fun nativeHasFit(handle: Long): Boolean
+    private external fun nativeReset(handle: Long)
+
+    companion object {
+        val isAvailable: Boolean get() = NativeSyncLibrary.loaded
+    }
+}
+
+/** [KalmanSync] in C, same parameters and the same update. Holds a native state: [close] it. */
+class NativeKalmanSync(
+    processNoiseOffsetNs: Double = KalmanSync.DEFAULT_PROCESS_NOISE_OFFSET_NS,
+    processNoiseSkewPpm: Double = KalmanSync.DEFAULT_PROCESS_NOISE_SKEW_PPM,
+    measurementNoiseMs: Double = KalmanSync.DEFAULT_MEASUREMENT_NOISE_MS,
+    initialSkewPpm: Double = KalmanSync.DEFAULT_INITIAL_SKEW_PPM
+) : ClockSync, AutoCloseable {
+    private var handle: Long
+    private val fitD = DoubleArray(2)
+    private val fitL = LongArray(2)
+    private val quality = DoubleArray(3)
+
+    init {
+        check(NativeCheepSync.isAvailable) { "libcheepsync_jni is not available" }
+        handle = nativeCreate(processNoiseOffsetNs, processNoiseSkewPpm, measurementNoiseMs, initialSkewPpm)
+        check(handle != 0L) { "native allocation failed" }
+    }
+
+    override val alpha: Double get() = getFit().absoluteAlpha
+    override val beta: Double get() = getFit().beta
+    override val rmsResidualMs: Double get() = quality(0) / 1_000_000.0
+    override val sampleCount: Int get() = nativeCount(live())
+    override val hasFit: Boolean get() = sampleCount >= 2
+
+    /** Standard deviation of the offset estimate at the latest sample, in nanoseconds. */
+    val offsetStdDevNs: Double get() = quality(1)
+
+    /** Standard deviation of the skew estimate, in ppm. */
+    val skewStdDevPpm: Double get() = quality(2)
+
+    override fun addSample(beaconTimeUs: Long, receiverTimeNs: Long) = nativeAdd(live(), beaconTimeUs, receiverTimeNs)
+
+    /** The first [count] pairs, oldest first, in one native call. */
+    fun addSamples(beaconTimesUs: LongArray, receiverTimesNs: LongArray, count: Int = beaconTimesUs.size) {
+        require(count in 0..minOf(beaconTimesUs.size, receiverTimesNs.size)) { "count $count exceeds the arrays" }
+        nativeAddAll(live(), beaconTimesUs, receiverTimesNs, count)
+    }
+
+    override fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long = nativeMap(live(), beaconTimeUs)
+
+    override fun residualMs(beaconTimeUs: Long, receiverTimeNs: Long): Double =
+        kotlin.math.abs(receiverTimeNs - mapBeaconToReceiverNs(beaconTimeUs)) / 1_000_000.0
+
+    override fun getFit(): SyncFit {
+        nativeFit(live(), fitD, fitL)
+        return SyncFit(alpha = fitD[0], beta = fitD[1], beaconEpochUs = fitL[0], receiverEpochNs = fitL[1])
+    }
+
+    override fun reset() = nativeReset(live())
+
+    override fun close() {
+        if (handle != 0L) nativeFree(handle)
+        handle = 0L
+    }
+
+    private fun quality(i: Int): Double {
+        nativeQuality(live(), quality)
+        return quality[i]
+    }
+
+    private fun live(): Long {
+        check(handle != 0L) { "NativeKalmanSync is closed" }
+        return handle
+    }
+
+    private external fun nativeCreate(qOffsetNs: Double, qSkewPpm: Double, measurementMs: Double, initialSkewPpm: Double): Long
+    private external fun nativeFree(handle: Long)
+    private external fun nativeAdd(handle: Long, beaconTimeUs: Long, receiverTimeNs: Long)
+    private external fun nativeAddAll(handle: Long, beaconTimesUs: LongArray, receiverTimesNs: LongArray, count: Int)
+    private external fun nativeMap(handle: Long, beaconTimeUs: Long): Long
+    private external fun nativeFit(handle: Long, doubles: DoubleArray, longs: LongArray)
+    private external fun nativeQuality(handle: Long, out: DoubleArray)
+    private external fun nativeCount(handle: Long): Int
+    private external fun nativeReset(handle: Long)
+}
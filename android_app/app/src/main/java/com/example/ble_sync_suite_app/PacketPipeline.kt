@@ -0,0 +1,193 @@
+package com.example.ble_sync_suite_app
+
+// Packet pipeline: hands raw notification bytes from the GATT binder thread to a decode thread.
+
+import android.util.Log
+import java.util.concurrent.CopyOnWriteArrayList
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+import java.util.concurrent.atomic.AtomicLong
+import java.util.concurrent.locks.LockSupport
+
+/**
+ * Lock-free single-producer / single-consumer ring of raw payloads.
+ * Slots are preallocated, so [offer] copies into an existing array and does not allocate.
+ *
+ * Producer: exactly one thread calls [offer]. Consumer: exactly one thread calls [poll].
+ * [head] is written only by the consumer, [tail] only by the producer; the atomic
+ * set/get pairs publish slot contents between them.
+ */
+class SpscPayloadQueue(capacity: Int, val maxPayloadLen: Int) {
+    private val mask: Int
+    private val payloads: Array<ByteArray>
+    private val lengths: IntArray
+    private val stamps: LongArray
+    private val generations: IntArray
+    private val head = AtomicLong(0)
+    private val tail = AtomicLong(0)
+
+    init {
+        require(capacity >= 2 && capacity and (capacity - 1) == 0) { "capacity must be a power of two, was $capacity" }
+        mask = capacity - 1
+        payloads = Array(capacity) { ByteArray(maxPayloadLen) }
+        lengths = IntArray(capacity)
+        stamps = LongArray(capacity)
+        generations = IntArray(capacity)
+    }
+
+    /** Copy [value] into the next slot. Returns false if the queue is full or the payload is too long. */
+    fun offer(value: ByteArray, receivedAtNs: Long, generation: Int): Boolean {
+        if (value.size > maxPayloadLen) return false
+        val t = tail.get()
+        if (t - head.get() > mask) return false
+        val i = (t and mask.toLong()).toInt()
+        System.arraycopy(value, 0, payloads[i], 0, value.size)
+        lengths[i] = value.size
+        stamps[i] = receivedAtNs
+        generations[i] = generation
+        tail.set(t + 1)
+        return true
+    }
+
+    /**
+     * Hand the oldest slot to [block] (payload array, valid length, stamp, generation) and release it.
+     * The array is reused after [block] returns; do not keep it. Returns false if the queue was empty.
+     */
+    inline fun poll(block: (payload: ByteArray, length: Int, receivedAtNs: Long, generation: Int) -> Unit): Boolean {
+        val i = peekSlot()
+        if (i < 0) return false
+        block(payloadAt(i), lengthAt(i), stampAt(i), generationAt(i))
+        release()
+        return true
+    }
+
+    @PublishedApi internal fun peekSlot(): Int {
+        val h = head.get()
+        if (h == tail.get()) return -1
+        return (h and mask.toLong()).toInt()
+    }
+
+    @PublishedApi internal fun payloadAt(i: Int): ByteArray = payloads[i]
+    @PublishedApi internal fun lengthAt(i: Int): Int = lengths[i]
+    @PublishedApi internal fun stampAt(i: Int): Long = stamps[i]
+    @PublishedApi internal fun generationAt(i: Int): Int = generations[i]
+    @PublishedApi internal fun release() { head.set(head.get() + 1) }
+}
+
+/**
+ * Two-stage receive path for ESP32 notifications, shared by all connected beacons.
+ *
+ * Each beacon gets a [Lane]: its own SPSC queue, so each GATT connection's callback thread is the
+ * single producer for its lane. One "esp32-decode" thread consumes every lane.
+ *
+ * Stage one ([Lane.submit], GATT binder thread): enqueue the already-stamped bytes and return.
+ * Stage two (decode thread): drain each lane, call its process per payload, then its onDrained
+ * once per drain so the UI gets one batched update instead of one post per packet.
+ *
+ * [Lane.reset] bumps the lane's session generation; payloads queued before it are dropped by
+ * stage two, and the lane's onReset runs on the decode thread before its next payload.
+ */
+class PacketPipeline {
+
+    inner class Lane internal constructor(
+        capacity: Int,
+        maxPayloadLen: Int,
+        private val process: (value: ByteArray, receivedAtNs: Long) -> Unit,
+        private val onDrained: () -> Unit,
+        private val onReset: () -> Unit
+    ) {
+        private val queue = SpscPayloadQueue(capacity, maxPayloadLen)
+        private val generation = AtomicInteger(0)
+        private val resetPending = AtomicBoolean(false)
+        // The decoders dispatch on value.size, so hand them an exact-length copy (reused while the length holds,
+        // so a session can keep one ByteBuffer view of it)
+        private var scratch = ByteArray(0)
+
+        /** Payloads dropped because the queue was full or the payload was longer than a slot. */
+        val droppedCount = AtomicLong(0)
+
+        /** Stage one. Call from this lane's GATT callback thread only. Returns false if the payload was dropped. */
+        fun submit(value: ByteArray, receivedAtNs: Long): Boolean {
+            if (!queue.offer(value, receivedAtNs, generation.get())) {
+                droppedCount.incrementAndGet()
+                return false
+            }
+            LockSupport.unpark(worker)
+            return true
+        }
+
+        /** Start a new session: drop anything still queued and reset downstream state on the decode thread. */
+        fun reset() {
+            generation.incrementAndGet()
+            resetPending.set(true)
+            LockSupport.unpark(worker)
+        }
+
+        /** Detach from the worker. Queued payloads are discarded. */
+        fun close() {
+            lanes.remove(this)
+        }
+
+        internal fun hasWork(): Boolean = queue.peekSlot() >= 0 || resetPending.get()
+
+        // Decode thread only
+        internal fun drain() {
+            if (resetPending.getAndSet(false)) onReset()
+            var drained = 0
+            while (true) {
+                val gen = generation.get()
+                val got = queue.poll { payload, length, receivedAtNs, itemGen ->
+                    if (itemGen != gen) return@poll
+                    if (scratch.size != length) scratch = ByteArray(length)
+                    System.arraycopy(payload, 0, scratch, 0, length)
+                    try {
+                        process(scratch, receivedAtNs)
+                        drained++
+                    } catch (e: Exception) {
+                        Log.e("ESP32", "Decode error", e)
+                    }
+                }
+                if (!got) break
+            }
+            if (drained > 0) onDrained()
+        }
+    }
+
+    private val lanes = CopyOnWriteArrayList<Lane>()
+    @Volatile private var running = true
+
+    private val worker = Thread({ runWorker() }, "esp32-decode").apply {
+        isDaemon = true
+        start()
+    }
+
+    /** Register a beacon. [process], [onDrained] and [onReset] run on the decode thread. */
+    fun openLane(
+        capacity: Int = DEFAULT_CAPACITY,
+        maxPayloadLen: Int = DEFAULT_MAX_PAYLOAD_LEN,
+        process: (value: ByteArray, receivedAtNs: Long) -> Unit,
+        onDrained: () -> Unit,
+        onReset: () -> Unit
+    ): Lane = Lane(capacity, maxPayloadLen, process, onDrained, onReset).also { lanes.add(it) }
+
+    fun shutdown() {
+        running = false
+        lanes.clear()
+        LockSupport.unpark(worker)
+    }
+
+    private fun runWorker() {
+        while (running) {
+            for (lane in lanes) lane.drain()
+            // Park until a producer signals; the timeout bounds a missed unpark
+            if (lanes.none { it.hasWork() }) LockSupport.parkNanos(this, PARK_TIMEOUT_NS)
+        }
+    }
+
+    companion object {
+        const val DEFAULT_CAPACITY = 256
+        // LOCAL_MTU on the ESP32 is 500, so no notification value exceeds 497 bytes
+        const val DEFAULT_MAX_PAYLOAD_LEN = 512
+        private const val PARK_TIMEOUT_NS = 50_000_000L
+    }
+}
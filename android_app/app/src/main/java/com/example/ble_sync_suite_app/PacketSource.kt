@@ -0,0 +1,188 @@
+package com.example.ble_sync_suite_app
+
+// Packet sources: feed a BeaconSession from something other than a GATT connection (load tests, replays).
+
+import android.os.SystemClock
+import android.util.Log
+import java.io.File
+import java.util.Random
+import java.util.concurrent.locks.LockSupport
+import kotlin.math.abs
+import kotlin.math.ln
+
+/** Receives raw payloads exactly as the GATT notification callback would hand them over. */
+fun interface PacketSink {
+    /**
+     * [value] may be reused by the source after this returns (BeaconSession.submit copies it).
+     * Returns false if the payload was dropped because the session's queue was full.
+     */
+    fun onPayload(value: ByteArray, receivedAtNs: Long): Boolean
+}
+
+/**
+ * Something that produces ESP32 payloads for one beacon address. Attached through
+ * BleManager.attachSource in place of a GATT connection; the rest of the receive path
+ * (pipeline, fit, stats, UI) cannot tell the difference.
+ *
+ * [start] must deliver on a single thread of the source's own (one lane producer).
+ */
+interface PacketSource {
+    val address: String
+    val name: String
+    fun start(sink: PacketSink)
+    /** Stop delivering and release the thread. Idempotent. */
+    fun stop()
+}
+
+/** Delay distribution added to each synthetic packet's receive stamp. */
+enum class JitterModel { NONE, GAUSSIAN, UNIFORM, EXPONENTIAL }
+
+data class SyntheticBeaconConfig(
+    val rateHz: Double = 100.0,
+    /** Beacon clock rate error relative to the phone (ppm; positive = beacon runs fast). */
+    val skewPpm: Double = 40.0,
+    /** Beacon uptime at the first packet, μs (start near u64 values a long run would reach, if wanted). */
+    val beaconStartUs: Long = 60_000_000L,
+    val jitter: JitterModel = JitterModel.EXPONENTIAL,
+    /** Scale of [jitter]: std dev (GAUSSIAN, folded to ≥ 0), width (UNIFORM) or mean (EXPONENTIAL), ms. */
+    val jitterMs: Double = 1.0,
+    /** Probability that a packet is never delivered (its seq is still consumed). */
+    val lossProbability: Double = 0.0,
+    /** First seq; the default wraps past 0xFFFFFFFF after 100 packets. */
+    val startSeq: Long = 0xFFFF_FFFFL - 100,
+    val seed: Long = 1
+)
+
+/**
+ * Generates legacy 12-byte payloads ([seq:u32][tUs:u64]) at [SyntheticBeaconConfig.rateHz] on its
+ * own thread. Send times follow the phone's elapsedRealtimeNanos; the beacon time is derived from
+ * them through the configured skew, and the receive stamp is the send time plus the jitter delay.
+ * Above what the thread can park for, packets that fall due together are delivered back to back.
+ */
+class SyntheticPacketSource(
+    private val config: SyntheticBeaconConfig = SyntheticBeaconConfig(),
+    override val address: String = SYNTHETIC_ADDRESS,
+    override val name: String = "Synthetic ${config.rateHz.toInt()} Hz"
+) : PacketSource {
+    @Volatile private var running = false
+    private var thread: Thread? = null
+
+    override fun start(sink: PacketSink) {
+        if (running) return
+        running = true
+        thread = Thread({ run(sink) }, "synthetic-beacon").apply {
+            isDaemon = true
+            start()
+        }
+    }
+
+    override fun stop() {
+        running = false
+        thread?.let { LockSupport.unpark(it) }
+        thread = null
+    }
+
+    private fun run(sink: PacketSink) {
+        val random = Random(config.seed)
+        val periodNs = (1e9 / config.rateHz).toLong().coerceAtLeast(1)
+        val value = ByteArray(ESP_LEGACY_PAYLOAD_LEN)
+        val startNs = SystemClock.elapsedRealtimeNanos()
+        var seq = config.startSeq and 0xFFFF_FFFFL
+        var n = 0L
+        while (running) {
+            val sendNs = startNs + n * periodNs
+            val now = SystemClock.elapsedRealtimeNanos()
+            if (sendNs > now) {
+                LockSupport.parkNanos(sendNs - now)
+                continue
+            }
+            if (config.lossProbability <= 0.0 || random.nextDouble() >= config.lossProbability) {
+                val elapsedNs = (sendNs - startNs).toDouble()
+                val tUs = config.beaconStartUs + (elapsedNs * (1.0 + config.skewPpm * 1e-6) / 1000.0).toLong()
+                encodeEspLegacyPayload(seq, tUs, value)
+                sink.onPayload(value, sendNs + delayNs(random))
+            }
+            seq = (seq + 1) and 0xFFFF_FFFFL
+            n++
+        }
+    }
+
+    private fun delayNs(random: Random): Long {
+        val scaleNs = config.jitterMs * 1e6
+        val d = when (config.jitter) {
+            JitterModel.NONE -> 0.0
+            JitterModel.GAUSSIAN -> abs(random.nextGaussian()) * scaleNs
+            JitterModel.UNIFORM -> random.nextDouble() * scaleNs
+            JitterModel.EXPONENTIAL -> -ln(1.0 - random.nextDouble()) * scaleNs
+        }
+        return d.toLong()
+    }
+
+    companion object {
+        /** Locally administered MAC, so it can never collide with a real beacon's session. */
+        const val SYNTHETIC_ADDRESS = "02:00:00:00:00:01"
+    }
+}
+
+/**
+ * Replays a capture written by SessionRecorder as legacy payloads with their original receive
+ * stamps, so the fit sees exactly the recorded samples. [speed] scales the original pacing
+ * (2.0 = twice as fast); 0 or less replays as fast as the pipeline accepts.
+ */
+class ReplayPacketSource(
+    private val file: File,
+    private val speed: Double = 1.0
+) : PacketSource {
+    private val reader = SessionLogReader(file)
+    override val address: String = reader.address
+    override val name: String = "Replay ${file.name}"
+
+    @Volatile private var running = false
+    private var thread: Thread? = null
+
+    override fun start(sink: PacketSink) {
+        if (running) return
+        running = true
+        thread = Thread({ run(sink) }, "session-replay").apply {
+            isDaemon = true
+            start()
+        }
+    }
+
+    override fun stop() {
+        running = false
+        thread?.let { LockSupport.unpark(it) }
+        thread = null
+    }
+
+    private fun run(sink: PacketSink) {
+        try {
+            val value = ByteArray(ESP_LEGACY_PAYLOAD_LEN)
+            val wallStartNs = SystemClock.elapsedRealtimeNanos()
+            val firstRxNs = if (reader.recordCount > 0) reader.receivedAtNsAt(0) else 0L
+            for (i in 0 until reader.recordCount) {
+                if (!running) break
+                val rxNs = reader.receivedAtNsAt(i)
+                if (speed > 0.0) {
+                    val dueNs = wallStartNs + ((rxNs - firstRxNs) / speed).toLong()
+                    while (running) {
+                        val waitNs = dueNs - SystemClock.elapsedRealtimeNanos()
+                        if (waitNs <= 0) break
+                        LockSupport.parkNanos(waitNs)
+                    }
+                }
+                encodeEspLegacyPayload(reader.seqAt(i), reader.tUsAt(i), value)
+                // Unpaced: wait for room instead of dropping, so every recorded sample reaches the fit
+                while (!sink.onPayload(value, rxNs) && speed <= 0.0 && running) LockSupport.parkNanos(BACKOFF_NS)
+            }
+        } catch (e: Exception) {
+            Log.e("ESP32", "Replay of ${file.name} failed", e)
+        } finally {
+            reader.close()
+        }
+    }
+
+    companion object {
+        private const val BACKOFF_NS = 200_000L
+    }
+}
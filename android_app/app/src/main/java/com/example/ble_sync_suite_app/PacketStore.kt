@@ -0,0 +1,231 @@
+package com.example.ble_sync_suite_app
+
+// Packet store: bounded in-memory history of ESP32 packets, with an optional spill-to-disk tier.
+
+import android.util.Log
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.asStateFlow
+import java.io.BufferedInputStream
+import java.io.DataInputStream
+import java.io.EOFException
+import java.io.File
+import java.io.FileInputStream
+import java.io.FileOutputStream
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.ExecutorService
+import java.util.concurrent.Executors
+
+/**
+ * Fixed-capacity ring of the most recent packets, stored as primitive columns (seq, tUs, receivedAtNs).
+ * Arrays are allocated once; add() does not allocate.
+ *
+ * When full, the oldest packet is evicted. If [spillFile] is set, evicted packets are appended to it
+ * (24 bytes each: seq, tUs, receivedAtNs as i64 little-endian) in chunks written off the caller's thread.
+ *
+ * The UI observes [version] (bumped on every change) instead of copying the list.
+ * Not thread-safe: call add/clear and the readers from one thread (the main thread).
+ */
+class PacketStore(
+    val capacity: Int = DEFAULT_CAPACITY,
+    private val spillFile: File? = null
+) {
+    private val seqs = LongArray(capacity)
+    private val tUss = LongArray(capacity)
+    private val receivedAtNss = LongArray(capacity)
+    private var head = 0
+
+    /** Number of packets currently held in memory (≤ capacity). */
+    var size = 0
+        private set
+
+    /** Packets evicted from memory since the last clear (written to spillFile if set). */
+    var evictedCount = 0L
+        private set
+
+    private val _version = MutableStateFlow(0L)
+    /** Incremented on every add/clear. Collect this to know when to re-read the store. */
+    val version: StateFlow<Long> = _version.asStateFlow()
+
+    private var spillChunk: ByteBuffer? = null
+    private val spillExecutor: ExecutorService? =
+        spillFile?.let { Executors.newSingleThreadExecutor { r -> Thread(r, "packet-spill") } }
+
+    init {
+        require(capacity >= 1) { "capacity must be at least 1, was $capacity" }
+    }
+
+    fun add(packet: EspPacket) = add(packet.seq, packet.tUs, packet.receivedAtNs)
+
+    fun add(seq: Long, tUs: Long, receivedAtNs: Long) {
+        append(seq, tUs, receivedAtNs)
+        _version.value++
+    }
+
+    /** Append a whole batch (oldest first) with a single [version] bump. */
+    fun addAll(batch: PacketBatch) {
+        if (batch.size == 0) return
+        for (i in 0 until batch.size) append(batch.seqAt(i), batch.tUsAt(i), batch.receivedAtNsAt(i))
+        _version.value++
+    }
+
+    private fun append(seq: Long, tUs: Long, receivedAtNs: Long) {
+        if (size == capacity) {
+            spill(seqs[head], tUss[head], receivedAtNss[head])
+            head = if (head + 1 == capacity) 0 else head + 1
+            size--
+            evictedCount++
+        }
+        val tail = slot(size)
+        seqs[tail] = seq
+        tUss[tail] = tUs
+        receivedAtNss[tail] = receivedAtNs
+        size++
+    }
+
+    // ----- Readers: index 0 = oldest packet in memory, size - 1 = newest -----
+    fun seqAt(i: Int): Long = seqs[checkedSlot(i)]
+    fun tUsAt(i: Int): Long = tUss[checkedSlot(i)]
+    fun receivedAtNsAt(i: Int): Long = receivedAtNss[checkedSlot(i)]
+
+    /** Boxed copy of one packet (for UI convenience; prefer the column readers in loops). */
+    fun packetAt(i: Int): EspPacket = EspPacket(seqAt(i), tUsAt(i), receivedAtNsAt(i))
+
+    fun isEmpty(): Boolean = size == 0
+
+    /** Drop everything in memory and truncate the spill file. */
+    fun clear() {
+        head = 0
+        size = 0
+        evictedCount = 0
+        spillChunk = null
+        spillFile?.let { file -> spillExecutor?.execute { file.delete() } }
+        _version.value++
+    }
+
+    /**
+     * Stream spilled (older) packets from disk, oldest first. Runs on the calling thread and does file IO,
+     * so call it from a background thread. Packets still buffered in memory for the next chunk are not included.
+     */
+    fun forEachSpilled(block: (seq: Long, tUs: Long, receivedAtNs: Long) -> Unit) {
+        val file = spillFile ?: return
+        if (!file.exists()) return
+        DataInputStream(BufferedInputStream(FileInputStream(file))).use { input ->
+            val record = ByteArray(SPILL_RECORD_BYTES)
+            val view = ByteBuffer.wrap(record).order(ByteOrder.LITTLE_ENDIAN)
+            while (true) {
+                try { input.readFully(record) } catch (_: EOFException) { break }
+                block(view.getLong(0), view.getLong(8), view.getLong(16))
+            }
+        }
+    }
+
+    /** Flush any buffered spill records and stop the writer thread. */
+    fun close() {
+        flushSpillChunk()
+        spillExecutor?.shutdown()
+    }
+
+    private fun slot(i: Int): Int {
+        val j = head + i
+        return if (j >= capacity) j - capacity else j
+    }
+
+    private fun checkedSlot(i: Int): Int {
+        if (i < 0 || i >= size) throw IndexOutOfBoundsException("index $i, size $size")
+        return slot(i)
+    }
+
+    private fun spill(seq: Long, tUs: Long, receivedAtNs: Long) {
+        if (spillFile == null) return
+        val chunk = spillChunk
+            ?: ByteBuffer.allocate(SPILL_CHUNK_RECORDS * SPILL_RECORD_BYTES).order(ByteOrder.LITTLE_ENDIAN)
+                .also { spillChunk = it }
+        chunk.putLong(seq).putLong(tUs).putLong(receivedAtNs)
+        if (!chunk.hasRemaining()) flushSpillChunk()
+    }
+
+    // Hand the current chunk to the writer thread; the next eviction starts a fresh one.
+    private fun flushSpillChunk() {
+        val chunk = spillChunk ?: return
+        val file = spillFile ?: return
+        spillChunk = null
+        chunk.flip()
+        spillExecutor?.execute {
+            try {
+                FileOutputStream(file, true).use { out ->
+                    while (chunk.hasRemaining()) out.channel.write(chunk)
+                }
+            } catch (e: Exception) {
+                Log.e("PacketStore", "Spill write failed", e)
+            }
+        }
+    }
+
+    companion object {
+        const val DEFAULT_CAPACITY = 1000
+        const val SPILL_RECORD_BYTES = 24
+        const val SPILL_CHUNK_RECORDS = 1024
+    }
+}
+
+/**
+ * Growable primitive columns (seq, tUs, receivedAtNs) for handing decoded packets from the decode thread to
+ * [PacketStore.addAll] on the main thread. Grows by doubling, so steady-state [add] does not allocate.
+ * Single-threaded: one owner at a time.
+ */
+class PacketBatch(initialCapacity: Int = DEFAULT_INITIAL_CAPACITY) {
+    private var seqs = LongArray(initialCapacity.coerceAtLeast(1))
+    private var tUss = LongArray(seqs.size)
+    private var receivedAtNss = LongArray(seqs.size)
+
+    var size = 0
+        private set
+
+    fun add(seq: Long, tUs: Long, receivedAtNs: Long) {
+        if (size == seqs.size) grow()
+        seqs[size] = seq
+        tUss[size] = tUs
+        receivedAtNss[size] = receivedAtNs
+        size++
+    }
+
+    fun seqAt(i: Int): Long = seqs[checked(i)]
+    fun tUsAt(i: Int): Long = tUss[checked(i)]
+    fun receivedAtNsAt(i: Int): Long = receivedAtNss[checked(i)]
+
+    /** Overwrite packet [i] (compacting in place). */
+    fun set(i: Int, seq: Long, tUs: Long, receivedAtNs: Long) {
+        val j = checked(i)
+        seqs[j] = seq
+        tUss[j] = tUs
+        receivedAtNss[j] = receivedAtNs
+    }
+
+    /** Keep only the first [newSize] packets. */
+    fun truncate(newSize: Int) {
+        require(newSize in 0..size) { "newSize $newSize, size $size" }
+        size = newSize
+    }
+
+    fun clear() {
+        size = 0
+    }
+
+    private fun checked(i: Int): Int {
+        if (i < 0 || i >= size) throw IndexOutOfBoundsException("index $i, size $size")
+        return i
+    }
+
+    private fun grow() {
+        val n = seqs.size * 2
+        seqs = seqs.copyOf(n)
+        tUss = tUss.copyOf(n)
+        receivedAtNss = receivedAtNss.copyOf(n)
+    }
+
+    companion object {
+        const val DEFAULT_INITIAL_CAPACITY = 256
+    }
+}
@@ -0,0 +1,78 @@
+package com.example.ble_sync_suite_app
+
+// Scan index: devices heard while scanning, one entry per address, and how the scan is set up.
+
+/** How [BleManager.startBleScan] looks for devices. */
+enum class ScanMode {
+    /**
+     * Hardware filters for this firmware: the sensor service UUID, or beacon manufacturer data for
+     * connectionless beacons. Results are delivered as they arrive, so broadcast samples stay on time.
+     */
+    ESP32,
+    /**
+     * Same filters, with results batched in the controller for [BleManager.SCAN_REPORT_DELAY_MS]
+     * where it supports offloaded batching (as [ESP32] otherwise). For picking a device: least wake-ups,
+     * but a connectionless beacon's samples arrive late and the controller may thin them out.
+     */
+    ESP32_BATCHED,
+    /** No filter: every advertiser nearby. */
+    ALL
+}
+
+/** The latest report of one advertiser. */
+data class ScannedDevice(
+    val address: String,
+    val name: String,
+    val rssi: Int,
+    /** elapsedRealtimeNanos of the latest report. */
+    val lastSeenNs: Long,
+    /** Reports since it was first heard. */
+    val reports: Long
+)
+
+/**
+ * Scanned devices keyed by address: each report updates its entry in place, so a device advertising
+ * every 20 ms stays one row. [snapshot] builds the list the UI shows. Not thread-safe: scan callbacks
+ * arrive on the main thread, use it there.
+ */
+class ScanIndex {
+    private class Entry(var name: String, var rssi: Int, var lastSeenNs: Long, var reports: Long)
+
+    private val byAddress = HashMap<String, Entry>()
+
+    /** True if a report came in since the last [snapshot]. */
+    var dirty = false
+        private set
+
+    val size: Int get() = byAddress.size
+
+    /** Record one report. A null [name] (not in this advertisement) keeps the one heard before. */
+    fun update(address: String, name: String?, rssi: Int, timestampNs: Long) {
+        val e = byAddress[address]
+        if (e == null) {
+            byAddress[address] = Entry(name ?: UNNAMED, rssi, timestampNs, 1)
+        } else {
+            if (name != null) e.name = name
+            e.rssi = rssi
+            if (timestampNs > e.lastSeenNs) e.lastSeenNs = timestampNs
+            e.reports++
+        }
+        dirty = true
+    }
+
+    /** Every device heard, strongest first. */
+    fun snapshot(): List<ScannedDevice> {
+        dirty = false
+        return byAddress.map { (address, e) -> ScannedDevice(address, e.name, e.rssi, e.lastSeenNs, e.reports) }
+            .sortedByDescending { it.rssi }
+    }
+
+    fun clear() {
+        byAddress.clear()
+        dirty = true
+    }
+
+    companion object {
+        const val UNNAMED = "Unnamed"
+    }
+}
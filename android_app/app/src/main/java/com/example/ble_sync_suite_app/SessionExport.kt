@@ -0,0 +1,212 @@
+package com.example.ble_sync_suite_app
+
+// Session export: streams a SessionLog capture to gzip CSV or a compressed columnar file for offline analysis.
+// java.io/java.util.zip only (no Android types), like SessionLog, so a desktop JVM can convert captures too.
+
+import com.example.ble_sync_suite_app.sync.SyncFit
+import java.io.BufferedOutputStream
+import java.io.BufferedWriter
+import java.io.File
+import java.io.FileOutputStream
+import java.io.IOException
+import java.io.OutputStream
+import java.io.OutputStreamWriter
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.ExecutorService
+import java.util.concurrent.Executors
+import java.util.concurrent.Future
+import java.util.zip.Deflater
+import java.util.zip.GZIPOutputStream
+
+enum class ExportFormat(val suffix: String) {
+    /** One row per packet, header line first, gzip-compressed. */
+    CSV_GZIP(".csv.gz"),
+    /** [SessionColumns] layout: row groups of delta-coded, deflated i64 columns. */
+    COLUMNAR(".bssc");
+
+    /** Export of [capture] in [dir]: same base name, this format's suffix. */
+    fun fileFor(capture: File, dir: File): File = File(dir, capture.nameWithoutExtension + suffix)
+}
+
+/**
+ * Columnar export layout (all little-endian), for loading whole columns without parsing text:
+ *
+ *   Header, HEADER_BYTES:
+ *     [0]  magic "BSSC"   [4]  version u16   [6]  column count u16
+ *     [8]  capture start wall time ms i64    [16] beacon MAC, 6 bytes (+2 padding)
+ *     [24] rows per group u32                [28] reserved u32
+ *
+ *   Row groups until the footer: [rows u32] then per column [compressed length u32][zlib stream of rows × i64],
+ *   each column delta-coded within the group (value − previous, from 0; two's complement wraps back exactly).
+ *
+ *   Footer, FOOTER_BYTES: [groups u32][rows i64][magic]; missing if the export was cut short.
+ *
+ * Columns, in order: [COLUMNS]. mapped_phone_ns and residual_ns are [NO_FIT] before the first fit.
+ */
+object SessionColumns {
+    const val MAGIC = 0x43535342 // "BSSC" read as little-endian i32
+    const val VERSION = 1
+    const val HEADER_BYTES = 32
+    const val FOOTER_BYTES = 16
+    const val ROWS_PER_GROUP = 8192
+    const val NO_FIT = Long.MIN_VALUE
+    val COLUMNS = listOf("seq", "t_us", "received_at_ns", "mapped_phone_ns", "residual_ns")
+}
+
+/**
+ * Streams one capture to [ExportFormat] files. Records are read straight from the memory-mapped capture
+ * and written as they go: memory stays at one row group (or one CSV line) however long the session was.
+ *
+ * Each packet's mapped phone time comes from the newest fit recorded at or before it (the fit a live consumer
+ * had), through [SyncFit.mapBeaconToReceiverNs]; residual_ns is its receive time minus that.
+ */
+object SessionExport {
+    /** Convert [capture] into [out] (overwritten). Writes to a temporary sibling first, renamed when complete. */
+    @Throws(IOException::class)
+    fun export(capture: File, out: File, format: ExportFormat) {
+        val tmp = File(out.parentFile, out.name + ".part")
+        SessionLogReader(capture).use { reader ->
+            FileOutputStream(tmp).use { fos ->
+                when (format) {
+                    ExportFormat.CSV_GZIP -> writeCsv(reader, fos)
+                    ExportFormat.COLUMNAR -> writeColumns(reader, fos)
+                }
+                fos.fd.sync()
+            }
+        }
+        if (!tmp.renameTo(out)) {
+            tmp.delete()
+            throw IOException("Cannot rename ${tmp.name} to ${out.name}")
+        }
+    }
+
+    @Throws(IOException::class)
+    fun writeCsv(reader: SessionLogReader, out: OutputStream) {
+        val gzip = GZIPOutputStream(out, BUFFER_BYTES)
+        val w = BufferedWriter(OutputStreamWriter(gzip, Charsets.US_ASCII), BUFFER_BYTES)
+        w.write("# address=${reader.address} start_wall_ms=${reader.startWallTimeMs}\n")
+        w.write(SessionColumns.COLUMNS.joinToString(","))
+        w.write("\n")
+        val line = StringBuilder(96)
+        forEachMapped(reader) { seq, tUs, rxNs, mappedNs ->
+            line.setLength(0)
+            line.append(seq).append(',').append(tUs).append(',').append(rxNs).append(',')
+            if (mappedNs != SessionColumns.NO_FIT) line.append(mappedNs).append(',').append(rxNs - mappedNs)
+            else line.append(',')
+            line.append('\n')
+            w.append(line)
+        }
+        w.flush()
+        gzip.finish()
+    }
+
+    @Throws(IOException::class)
+    fun writeColumns(reader: SessionLogReader, out: OutputStream) {
+        val data = BufferedOutputStream(out, BUFFER_BYTES)
+        val rows = SessionColumns.ROWS_PER_GROUP
+        val columnCount = SessionColumns.COLUMNS.size
+        val header = ByteBuffer.allocate(SessionColumns.HEADER_BYTES).order(ByteOrder.LITTLE_ENDIAN)
+        header.putInt(SessionColumns.MAGIC)
+            .putShort(SessionColumns.VERSION.toShort())
+            .putShort(columnCount.toShort())
+            .putLong(reader.startWallTimeMs)
+            .put(SessionLog.macBytes(reader.address))
+            .putShort(0)
+            .putInt(rows)
+            .putInt(0)
+        data.write(header.array())
+
+        // One group of raw columns, and one reusable deflate output buffer
+        val group = Array(columnCount) { ByteBuffer.allocate(rows * 8).order(ByteOrder.LITTLE_ENDIAN) }
+        val previous = LongArray(columnCount)
+        val deflater = Deflater(Deflater.DEFAULT_COMPRESSION)
+        val compressed = ByteArray(rows * 8 + 1024)
+        val le = ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN)
+        var inGroup = 0
+        var groups = 0
+        var total = 0L
+
+        fun put(column: Int, value: Long) {
+            group[column].putLong(value - previous[column])
+            previous[column] = value
+        }
+
+        fun flushGroup() {
+            if (inGroup == 0) return
+            data.write(le.putInt(0, inGroup).array())
+            for (c in 0 until columnCount) {
+                val raw = group[c]
+                deflater.reset()
+                deflater.setInput(raw.array(), 0, raw.position())
+                deflater.finish()
+                var len = 0
+                while (!deflater.finished()) len += deflater.deflate(compressed, len, compressed.size - len)
+                data.write(le.putInt(0, len).array())
+                data.write(compressed, 0, len)
+                raw.clear()
+            }
+            previous.fill(0L)
+            groups++
+            inGroup = 0
+        }
+
+        try {
+            forEachMapped(reader) { seq, tUs, rxNs, mappedNs ->
+                put(0, seq)
+                put(1, tUs)
+                put(2, rxNs)
+                put(3, mappedNs)
+                put(4, if (mappedNs == SessionColumns.NO_FIT) SessionColumns.NO_FIT else rxNs - mappedNs)
+                total++
+                if (++inGroup == rows) flushGroup()
+            }
+            flushGroup()
+        } finally {
+            deflater.end()
+        }
+        val footer = ByteBuffer.allocate(SessionColumns.FOOTER_BYTES).order(ByteOrder.LITTLE_ENDIAN)
+        footer.putInt(groups).putLong(total).putInt(SessionColumns.MAGIC)
+        data.write(footer.array())
+        data.flush()
+    }
+
+    // Every record with the mapped phone time of the newest fit at or before it (NO_FIT before the first)
+    private inline fun forEachMapped(
+        reader: SessionLogReader,
+        onRecord: (seq: Long, tUs: Long, receivedAtNs: Long, mappedNs: Long) -> Unit
+    ) {
+        var fit: SyncFit? = null
+        for (i in 0 until reader.recordCount) {
+            reader.fitAt(i)?.let { fit = it }
+            val tUs = reader.tUsAt(i)
+            onRecord(reader.seqAt(i), tUs, reader.receivedAtNsAt(i), fit?.mapBeaconToReceiverNs(tUs) ?: SessionColumns.NO_FIT)
+        }
+    }
+
+    private const val BUFFER_BYTES = 64 * 1024
+}
+
+/**
+ * Runs [SessionExport] off the caller's thread, one capture at a time on a low-priority worker, so exports
+ * never compete with the receive path. [onDone] runs on the worker with the exported file or the error.
+ */
+class SessionExporter {
+    private val worker: ExecutorService = Executors.newSingleThreadExecutor { r ->
+        Thread(r, "session-export").apply { priority = Thread.MIN_PRIORITY }
+    }
+
+    fun submit(capture: File, outDir: File, format: ExportFormat, onDone: (File?, Exception?) -> Unit): Future<*> =
+        worker.submit {
+            val out = format.fileFor(capture, outDir)
+            try {
+                if (!outDir.isDirectory && !outDir.mkdirs()) throw IOException("Cannot create $outDir")
+                SessionExport.export(capture, out, format)
+                onDone(out, null)
+            } catch (e: IOException) {
+                onDone(null, e)
+            }
+        }
+
+    fun shutdown() = worker.shutdown()
+}
@@ -0,0 +1,232 @@
+package com.example.ble_sync_suite_app
+
+// Session log: append-only binary capture of a beacon session, and a memory-mapped replay reader.
+// The format and the reader are java.nio only (no Android types), so captures can be replayed on a desktop
+// JVM as well; the recorder logs its I/O failures through android.util.Log.
+
+import android.util.Log
+import com.example.ble_sync_suite_app.sync.ClockSync
+import com.example.ble_sync_suite_app.sync.SyncFit
+import java.io.File
+import java.io.IOException
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.MappedByteBuffer
+import java.nio.channels.FileChannel
+import java.nio.file.StandardOpenOption
+import java.util.concurrent.ExecutorService
+import java.util.concurrent.Executors
+
+/**
+ * File layout (all little-endian):
+ *
+ *   Header, HEADER_BYTES:
+ *     [0]  magic "BSSL"        [4]  version u16     [6]  record size u16
+ *     [8]  start wall time ms i64                    [16] beacon MAC, 6 bytes (+2 padding)
+ *     [24] reserved, 8 bytes
+ *
+ *   Record, RECORD_BYTES, fixed width so replay can index it directly:
+ *     [0]  seq u32             [4]  flags u32 (FLAG_HAS_FIT)
+ *     [8]  tUs i64             [16] receivedAtNs i64
+ *     [24] fit alpha f64       [32] fit beta f64
+ *     [40] fit beaconEpochUs   [48] fit receiverEpochNs        (fit fields 0 without FLAG_HAS_FIT)
+ *
+ * A capture cut short (app killed mid-write) just ends on the last complete record.
+ */
+object SessionLog {
+    const val MAGIC = 0x4C535342 // "BSSL" read as little-endian i32
+    const val VERSION = 1
+    const val HEADER_BYTES = 32
+    const val RECORD_BYTES = 56
+    const val FLAG_HAS_FIT = 1
+
+    /** Parse "AA:BB:CC:DD:EE:FF" into 6 bytes; anything else becomes zeros. */
+    internal fun macBytes(address: String): ByteArray {
+        val parts = address.split(":")
+        if (parts.size != 6) return ByteArray(6)
+        return ByteArray(6) { i -> parts[i].toIntOrNull(16)?.toByte() ?: 0 }
+    }
+}
+
+/**
+ * Writes one session's packets to [file] (appends if it already holds a capture).
+ * [record] only copies into the current chunk; full chunks are written by a single writer thread,
+ * which also forces the file to storage at most every [fsyncIntervalMs].
+ * [record] and [close] may be called from different threads.
+ */
+class SessionRecorder(
+    private val file: File,
+    address: String,
+    private val fsyncIntervalMs: Long = DEFAULT_FSYNC_INTERVAL_MS,
+    startWallTimeMs: Long = System.currentTimeMillis()
+) {
+    private val channel: FileChannel = FileChannel.open(
+        file.toPath(), StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.APPEND
+    )
+    private val writer: ExecutorService = Executors.newSingleThreadExecutor { r -> Thread(r, "session-log") }
+    private var chunk = newChunk()
+    private var lastSyncMs = 0L
+    private var closed = false
+
+    init {
+        val header = ByteBuffer.allocate(SessionLog.HEADER_BYTES).order(ByteOrder.LITTLE_ENDIAN)
+        header.putInt(SessionLog.MAGIC)
+            .putShort(SessionLog.VERSION.toShort())
+            .putShort(SessionLog.RECORD_BYTES.toShort())
+            .putLong(startWallTimeMs)
+            .put(SessionLog.macBytes(address))
+        header.clear()
+        // First task on the writer thread, so it lands before any record
+        writer.execute {
+            try {
+                if (channel.size() == 0L) while (header.hasRemaining()) channel.write(header)
+            } catch (e: IOException) {
+                logError("Header write", e)
+            }
+        }
+    }
+
+    /** Append one packet, with the fit that was current after it (null if none yet). */
+    fun record(packet: EspPacket, fit: SyncFit?) = record(packet.seq, packet.tUs, packet.receivedAtNs, fit)
+
+    @Synchronized
+    fun record(seq: Long, tUs: Long, receivedAtNs: Long, fit: SyncFit?) {
+        if (closed) return
+        val b = chunk
+        b.putInt(seq.toInt())
+        b.putInt(if (fit != null) SessionLog.FLAG_HAS_FIT else 0)
+        b.putLong(tUs)
+        b.putLong(receivedAtNs)
+        b.putDouble(fit?.alpha ?: 0.0)
+        b.putDouble(fit?.beta ?: 0.0)
+        b.putLong(fit?.beaconEpochUs ?: 0L)
+        b.putLong(fit?.receiverEpochNs ?: 0L)
+        val nowMs = System.nanoTime() / 1_000_000
+        val syncDue = nowMs - lastSyncMs >= fsyncIntervalMs
+        if (!b.hasRemaining() || syncDue) {
+            flush(sync = syncDue)
+            if (syncDue) lastSyncMs = nowMs
+        }
+    }
+
+    /** Write everything recorded so far, force it to storage, and release the file. */
+    @Synchronized
+    fun close() {
+        if (closed) return
+        flush(sync = true)
+        closed = true
+        writer.execute {
+            try { channel.close() } catch (e: IOException) { logError("Close", e) }
+        }
+        writer.shutdown()
+    }
+
+    // Hand the current chunk to the writer thread; the next record starts a fresh one.
+    private fun flush(sync: Boolean) {
+        val full = chunk
+        chunk = newChunk()
+        full.flip()
+        writer.execute {
+            try {
+                while (full.hasRemaining()) channel.write(full)
+                if (sync) channel.force(false)
+            } catch (e: IOException) {
+                logError("Write", e)
+            }
+        }
+    }
+
+    private fun newChunk(): ByteBuffer =
+        ByteBuffer.allocate(CHUNK_RECORDS * SessionLog.RECORD_BYTES).order(ByteOrder.LITTLE_ENDIAN)
+
+    private fun logError(what: String, e: Exception) {
+        Log.e("SessionRecorder", "$what failed for ${file.name}", e)
+    }
+
+    companion object {
+        const val DEFAULT_FSYNC_INTERVAL_MS = 1000L
+        const val CHUNK_RECORDS = 256
+    }
+}
+
+/**
+ * Memory-mapped, read-only view of a capture written by [SessionRecorder].
+ * Column readers index records directly; nothing is copied up front. Files up to 2 GiB
+ * (about 38 M records, days of capture at 100 Hz).
+ */
+class SessionLogReader(file: File) : AutoCloseable {
+    private val channel: FileChannel = FileChannel.open(file.toPath(), StandardOpenOption.READ)
+    private val map: MappedByteBuffer
+    private val recordBytes: Int
+
+    /** Wall-clock time (ms) when the capture was started. */
+    val startWallTimeMs: Long
+
+    /** Beacon MAC as "AA:BB:CC:DD:EE:FF". */
+    val address: String
+
+    /** Complete records in the file. */
+    val recordCount: Int
+
+    init {
+        val size = channel.size()
+        if (size < SessionLog.HEADER_BYTES || size > Int.MAX_VALUE) {
+            channel.close()
+            throw IOException("Not a session log (size $size): ${file.name}")
+        }
+        map = channel.map(FileChannel.MapMode.READ_ONLY, 0, size)
+        map.order(ByteOrder.LITTLE_ENDIAN)
+        if (map.getInt(0) != SessionLog.MAGIC || map.getShort(4).toInt() != SessionLog.VERSION) {
+            channel.close()
+            throw IOException("Unsupported session log header: ${file.name}")
+        }
+        recordBytes = map.getShort(6).toInt()
+        if (recordBytes < SessionLog.RECORD_BYTES) {
+            channel.close()
+            throw IOException("Record size $recordBytes too small: ${file.name}")
+        }
+        startWallTimeMs = map.getLong(8)
+        address = (0 until 6).joinToString(":") { "%02X".format(map.get(16 + it).toInt() and 0xFF) }
+        recordCount = ((size - SessionLog.HEADER_BYTES) / recordBytes).toInt()
+    }
+
+    private fun offset(i: Int): Int {
+        if (i < 0 || i >= recordCount) throw IndexOutOfBoundsException("record $i, count $recordCount")
+        return SessionLog.HEADER_BYTES + i * recordBytes
+    }
+
+    fun seqAt(i: Int): Long = map.getInt(offset(i)).toLong() and 0xFFFF_FFFFL
+    fun tUsAt(i: Int): Long = map.getLong(offset(i) + 8)
+    fun receivedAtNsAt(i: Int): Long = map.getLong(offset(i) + 16)
+
+    /** Fit recorded with packet [i], or null if the session had none yet. */
+    fun fitAt(i: Int): SyncFit? {
+        val o = offset(i)
+        if (map.getInt(o + 4) and SessionLog.FLAG_HAS_FIT == 0) return null
+        return SyncFit(
+            alpha = map.getDouble(o + 24),
+            beta = map.getDouble(o + 32),
+            beaconEpochUs = map.getLong(o + 40),
+            receiverEpochNs = map.getLong(o + 48)
+        )
+    }
+
+    /**
+     * Feed records [from] until [to] through [sync] as fast as they can be read, calling [onSample]
+     * after each one (e.g. to score [sync] against the recorded fit or the next packet).
+     * [sync] is not reset first, so several ranges can be chained.
+     */
+    inline fun replay(
+        sync: ClockSync,
+        from: Int = 0,
+        to: Int = recordCount,
+        onSample: (index: Int, sync: ClockSync) -> Unit = { _, _ -> }
+    ) {
+        for (i in from until to) {
+            sync.addSample(tUsAt(i), receivedAtNsAt(i))
+            onSample(i, sync)
+        }
+    }
+
+    override fun close() = channel.close()
+}
@@ -0,0 +1,141 @@
+package com.example.ble_sync_suite_app
+
+// Sync cache: the last settled fit of each beacon, kept across connections so a reconnect to a beacon
+// that has not rebooted starts from it instead of from nothing. Stored with java.nio, like SessionLog.
+
+import android.util.Log
+import com.example.ble_sync_suite_app.sync.SyncFit
+import java.io.File
+import java.io.IOException
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.concurrent.ExecutorService
+import java.util.concurrent.Executors
+
+/** One beacon's cached fit and what it was valid for. */
+data class CachedSync(
+    /** Beacon boot ID (diagnostics v3) the fit was estimated under. */
+    val bootId: Long,
+    val fit: SyncFit,
+    /** Fit quality when saved; the lower-envelope window has no covariance, so this and [sampleCount] stand in. */
+    val rmsResidualMs: Double,
+    val sampleCount: Int,
+    /** Phone elapsedRealtimeNanos when saved: the receiver clock the fit maps into. */
+    val savedAtElapsedNs: Long,
+    /** Phone wall clock when saved; with [savedAtElapsedNs] it tells a phone reboot apart. */
+    val savedAtWallMs: Long
+)
+
+/**
+ * One file per beacon address in [dir], fixed layout (little-endian, ENTRY_BYTES):
+ *
+ *     [0]  magic "BSSC"        [4]  version u16     [6]  reserved u16
+ *     [8]  boot ID u32         [12] sample count u32
+ *     [16] alpha f64           [24] beta f64
+ *     [32] beaconEpochUs i64   [40] receiverEpochNs i64
+ *     [48] rmsResidualMs f64   [56] savedAtElapsedNs i64   [64] savedAtWallMs i64
+ *
+ * [store] writes on a single writer thread, to a temporary file renamed over the old one, so a reader
+ * never sees half an entry. [load] reads on the caller's thread (one 72-byte file).
+ */
+class SyncCache(
+    private val dir: File,
+    private val maxAgeNs: Long = DEFAULT_MAX_AGE_NS
+) {
+    private val writer: ExecutorService = Executors.newSingleThreadExecutor { r -> Thread(r, "sync-cache") }
+
+    /**
+     * The cached fit for [address], or null if there is none, it was estimated under another boot of the
+     * beacon, it is older than maxAgeNs, or the phone has rebooted since (elapsedRealtime restarted).
+     */
+    fun load(address: String, bootId: Long, nowElapsedNs: Long, nowWallMs: Long): CachedSync? {
+        val entry = read(fileFor(address)) ?: return null
+        if (entry.bootId != bootId) return null
+        val ageNs = nowElapsedNs - entry.savedAtElapsedNs
+        if (ageNs < 0 || ageNs > maxAgeNs) return null
+        // Same phone boot: wall time and elapsed time moved together (up to clock adjustments)
+        val bootShiftMs = (nowWallMs - ageNs / 1_000_000) - entry.savedAtWallMs
+        if (bootShiftMs < -BOOT_TOLERANCE_MS || bootShiftMs > BOOT_TOLERANCE_MS) return null
+        return entry
+    }
+
+    /** Replace [address]'s entry. Returns immediately; the write happens on the writer thread. */
+    fun store(address: String, entry: CachedSync) {
+        val b = ByteBuffer.allocate(ENTRY_BYTES).order(ByteOrder.LITTLE_ENDIAN)
+        b.putInt(MAGIC)
+            .putShort(VERSION.toShort())
+            .putShort(0)
+            .putInt(entry.bootId.toInt())
+            .putInt(entry.sampleCount)
+            .putDouble(entry.fit.alpha)
+            .putDouble(entry.fit.beta)
+            .putLong(entry.fit.beaconEpochUs)
+            .putLong(entry.fit.receiverEpochNs)
+            .putDouble(entry.rmsResidualMs)
+            .putLong(entry.savedAtElapsedNs)
+            .putLong(entry.savedAtWallMs)
+        val target = fileFor(address)
+        writer.execute {
+            try {
+                if (!dir.isDirectory && !dir.mkdirs()) throw IOException("cannot create $dir")
+                val tmp = File(dir, target.name + ".tmp")
+                tmp.writeBytes(b.array())
+                if (!tmp.renameTo(target)) throw IOException("rename to ${target.name} failed")
+            } catch (e: IOException) {
+                logError("Store", e)
+            }
+        }
+    }
+
+    /** Drop [address]'s entry (beacon forgotten, or its fit known to be bad). */
+    fun remove(address: String) {
+        val target = fileFor(address)
+        writer.execute { target.delete() }
+    }
+
+    /** Finish pending writes and stop the writer thread. */
+    fun close() {
+        writer.shutdown()
+    }
+
+    private fun fileFor(address: String): File = File(dir, "${address.replace(":", "")}.sync")
+
+    private fun read(file: File): CachedSync? {
+        if (!file.isFile || file.length() != ENTRY_BYTES.toLong()) return null
+        val b = try {
+            ByteBuffer.wrap(file.readBytes()).order(ByteOrder.LITTLE_ENDIAN)
+        } catch (e: IOException) {
+            logError("Load", e)
+            return null
+        }
+        if (b.limit() != ENTRY_BYTES || b.getInt(0) != MAGIC || b.getShort(4).toInt() != VERSION) return null
+        val beta = b.getDouble(24)
+        if (!beta.isFinite() || beta <= 0.0) return null
+        return CachedSync(
+            bootId = b.getInt(8).toLong() and 0xFFFF_FFFFL,
+            fit = SyncFit(
+                alpha = b.getDouble(16),
+                beta = beta,
+                beaconEpochUs = b.getLong(32),
+                receiverEpochNs = b.getLong(40)
+            ),
+            rmsResidualMs = b.getDouble(48),
+            sampleCount = b.getInt(12),
+            savedAtElapsedNs = b.getLong(56),
+            savedAtWallMs = b.getLong(64)
+        )
+    }
+
+    private fun logError(what: String, e: Exception) {
+        Log.e("SyncCache", "$what failed", e)
+    }
+
+    companion object {
+        const val MAGIC = 0x43535342 // "BSSC" read as little-endian i32
+        const val VERSION = 1
+        const val ENTRY_BYTES = 72
+        /** Beyond this the beacon's skew has likely drifted (temperature) more than a fresh window would. */
+        const val DEFAULT_MAX_AGE_NS = 3_600_000_000_000L
+        private const val BOOT_TOLERANCE_MS = 2_000L
+    }
+}
@@ -0,0 +1,153 @@
+package com.example.ble_sync_suite_app
+
+// Sync service: owns the BleManager, so connections, decode and fit keep running with the screen off or the
+// UI in the background. Foreground (notification plus a partial wake lock) only while a session is open.
+
+import android.app.Notification
+import android.app.NotificationChannel
+import android.app.NotificationManager
+import android.app.PendingIntent
+import android.app.Service
+import android.content.Context
+import android.content.Intent
+import android.content.pm.PackageManager
+import android.content.pm.ServiceInfo
+import android.os.Binder
+import android.os.Build
+import android.os.IBinder
+import android.os.PowerManager
+import android.util.Log
+import androidx.core.app.NotificationCompat
+import androidx.core.app.ServiceCompat
+import androidx.core.content.ContextCompat
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.cancel
+import kotlinx.coroutines.launch
+
+/**
+ * Bound by MainActivity for as long as it exists ([LocalBinder.manager]); started in the foreground by
+ * itself when the first session opens, and stopped again when the last one closes. A capture therefore
+ * survives the activity going away, and the service goes away with the activity when nothing is connected.
+ */
+class SyncService : Service() {
+
+    inner class LocalBinder : Binder() {
+        val manager: BleManager get() = this@SyncService.manager
+    }
+
+    private val binder = LocalBinder()
+    private lateinit var manager: BleManager
+    private val scope = CoroutineScope(SupervisorJob() + Dispatchers.Main.immediate)
+    private var wakeLock: PowerManager.WakeLock? = null
+    private var foreground = false
+
+    override fun onCreate() {
+        super.onCreate()
+        manager = BleManager(
+            context = this,
+            hasScanPermission = { hasPermission(PERMISSION_BLUETOOTH_SCAN) },
+            hasConnectPermission = { hasPermission(PERMISSION_BLUETOOTH_CONNECT) }
+        )
+        scope.launch {
+            manager.connectedSessions.collect { sessions -> onSessionsChanged(sessions.size) }
+        }
+    }
+
+    override fun onBind(intent: Intent): IBinder = binder
+
+    override fun onStartCommand(intent: Intent?, flags: Int, startId: Int): Int {
+        // Only ever started by onSessionsChanged, which expects startForeground right away
+        val count = manager.connectedSessions.value.size
+        try {
+            ServiceCompat.startForeground(
+                this, NOTIFICATION_ID, buildNotification(count),
+                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) ServiceInfo.FOREGROUND_SERVICE_TYPE_CONNECTED_DEVICE else 0
+            )
+            foreground = true
+        } catch (e: RuntimeException) {
+            // Not allowed from the background, or the connected-device type lacks its Bluetooth permission
+            Log.e("SyncService", "Cannot enter the foreground; sync stops with the UI", e)
+            stopSelf(startId)
+        }
+        // Nothing to reconnect to after the process is killed: the sessions are gone with it
+        return START_NOT_STICKY
+    }
+
+    override fun onDestroy() {
+        scope.cancel()
+        manager.listener = null
+        try { manager.disconnect() } catch (_: SecurityException) {}
+        manager.shutdown()
+        releaseWakeLock()
+        super.onDestroy()
+    }
+
+    private fun onSessionsChanged(count: Int) {
+        if (count > 0) {
+            acquireWakeLock()
+            if (!foreground) {
+                ContextCompat.startForegroundService(this, Intent(this, SyncService::class.java))
+            } else {
+                getSystemService(NotificationManager::class.java)?.notify(NOTIFICATION_ID, buildNotification(count))
+            }
+        } else {
+            releaseWakeLock()
+            if (foreground) {
+                ServiceCompat.stopForeground(this, ServiceCompat.STOP_FOREGROUND_REMOVE)
+                foreground = false
+                // Stays alive while the activity is bound
+                stopSelf()
+            }
+        }
+    }
+
+    // The decode thread and spill/record writers need the CPU while the screen is off; GATT callbacks
+    // alone would only wake it per notification. Bounded so a forgotten session cannot drain the battery forever.
+    private fun acquireWakeLock() {
+        if (wakeLock?.isHeld == true) return
+        val pm = getSystemService(Context.POWER_SERVICE) as PowerManager
+        wakeLock = pm.newWakeLock(PowerManager.PARTIAL_WAKE_LOCK, WAKE_LOCK_TAG).apply {
+            setReferenceCounted(false)
+            acquire(MAX_WAKE_LOCK_MS)
+        }
+    }
+
+    private fun releaseWakeLock() {
+        wakeLock?.let { if (it.isHeld) it.release() }
+        wakeLock = null
+    }
+
+    private fun buildNotification(sessionCount: Int): Notification {
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O) {
+            val channel = NotificationChannel(CHANNEL_ID, "Beacon sync", NotificationManager.IMPORTANCE_LOW)
+            getSystemService(NotificationManager::class.java)?.createNotificationChannel(channel)
+        }
+        val open = PendingIntent.getActivity(
+            this, 0,
+            Intent(this, MainActivity::class.java).addFlags(Intent.FLAG_ACTIVITY_SINGLE_TOP),
+            PendingIntent.FLAG_IMMUTABLE
+        )
+        return NotificationCompat.Builder(this, CHANNEL_ID)
+            .setSmallIcon(android.R.drawable.stat_sys_data_bluetooth)
+            .setContentTitle("Syncing with $sessionCount beacon${if (sessionCount == 1) "" else "s"}")
+            .setContentText("Connections, decode and fit keep running with the screen off")
+            .setContentIntent(open)
+            .setOngoing(true)
+            .setOnlyAlertOnce(true)
+            .build()
+    }
+
+    private fun hasPermission(permission: String) =
+        Build.VERSION.SDK_INT < Build.VERSION_CODES.S ||
+            ContextCompat.checkSelfPermission(this, permission) == PackageManager.PERMISSION_GRANTED
+
+    companion object {
+        private const val CHANNEL_ID = "sync"
+        private const val NOTIFICATION_ID = 1
+        private const val WAKE_LOCK_TAG = "BleSyncSuite:sync"
+        /** Longest capture the wake lock covers; a new session after that takes it again. */
+        const val MAX_WAKE_LOCK_MS = 12 * 60 * 60 * 1000L
+    }
+}
@@ -2,6 +2,7 @@ package com.example.ble_sync_suite_app.sync
 
 import kotlin.math.abs
 import kotlin.math.sqrt
+import kotlin.random.Random
 
 // =============================================================================
 // CHEEP SYNC — Standalone clock synchronization (no Android/BLE dependency)
@@ -19,73 +20,274 @@ import kotlin.math.sqrt
 // Input:  Pairs (beaconTimeUs, receiverTimeNs) from your transport (e.g. each BLE packet).
 // Output: Updated alpha, beta, and the ability to map any beacon timestamp → receiver ns.
 //         No automatic correction of raw data; you call mapBeaconToReceiverNs when you need a converted time.
+//
+// Precision: after days of uptime both clocks are ~1e14 ns, where Double products such as
+// tb·tb lose most of their bits. The fit therefore runs on deltas from an epoch (one
+// sample's exact Long timestamps), refreshed every REBASE_INTERVAL_US of beacon time, and
+// SyncFit carries that epoch. The window values then stay within a few minutes of zero.
 // =============================================================================
 
+/**
+ * How CheepSync recomputes the fit on each sample.
+ * INCREMENTAL: running centered sums (Welford-style add/remove), O(1) per sample.
+ * BATCH:       full rescan of the window, O(windowSize) per sample. Kept as the reference path.
+ */
+enum class FitMode { INCREMENTAL, BATCH }
+
+/**
+ * Which samples the line is fitted to. Independent of [FitMode]: both modes give the same fit,
+ * INCREMENTAL from running weighted sums, BATCH by rescanning the window.
+ * LEAST_SQUARES:  plain OLS, every sample weight 1.
+ * LOWER_ENVELOPE: minimum-delay filter. The window is split into blocks of [CheepSync.ENVELOPE_BLOCK_SIZE]
+ *                 consecutive samples; only the least-delayed sample of each block is fitted.
+ * HUBER:          IRLS with Huber weights (1 inside c·σ, c·σ/|r| outside), σ from the residuals' MAD.
+ * RANSAC:         consensus over [CheepSync.RANSAC_ITERATIONS] two-point hypotheses; OLS over the inliers.
+ * All four are amortized O(1) per sample (see "ROBUST" below).
+ */
+enum class Estimator { LEAST_SQUARES, LOWER_ENVELOPE, HUBER, RANSAC }
+
 class CheepSync(
-    private val windowSize: Int = DEFAULT_WINDOW_SIZE
-) {
-    // One (beacon time in ns, receiver time in ns) pair for the regression.
-    private data class Sample(
-        val tbNs: Double,
-        val TrNs: Double
-    )
+    private val windowSize: Int = DEFAULT_WINDOW_SIZE,
+    val mode: FitMode = FitMode.INCREMENTAL,
+    val estimator: Estimator = Estimator.LEAST_SQUARES,
+    /** RANSAC inlier band: |residual| at or below this (ms) counts as consensus. */
+    private val outlierThresholdMs: Double = DEFAULT_OUTLIER_THRESHOLD_MS
+) : ClockSync {
+    // Sliding window of recent (beacon ns, receiver ns) pairs as a fixed-capacity ring of primitives.
+    // Allocated once here; addSample never allocates. `head` is the oldest slot, `count` the fill level.
+    private val tbWindow = DoubleArray(windowSize)
+    private val TrWindow = DoubleArray(windowSize)
+    // Per-slot fit weight: always 1 for LEAST_SQUARES, set by the robust estimators otherwise
+    private val weights = DoubleArray(windowSize)
+    private var head = 0
+    private var count = 0
 
-    // Sliding window of recent samples. Oldest dropped when over windowSize.
-    private val window = ArrayDeque<Sample>()
+    init {
+        require(windowSize >= 1) { "windowSize must be at least 1, was $windowSize" }
+    }
 
-    /** Current offset α in nanoseconds. When beacon time is 0, receiver time ≈ alpha. */
-    var alpha: Double = 0.0
-        private set
+    // Running weighted centered sums over the window (INCREMENTAL mode only).
+    //   wSum = Σw;  tbMean, TrMean = weighted means;  sxx = Σw(x-x̄)²,  sxy = Σw(x-x̄)(y-ȳ),  syy = Σw(y-ȳ)²
+    private var wSum = 0.0
+    private var tbMean = 0.0
+    private var TrMean = 0.0
+    private var sxx = 0.0
+    private var sxy = 0.0
+    private var syy = 0.0
+    // Evictions since the sums were last rebuilt from the window (bounds floating-point drift).
+    private var evictionsSinceRebuild = 0
+
+    // Robust estimator state (unused for LEAST_SQUARES)
+    private val scratch = DoubleArray(windowSize)
+    private val random = Random(RANSAC_SEED)
+    private val envelopeBlockSize = minOf(ENVELOPE_BLOCK_SIZE, windowSize)
+    private var envelopeBlockFill = 0
+    private var envelopeSlot = -1
+    private var envelopeDelayNs = 0.0
+    private var envelopeBeta = 1.0
+    private var huberScaleNs = 0.0
+    private var samplesSinceReweight = 0
+    private var reweightInterval = 1
+
+    // Epoch the window is measured from (exact), and the fitted offset at that epoch:
+    //   Tr − receiverEpochNs ≈ offsetNs + β · (tb − beaconEpoch)
+    private var beaconEpochUs = 0L
+    private var receiverEpochNs = 0L
+    private var offsetNs = 0.0
+
+    /**
+     * Current offset α in nanoseconds, extrapolated to beacon time 0 (receiver time ≈ alpha there).
+     * Derived from the rebased fit; map timestamps with [getFit] or [mapBeaconToReceiverNs] instead
+     * of recomputing α + β·tb, which loses precision on long uptimes.
+     */
+    override val alpha: Double
+        get() = receiverEpochNs + offsetNs - beta * (beaconEpochUs * 1000.0)
 
     /** Current skew β (dimensionless). Ratio of receiver clock rate to beacon clock rate. */
-    var beta: Double = 1.0
+    override var beta: Double = 1.0
         private set
 
     /** How well the line fits the window: root-mean-square error in milliseconds. */
-    var rmsResidualMs: Double = 0.0
+    override var rmsResidualMs: Double = 0.0
         private set
 
     /** How many samples are currently in the sliding window. */
-    val sampleCount: Int get() = window.size
+    override val sampleCount: Int get() = count
+
+    /**
+     * True once α, β come from an actual fit. With LEAST_SQUARES that is two samples; LOWER_ENVELOPE
+     * needs two blocks' minima, so check this rather than [sampleCount] before trusting the fit.
+     */
+    override var hasFit: Boolean = false
+        private set
 
     /**
      * Main sync method: add one (beacon time, receiver time) sample and recompute α, β.
-     * Uses least-squares linear regression over the sliding window.
+     * Uses (weighted) least-squares linear regression over the sliding window; see [Estimator].
      *
      * Input:  beaconTimeUs  = timestamp from beacon clock (microseconds)
      *         receiverTimeNs = timestamp from receiver clock when packet was received (nanoseconds)
      * Output: None. Updates alpha, beta, rmsResidualMs. Need at least 2 samples to compute a fit.
      */
-    fun addSample(beaconTimeUs: Long, receiverTimeNs: Long) {
-        // Convert beacon μs → ns for consistent units in regression
-        val tbNs = beaconTimeUs * 1000.0
-        val TrNs = receiverTimeNs.toDouble()
-        window.addLast(Sample(tbNs = tbNs, TrNs = TrNs))
-        while (window.size > windowSize) {
-            window.removeFirst()
+    override fun addSample(beaconTimeUs: Long, receiverTimeNs: Long) {
+        if (count == 0) {
+            beaconEpochUs = beaconTimeUs
+            receiverEpochNs = receiverTimeNs
+        } else if (beaconTimeUs - beaconEpochUs > REBASE_INTERVAL_US) {
+            rebase(beaconTimeUs, receiverTimeNs)
+        }
+        // Deltas from the epoch, taken in Long space (exact); beacon μs → ns for consistent units
+        val tbNs = (beaconTimeUs - beaconEpochUs) * 1000.0
+        val TrNs = (receiverTimeNs - receiverEpochNs).toDouble()
+        if (count == windowSize) {
+            // Full: evict the oldest slot, then reuse it for the new sample
+            val oldTb = tbWindow[head]
+            val oldTr = TrWindow[head]
+            val oldW = weights[head]
+            if (head == envelopeSlot) envelopeSlot = -1
+            head = if (head + 1 == windowSize) 0 else head + 1
+            count--
+            if (mode == FitMode.INCREMENTAL) {
+                exclude(oldTb, oldTr, oldW)
+                evictionsSinceRebuild++
+            }
+        }
+        val tail = slot(count)
+        tbWindow[tail] = tbNs
+        TrWindow[tail] = TrNs
+        weights[tail] = 0.0
+        count++
+        if (estimator == Estimator.LOWER_ENVELOPE) {
+            addToEnvelope(tail)
+        } else {
+            setWeight(tail, arrivalWeight(tbNs, TrNs))
         }
 
-        if (window.size < 2) return
+        // HUBER/RANSAC: re-score the whole window once the samples added since the last pass reach the
+        // fill at that pass (doubling while the window fills, then every windowSize) → amortized O(1)
+        if (estimator == Estimator.HUBER || estimator == Estimator.RANSAC) {
+            samplesSinceReweight++
+            if (samplesSinceReweight >= reweightInterval) {
+                samplesSinceReweight = 0
+                reweightInterval = count
+                if (estimator == Estimator.HUBER) huberReweight() else ransacReweight()
+                if (mode == FitMode.INCREMENTAL) rebuildSums()
+            }
+        }
 
-        val n = window.size.toDouble()
-        // Compute means of tb and Tr over the window
+        if (count < 2) return
+
+        when (mode) {
+            FitMode.INCREMENTAL -> {
+                if (evictionsSinceRebuild >= windowSize) rebuildSums()
+                incrementalFit()
+            }
+            FitMode.BATCH -> batchFit()
+        }
+    }
+
+    // ----- INCREMENTAL: Welford-style running sums (weighted; w = 1 reduces to plain OLS) -----
+
+    /** Ring index of the i-th oldest sample (0 = oldest). */
+    private fun slot(i: Int): Int {
+        val j = head + i
+        return if (j >= windowSize) j - windowSize else j
+    }
+
+    /** Add one sample with weight [w] to the running sums. */
+    private fun include(tbNs: Double, TrNs: Double, w: Double) {
+        if (w <= 0.0) return
+        wSum += w
+        val dx = tbNs - tbMean
+        val dyOld = TrNs - TrMean
+        tbMean += w * dx / wSum
+        TrMean += w * dyOld / wSum
+        val dyNew = TrNs - TrMean
+        sxx += w * dx * (tbNs - tbMean)
+        sxy += w * dx * dyNew
+        syy += w * dyOld * dyNew
+    }
+
+    /** Remove one sample with weight [w] from the running sums (any sample, not only the oldest). */
+    private fun exclude(tbNs: Double, TrNs: Double, w: Double) {
+        if (w <= 0.0) return
+        wSum -= w
+        if (wSum <= 0.0) {
+            wSum = 0.0; tbMean = 0.0; TrMean = 0.0; sxx = 0.0; sxy = 0.0; syy = 0.0
+            return
+        }
+        val tbMeanOld = tbMean
+        val TrMeanOld = TrMean
+        tbMean -= w * (tbNs - tbMeanOld) / wSum
+        TrMean -= w * (TrNs - TrMeanOld) / wSum
+        val dxNew = tbNs - tbMean
+        sxx -= w * dxNew * (tbNs - tbMeanOld)
+        sxy -= w * dxNew * (TrNs - TrMeanOld)
+        syy -= w * (TrNs - TrMean) * (TrNs - TrMeanOld)
+    }
+
+    /** Recompute the running sums exactly from the window. Runs once per windowSize evictions → amortized O(1). */
+    private fun rebuildSums() {
+        var w = 0.0
+        var xSum = 0.0
+        var ySum = 0.0
+        for (i in 0 until count) {
+            val k = slot(i)
+            w += weights[k]
+            xSum += weights[k] * tbWindow[k]
+            ySum += weights[k] * TrWindow[k]
+        }
+        wSum = w
+        tbMean = if (w > 0.0) xSum / w else 0.0
+        TrMean = if (w > 0.0) ySum / w else 0.0
+        sxx = 0.0; sxy = 0.0; syy = 0.0
+        for (i in 0 until count) {
+            val k = slot(i)
+            val x = tbWindow[k] - tbMean
+            val y = TrWindow[k] - TrMean
+            sxx += weights[k] * x * x
+            sxy += weights[k] * x * y
+            syy += weights[k] * y * y
+        }
+        evictionsSinceRebuild = 0
+    }
+
+    /** α, β and RMS straight from the running sums: RSS = Syy - Sxy² / Sxx. */
+    private fun incrementalFit() {
+        if (sxx <= 0.0 || wSum <= 0.0) return
+        beta = sxy / sxx
+        offsetNs = TrMean - beta * tbMean
+        val rss = (syy - sxy * sxy / sxx).coerceAtLeast(0.0)
+        rmsResidualMs = sqrt(rss / wSum) / 1_000_000.0
+        hasFit = true
+    }
+
+    // ----- BATCH: reference path, full rescan of the window -----
+
+    private fun batchFit() {
+        // Compute weighted means of tb and Tr over the window
+        var n = 0.0
         var tbMean = 0.0
         var TrMean = 0.0
-        for (s in window) {
-            tbMean += s.tbNs
-            TrMean += s.TrNs
+        for (i in 0 until count) {
+            val k = slot(i)
+            n += weights[k]
+            tbMean += weights[k] * tbWindow[k]
+            TrMean += weights[k] * TrWindow[k]
         }
+        if (n <= 0.0) return
         tbMean /= n
         TrMean /= n
 
         // Least-squares: β = cov(tb, Tr) / var(tb),  α = TrMean - β * tbMean
         var cov = 0.0
         var varTb = 0.0
-        for (s in window) {
-            val x = s.tbNs - tbMean
-            val y = s.TrNs - TrMean
-            cov += x * y
-            varTb += x * x
+        for (i in 0 until count) {
+            val k = slot(i)
+            val x = tbWindow[k] - tbMean
+            val y = TrWindow[k] - TrMean
+            cov += weights[k] * x * y
+            varTb += weights[k] * x * x
         }
 
         if (varTb == 0.0) return
@@ -93,72 +295,318 @@ class CheepSync(
         val newBeta = cov / varTb
         val newAlpha = TrMean - newBeta * tbMean
         beta = newBeta
-        alpha = newAlpha
+        offsetNs = newAlpha
+        hasFit = true
 
-        // RMS residual: sqrt(mean of squared errors) in ns, then convert to ms
+        // RMS residual: sqrt(weighted mean of squared errors) in ns, then convert to ms
         var rss = 0.0
-        for (s in window) {
-            val pred = alpha + beta * s.tbNs
-            val r = s.TrNs - pred
-            rss += r * r
+        for (i in 0 until count) {
+            val k = slot(i)
+            val pred = offsetNs + beta * tbWindow[k]
+            val r = TrWindow[k] - pred
+            rss += weights[k] * r * r
         }
         val rmsNs = sqrt(rss / n)
         rmsResidualMs = rmsNs / 1_000_000.0
     }
 
+    // ----- ROBUST: per-slot weights on top of the weighted sums -----
+    //
+    // Every estimator reduces to "which weight does each window slot get"; the fit itself is always the
+    // weighted least-squares above, so INCREMENTAL and BATCH stay interchangeable.
+    //   LOWER_ENVELOPE: O(1) exactly. Within a block, delay = Tr − β·tb with β frozen at the block's first
+    //                   sample; a new block minimum swaps weight 1 from the previous candidate to itself.
+    //   HUBER, RANSAC:  a new sample is weighted against the current fit (O(1)); the whole window is
+    //                   re-scored in O(windowSize · iterations) only when the samples added since the last
+    //                   pass reach the current fill — amortized O(iterations) = O(1) per sample.
+    // rmsResidualMs is the weighted RMS, i.e. over the samples the estimator keeps.
+
+    // ----- Epoch -----
+
+    /**
+     * Move the epoch to (beaconTimeUs, receiverTimeNs). Shifting every point by a constant leaves the
+     * centered sums, β and the weights unchanged; only the means, the window and the offset move.
+     * O(windowSize) once per REBASE_INTERVAL_US → amortized O(1).
+     */
+    private fun rebase(beaconTimeUs: Long, receiverTimeNs: Long) {
+        val dx = (beaconTimeUs - beaconEpochUs) * 1000.0
+        val dy = (receiverTimeNs - receiverEpochNs).toDouble()
+        for (i in 0 until count) {
+            val k = slot(i)
+            tbWindow[k] -= dx
+            TrWindow[k] -= dy
+        }
+        tbMean -= dx
+        TrMean -= dy
+        offsetNs += beta * dx - dy
+        envelopeDelayNs += envelopeBeta * dx - dy
+        beaconEpochUs = beaconTimeUs
+        receiverEpochNs = receiverTimeNs
+    }
+
+    /** Change one slot's weight, keeping the running sums in step. */
+    private fun setWeight(k: Int, w: Double) {
+        if (mode == FitMode.INCREMENTAL) {
+            exclude(tbWindow[k], TrWindow[k], weights[k])
+            include(tbWindow[k], TrWindow[k], w)
+        }
+        weights[k] = w
+    }
+
+    /** Weight of a newly added sample against the current fit (LEAST_SQUARES, HUBER, RANSAC). */
+    private fun arrivalWeight(tbNs: Double, TrNs: Double): Double {
+        if (estimator == Estimator.LEAST_SQUARES || !hasFit) return 1.0
+        val r = abs(TrNs - (offsetNs + beta * tbNs))
+        return when (estimator) {
+            Estimator.HUBER -> huberWeight(r)
+            Estimator.RANSAC -> if (r <= outlierThresholdMs * 1_000_000.0) 1.0 else 0.0
+            else -> 1.0
+        }
+    }
+
+    private fun addToEnvelope(k: Int) {
+        weights[k] = 0.0
+        if (envelopeBlockFill == 0) {
+            envelopeBeta = beta
+            envelopeSlot = -1
+        }
+        val delay = TrWindow[k] - envelopeBeta * tbWindow[k]
+        if (envelopeSlot < 0 || delay < envelopeDelayNs) {
+            if (envelopeSlot >= 0) setWeight(envelopeSlot, 0.0)
+            envelopeSlot = k
+            envelopeDelayNs = delay
+            setWeight(k, 1.0)
+        }
+        envelopeBlockFill++
+        if (envelopeBlockFill == envelopeBlockSize) envelopeBlockFill = 0
+    }
+
+    private fun huberWeight(absResidualNs: Double): Double {
+        if (huberScaleNs <= 0.0) return 1.0
+        val c = HUBER_K * huberScaleNs
+        return if (absResidualNs <= c) 1.0 else c / absResidualNs
+    }
+
+    /** IRLS from the plain OLS fit: estimate σ from the MAD, reweight, refit; HUBER_ITERATIONS rounds. */
+    private fun huberReweight() {
+        for (i in 0 until count) weights[slot(i)] = 1.0
+        if (count < 3) {
+            batchFit()
+            return
+        }
+        repeat(HUBER_ITERATIONS) {
+            batchFit()
+            for (i in 0 until count) {
+                val k = slot(i)
+                scratch[i] = TrWindow[k] - (offsetNs + beta * tbWindow[k])
+            }
+            val med = select(scratch, count, count / 2)
+            for (i in 0 until count) scratch[i] = abs(scratch[i] - med)
+            huberScaleNs = (MAD_TO_SIGMA * select(scratch, count, count / 2)).coerceAtLeast(MIN_SCALE_NS)
+            for (i in 0 until count) {
+                val k = slot(i)
+                weights[k] = huberWeight(abs(TrWindow[k] - (offsetNs + beta * tbWindow[k])))
+            }
+        }
+        batchFit()
+    }
+
+    /** Best of RANSAC_ITERATIONS two-point lines by inlier count (ties: smaller absolute residual sum). */
+    private fun ransacReweight() {
+        for (i in 0 until count) weights[slot(i)] = 1.0
+        if (count < 3) {
+            batchFit()
+            return
+        }
+        val threshold = outlierThresholdMs * 1_000_000.0
+        var bestInliers = -1
+        var bestCost = Double.MAX_VALUE
+        var bestAlpha = offsetNs
+        var bestBeta = beta
+        repeat(RANSAC_ITERATIONS) {
+            val a = slot(random.nextInt(count))
+            val b = slot(random.nextInt(count))
+            val dx = tbWindow[b] - tbWindow[a]
+            if (dx == 0.0) return@repeat
+            val hBeta = (TrWindow[b] - TrWindow[a]) / dx
+            val hAlpha = TrWindow[a] - hBeta * tbWindow[a]
+            var inliers = 0
+            var cost = 0.0
+            for (i in 0 until count) {
+                val k = slot(i)
+                val r = abs(TrWindow[k] - (hAlpha + hBeta * tbWindow[k]))
+                if (r <= threshold) {
+                    inliers++
+                    cost += r
+                }
+            }
+            if (inliers > bestInliers || (inliers == bestInliers && cost < bestCost)) {
+                bestInliers = inliers
+                bestCost = cost
+                bestAlpha = hAlpha
+                bestBeta = hBeta
+            }
+        }
+        if (bestInliers < 2) {
+            batchFit()
+            return
+        }
+        for (i in 0 until count) {
+            val k = slot(i)
+            weights[k] = if (abs(TrWindow[k] - (bestAlpha + bestBeta * tbWindow[k])) <= threshold) 1.0 else 0.0
+        }
+        batchFit()
+    }
+
+    /** k-th smallest of values[0 until n] (Hoare quickselect, reorders values). Expected O(n). */
+    private fun select(values: DoubleArray, n: Int, k: Int): Double {
+        var lo = 0
+        var hi = n - 1
+        while (lo < hi) {
+            val pivot = values[(lo + hi) ushr 1]
+            var i = lo
+            var j = hi
+            while (i <= j) {
+                while (values[i] < pivot) i++
+                while (values[j] > pivot) j--
+                if (i <= j) {
+                    val t = values[i]; values[i] = values[j]; values[j] = t
+                    i++; j--
+                }
+            }
+            if (k <= j) hi = j else if (k >= i) lo = i else return values[k]
+        }
+        return values[k]
+    }
+
     /**
      * Convert a beacon timestamp (μs) into the receiver's timeline (ns).
-     * Formula: receiver_ns = α + β * (beaconTimeUs * 1000).
+     * Formula: receiver_ns = α + β * (beaconTimeUs * 1000), evaluated relative to the epoch.
      */
-    fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long {
-        val tbNs = beaconTimeUs * 1000.0
-        return (alpha + beta * tbNs).toLong()
+    override fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long {
+        val tbNs = (beaconTimeUs - beaconEpochUs) * 1000.0
+        return receiverEpochNs + (offsetNs + beta * tbNs).toLong()
     }
 
     /**
      * Sync error for one sample: |actual receiver time - predicted| in milliseconds.
      * Useful to check how well a single packet fits the current fit.
      */
-    fun residualMs(beaconTimeUs: Long, receiverTimeNs: Long): Double {
-        val tbNs = beaconTimeUs * 1000.0
-        val pred = alpha + beta * tbNs
-        return abs(receiverTimeNs.toDouble() - pred) / 1_000_000.0
+    override fun residualMs(beaconTimeUs: Long, receiverTimeNs: Long): Double {
+        val tbNs = (beaconTimeUs - beaconEpochUs) * 1000.0
+        val pred = offsetNs + beta * tbNs
+        return abs((receiverTimeNs - receiverEpochNs) - pred) / 1_000_000.0
     }
 
     /**
      * Snapshot of (α, β) so other code can convert timestamps without holding a reference to CheepSync.
      * Use SyncFit.mapBeaconToReceiverNs(...) or mapBeaconToReceiverMs(...) with that snapshot.
      */
-    fun getFit(): SyncFit = SyncFit(alpha = alpha, beta = beta)
+    override fun getFit(): SyncFit =
+        SyncFit(alpha = offsetNs, beta = beta, beaconEpochUs = beaconEpochUs, receiverEpochNs = receiverEpochNs)
 
     /** Clear the window and reset α=0, β=1. Call when starting a new connection/session. */
-    fun reset() {
-        window.clear()
-        alpha = 0.0
+    override fun reset() {
+        head = 0
+        count = 0
+        wSum = 0.0
+        tbMean = 0.0
+        TrMean = 0.0
+        sxx = 0.0
+        sxy = 0.0
+        syy = 0.0
+        evictionsSinceRebuild = 0
+        envelopeBlockFill = 0
+        envelopeSlot = -1
+        envelopeBeta = 1.0
+        huberScaleNs = 0.0
+        samplesSinceReweight = 0
+        reweightInterval = 1
+        beaconEpochUs = 0L
+        receiverEpochNs = 0L
+        offsetNs = 0.0
         beta = 1.0
         rmsResidualMs = 0.0
+        hasFit = false
     }
 
     companion object {
         const val DEFAULT_WINDOW_SIZE = 50
+        /** Beacon time between epoch refreshes (60 s): keeps window deltas below ~1e11 ns. */
+        const val REBASE_INTERVAL_US = 60_000_000L
+        /** LOWER_ENVELOPE: samples per block (one minimum kept per block). */
+        const val ENVELOPE_BLOCK_SIZE = 4
+        /** HUBER: tuning constant k (95% efficiency under Gaussian noise) and IRLS rounds per re-score. */
+        const val HUBER_K = 1.345
+        const val HUBER_ITERATIONS = 3
+        /** RANSAC: hypotheses per re-score. */
+        const val RANSAC_ITERATIONS = 16
+        const val DEFAULT_OUTLIER_THRESHOLD_MS = 2.0
+        // Fixed seed so an INCREMENTAL and a BATCH instance fed the same samples pick the same hypotheses
+        private const val RANSAC_SEED = 0x5EED
+        private const val MAD_TO_SIGMA = 1.4826
+        // Floor for the Huber scale so a near-perfect window does not down-weight everything (0.1 ms)
+        private const val MIN_SCALE_NS = 100_000.0
     }
 }
 
 /**
- * Immutable copy of (α, β). Use this to convert timestamps in another module without depending on CheepSync.
+ * Immutable copy of (α, β) and the epoch they are relative to. Use this to convert timestamps in another
+ * module without depending on CheepSync.
+ *   Tr − receiverEpochNs ≈ alpha + beta · (tb − beaconEpochUs)·1000
+ * With both epochs 0 (the defaults) this is the plain Tr ≈ α + β·tb. Mapping goes through the epoch
+ * in Long space, so it keeps ns precision however long the clocks have been running.
  * mapBeaconToReceiverNs: beacon μs → receiver ns.
  * mapBeaconToReceiverMs: beacon μs → receiver ms.
+ * mapReceiverToBeaconUs: receiver ns → beacon μs (inverse of the fit).
+ * mapToBeaconUs:         beacon μs → another beacon's μs, through the shared receiver timeline.
  */
 data class SyncFit(
+    /** Offset (ns) at the epoch: predicted Tr − receiverEpochNs when tb = beaconEpochUs. */
     val alpha: Double,
-    val beta: Double
+    val beta: Double,
+    val beaconEpochUs: Long = 0L,
+    val receiverEpochNs: Long = 0L
 ) {
+    /** α extrapolated to beacon time 0 (the un-rebased offset). For display; loses precision on long uptimes. */
+    val absoluteAlpha: Double get() = receiverEpochNs + alpha - beta * (beaconEpochUs * 1000.0)
+
     fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long {
-        val tbNs = beaconTimeUs * 1000.0
-        return (alpha + beta * tbNs).toLong()
+        val tbNs = (beaconTimeUs - beaconEpochUs) * 1000.0
+        return receiverEpochNs + (alpha + beta * tbNs).toLong()
+    }
+
+    /**
+     * [mapBeaconToReceiverNs] of beaconTimesUs[from until to], written to the same indices of [out] (which may be
+     * [beaconTimesUs] itself). One pass, no allocation, and every timestamp of the batch goes through this one fit.
+     */
+    fun mapBeaconToReceiverNs(beaconTimesUs: LongArray, out: LongArray, from: Int = 0, to: Int = beaconTimesUs.size) {
+        require(from in 0..to && to <= beaconTimesUs.size && to <= out.size) { "range $from..$to outside the arrays" }
+        val epochUs = beaconEpochUs
+        val epochNs = receiverEpochNs
+        val a = alpha
+        val b = beta
+        for (i in from until to) {
+            out[i] = epochNs + (a + b * ((beaconTimesUs[i] - epochUs) * 1000.0)).toLong()
+        }
     }
 
     fun mapBeaconToReceiverMs(beaconTimeUs: Long): Double {
         return mapBeaconToReceiverNs(beaconTimeUs) / 1_000_000.0
     }
+
+    fun mapReceiverToBeaconUs(receiverTimeNs: Long): Long {
+        return beaconEpochUs + (((receiverTimeNs - receiverEpochNs) - alpha) / beta / 1000.0).toLong()
+    }
+
+    /**
+     * Map a timestamp from this fit's beacon to [other]'s beacon, where both fits were estimated
+     * against the same receiver clock: tb_other = (α + β·tb − α_other) / β_other.
+     * Computed in one step, relative to [other]'s receiver epoch, so the receiver-time intermediate is
+     * never rounded to a Long.
+     */
+    fun mapToBeaconUs(beaconTimeUs: Long, other: SyncFit): Long {
+        val receiverNs = (receiverEpochNs - other.receiverEpochNs) + alpha + beta * ((beaconTimeUs - beaconEpochUs) * 1000.0)
+        return other.beaconEpochUs + ((receiverNs - other.alpha) / other.beta / 1000.0).toLong()
+    }
 }
@@ -0,0 +1,42 @@
+package com.example.ble_sync_suite_app.sync
+
+// =============================================================================
+// CLOCK SYNC — Common contract of the clock estimators (no Android/BLE dependency)
+// =============================================================================
+//
+// CheepSync (sliding-window regression) and KalmanSync (2-state tracker) both
+// estimate Tr ≈ α + β·tb from (beaconTimeUs, receiverTimeNs) samples; callers that
+// only feed samples and map timestamps can hold either through this interface.
+// =============================================================================
+
+interface ClockSync {
+    /** Offset α in nanoseconds (predicted receiver time at beacon time 0). */
+    val alpha: Double
+
+    /** Skew β (dimensionless): receiver clock rate over beacon clock rate. */
+    val beta: Double
+
+    /** Fit quality in milliseconds (see each implementation for exactly what is measured). */
+    val rmsResidualMs: Double
+
+    /** Samples currently contributing to the estimate. */
+    val sampleCount: Int
+
+    /** True once α, β come from actual data rather than the initial α=0, β=1. */
+    val hasFit: Boolean
+
+    /** Feed one (beacon μs, receiver ns) pair. */
+    fun addSample(beaconTimeUs: Long, receiverTimeNs: Long)
+
+    /** Beacon μs → receiver ns with the current estimate. */
+    fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long
+
+    /** |actual − predicted| for one sample, in milliseconds. */
+    fun residualMs(beaconTimeUs: Long, receiverTimeNs: Long): Double
+
+    /** Immutable snapshot of (α, β). */
+    fun getFit(): SyncFit
+
+    /** Forget everything (new connection/session). */
+    fun reset()
+}
@@ -0,0 +1,177 @@
+package com.example.ble_sync_suite_app.sync
+
+import kotlin.math.abs
+import kotlin.math.sqrt
+
+// =============================================================================
+// KALMAN SYNC — 2-state (offset, skew) clock tracker (no Android/BLE dependency)
+// =============================================================================
+//
+// Purpose: Follow a skew that keeps changing (e.g. a beacon crystal warming up after
+// boot) without the lag/noise trade-off of a fixed regression window. O(1) per
+// sample, no window memory.
+//
+// State at the latest sample's beacon time tb_k (ns):
+//   o = Tr − tb   offset (ns)        s = β − 1   skew (dimensionless)
+// Predict over Δ = tb_k − tb_{k−1}:   o ← o + s·Δ,   s ← s
+// Measure:                            z = Tr − tb = o + noise
+//
+// Process noise is a random walk on each state, given per √second of beacon time:
+//   offset: processNoiseOffsetNs ns/√s     skew: processNoiseSkewPpm ppm/√s
+// Measurement noise: measurementNoiseMs, the standard deviation of one sample.
+// Larger skew noise follows drift changes faster; larger measurement noise smooths more.
+//
+// The offset is kept relative to the first sample's exact Tr − tb (offsetEpochNs) and the
+// state time as the latest sample's Long μs, so no Double ever holds a raw ~1e14 ns stamp.
+// =============================================================================
+
+class KalmanSync(
+    private val processNoiseOffsetNs: Double = DEFAULT_PROCESS_NOISE_OFFSET_NS,
+    private val processNoiseSkewPpm: Double = DEFAULT_PROCESS_NOISE_SKEW_PPM,
+    private val measurementNoiseMs: Double = DEFAULT_MEASUREMENT_NOISE_MS,
+    /** Prior standard deviation of the skew before the first update (ppm). */
+    private val initialSkewPpm: Double = DEFAULT_INITIAL_SKEW_PPM
+) : ClockSync {
+    // State and covariance P = [[pOO, pOS], [pOS, pSS]] at beacon time lastTbUs; o = offsetEpochNs + offsetNs
+    private var offsetEpochNs = 0L
+    private var offsetNs = 0.0
+    private var skew = 0.0
+    private var pOO = 0.0
+    private var pOS = 0.0
+    private var pSS = 0.0
+    private var lastTbUs = 0L
+    private var innovationMeanSq = 0.0
+    private var count = 0
+
+    private val r = square(measurementNoiseMs * 1_000_000.0)
+    private val qOffset = square(processNoiseOffsetNs)          // ns² per s
+    private val qSkew = square(processNoiseSkewPpm * 1e-6)      // 1/s
+
+    /** α extrapolated to beacon time 0; map timestamps through [getFit] or [mapBeaconToReceiverNs] instead. */
+    override val alpha: Double get() = offsetEpochNs + offsetNs - skew * (lastTbUs * 1000.0)
+
+    override val beta: Double get() = 1.0 + skew
+
+    /**
+     * RMS of the innovations (measurement minus prediction, before each update), exponentially
+     * averaged over about [CheepSync.DEFAULT_WINDOW_SIZE] samples, in milliseconds.
+     */
+    override val rmsResidualMs: Double get() = sqrt(innovationMeanSq) / 1_000_000.0
+
+    /** Samples accepted since the last reset (there is no window). */
+    override val sampleCount: Int get() = count
+
+    override val hasFit: Boolean get() = count >= 2
+
+    /** Standard deviation of the offset estimate at the latest sample, in nanoseconds. */
+    val offsetStdDevNs: Double get() = sqrt(pOO)
+
+    /** Standard deviation of the skew estimate, in ppm. */
+    val skewStdDevPpm: Double get() = sqrt(pSS) * 1e6
+
+    /**
+     * Track one sample. Samples older than the latest one are ignored (the state only moves forward
+     * in beacon time).
+     */
+    override fun addSample(beaconTimeUs: Long, receiverTimeNs: Long) {
+        // Difference in Long space: exact, then relative to the first one so the state stays small
+        val zAbs = receiverTimeNs - beaconTimeUs * 1000L
+        if (count == 0) {
+            offsetEpochNs = zAbs
+            offsetNs = 0.0
+            skew = 0.0
+            pOO = r
+            pOS = 0.0
+            pSS = square(initialSkewPpm * 1e-6)
+            lastTbUs = beaconTimeUs
+            count = 1
+            return
+        }
+        if (beaconTimeUs < lastTbUs) return
+        predict((beaconTimeUs - lastTbUs) * 1000.0)
+        lastTbUs = beaconTimeUs
+        val z = (zAbs - offsetEpochNs).toDouble()
+
+        // Update with H = [1, 0]
+        val innovation = z - offsetNs
+        val s = pOO + r
+        val kO = pOO / s
+        val kS = pOS / s
+        offsetNs += kO * innovation
+        skew += kS * innovation
+        val oo = pOO
+        val os = pOS
+        pOO = (1.0 - kO) * oo
+        pOS = (1.0 - kO) * os
+        pSS -= kS * os
+
+        innovationMeanSq += (innovation * innovation - innovationMeanSq) /
+            minOf(count, CheepSync.DEFAULT_WINDOW_SIZE).toDouble()
+        count++
+    }
+
+    /** Propagate state and covariance forward by [dtNs] of beacon time. */
+    private fun predict(dtNs: Double) {
+        val dtS = dtNs / 1e9
+        offsetNs += skew * dtNs
+        // P ← F P Fᵀ + Q with F = [[1, Δ], [0, 1]]
+        pOO += 2.0 * dtNs * pOS + dtNs * dtNs * pSS
+        pOS += dtNs * pSS
+        // Q for random walks on offset and skew (skew integrates into offset over the step)
+        pOO += qOffset * dtS + qSkew * dtS * dtNs * dtNs / 3.0
+        pOS += qSkew * dtS * dtNs / 2.0
+        pSS += qSkew * dtS
+    }
+
+    override fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long {
+        val dtNs = (beaconTimeUs - lastTbUs) * 1000.0
+        return beaconTimeUs * 1000L + offsetEpochNs + (offsetNs + skew * dtNs).toLong()
+    }
+
+    override fun residualMs(beaconTimeUs: Long, receiverTimeNs: Long): Double =
+        abs(receiverTimeNs - mapBeaconToReceiverNs(beaconTimeUs)) / 1_000_000.0
+
+    /**
+     * Half-width (ns) of the confidence interval of [mapBeaconToReceiverNs] at [beaconTimeUs]:
+     * [sigmas] standard deviations of the predicted offset, including process noise when
+     * extrapolating past the latest sample. 1.96 ≈ 95% for Gaussian noise.
+     */
+    fun confidenceIntervalNs(beaconTimeUs: Long, sigmas: Double = 1.96): Double {
+        val dtNs = (beaconTimeUs - lastTbUs) * 1000.0
+        var variance = pOO + 2.0 * dtNs * pOS + dtNs * dtNs * pSS
+        if (dtNs > 0.0) {
+            val dtS = dtNs / 1e9
+            variance += qOffset * dtS + qSkew * dtS * dtNs * dtNs / 3.0
+        }
+        return sigmas * sqrt(variance.coerceAtLeast(0.0))
+    }
+
+    /** Fit with its epoch at the latest sample, so mapping through it matches [mapBeaconToReceiverNs]. */
+    override fun getFit(): SyncFit = SyncFit(
+        alpha = offsetNs,
+        beta = beta,
+        beaconEpochUs = lastTbUs,
+        receiverEpochNs = lastTbUs * 1000L + offsetEpochNs
+    )
+
+    override fun reset() {
+        offsetNs = 0.0
+        skew = 0.0
+        pOO = 0.0
+        pOS = 0.0
+        pSS = 0.0
+        offsetEpochNs = 0L
+        lastTbUs = 0L
+        innovationMeanSq = 0.0
+        count = 0
+    }
+
+    private fun square(x: Double) = x * x
+
+    companion object {
+        const val DEFAULT_PROCESS_NOISE_OFFSET_NS = 1_000.0
+        const val DEFAULT_PROCESS_NOISE_SKEW_PPM = 0.05
+        const val DEFAULT_MEASUREMENT_NOISE_MS = 2.0
+        const val DEFAULT_INITIAL_SKEW_PPM = 100.0
+    }
+}
@@ -0,0 +1,173 @@
+package com.example.ble_sync_suite_app.sync
+
+// =============================================================================
+// LOSS TRACKER — Incremental sequence-gap accounting (no Android/BLE dependency)
+// =============================================================================
+//
+// Purpose: Classify each arriving u32 sequence number against the highest one seen
+// so far, in O(1) and without storing the stream: in order, after a gap (and how
+// long the burst of missing packets was), a late arrival of a packet already counted
+// lost, a duplicate, or a restart of the sender's counter.
+//
+// Sequence arithmetic is modulo 2^32 (RFC 1982 style): a forward distance below 2^31
+// is ahead, anything else is behind. The last [REORDER_WINDOW] seqs below the highest
+// are remembered in a bitmask (as in RTP/IPsec replay windows), which is what tells a
+// late arrival from a duplicate. Further behind than that is a counter restart
+// (beacon reboot or a new session on the same link).
+// =============================================================================
+
+/** What [LossTracker.add] made of one sequence number. */
+enum class SeqEvent {
+    /** First packet since the last reset or restart. */
+    FIRST,
+    /** Exactly the next seq. */
+    IN_ORDER,
+    /** Ahead of the next seq: [LossTracker.lastGapLength] packets are missing before it. */
+    GAP,
+    /** Behind the highest seq but not seen before: a packet previously counted lost arrived late. */
+    REORDERED,
+    /** Seen before (within the window). */
+    DUPLICATE,
+    /** Far behind the highest seq: the sender's counter restarted. Counters keep running; the window restarts here. */
+    RESTART
+}
+
+/** Snapshot of [LossTracker]; immutable, safe to hand to the UI. */
+data class LossStats(
+    /** Distinct packets received (duplicates excluded). */
+    val received: Long = 0,
+    /** Packets the seq range says should have arrived: received + lost. */
+    val expected: Long = 0,
+    /** Missing packets, net of late arrivals. */
+    val lost: Long = 0,
+    /** Gap events (bursts of one or more missing packets). */
+    val gaps: Long = 0,
+    val reordered: Long = 0,
+    val duplicates: Long = 0,
+    val restarts: Long = 0,
+    /** Longest burst of consecutive missing packets. */
+    val longestBurst: Long = 0,
+    /**
+     * Gap events by burst length, log2 buckets: [0] = 1 packet, [i] = [2^i, 2^(i+1)) packets,
+     * last bucket open-ended.
+     */
+    val burstHistogram: List<Long> = List(LossTracker.BURST_BUCKETS) { 0L }
+) {
+    /** Fraction of expected packets that never arrived; 0 before any. */
+    val lossRatio: Double get() = if (expected == 0L) 0.0 else lost.toDouble() / expected
+}
+
+/**
+ * Running loss counters behind [LossStats]. [add] is O(1) and does not allocate; [snapshot] allocates
+ * one [LossStats]. Not thread-safe: feed it from one thread.
+ */
+class LossTracker {
+    private var started = false
+    private var highest = 0L
+    // Bit i set: seq (highest - 1 - i) has been received
+    private var window = 0L
+
+    private var received = 0L
+    private var lost = 0L
+    private var gaps = 0L
+    private var reordered = 0L
+    private var duplicates = 0L
+    private var restarts = 0L
+    private var longestBurst = 0L
+    private val burstHistogram = LongArray(BURST_BUCKETS)
+
+    /** Missing packets before the seq most recently classified as [SeqEvent.GAP]. */
+    var lastGapLength = 0L
+        private set
+
+    /** Classify one u32 [seq] (as handed out by u32LE, 0..0xFFFFFFFF) and update the counters. */
+    fun add(seq: Long): SeqEvent {
+        if (!started) {
+            restartAt(seq)
+            received++
+            return SeqEvent.FIRST
+        }
+        val ahead = (seq - highest) and SEQ_MASK
+        if (ahead == 0L) {
+            duplicates++
+            return SeqEvent.DUPLICATE
+        }
+        if (ahead < SEQ_HALF) {
+            // Shift the window up to seq: the old highest becomes bit ahead-1, the ones in between stay 0
+            window = if (ahead > REORDER_WINDOW) 0L else (window shl 1 or 1L) shl (ahead - 1).toInt()
+            highest = seq
+            received++
+            if (ahead == 1L) return SeqEvent.IN_ORDER
+            val burst = ahead - 1
+            lost += burst
+            gaps++
+            if (burst > longestBurst) longestBurst = burst
+            burstHistogram[burstBucket(burst)]++
+            lastGapLength = burst
+            return SeqEvent.GAP
+        }
+        val behind = (highest - seq) and SEQ_MASK
+        if (behind > REORDER_WINDOW) {
+            restarts++
+            restartAt(seq)
+            received++
+            return SeqEvent.RESTART
+        }
+        val bit = 1L shl (behind - 1).toInt()
+        if (window and bit != 0L) {
+            duplicates++
+            return SeqEvent.DUPLICATE
+        }
+        window = window or bit
+        received++
+        lost--
+        reordered++
+        return SeqEvent.REORDERED
+    }
+
+    fun snapshot(): LossStats = LossStats(
+        received = received,
+        expected = received + lost,
+        lost = lost,
+        gaps = gaps,
+        reordered = reordered,
+        duplicates = duplicates,
+        restarts = restarts,
+        longestBurst = longestBurst,
+        burstHistogram = burstHistogram.toList()
+    )
+
+    fun reset() {
+        started = false
+        highest = 0
+        window = 0
+        received = 0
+        lost = 0
+        gaps = 0
+        reordered = 0
+        duplicates = 0
+        restarts = 0
+        longestBurst = 0
+        lastGapLength = 0
+        burstHistogram.fill(0L)
+    }
+
+    private fun restartAt(seq: Long) {
+        started = true
+        highest = seq and SEQ_MASK
+        window = 0
+    }
+
+    companion object {
+        /** Seqs below the highest that are remembered for duplicate/late detection. */
+        const val REORDER_WINDOW = 64L
+        const val BURST_BUCKETS = 8
+        private const val SEQ_MASK = 0xFFFF_FFFFL
+        private const val SEQ_HALF = 0x8000_0000L
+
+        private fun burstBucket(burst: Long): Int {
+            val b = 63 - burst.countLeadingZeroBits()
+            return if (b < BURST_BUCKETS) b else BURST_BUCKETS - 1
+        }
+    }
+}
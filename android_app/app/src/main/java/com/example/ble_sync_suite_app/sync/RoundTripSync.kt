@@ -0,0 +1,107 @@
+package com.example.ble_sync_suite_app.sync
+
+// =============================================================================
+// ROUND TRIP SYNC — Two-way (NTP-style) clock sync (no Android/BLE dependency)
+// =============================================================================
+//
+// Purpose: CheepSync sees one-way samples only, so the fixed part of the path delay
+// (stack + air) ends up inside α. A round trip measures that delay and removes it.
+//
+// One exchange, four timestamps:
+//   t1 = receiver sends request          (receiver clock, ns)
+//   t2 = beacon receives request         (beacon clock, μs)
+//   t3 = beacon sends response           (beacon clock, μs)
+//   t4 = receiver receives response      (receiver clock, ns)
+//
+//   round-trip delay  δ = (t4 − t1) − (t3 − t2)      (each difference in its own clock)
+//   midpoint pair     beacon (t2 + t3)/2  ↔  receiver (t1 + t4)/2
+//
+// With a symmetric path the midpoints are simultaneous, so fitting Tr ≈ α + β·tb to the
+// midpoint pairs gives α without the path delay. δ/2 is the one-way path delay, which
+// can also be subtracted from a one-way CheepSync α (see correctOneWay).
+// =============================================================================
+
+/** Summary of the round-trip estimator; immutable, safe to hand to the UI. */
+data class RoundTripEstimate(
+    /** Exchanges accepted since the last reset. */
+    val exchanges: Long = 0,
+    val lastRoundTripMs: Double = 0.0,
+    val minRoundTripMs: Double = 0.0,
+    /** One-way path delay estimate: half the smallest round trip seen. */
+    val pathDelayMs: Double = 0.0,
+    /** Fit over midpoint pairs, or null until two exchanges are in the window. */
+    val fit: SyncFit? = null
+)
+
+/**
+ * Least-squares fit over round-trip midpoints (a CheepSync window fed with midpoint pairs),
+ * plus running round-trip delay statistics. O(1) per exchange in INCREMENTAL mode.
+ * Not thread-safe: feed it from one thread.
+ */
+class RoundTripSync(
+    windowSize: Int = CheepSync.DEFAULT_WINDOW_SIZE,
+    mode: FitMode = FitMode.INCREMENTAL,
+    estimator: Estimator = Estimator.LEAST_SQUARES
+) {
+    private val midpointFit = CheepSync(windowSize, mode, estimator)
+
+    private var exchanges = 0L
+    private var lastRoundTripNs = 0.0
+    private var minRoundTripNs = Double.MAX_VALUE
+
+    /** Offset α (ns) of the midpoint fit. */
+    val alpha: Double get() = midpointFit.alpha
+
+    /** Skew β of the midpoint fit. */
+    val beta: Double get() = midpointFit.beta
+
+    val sampleCount: Int get() = midpointFit.sampleCount
+
+    /** Half the smallest round trip seen (ns); 0 until the first exchange. */
+    val pathDelayNs: Double get() = if (exchanges == 0L) 0.0 else minRoundTripNs / 2.0
+
+    /**
+     * Add one exchange. Returns false (and ignores it) if the timestamps are inconsistent,
+     * i.e. the beacon's turnaround is longer than the receiver-side round trip.
+     */
+    fun addExchange(receiverSendNs: Long, beaconReceiveUs: Long, beaconSendUs: Long, receiverReceiveNs: Long): Boolean {
+        val turnaroundNs = (beaconSendUs - beaconReceiveUs) * 1000.0
+        val roundTripNs = (receiverReceiveNs - receiverSendNs) - turnaroundNs
+        if (turnaroundNs < 0 || roundTripNs < 0) return false
+
+        exchanges++
+        lastRoundTripNs = roundTripNs
+        if (roundTripNs < minRoundTripNs) minRoundTripNs = roundTripNs
+
+        // Average in Long space around t1 so the midpoint keeps ns resolution without overflow
+        val receiverMidNs = receiverSendNs + (receiverReceiveNs - receiverSendNs) / 2
+        val beaconMidUs = beaconReceiveUs + (beaconSendUs - beaconReceiveUs) / 2
+        midpointFit.addSample(beaconMidUs, receiverMidNs)
+        return true
+    }
+
+    fun mapBeaconToReceiverNs(beaconTimeUs: Long): Long = midpointFit.mapBeaconToReceiverNs(beaconTimeUs)
+
+    fun getFit(): SyncFit = midpointFit.getFit()
+
+    /** Remove the one-way path delay from a fit estimated on one-way (send stamp ↔ receive stamp) samples. */
+    fun correctOneWay(oneWay: SyncFit): SyncFit = oneWay.copy(alpha = oneWay.alpha - pathDelayNs)
+
+    fun estimate(): RoundTripEstimate {
+        if (exchanges == 0L) return RoundTripEstimate()
+        return RoundTripEstimate(
+            exchanges = exchanges,
+            lastRoundTripMs = lastRoundTripNs / 1_000_000.0,
+            minRoundTripMs = minRoundTripNs / 1_000_000.0,
+            pathDelayMs = pathDelayNs / 1_000_000.0,
+            fit = if (midpointFit.hasFit) midpointFit.getFit() else null
+        )
+    }
+
+    fun reset() {
+        midpointFit.reset()
+        exchanges = 0
+        lastRoundTripNs = 0.0
+        minRoundTripNs = Double.MAX_VALUE
+    }
+}
@@ -0,0 +1,145 @@
+package com.example.ble_sync_suite_app.sync
+
+// =============================================================================
+// SERIES PYRAMID — Multi-resolution min/max/mean history (no Android/BLE dependency)
+// =============================================================================
+//
+// Purpose: Chart a per-packet series (residual, skew) over any zoom level without
+// rescanning the packets. Level k aggregates the series into buckets of
+// baseBucketUs × fanout^k of beacon time; each level is a ring of the newest
+// bucketsPerLevel buckets, so level 0 holds minutes at full resolution and the top
+// level months at coarse resolution, in fixed memory.
+//
+// add() updates the current bucket of every level: O(levels), no allocation. A ring
+// slot remembers which bucket it holds, so skipped buckets (a gap in the stream) need
+// no clearing: a slot whose bucket index does not match is simply empty. query()
+// picks the finest level that covers the range in at most maxPoints buckets and
+// copies those buckets out: O(maxPoints), whatever the session length.
+// =============================================================================
+
+/** Reusable output of [SeriesPyramid.query]: the first [size] buckets, oldest first. */
+class SeriesWindow(val capacity: Int) {
+    /** Bucket start, beacon time (µs). */
+    val startUs = LongArray(capacity)
+    val min = DoubleArray(capacity)
+    val max = DoubleArray(capacity)
+    val mean = DoubleArray(capacity)
+    var size = 0
+        internal set
+    /** Width of the buckets in this window (µs). */
+    var bucketUs = 0L
+        internal set
+}
+
+/**
+ * Min/max/mean pyramid over one series, keyed by beacon time. [add] and [query] are synchronized, so one
+ * thread can feed it while another draws from it.
+ */
+class SeriesPyramid(
+    val baseBucketUs: Long = DEFAULT_BASE_BUCKET_US,
+    val bucketsPerLevel: Int = DEFAULT_BUCKETS_PER_LEVEL,
+    val levels: Int = DEFAULT_LEVELS,
+    val fanout: Int = DEFAULT_FANOUT
+) {
+    init {
+        require(baseBucketUs > 0 && bucketsPerLevel > 0 && levels > 0 && fanout >= 2) { "invalid pyramid shape" }
+    }
+
+    private val widthUs = LongArray(levels) { k -> var w = baseBucketUs; repeat(k) { w *= fanout }; w }
+    private val size = levels * bucketsPerLevel
+    private val bucket = LongArray(size) { Long.MIN_VALUE }
+    private val min = DoubleArray(size)
+    private val max = DoubleArray(size)
+    private val sum = DoubleArray(size)
+    private val count = IntArray(size)
+    // Newest bucket index per level; the ring covers (head - bucketsPerLevel, head]
+    private val head = LongArray(levels) { Long.MIN_VALUE }
+
+    /** Beacon time of the oldest and newest point since the last [reset]; [Long.MIN_VALUE] while empty. */
+    var firstUs: Long = Long.MIN_VALUE
+        private set
+    var lastUs: Long = Long.MIN_VALUE
+        private set
+
+    /** Width of level [level]'s buckets (µs). */
+    fun bucketWidthUs(level: Int): Long = widthUs[level]
+
+    /** One point. Points older than a level's ring are dropped from that level only. NaN is ignored. */
+    @Synchronized
+    fun add(beaconTimeUs: Long, value: Double) {
+        if (value.isNaN()) return
+        if (firstUs == Long.MIN_VALUE || beaconTimeUs < firstUs) firstUs = beaconTimeUs
+        if (beaconTimeUs > lastUs) lastUs = beaconTimeUs
+        for (k in 0 until levels) {
+            val b = Math.floorDiv(beaconTimeUs, widthUs[k])
+            if (b > head[k]) head[k] = b
+            else if (b <= head[k] - bucketsPerLevel) continue
+            val i = k * bucketsPerLevel + Math.floorMod(b, bucketsPerLevel.toLong()).toInt()
+            if (bucket[i] != b) {
+                bucket[i] = b
+                min[i] = value
+                max[i] = value
+                sum[i] = value
+                count[i] = 1
+            } else {
+                if (value < min[i]) min[i] = value
+                if (value > max[i]) max[i] = value
+                sum[i] += value
+                count[i]++
+            }
+        }
+    }
+
+    /**
+     * Buckets overlapping [fromUs]..[toUs] into [out], at most min([maxPoints], out.capacity): the finest
+     * level that fits them and still holds [fromUs], else the coarsest (clipped to what it holds).
+     * Empty buckets are skipped. Returns out.size.
+     */
+    @Synchronized
+    fun query(fromUs: Long, toUs: Long, maxPoints: Int, out: SeriesWindow): Int {
+        out.size = 0
+        val limit = minOf(maxPoints, out.capacity)
+        if (limit <= 0 || toUs < fromUs || lastUs == Long.MIN_VALUE) return 0
+        var k = 0
+        while (k < levels - 1) {
+            val first = Math.floorDiv(fromUs, widthUs[k])
+            val last = Math.floorDiv(toUs, widthUs[k])
+            if (last - first < limit && first > head[k] - bucketsPerLevel) break
+            k++
+        }
+        val w = widthUs[k]
+        var b = maxOf(Math.floorDiv(fromUs, w), head[k] - bucketsPerLevel + 1)
+        val last = minOf(Math.floorDiv(toUs, w), head[k])
+        out.bucketUs = w
+        var n = 0
+        while (b <= last && n < limit) {
+            val i = k * bucketsPerLevel + Math.floorMod(b, bucketsPerLevel.toLong()).toInt()
+            if (bucket[i] == b) {
+                out.startUs[n] = b * w
+                out.min[n] = min[i]
+                out.max[n] = max[i]
+                out.mean[n] = sum[i] / count[i]
+                n++
+            }
+            b++
+        }
+        out.size = n
+        return n
+    }
+
+    @Synchronized
+    fun reset() {
+        bucket.fill(Long.MIN_VALUE)
+        head.fill(Long.MIN_VALUE)
+        firstUs = Long.MIN_VALUE
+        lastUs = Long.MIN_VALUE
+    }
+
+    companion object {
+        const val DEFAULT_BASE_BUCKET_US = 1_000_000L
+        const val DEFAULT_BUCKETS_PER_LEVEL = 512
+        /** 1 s to 4^7 s ≈ 4.5 h buckets: level 0 spans 8.5 min, the top level about 3 months. */
+        const val DEFAULT_LEVELS = 8
+        const val DEFAULT_FANOUT = 4
+    }
+}
@@ -0,0 +1,117 @@
+package com.example.ble_sync_suite_app.sync
+
+import kotlin.math.abs
+
+// =============================================================================
+// SYNC STATS — Streaming session statistics (no Android/BLE dependency)
+// =============================================================================
+//
+// Purpose: Keep the stats shown on the sync statistics screen up to date as packets
+// arrive, in O(1) per packet and without storing the packets themselves.
+//
+// Residuals are measured against the fit that was current when each packet arrived
+// (the residual a live consumer of the fit would actually have seen). The fit is not
+// re-applied to older packets, so a long session costs nothing extra.
+// =============================================================================
+
+/** Snapshot of [SyncStatsAccumulator]; immutable, safe to hand to the UI. */
+data class SyncStats(
+    /** Packets seen since the last reset. */
+    val packetCount: Long = 0,
+    /** Consecutive packet pairs whose seq did not advance by exactly 1 (u32 wrap allowed). */
+    val droppedPacketCount: Long = 0,
+    val meanAbsResidualMs: Double = 0.0,
+    val latestResidualMs: Double = 0.0,
+    /** Mean beacon-time interval between consecutive packets (positive intervals only), ms. */
+    val meanIntervalMs: Double = 0.0,
+    /** Beacon-time span from first to latest packet, ms. */
+    val beaconSpanMs: Double = 0.0,
+    /** Receiver-time span from first to latest packet, ms. */
+    val receiverSpanMs: Double = 0.0,
+    /** Fit (α ns, β) at the time of the latest packet. */
+    val alpha: Double = 0.0,
+    val beta: Double = 1.0
+) {
+    val clockSkew: Double get() = beta - 1.0
+    /** Packets per second from [meanIntervalMs]; 0 if unknown. */
+    val packetsPerSecond: Double get() = if (meanIntervalMs > 0) 1000.0 / meanIntervalMs else 0.0
+}
+
+/**
+ * Running sums behind [SyncStats]. [add] is O(1) and does not allocate; [snapshot] allocates one [SyncStats].
+ * Not thread-safe: feed it from one thread.
+ */
+class SyncStatsAccumulator {
+
+    private var count = 0L
+    private var dropped = 0L
+    private var absResidualSumMs = 0.0
+    private var latestResidualMs = 0.0
+    private var intervalSumUs = 0.0
+    private var intervalCount = 0L
+    private var firstTUs = 0L
+    private var firstRxNs = 0L
+    private var lastSeq = 0L
+    private var lastTUs = 0L
+    private var lastRxNs = 0L
+    private var alpha = 0.0
+    private var beta = 1.0
+
+    /**
+     * Account for one packet. [alpha]/[beta] are the current fit (Tr ≈ α + β·tb, tb in ns).
+     */
+    fun add(seq: Long, beaconTimeUs: Long, receiverTimeNs: Long, alpha: Double, beta: Double) {
+        // Residual = actual receive time minus (alpha + beta * tb) in ms
+        latestResidualMs = (receiverTimeNs.toDouble() - (alpha + beta * beaconTimeUs * 1000.0)) / 1_000_000.0
+        absResidualSumMs += abs(latestResidualMs)
+        if (count == 0L) {
+            firstTUs = beaconTimeUs
+            firstRxNs = receiverTimeNs
+        } else {
+            // Count sequence gaps (missing packets)
+            if (seq != lastSeq + 1L && !(lastSeq == 0xFFFF_FFFFL && seq == 0L)) dropped++
+            val intervalUs = beaconTimeUs - lastTUs
+            if (intervalUs > 0) {
+                intervalSumUs += intervalUs
+                intervalCount++
+            }
+        }
+        lastSeq = seq
+        lastTUs = beaconTimeUs
+        lastRxNs = receiverTimeNs
+        this.alpha = alpha
+        this.beta = beta
+        count++
+    }
+
+    fun snapshot(): SyncStats {
+        if (count == 0L) return SyncStats()
+        return SyncStats(
+            packetCount = count,
+            droppedPacketCount = dropped,
+            meanAbsResidualMs = absResidualSumMs / count,
+            latestResidualMs = latestResidualMs,
+            meanIntervalMs = if (intervalCount > 0) intervalSumUs / intervalCount / 1000.0 else 0.0,
+            beaconSpanMs = (lastTUs - firstTUs) / 1000.0,
+            receiverSpanMs = (lastRxNs - firstRxNs) / 1_000_000.0,
+            alpha = alpha,
+            beta = beta
+        )
+    }
+
+    fun reset() {
+        count = 0
+        dropped = 0
+        absResidualSumMs = 0.0
+        latestResidualMs = 0.0
+        intervalSumUs = 0.0
+        intervalCount = 0
+        firstTUs = 0
+        firstRxNs = 0
+        lastSeq = 0
+        lastTUs = 0
+        lastRxNs = 0
+        alpha = 0.0
+        beta = 1.0
+    }
+}
@@ -0,0 +1,207 @@
+package com.example.ble_sync_suite_app.sync
+
+import kotlin.math.abs
+import kotlin.math.ceil
+
+// =============================================================================
+// THERMAL SKEW — Skew as a function of beacon temperature (no Android/BLE dependency)
+// =============================================================================
+//
+// Purpose: A crystal's frequency follows its temperature (a 32 kHz tuning fork bends
+// about −0.035 ppm/°C² around its turnover; an AT-cut MHz crystal moves a few ppm over
+// a day's swing), so β moves with the beacon's temperature. A regression window only
+// sees the skew averaged over its span; at a low notify rate that span is long and the
+// fit lags every temperature change.
+//
+// ThermalSkewModel learns β(T) from a running fit: each observation (temperature
+// averaged over the fit's window, the fit's β) is averaged into a bin of binWidthC.
+// β(T) is the least-squares polynomial through the bin means: quadratic once the bins
+// span MIN_QUADRATIC_SPAN_C, linear over MIN_LINEAR_SPAN_C, constant below that. Every
+// bin weighs the same, so a long dwell at one temperature does not swamp the curve.
+// Between samples, ThermalSkewCurve.extrapolate carries a fit forward at β of the
+// current temperature instead of the window's average.
+//
+// β is the beacon's skew against the receiver clock, so the receiver's own drift is in
+// it too: the model holds for one receiver at a steady temperature (a phone on a desk).
+// =============================================================================
+
+/**
+ * β(T) fitted by [ThermalSkewModel], in ppm around [referenceC]:
+ * skew(T) = c0 + c1·(T − referenceC) + c2·(T − referenceC)². Immutable, safe to hand to the UI.
+ */
+data class ThermalSkewCurve(
+    val referenceC: Double,
+    val c0Ppm: Double,
+    val c1PpmPerC: Double,
+    val c2PpmPerC2: Double,
+    /** Temperature span the bins cover; temperatures outside it are held at the nearer edge. */
+    val minC: Double,
+    val maxC: Double,
+    val bins: Int,
+    /** 0, 1 or 2: how many terms the span supported. */
+    val degree: Int
+) {
+    /** Skew (β − 1) at [temperatureC], in ppm. */
+    fun skewPpmAt(temperatureC: Double): Double {
+        val x = temperatureC.coerceIn(minC, maxC) - referenceC
+        return c0Ppm + x * (c1PpmPerC + x * c2PpmPerC2)
+    }
+
+    fun betaAt(temperatureC: Double): Double = 1.0 + skewPpmAt(temperatureC) / 1e6
+
+    /**
+     * [fit] carried past [anchorBeaconUs] (its newest sample) at β of [temperatureC]: the same mapping at the
+     * anchor, the curve's slope after it. Use it for beacon times after the anchor only.
+     */
+    fun extrapolate(fit: SyncFit, anchorBeaconUs: Long, temperatureC: Double): SyncFit =
+        SyncFit(
+            alpha = 0.0,
+            beta = betaAt(temperatureC),
+            beaconEpochUs = anchorBeaconUs,
+            receiverEpochNs = fit.mapBeaconToReceiverNs(anchorBeaconUs)
+        )
+}
+
+/**
+ * Bins (temperature, β) observations and fits [ThermalSkewCurve] through them. Fixed arrays over
+ * [minTemperatureC]..[maxTemperatureC]: [add] does not allocate, [curve] refits only after new observations.
+ * Not thread-safe.
+ */
+class ThermalSkewModel(
+    val binWidthC: Double = DEFAULT_BIN_WIDTH_C,
+    val minTemperatureC: Double = DEFAULT_MIN_TEMPERATURE_C,
+    val maxTemperatureC: Double = DEFAULT_MAX_TEMPERATURE_C
+) {
+    init {
+        require(binWidthC > 0.0) { "binWidthC must be positive, was $binWidthC" }
+        require(maxTemperatureC > minTemperatureC) { "empty temperature range" }
+    }
+
+    private val binCount = ceil((maxTemperatureC - minTemperatureC) / binWidthC).toInt()
+    private val sumTemperatureC = DoubleArray(binCount)
+    private val sumSkewPpm = DoubleArray(binCount)
+    private val counts = IntArray(binCount)
+    private var cached: ThermalSkewCurve? = null
+    private var dirty = false
+
+    /** Observations accepted since the last [reset]. */
+    var observationCount: Long = 0
+        private set
+
+    /** Bins holding at least one observation. */
+    var binsFilled: Int = 0
+        private set
+
+    /** One observation: the fit's [beta] and the beacon temperature over its window. False if out of range or NaN. */
+    fun add(temperatureC: Double, beta: Double): Boolean {
+        if (temperatureC.isNaN() || beta.isNaN() || temperatureC < minTemperatureC || temperatureC >= maxTemperatureC) return false
+        val bin = ((temperatureC - minTemperatureC) / binWidthC).toInt().coerceAtMost(binCount - 1)
+        if (counts[bin] == 0) binsFilled++
+        counts[bin]++
+        sumTemperatureC[bin] += temperatureC
+        sumSkewPpm[bin] += (beta - 1.0) * 1e6
+        observationCount++
+        dirty = true
+        return true
+    }
+
+    /** The current β(T), refitted if observations were added; null before the first. */
+    fun curve(): ThermalSkewCurve? {
+        if (dirty) {
+            cached = fit()
+            dirty = false
+        }
+        return cached
+    }
+
+    /** β at [temperatureC], or NaN before the first observation. */
+    fun predictBeta(temperatureC: Double): Double = curve()?.betaAt(temperatureC) ?: Double.NaN
+
+    fun reset() {
+        sumTemperatureC.fill(0.0)
+        sumSkewPpm.fill(0.0)
+        counts.fill(0)
+        observationCount = 0
+        binsFilled = 0
+        cached = null
+        dirty = false
+    }
+
+    // Weighted-equally polynomial over the bin means, centered on their mean temperature for conditioning
+    private fun fit(): ThermalSkewCurve? {
+        if (binsFilled == 0) return null
+        var t0 = 0.0
+        var lo = Double.MAX_VALUE
+        var hi = -Double.MAX_VALUE
+        for (i in 0 until binCount) {
+            if (counts[i] == 0) continue
+            val t = sumTemperatureC[i] / counts[i]
+            t0 += t
+            if (t < lo) lo = t
+            if (t > hi) hi = t
+        }
+        t0 /= binsFilled
+        val span = hi - lo
+
+        // Σx^k (k = 0..4) and Σx^k·y (k = 0..2)
+        val sx = DoubleArray(5)
+        val sxy = DoubleArray(3)
+        for (i in 0 until binCount) {
+            if (counts[i] == 0) continue
+            val x = sumTemperatureC[i] / counts[i] - t0
+            val y = sumSkewPpm[i] / counts[i]
+            var p = 1.0
+            for (k in 0..4) {
+                sx[k] += p
+                if (k <= 2) sxy[k] += p * y
+                p *= x
+            }
+        }
+
+        var degree = when {
+            binsFilled >= 3 && span >= MIN_QUADRATIC_SPAN_C -> 2
+            binsFilled >= 2 && span >= MIN_LINEAR_SPAN_C -> 1
+            else -> 0
+        }
+        while (degree >= 0) {
+            solve(sx, sxy, degree)?.let { c ->
+                return ThermalSkewCurve(t0, c[0], c[1], c[2], lo, hi, binsFilled, degree)
+            }
+            degree--
+        }
+        return null
+    }
+
+    // Normal equations of the given degree by Cramer's rule; null if singular
+    private fun solve(sx: DoubleArray, sxy: DoubleArray, degree: Int): DoubleArray? {
+        val n = degree + 1
+        val m = Array(n) { r -> DoubleArray(n) { c -> sx[r + c] } }
+        val d = det(m, n)
+        if (abs(d) < SINGULAR_EPS * abs(sx[0]).coerceAtLeast(1.0)) return null
+        val out = DoubleArray(3)
+        for (k in 0 until n) {
+            val mk = Array(n) { r -> DoubleArray(n) { c -> if (c == k) sxy[r] else sx[r + c] } }
+            out[k] = det(mk, n) / d
+        }
+        return out
+    }
+
+    private fun det(m: Array<DoubleArray>, n: Int): Double = when (n) {
+        1 -> m[0][0]
+        2 -> m[0][0] * m[1][1] - m[0][1] * m[1][0]
+        else -> m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+            m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+            m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])
+    }
+
+    companion object {
+        const val DEFAULT_BIN_WIDTH_C = 0.5
+        const val DEFAULT_MIN_TEMPERATURE_C = -40.0
+        const val DEFAULT_MAX_TEMPERATURE_C = 125.0
+        /** Narrower than this, a slope is mostly noise: β(T) stays the mean skew. */
+        const val MIN_LINEAR_SPAN_C = 1.0
+        /** Narrower than this, curvature is mostly noise: β(T) stays linear. */
+        const val MIN_QUADRATIC_SPAN_C = 4.0
+        private const val SINGULAR_EPS = 1e-12
+    }
+}
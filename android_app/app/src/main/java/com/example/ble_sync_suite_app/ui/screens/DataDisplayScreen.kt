@@ -26,7 +26,6 @@ import androidx.compose.foundation.shape.RoundedCornerShape
 import androidx.compose.material3.Button
 import androidx.compose.material3.Text
 import androidx.compose.material3.TextButton
-import androidx.compose.runtime.collectAsState
 import androidx.compose.runtime.Composable
 import androidx.compose.runtime.LaunchedEffect
 import androidx.compose.runtime.getValue
@@ -72,7 +71,7 @@ fun DataDisplayScreen(
     val listState = rememberLazyListState()
     val notificationStates = remember { mutableStateMapOf<UUID, Boolean>() }
     val alpha by animateFloatAsState(if (visible) 1f else 0f, tween(1000), label = "fadeIn")
-    val latestPacket by latestEspPacket.collectAsState()
+    val latestPacket by latestEspPacket.collectAsFrameState()
 
     LaunchedEffect(Unit) {
         visible = true
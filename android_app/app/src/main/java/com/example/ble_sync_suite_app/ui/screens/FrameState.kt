@@ -0,0 +1,43 @@
+package com.example.ble_sync_suite_app.ui.screens
+
+import androidx.compose.runtime.Composable
+import androidx.compose.runtime.LaunchedEffect
+import androidx.compose.runtime.State
+import androidx.compose.runtime.mutableStateOf
+import androidx.compose.runtime.remember
+import androidx.compose.runtime.withFrameNanos
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.conflate
+import kotlinx.coroutines.flow.flowOn
+
+// Frame-aligned collection for flows written at the packet rate. BleManager keeps updating its StateFlows
+// on the decode thread as fast as packets arrive; the screen picks up only the newest value, at most once per
+// frame and at most maxHz times a second, so recomposition cost no longer scales with the input rate.
+
+// Default screen refresh for packet-driven values; charts and counters read fine well below display rate
+const val UI_MAX_HZ = 30
+
+/**
+ * Like collectAsState, but the upstream is collected on Dispatchers.Default into a conflated buffer and the
+ * state is set from a withFrameNanos callback, so Main is woken once per published frame, not per emission.
+ * Idle flows cost nothing: no frame is requested until something changed.
+ */
+@Composable
+fun <T> StateFlow<T>.collectAsFrameState(maxHz: Int = UI_MAX_HZ): State<T> {
+    val flow = this
+    val state = remember(flow) { mutableStateOf(flow.value) }
+    LaunchedEffect(flow, maxHz) {
+        // A little under the interval, so 30 Hz on a 60 Hz display is every other frame, not every third
+        val minIntervalNs = 1_000_000_000L / maxHz * 9 / 10
+        var lastFrameNs = Long.MIN_VALUE / 2
+        flow.flowOn(Dispatchers.Default).conflate().collect {
+            var frameNs = withFrameNanos { it }
+            while (frameNs - lastFrameNs < minIntervalNs) frameNs = withFrameNanos { it }
+            lastFrameNs = frameNs
+            // The newest value, not the buffered one: more may have arrived while waiting for the frame
+            state.value = flow.value
+        }
+    }
+    return state
+}
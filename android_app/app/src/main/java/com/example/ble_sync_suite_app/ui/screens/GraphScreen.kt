@@ -1,6 +1,16 @@
 package com.example.ble_sync_suite_app.ui.screens
 
-import com.example.ble_sync_suite_app.EspPacket
+import com.example.ble_sync_suite_app.EspCapabilities
+import com.example.ble_sync_suite_app.EspConnParams
+import com.example.ble_sync_suite_app.EspDetectorConfig
+import com.example.ble_sync_suite_app.EspDiagnostics
+import com.example.ble_sync_suite_app.MappedAcousticEvent
+import com.example.ble_sync_suite_app.espFormatName
+import com.example.ble_sync_suite_app.sync.LossStats
+import com.example.ble_sync_suite_app.sync.RoundTripEstimate
+import com.example.ble_sync_suite_app.sync.SeriesPyramid
+import com.example.ble_sync_suite_app.sync.SyncStats
+import com.example.ble_sync_suite_app.sync.ThermalSkewCurve
 import androidx.compose.foundation.background
 import androidx.compose.foundation.layout.Arrangement
 import androidx.compose.foundation.layout.Column
@@ -18,6 +28,9 @@ import androidx.compose.material3.TextButton
 import androidx.compose.runtime.collectAsState
 import androidx.compose.runtime.Composable
 import androidx.compose.runtime.getValue
+import androidx.compose.runtime.mutableLongStateOf
+import androidx.compose.runtime.remember
+import androidx.compose.runtime.setValue
 import androidx.compose.ui.Alignment
 import androidx.compose.ui.Modifier
 import androidx.compose.ui.graphics.Color
@@ -25,20 +38,44 @@ import androidx.compose.ui.text.font.FontWeight
 import androidx.compose.ui.unit.dp
 import androidx.compose.ui.unit.sp
 import kotlinx.coroutines.flow.StateFlow
-import kotlin.math.abs
 
-// Sync statistics screen: shows CheepSync fit (alpha, beta, skew), residuals, packet stats, transmission rate, time spans.
-// Opened by tapping the ESP32 characteristic or enabling Notify on it. No graph drawing — stats only.
+// Sync statistics screen: shows CheepSync fit (alpha, beta, skew), residual and skew charts, packet stats,
+// transmission rate, time spans. Opened by tapping the ESP32 characteristic or enabling Notify on it.
+
+// Chart zoom choices: window ending at the newest sample (0 = all history held)
+private val CHART_SPANS = listOf("1 min" to 60_000_000L, "10 min" to 600_000_000L, "1 h" to 3_600_000_000L, "All" to 0L)
 
 @Composable
 fun GraphScreen(
     onBack: () -> Unit,
-    packets: List<EspPacket>,
-    cheepSyncAlpha: StateFlow<Double>,
-    cheepSyncBeta: StateFlow<Double>
+    syncStats: StateFlow<SyncStats>,
+    lossStats: StateFlow<LossStats>,
+    connParams: StateFlow<EspConnParams?>,
+    roundTrip: StateFlow<RoundTripEstimate>,
+    diagnostics: StateFlow<EspDiagnostics?>,
+    acousticEvents: StateFlow<List<MappedAcousticEvent>>,
+    detectorConfig: StateFlow<EspDetectorConfig?>,
+    beaconTemperatureC: StateFlow<Double>,
+    thermalSkewCurve: StateFlow<ThermalSkewCurve?>,
+    residualHistory: StateFlow<SeriesPyramid?>,
+    skewHistory: StateFlow<SeriesPyramid?>,
+    capabilities: StateFlow<EspCapabilities?>
 ) {
-    val alpha by cheepSyncAlpha.collectAsState()
-    val beta by cheepSyncBeta.collectAsState()
+    // Stats are accumulated per packet in BleManager; this screen only renders them. Per-packet values are
+    // picked up once per frame at most (collectAsFrameState), the rarely changing ones as they come.
+    val stats by syncStats.collectAsFrameState()
+    val loss by lossStats.collectAsFrameState()
+    val conn by connParams.collectAsState()
+    val rtt by roundTrip.collectAsState()
+    val diag by diagnostics.collectAsState()
+    val events by acousticEvents.collectAsFrameState()
+    val detector by detectorConfig.collectAsState()
+    val temperatureC by beaconTemperatureC.collectAsFrameState()
+    val thermal by thermalSkewCurve.collectAsFrameState()
+    val residuals by residualHistory.collectAsFrameState()
+    val skews by skewHistory.collectAsFrameState()
+    val caps by capabilities.collectAsState()
+    var chartSpanUs by remember { mutableLongStateOf(CHART_SPANS[1].second) }
 
     Column(modifier = Modifier.fillMaxSize().padding(24.dp)) {
         Row(
@@ -51,63 +88,122 @@ fun GraphScreen(
         }
         Spacer(Modifier.height(16.dp))
 
-        if (packets.isEmpty()) {
+        if (stats.packetCount == 0L) {
             Text("No data yet. Waiting for ESP32 packets...", color = Color.Gray)
             return@Column
         }
 
         // Need at least 2 packets to compute fit-based stats
-        if (packets.size >= 2) {
-            val first = packets.first()
-            // Residual = actual receive time minus (alpha + beta * tb) in ms
-            val residualsMs = packets.map { p ->
-                val Tr = p.receivedAtNs.toDouble()
-                val tb = p.tUs * 1000.0
-                (Tr - (alpha + beta * tb)) / 1_000_000.0
-            }
-            val meanAbsResidualMs = residualsMs.map { abs(it) }.average()
-            val latestResidualMs = residualsMs.last()
-            val clockSkew = beta - 1.0
-            // Count sequence gaps (missing packets)
-            val droppedPacketCount = run {
-                var valid = 1
-                for (i in 1 until packets.size) {
-                    val prev = packets[i - 1].seq
-                    val curr = packets[i].seq
-                    if (curr == prev + 1L || (prev == 0xFFFF_FFFFL && curr == 0L)) valid++
-                }
-                packets.size - valid
-            }
-            val intervalsUs = (1 until packets.size).map { packets[it].tUs - packets[it - 1].tUs }.filter { it > 0 }
-            val transmissionRateMs = if (intervalsUs.isNotEmpty()) intervalsUs.map { it.toDouble() }.average() / 1000.0 else 0.0
-            val latest = packets.last()
-            val tUsDeltaMs = (latest.tUs - first.tUs) / 1000.0
-            val rxDeltaMs = (latest.receivedAtNs - first.receivedAtNs) / 1_000_000.0
-
+        if (stats.packetCount >= 2) {
             // Scrollable stats block: fit, residuals, packet count, rate, time spans
             Column(
                 modifier = Modifier.fillMaxWidth().verticalScroll(rememberScrollState()).background(Color(0xFF111111), RoundedCornerShape(8.dp)).padding(12.dp)
             ) {
                 Text("CheepSync Fit Metrics:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
-                Text("  alpha (ns): ${"%.0f".format(alpha)}", fontSize = 12.sp, color = Color.White)
-                Text("  beta (unitless): ${"%.9f".format(beta)}", fontSize = 12.sp, color = Color.White)
-                Text("  skew = beta-1: ${"%.9f".format(clockSkew)}", fontSize = 12.sp, color = Color.White)
+                Text("  alpha (ns): ${"%.0f".format(stats.alpha)}", fontSize = 12.sp, color = Color.White)
+                Text("  beta (unitless): ${"%.9f".format(stats.beta)}", fontSize = 12.sp, color = Color.White)
+                Text("  skew = beta-1: ${"%.9f".format(stats.clockSkew)}", fontSize = 12.sp, color = Color.White)
+                if (!temperatureC.isNaN()) {
+                    Text("  Beacon temperature: ${"%.2f".format(temperatureC)} °C", fontSize = 12.sp, color = Color.White)
+                    thermal?.let { c ->
+                        val slope = if (c.degree > 0) ", ${"%.3f".format(c.c1PpmPerC)} ppm/°C at ${"%.1f".format(c.referenceC)} °C" else ""
+                        Text("  Thermal skew: ${"%.3f".format(c.skewPpmAt(temperatureC))} ppm$slope (${c.bins} bins, ${"%.1f".format(c.minC)}..${"%.1f".format(c.maxC)} °C)", fontSize = 12.sp, color = Color.White)
+                    }
+                }
                 Spacer(Modifier.height(8.dp))
                 Text("Residual (sync error):", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
-                Text("  Mean |residual|: ${"%.3f".format(meanAbsResidualMs)} ms", fontSize = 12.sp, color = Color.White)
-                Text("  Latest residual: ${"%.3f".format(latestResidualMs)} ms", fontSize = 12.sp, color = Color.White)
+                Text("  Mean |residual|: ${"%.3f".format(stats.meanAbsResidualMs)} ms", fontSize = 12.sp, color = Color.White)
+                Text("  Latest residual: ${"%.3f".format(stats.latestResidualMs)} ms", fontSize = 12.sp, color = Color.White)
+                val residualSeries = residuals
+                val skewSeries = skews
+                if (residualSeries != null && skewSeries != null) {
+                    Spacer(Modifier.height(8.dp))
+                    Row(verticalAlignment = Alignment.CenterVertically) {
+                        Text("Charts:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
+                        for ((label, span) in CHART_SPANS) {
+                            TextButton(onClick = { chartSpanUs = span }) {
+                                Text(label, fontSize = 12.sp, color = if (span == chartSpanUs) Color.White else Color.Gray)
+                            }
+                        }
+                    }
+                    SeriesChart("Residual", "ms", residualSeries, chartSpanUs, stats.packetCount, Color(0xFFFFCC80))
+                    Spacer(Modifier.height(4.dp))
+                    SeriesChart("Skew", "ppm", skewSeries, chartSpanUs, stats.packetCount, Color(0xFF90CAF9))
+                }
                 Spacer(Modifier.height(8.dp))
                 Text("Packet Statistics:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
-                Text("  Total packets: ${packets.size}", fontSize = 12.sp, color = Color.White)
-                Text("  Dropped packets (seq gaps): $droppedPacketCount", fontSize = 12.sp, color = Color.White)
+                Text("  Total packets: ${stats.packetCount}", fontSize = 12.sp, color = Color.White)
+                Text("  Lost packets: ${loss.lost} of ${loss.expected} (${"%.2f".format(loss.lossRatio * 100)}%) in ${loss.gaps} gaps", fontSize = 12.sp, color = Color.White)
+                if (loss.gaps > 0) {
+                    // Bucket i holds bursts of 2^i..2^(i+1)-1 packets
+                    val bursts = loss.burstHistogram.withIndex().filter { it.value > 0 }
+                        .joinToString { (i, n) -> "${1L shl i}${if (i == loss.burstHistogram.lastIndex) "+" else ""}: $n" }
+                    Text("  Burst lengths: $bursts (longest ${loss.longestBurst})", fontSize = 12.sp, color = Color.White)
+                }
+                if (loss.reordered > 0 || loss.duplicates > 0 || loss.restarts > 0) {
+                    Text("  Late / duplicate / restarts: ${loss.reordered} / ${loss.duplicates} / ${loss.restarts}", fontSize = 12.sp, color = Color.White)
+                }
+                Spacer(Modifier.height(8.dp))
+                Text("Connection:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
+                conn?.let { c ->
+                    Text("  Interval: ${"%.2f".format(c.intervalMs)} ms", fontSize = 12.sp, color = Color.White)
+                    Text("  Latency: ${c.latency}, timeout: ${c.timeoutMs} ms", fontSize = 12.sp, color = Color.White)
+                } ?: Text("  Interval: not reported", fontSize = 12.sp, color = Color.Gray)
+                caps?.let { c ->
+                    val offered = (0..15).filter(c::supportsFormat).joinToString("/") { espFormatName(it) }
+                    Text("  Payload: ${espFormatName(c.format)}, batch ${c.batchSize} (offers $offered)", fontSize = 12.sp, color = Color.White)
+                } ?: Text("  Payload: firmware default (no capabilities)", fontSize = 12.sp, color = Color.Gray)
+                Spacer(Modifier.height(8.dp))
+                Text("Round Trip:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
+                if (rtt.exchanges > 0) {
+                    Text("  Exchanges: ${rtt.exchanges}", fontSize = 12.sp, color = Color.White)
+                    Text("  Last / min RTT: ${"%.3f".format(rtt.lastRoundTripMs)} / ${"%.3f".format(rtt.minRoundTripMs)} ms", fontSize = 12.sp, color = Color.White)
+                    Text("  One-way path delay: ${"%.3f".format(rtt.pathDelayMs)} ms", fontSize = 12.sp, color = Color.White)
+                    rtt.fit?.let { f ->
+                        Text("  Midpoint alpha (ns): ${"%.0f".format(f.absoluteAlpha)}", fontSize = 12.sp, color = Color.White)
+                    }
+                } else {
+                    Text("  No exchanges yet", fontSize = 12.sp, color = Color.Gray)
+                }
+                Spacer(Modifier.height(8.dp))
+                Text("ESP32 Diagnostics:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
+                diag?.let { d ->
+                    Text("  Sends: ${d.sendCalls}, failed: ${d.sendFailures}", fontSize = 12.sp, color = Color.White)
+                    Text("  Send latency p50 / p99 / max: ≤${d.sendLatencyQuantileUs(0.5)} / ≤${d.sendLatencyQuantileUs(0.99)} / ${d.sendMaxUs} μs", fontSize = 12.sp, color = Color.White)
+                    if (d.sendErrors.isNotEmpty()) {
+                        Text("  Errors: ${d.sendErrors.entries.joinToString { "0x%x × %d".format(it.key, it.value) }}", fontSize = 12.sp, color = Color.White)
+                    }
+                    Text("  Congestion: ${d.congestEvents} events, ${d.congestedMs} ms", fontSize = 12.sp, color = Color.White)
+                    Text("  Queued samples coalesced / dropped: ${d.queueCoalesced} / ${d.queueDropped}", fontSize = 12.sp, color = Color.White)
+                    Text("  Wake lateness mean / max: ${"%.0f".format(d.wakeLateMeanUs)} / ${d.wakeLateMaxUs} μs", fontSize = 12.sp, color = Color.White)
+                    Text("  Free heap: ${d.freeHeapBytes} B (min ${d.minFreeHeapBytes} B)", fontSize = 12.sp, color = Color.White)
+                    if (d.sleepClockPpm > 0) {
+                        val slept = if (d.sleepCounted) ", slept ${d.sleptMs / 1000} s" else ""
+                        Text("  Light sleep: clock ±${d.sleepClockPpm} ppm$slept, skew budget ±${"%.1f".format(d.sleepSkewPpm)} ppm", fontSize = 12.sp, color = Color.White)
+                    }
+                } ?: Text("  Not reported", fontSize = 12.sp, color = Color.Gray)
+                if (events.isNotEmpty() || detector != null) {
+                    Spacer(Modifier.height(8.dp))
+                    Text("Acoustic Events:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
+                    detector?.let { c ->
+                        Text("  Detector: k ${c.k}, release ${c.release}, min ${c.minLevel}, hold ${c.holdMs} ms, floor over ${c.floorMs} ms", fontSize = 12.sp, color = Color.White)
+                        Text("  Noise floor / sigma: ${c.noiseFloor} / ${c.noiseSigma}", fontSize = 12.sp, color = Color.White)
+                    }
+                    if (events.isNotEmpty()) Text("  Received: ${events.size} (last seq ${events.last().event.seq})", fontSize = 12.sp, color = Color.White)
+                    for (m in events.takeLast(5).asReversed()) {
+                        val phone = m.phoneTimeNs?.let { "%.3f ms".format(it / 1e6) } ?: "no fit yet"
+                        val uncertain = if (m.event.timingUncertain) " (timing uncertain)" else ""
+                        Text("  #${m.event.seq}: beacon ${m.event.tUs} μs → phone $phone, peak ${m.event.peak}$uncertain", fontSize = 12.sp, color = Color.White)
+                    }
+                }
                 Spacer(Modifier.height(8.dp))
                 Text("Transmission Rate:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
-                Text("  Avg interval: ${"%.2f".format(transmissionRateMs)} ms", fontSize = 12.sp, color = Color.White)
-                if (transmissionRateMs > 0) Text("  Rate: ${"%.2f".format(1000.0 / transmissionRateMs)} packets/sec", fontSize = 12.sp, color = Color.White)
+                Text("  Avg interval: ${"%.2f".format(stats.meanIntervalMs)} ms", fontSize = 12.sp, color = Color.White)
+                if (stats.meanIntervalMs > 0) Text("  Rate: ${"%.2f".format(stats.packetsPerSecond)} packets/sec", fontSize = 12.sp, color = Color.White)
                 Spacer(Modifier.height(8.dp))
                 Text("Time Spans:", fontSize = 14.sp, fontWeight = FontWeight.Bold, color = Color.White)
-                Text("  ESP32 span: ${"%.1f".format(tUsDeltaMs)} ms", fontSize = 12.sp, color = Color(0xFF90CAF9))
-                Text("  Android Rx span: ${"%.1f".format(rxDeltaMs)} ms", fontSize = 12.sp, color = Color(0xFFA5D6A7))
+                Text("  ESP32 span: ${"%.1f".format(stats.beaconSpanMs)} ms", fontSize = 12.sp, color = Color(0xFF90CAF9))
+                Text("  Android Rx span: ${"%.1f".format(stats.receiverSpanMs)} ms", fontSize = 12.sp, color = Color(0xFFA5D6A7))
             }
         } else {
             Text("Waiting for more packets to calculate sync metrics...", fontSize = 12.sp, color = Color.Gray)
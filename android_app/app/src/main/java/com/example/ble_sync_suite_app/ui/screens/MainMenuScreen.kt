@@ -2,12 +2,15 @@ package com.example.ble_sync_suite_app.ui.screens
 
 import androidx.compose.foundation.layout.Arrangement
 import androidx.compose.foundation.layout.Column
+import androidx.compose.foundation.layout.Row
 import androidx.compose.foundation.layout.Spacer
 import androidx.compose.foundation.layout.fillMaxSize
 import androidx.compose.foundation.layout.fillMaxWidth
 import androidx.compose.foundation.layout.height
 import androidx.compose.foundation.layout.padding
+import androidx.compose.foundation.layout.width
 import androidx.compose.material3.Button
+import androidx.compose.material3.OutlinedButton
 import androidx.compose.material3.Text
 import androidx.compose.runtime.Composable
 import androidx.compose.ui.Alignment
@@ -16,11 +19,13 @@ import androidx.compose.ui.graphics.Color
 import androidx.compose.ui.text.style.TextAlign
 import androidx.compose.ui.unit.dp
 import androidx.compose.ui.unit.sp
+import com.example.ble_sync_suite_app.ExportFormat
 
-// Main menu: single button to go to "Connect to Device" (scanner screen).
+// Main menu: "Connect to Device" (scanner screen), a synthetic beacon for load-testing the receive path, or
+// exporting the recorded sessions for offline analysis.
 
 @Composable
-fun MainMenuScreen(onConnectToDevice: () -> Unit) {
+fun MainMenuScreen(onConnectToDevice: () -> Unit, onSimulateBeacon: () -> Unit, onExportRecordings: (ExportFormat) -> Unit) {
     Column(
         modifier = Modifier.fillMaxSize().padding(horizontal = 32.dp, vertical = 48.dp),
         verticalArrangement = Arrangement.Center,
@@ -31,5 +36,13 @@ fun MainMenuScreen(onConnectToDevice: () -> Unit) {
         Text("Select what you want to do", fontSize = 18.sp, color = Color.Gray, textAlign = TextAlign.Center)
         Spacer(Modifier.height(48.dp))
         Button(onClick = onConnectToDevice, modifier = Modifier.fillMaxWidth()) { Text("Connect to Device") }
+        Spacer(Modifier.height(12.dp))
+        OutlinedButton(onClick = onSimulateBeacon, modifier = Modifier.fillMaxWidth()) { Text("Simulate Beacon (load test)") }
+        Spacer(Modifier.height(12.dp))
+        Row(modifier = Modifier.fillMaxWidth()) {
+            OutlinedButton(onClick = { onExportRecordings(ExportFormat.CSV_GZIP) }, modifier = Modifier.weight(1f)) { Text("Export CSV") }
+            Spacer(Modifier.width(12.dp))
+            OutlinedButton(onClick = { onExportRecordings(ExportFormat.COLUMNAR) }, modifier = Modifier.weight(1f)) { Text("Export columnar") }
+        }
     }
 }
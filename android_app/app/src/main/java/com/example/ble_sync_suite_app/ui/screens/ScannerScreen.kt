@@ -1,5 +1,6 @@
 package com.example.ble_sync_suite_app.ui.screens
 
+import android.os.SystemClock
 import androidx.compose.foundation.clickable
 import androidx.compose.foundation.layout.Arrangement
 import androidx.compose.foundation.layout.Column
@@ -14,6 +15,7 @@ import androidx.compose.foundation.lazy.items
 import androidx.compose.material3.Button
 import androidx.compose.material3.MaterialTheme
 import androidx.compose.material3.OutlinedTextField
+import androidx.compose.material3.RadioButton
 import androidx.compose.material3.Switch
 import androidx.compose.material3.Text
 import androidx.compose.runtime.Composable
@@ -22,6 +24,8 @@ import androidx.compose.ui.Modifier
 import androidx.compose.ui.graphics.Color
 import androidx.compose.ui.unit.dp
 import androidx.compose.ui.unit.sp
+import com.example.ble_sync_suite_app.ScanMode
+import com.example.ble_sync_suite_app.ScannedDevice
 
 // Row: "Scanning Enabled" / "Scan Disabled" label + Switch to start/stop BLE scan.
 
@@ -52,15 +56,32 @@ fun FilterBar(query: String, onQueryChanged: (String) -> Unit) {
     )
 }
 
-// Scanner screen: Back, scan toggle, filter bar, list of scanned devices. Tapping a device connects.
+// Row of radio buttons: which ScanMode the next (or running) scan uses.
+@Composable
+fun ScanModeSelector(mode: ScanMode, onModeChanged: (ScanMode) -> Unit) {
+    Row(
+        modifier = Modifier.fillMaxWidth().padding(horizontal = 16.dp),
+        verticalAlignment = Alignment.CenterVertically
+    ) {
+        for ((m, label) in listOf(ScanMode.ESP32 to "ESP32", ScanMode.ESP32_BATCHED to "Batched", ScanMode.ALL to "All")) {
+            RadioButton(selected = mode == m, onClick = { onModeChanged(m) })
+            Text(text = label, modifier = Modifier.clickable { onModeChanged(m) })
+        }
+    }
+}
+
+// Scanner screen: Back, scan toggle, scan mode, filter bar, list of scanned devices (one row per address,
+// strongest first). Tapping a device connects.
 
 @Composable
 fun MainScannerScreen(
     isScanning: Boolean,
     searchQuery: String,
-    scannedDevices: List<String>,
+    scannedDevices: List<ScannedDevice>,
+    scanMode: ScanMode,
     onBack: () -> Unit,
     onScanToggle: (Boolean) -> Unit,
+    onScanModeChanged: (ScanMode) -> Unit,
     onQueryChanged: (String) -> Unit,
     onDeviceClick: (address: String, name: String) -> Unit
 ) {
@@ -68,18 +89,25 @@ fun MainScannerScreen(
         Button(onClick = onBack) { Text("Back to Menu") }
         Spacer(Modifier.height(12.dp))
         BleScanToggle(isScanning = isScanning, onToggle = onScanToggle)
+        ScanModeSelector(mode = scanMode, onModeChanged = onScanModeChanged)
         FilterBar(query = searchQuery, onQueryChanged = onQueryChanged)
-        val filtered = scannedDevices.filter { it.contains(searchQuery, ignoreCase = true) }
+        val filtered = scannedDevices.filter {
+            it.name.contains(searchQuery, ignoreCase = true) || it.address.contains(searchQuery, ignoreCase = true)
+        }
+        // The list is refreshed at most twice a second, so the age shown is as of that refresh
+        val nowNs = SystemClock.elapsedRealtimeNanos()
         LazyColumn {
-            // Each item is "Name [address]"; on click we pass address and name for connection
-            items(filtered) { deviceInfo ->
-                val address = deviceInfo.substringAfter("[").substringBefore("]")
-                val name = deviceInfo.substringBefore(" [")
-                Text(
-                    text = deviceInfo,
-                    style = MaterialTheme.typography.bodyLarge,
-                    modifier = Modifier.padding(16.dp).clickable { onDeviceClick(address, name) }
-                )
+            items(filtered, key = { it.address }) { device ->
+                Column(modifier = Modifier.fillMaxWidth().clickable { onDeviceClick(device.address, device.name) }.padding(16.dp)) {
+                    Text(text = "${device.name} [${device.address}]", style = MaterialTheme.typography.bodyLarge)
+                    Text(
+                        text = "%d dBm · seen %.1f s ago · %d reports".format(
+                            device.rssi, (nowNs - device.lastSeenNs).coerceAtLeast(0) / 1e9, device.reports
+                        ),
+                        style = MaterialTheme.typography.bodySmall,
+                        color = Color.Gray
+                    )
+                }
             }
         }
     }
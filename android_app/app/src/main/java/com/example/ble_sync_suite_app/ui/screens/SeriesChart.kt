@@ -0,0 +1,91 @@
+package com.example.ble_sync_suite_app.ui.screens
+
+import com.example.ble_sync_suite_app.sync.SeriesPyramid
+import com.example.ble_sync_suite_app.sync.SeriesWindow
+import androidx.compose.foundation.Canvas
+import androidx.compose.foundation.layout.BoxWithConstraints
+import androidx.compose.foundation.layout.Column
+import androidx.compose.foundation.layout.fillMaxWidth
+import androidx.compose.foundation.layout.height
+import androidx.compose.material3.Text
+import androidx.compose.runtime.Composable
+import androidx.compose.runtime.remember
+import androidx.compose.ui.Modifier
+import androidx.compose.ui.geometry.Offset
+import androidx.compose.ui.graphics.Color
+import androidx.compose.ui.graphics.Path
+import androidx.compose.ui.graphics.drawscope.Stroke
+import androidx.compose.ui.unit.dp
+import androidx.compose.ui.unit.sp
+
+// Canvas chart over a SeriesPyramid: per bucket a min..max band and the mean line. At most one bucket per
+// pixel column is queried, so a frame costs O(width) however long the session has run.
+
+private const val MAX_CHART_POINTS = 2048
+
+private class ChartRange(val fromUs: Long, val toUs: Long, val lo: Double, val hi: Double)
+
+/**
+ * [spanUs] is the window ending at the newest point (0 = everything still held). [version] changes whenever
+ * [history] has new points (the packet count will do); the chart is re-queried only then.
+ */
+@Composable
+fun SeriesChart(
+    title: String,
+    unit: String,
+    history: SeriesPyramid,
+    spanUs: Long,
+    version: Long,
+    color: Color,
+    modifier: Modifier = Modifier
+) {
+    val window = remember(history) { SeriesWindow(MAX_CHART_POINTS) }
+    BoxWithConstraints(modifier.fillMaxWidth()) {
+        val points = constraints.maxWidth.coerceIn(1, MAX_CHART_POINTS)
+        val range = remember(history, version, spanUs, points) {
+            val toUs = history.lastUs
+            val fromUs = if (spanUs > 0) toUs - spanUs else history.firstUs
+            if (toUs == Long.MIN_VALUE || history.query(fromUs, toUs, points, window) == 0) {
+                null
+            } else {
+                var lo = window.min[0]
+                var hi = window.max[0]
+                for (i in 1 until window.size) {
+                    if (window.min[i] < lo) lo = window.min[i]
+                    if (window.max[i] > hi) hi = window.max[i]
+                }
+                ChartRange(fromUs, maxOf(toUs, fromUs + 1), lo, hi)
+            }
+        }
+        Column {
+            Canvas(Modifier.fillMaxWidth().height(120.dp)) {
+                drawRect(Color(0xFF1E1E1E))
+                val r = range ?: return@Canvas
+                // A flat series still gets a visible band around it
+                val flat = r.hi - r.lo < 1e-9
+                val lo = if (flat) r.lo - 0.5 else r.lo
+                val hi = if (flat) r.hi + 0.5 else r.hi
+                val spanX = (r.toUs - r.fromUs).toFloat()
+                val spanY = (hi - lo).toFloat()
+                fun x(tUs: Long) = ((tUs - r.fromUs) / spanX * size.width).coerceIn(0f, size.width)
+                fun y(v: Double) = size.height - ((v - lo).toFloat() / spanY) * size.height
+                if (lo < 0.0 && hi > 0.0) {
+                    drawLine(Color.Gray, Offset(0f, y(0.0)), Offset(size.width, y(0.0)), strokeWidth = 1f)
+                }
+                val band = color.copy(alpha = 0.35f)
+                val bandWidth = maxOf(1f, window.bucketUs / spanX * size.width)
+                val mean = Path()
+                for (i in 0 until window.size) {
+                    val cx = x(window.startUs[i] + window.bucketUs / 2)
+                    drawLine(band, Offset(cx, y(window.min[i])), Offset(cx, y(window.max[i])), strokeWidth = bandWidth)
+                    if (i == 0) mean.moveTo(cx, y(window.mean[i])) else mean.lineTo(cx, y(window.mean[i]))
+                }
+                drawPath(mean, color, style = Stroke(width = 2f))
+            }
+            val caption = range?.let {
+                "  $title: ${"%.3f".format(it.lo)} .. ${"%.3f".format(it.hi)} $unit (${window.size} × ${"%.0f".format(window.bucketUs / 1e6)} s buckets)"
+            } ?: "  $title: no data yet"
+            Text(caption, fontSize = 12.sp, color = Color.White)
+        }
+    }
+}
@@ -0,0 +1,182 @@
+package com.example.ble_sync_suite_app
+
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Decoders against byte fixtures. Each fixture is what sensor_payload_build_* in
+ * esp32_ble/components/sensor_protocol writes for the records noted beside it, so a field-order or width
+ * change on either side fails here.
+ */
+class EspPayloadDecodeTest {
+
+    @Test
+    fun deltaRecordsFollowPeriodAndJitter() {
+        val value = hex(DELTA)
+        val seqs = ArrayList<Long>()
+        val times = ArrayList<Long>()
+        val count = forEachEspDeltaRecord(value) { seq, tUs ->
+            seqs.add(seq)
+            times.add(tUs)
+        }
+        assertEquals(DELTA_SEQS.size, count)
+        assertArrayEquals(DELTA_SEQS, seqs.toLongArray())
+        assertArrayEquals(DELTA_TIMES_US, times.toLongArray())
+    }
+
+    @Test
+    fun deltaSingleRecordIsHeaderOnly() {
+        val value = hex(DELTA_SINGLE)
+        assertEquals(ESP_DELTA_HEADER_LEN, value.size)
+        assertEquals(listOf(DELTA_SEQS[0] to DELTA_TIMES_US[0]), deltaRecords(value, value.size))
+    }
+
+    @Test
+    fun deltaHonoursLength() {
+        // Trailing bytes past length (a reused receive buffer) are not read
+        val value = hex(DELTA) + byteArrayOf(0x7F, 0x7F)
+        assertEquals(DELTA_SEQS.size, forEachEspDeltaRecord(value, value.size - 2) { _, _ -> })
+    }
+
+    @Test
+    fun truncatedDeltaYieldsNoRecords() {
+        val value = hex(DELTA)
+        // Cut inside the last varint, before it, and inside the header: nothing reaches onRecord
+        for (length in listOf(value.size - 1, value.size - 2, ESP_DELTA_HEADER_LEN, ESP_DELTA_HEADER_LEN - 1, 0)) {
+            var calls = 0
+            assertEquals("length $length", -1, forEachEspDeltaRecord(value, length) { _, _ -> calls++ })
+            assertEquals("length $length", 0, calls)
+        }
+    }
+
+    @Test
+    fun deltaRejectsOtherVersionsAndEmptyCount() {
+        val otherVersion = hex(DELTA).also { it[0] = ESP_PAYLOAD_VERSION_BATCH.toByte() }
+        assertEquals(-1, forEachEspDeltaRecord(otherVersion) { _, _ -> })
+        val empty = hex(DELTA_SINGLE).also { it[1] = 0 }
+        assertEquals(-1, forEachEspDeltaRecord(empty) { _, _ -> })
+    }
+
+    @Test
+    fun legacyRecord() {
+        assertEquals(listOf(Record(SEQ, T_US)), decode(hex(LEGACY)))
+    }
+
+    @Test
+    fun batchRecordsOldestFirst() {
+        assertEquals(listOf(Record(7, 1_000_000), Record(8, 1_100_000), Record(9, 1_200_000)), decode(hex(BATCH)))
+    }
+
+    @Test
+    fun thermalRecordsAndTemperature() {
+        val value = hex(THERMAL)
+        assertEquals(listOf(Record(7, 1_000_000), Record(8, 1_100_000)), decode(value))
+        assertEquals(23.45, espPayloadTemperatureC(view(value)), 1e-9)
+        val unknown = hex(THERMAL_UNKNOWN)
+        assertEquals(listOf(Record(7, 1_000_000)), decode(unknown))
+        assertTrue(espPayloadTemperatureC(view(unknown)).isNaN())
+        assertTrue(espPayloadTemperatureC(view(hex(BATCH))).isNaN())
+    }
+
+    @Test
+    fun timedRecordCarriesPreviousDelay() {
+        assertEquals(listOf(Record(SEQ, T_US, SEQ - 1, 1234)), decode(hex(TIMED_CONF)))
+        // Neither flag set: the delay field is not a measurement
+        assertEquals(listOf(Record(SEQ, T_US, SEQ - 1, EspPacket.UNKNOWN)), decode(hex(TIMED_NO_DELAY)))
+    }
+
+    @Test
+    fun beaconAndRootTimeRecords() {
+        assertEquals(listOf(Record(SEQ, T_US)), decode(hex(BEACON)))
+        assertEquals(listOf(Record(SEQ, T_US)), decode(hex(ROOT_TIME)))
+        val unsynced = hex(ROOT_TIME_UNSYNCED)
+        assertEquals(emptyList<Record>(), decode(unsynced))
+        assertTrue(isEspUnsyncedRootTime(view(unsynced)))
+    }
+
+    @Test
+    fun deltaThroughTheSink() {
+        val records = DELTA_SEQS.indices.map { Record(DELTA_SEQS[it], DELTA_TIMES_US[it]) }
+        assertEquals(records, decode(hex(DELTA)))
+    }
+
+    @Test
+    fun truncatedPayloadsYieldNoRecords() {
+        for (fixture in listOf(BATCH, THERMAL, TIMED_CONF, BEACON, ROOT_TIME, DELTA)) {
+            val value = hex(fixture)
+            // One byte short, and header only; a 12-byte cut would read as legacy, so skip that length
+            for (length in listOf(value.size - 1, 2, 1, 0)) {
+                if (length == ESP_LEGACY_PAYLOAD_LEN) continue
+                assertEquals("$fixture cut to $length", emptyList<Record>(), decode(value.copyOf(length)))
+            }
+        }
+    }
+
+    @Test
+    fun unknownVersionYieldsNoRecords() {
+        val value = hex(BATCH).also { it[0] = 0x7E }
+        assertEquals(emptyList<Record>(), decode(value))
+    }
+
+    @Test
+    fun listDecoderStampsReceiveTime() {
+        val packets = decodeEspPayload(hex(TIMED_CONF), receivedAtNs = 42)
+        assertEquals(listOf(EspPacket(SEQ, T_US, 42, SEQ - 1, 1234)), packets)
+    }
+
+    private data class Record(
+        val seq: Long,
+        val tUs: Long,
+        val prevSeq: Long = EspPacket.UNKNOWN,
+        val prevSendDelayUs: Long = EspPacket.UNKNOWN
+    )
+
+    private fun view(value: ByteArray): ByteBuffer = ByteBuffer.wrap(value).order(ByteOrder.LITTLE_ENDIAN)
+
+    // Through the allocation-free sink; the count returned must match the records delivered
+    private fun decode(value: ByteArray): List<Record> {
+        val records = ArrayList<Record>()
+        val count = decodeEspPayloadInto(view(value)) { seq, tUs, prevSeq, prevSendDelayUs ->
+            records.add(Record(seq, tUs, prevSeq, prevSendDelayUs))
+        }
+        assertEquals(records.size, count)
+        return records
+    }
+
+    private fun deltaRecords(value: ByteArray, length: Int): List<Pair<Long, Long>> {
+        val records = ArrayList<Pair<Long, Long>>()
+        forEachEspDeltaRecord(value, length) { seq, tUs -> records.add(seq to tUs) }
+        return records
+    }
+
+    private fun hex(s: String): ByteArray = ByteArray(s.length / 2) { s.substring(2 * it, 2 * it + 2).toInt(16).toByte() }
+
+    private companion object {
+        // seq 0x89ABCDEF, t_us 0x0001020304050607 unless noted
+        const val SEQ = 0x89AB_CDEFL
+        const val T_US = 0x0001_0203_0405_0607L
+        const val LEGACY = "EFCDAB890706050403020100"
+        // seq 7, 8, 9 at 1.0, 1.1, 1.2 s
+        const val BATCH = "01030700000040420F000000000008000000E0C810000000000009000000804F120000000000"
+        // The first two BATCH records at 23.45 C; then the first alone at INT16_MIN (unknown)
+        const val THERMAL = "070229090700000040420F000000000008000000E0C8100000000000"
+        const val THERMAL_UNKNOWN = "070100800700000040420F0000000000"
+        // prev_seq SEQ - 1: 1234 us with DELAY_CONF, then no flags and a zero delay
+        const val TIMED_CONF = "0201EFCDAB890706050403020100EECDAB89D2040000"
+        const val TIMED_NO_DELAY = "0200EFCDAB890706050403020100EECDAB8900000000"
+        const val BEACON = "03EFCDAB890706050403020100"
+        // Hop 2 with err_us 300, then an unsynced relay
+        const val ROOT_TIME = "0602EFCDAB8907060504030201002C01"
+        const val ROOT_TIME_UNSYNCED = "06FFEFCDAB8907060504030201000000"
+        // sensor_payload_build_delta, period 10000 us, records below: jitter 0, +63, -64, +64, -1000 us
+        // (1- and 2-byte varints), seq wrapping through 0xFFFFFFFF
+        const val DELTA = "050610270000FEFFFFFF00F2052A01000000007E7F8001CF0F"
+        const val DELTA_SINGLE = "050110270000FEFFFFFF00F2052A01000000"
+        val DELTA_SEQS = longArrayOf(0xFFFF_FFFEL, 0xFFFF_FFFFL, 0, 1, 2, 3)
+        val DELTA_TIMES_US = longArrayOf(5_000_000_000, 5_000_010_000, 5_000_020_063, 5_000_029_999, 5_000_040_063, 5_000_049_063)
+    }
+}
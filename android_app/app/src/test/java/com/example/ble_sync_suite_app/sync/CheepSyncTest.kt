@@ -0,0 +1,94 @@
+package com.example.ble_sync_suite_app.sync
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import kotlin.math.abs
+
+/**
+ * FitMode.INCREMENTAL against the FitMode.BATCH reference on one sample stream, and the precision of the
+ * epoch-rebased fit. Both clocks start days into their uptime, so raw stamps are ~1e14 ns, and the stream
+ * spans several REBASE_INTERVAL_US.
+ */
+class CheepSyncTest {
+
+    @Test
+    fun incrementalMatchesBatchAcrossRebases() {
+        val delays = delaysNs()
+        for (estimator in Estimator.values()) {
+            val incremental = CheepSync(mode = FitMode.INCREMENTAL, estimator = estimator)
+            val batch = CheepSync(mode = FitMode.BATCH, estimator = estimator)
+            val epochs = HashSet<Long>()
+            for (i in 0 until SAMPLES) {
+                val receiverNs = idealReceiverNs(i) + delays[i]
+                incremental.addSample(beaconUs(i), receiverNs)
+                batch.addSample(beaconUs(i), receiverNs)
+
+                assertEquals("$estimator hasFit at $i", batch.hasFit, incremental.hasFit)
+                if (!batch.hasFit) continue
+                val a = incremental.getFit()
+                val b = batch.getFit()
+                // Rebasing depends only on the samples, so both sit on the same epoch
+                assertEquals("$estimator beacon epoch at $i", b.beaconEpochUs, a.beaconEpochUs)
+                assertEquals("$estimator receiver epoch at $i", b.receiverEpochNs, a.receiverEpochNs)
+                assertEquals("$estimator beta at $i", b.beta, a.beta, BETA_TOLERANCE)
+                assertEquals("$estimator alpha at $i", b.alpha, a.alpha, OFFSET_TOLERANCE_NS)
+                assertEquals("$estimator rms at $i", batch.rmsResidualMs, incremental.rmsResidualMs, RMS_TOLERANCE_MS)
+                epochs.add(b.beaconEpochUs)
+            }
+            assertTrue("$estimator: the stream should cross several rebases", epochs.size >= 4)
+        }
+    }
+
+    @Test
+    fun rebasedFitKeepsNanosecondPrecisionOnLongUptimes() {
+        for (mode in FitMode.values()) {
+            val sync = CheepSync(mode = mode)
+            for (i in 0 until SAMPLES) {
+                sync.addSample(beaconUs(i), idealReceiverNs(i))
+                if (!sync.hasFit) continue
+                // Exact linear clocks: only the receiver stamps' rounding to whole ns is left
+                assertEquals("$mode beta at $i", TRUE_BETA, sync.beta, 1e-8)
+                val fit = sync.getFit()
+                assertTrue("$mode next sample at $i", abs(fit.mapBeaconToReceiverNs(beaconUs(i + 1)) - idealReceiverNs(i + 1)) <= 2)
+                assertEquals("$mode fit and estimator map alike at $i", sync.mapBeaconToReceiverNs(beaconUs(i + 1)),
+                    fit.mapBeaconToReceiverNs(beaconUs(i + 1)))
+            }
+            // A minute past the last sample, beyond the next rebase
+            val ahead = SAMPLES + 600
+            assertTrue("$mode a minute ahead", abs(sync.getFit().mapBeaconToReceiverNs(beaconUs(ahead)) - idealReceiverNs(ahead)) <= 10)
+            assertTrue("$mode round trip", abs(sync.getFit().mapReceiverToBeaconUs(idealReceiverNs(ahead)) - beaconUs(ahead)) <= 1)
+        }
+    }
+
+    private fun beaconUs(i: Int): Long = BEACON_START_US + i * PERIOD_US
+
+    private fun idealReceiverNs(i: Int): Long = RECEIVER_START_NS + Math.round(TRUE_BETA * (i * PERIOD_US * 1000.0))
+
+    // Reception delays: up to 1 ms of jitter, and every OUTLIER_EVERY-th sample 20 ms late (exercises the
+    // robust estimators). A fixed LCG, so the stream is the same on every run.
+    private fun delaysNs(): LongArray {
+        var state = 0x2545F4914F6CDD1DL
+        return LongArray(SAMPLES) { i ->
+            state = state * 6364136223846793005L + 1442695040888963407L
+            val jitter = (state ushr 33) % JITTER_NS
+            if (i % OUTLIER_EVERY == OUTLIER_EVERY - 1) jitter + OUTLIER_NS else jitter
+        }
+    }
+
+    private companion object {
+        const val SAMPLES = 3000                         // ~5 min of beacon time at PERIOD_US
+        const val PERIOD_US = 100_003L                   // not a round number, so samples do not tie
+        const val BEACON_START_US = 2L * 86_400_000_000L          // two days of beacon uptime
+        const val RECEIVER_START_NS = 3L * 86_400_000_000_000L    // three days of phone uptime
+        const val TRUE_BETA = 1.0 + 40e-6
+        const val JITTER_NS = 1_000_000L
+        const val OUTLIER_EVERY = 37
+        const val OUTLIER_NS = 20_000_000L
+
+        // The two modes differ by rounding only (~1e-13 and ~0.01 ns on this stream)
+        const val BETA_TOLERANCE = 1e-10
+        const val OFFSET_TOLERANCE_NS = 1.0
+        const val RMS_TOLERANCE_MS = 1e-6
+    }
+}
@@ -21,4 +21,5 @@ dependencyResolutionManagement {
 
 rootProject.name = "ble_sync_suite_app"
 include(":app")
+include(":sync-bench")
  
\ No newline at end of file
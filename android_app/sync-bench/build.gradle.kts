@@ -0,0 +1,45 @@
+import org.jetbrains.kotlin.gradle.dsl.JvmTarget
+
+// JVM-only benchmarks for the stdlib-only sync module. The sources are compiled straight from the app
+// module, so what is measured here is exactly what ships.
+plugins {
+    alias(libs.plugins.kotlin.jvm)
+    alias(libs.plugins.jmh)
+    application
+}
+
+java {
+    sourceCompatibility = JavaVersion.VERSION_11
+    targetCompatibility = JavaVersion.VERSION_11
+}
+
+kotlin {
+    compilerOptions {
+        jvmTarget.set(JvmTarget.JVM_11)
+    }
+    sourceSets["main"].kotlin.srcDir("../app/src/main/java/com/example/ble_sync_suite_app/sync")
+}
+
+application {
+    // ./gradlew :sync-bench:run — convergence error of each estimator on synthetic traces
+    mainClass.set("com.example.ble_sync_suite_app.bench.ConvergenceReportKt")
+}
+
+// ./gradlew :sync-bench:e2eReport --args="--analyser a.csv --beacon A.csv.gz:0 …" — report of one hardware
+// benchmark run (esp32_ble/Bluedroid_GATT_Server/bench)
+tasks.register<JavaExec>("e2eReport") {
+    classpath = sourceSets["main"].runtimeClasspath
+    mainClass.set("com.example.ble_sync_suite_app.bench.EndToEndReportKt")
+}
+
+jmh {
+    // ./gradlew :sync-bench:jmh — throughput, latency and (with the gc profiler) allocation per op
+    // The plugin adds jmh-core and runs the bytecode generator itself, so no kapt is needed
+    jmhVersion.set(libs.versions.jmh)
+    profilers.add("gc")
+    warmupIterations.set(3)
+    iterations.set(5)
+    fork.set(1)
+    // e.g. -PjmhIncludes=MapBenchmark
+    (findProperty("jmhIncludes") as String?)?.let { includes.add(it) }
+}
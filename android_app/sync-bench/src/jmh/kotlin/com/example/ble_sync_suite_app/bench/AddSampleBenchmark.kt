@@ -0,0 +1,88 @@
+package com.example.ble_sync_suite_app.bench
+
+import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.Estimator
+import com.example.ble_sync_suite_app.sync.FitMode
+import com.example.ble_sync_suite_app.sync.KalmanSync
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import java.util.concurrent.TimeUnit
+
+/**
+ * addSample throughput on a full window (steady state: every call also evicts).
+ * Run with the gc profiler (on by default in build.gradle.kts): gc.alloc.rate.norm should be 0 B/op.
+ * BATCH is O(windowSize) per sample; expect it to fall off a cliff at large windows.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class AddSampleBenchmark {
+    @Param("10", "100", "1000", "10000", "100000")
+    @JvmField
+    var windowSize = 0
+
+    @Param("INCREMENTAL", "BATCH")
+    @JvmField
+    var mode = FitMode.INCREMENTAL
+
+    @Param("LEAST_SQUARES", "LOWER_ENVELOPE", "HUBER", "RANSAC")
+    @JvmField
+    var estimator = Estimator.LEAST_SQUARES
+
+    private lateinit var trace: SyntheticTrace
+    private lateinit var sync: CheepSync
+    private var i = 0
+
+    @Setup
+    fun setup() {
+        trace = SyntheticTrace(TRACE_SIZE, lateProbability = 0.05)
+        sync = CheepSync(windowSize, mode, estimator)
+        // Fill the window first so every measured call is in the evicting steady state
+        repeat(windowSize) { next() }
+    }
+
+    private fun next() {
+        sync.addSample(trace.beaconTimeUs[i], trace.receiverTimeNs[i])
+        i = if (i + 1 == TRACE_SIZE) 0 else i + 1
+    }
+
+    @Benchmark
+    fun addSample(): Double {
+        next()
+        return sync.beta
+    }
+
+    companion object {
+        // Longer than the largest window. Wrapping back to the start makes beacon time jump backwards
+        // once per lap; the fits are meaningless for a window after that, but the cost per call is the same.
+        const val TRACE_SIZE = 1 shl 18
+    }
+}
+
+@State(Scope.Thread)
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+open class KalmanAddSampleBenchmark {
+    private lateinit var trace: SyntheticTrace
+    private val sync = KalmanSync()
+    private var i = 0
+
+    @Setup
+    fun setup() {
+        trace = SyntheticTrace(AddSampleBenchmark.TRACE_SIZE)
+    }
+
+    @Benchmark
+    fun addSample(): Double {
+        if (i == 0) sync.reset()
+        sync.addSample(trace.beaconTimeUs[i], trace.receiverTimeNs[i])
+        i = if (i + 1 == AddSampleBenchmark.TRACE_SIZE) 0 else i + 1
+        return sync.beta
+    }
+}
@@ -0,0 +1,74 @@
+package com.example.ble_sync_suite_app.bench
+
+import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.KalmanSync
+import com.example.ble_sync_suite_app.sync.SyncFit
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OperationsPerInvocation
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import java.util.concurrent.TimeUnit
+
+/**
+ * Latency of one beacon → receiver mapping, through the live estimator and through a SyncFit snapshot,
+ * and per timestamp when a SyncFit maps the whole trace in one call.
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+open class MapBenchmark {
+    private lateinit var trace: SyntheticTrace
+    private val cheepSync = CheepSync()
+    private val kalman = KalmanSync()
+    private lateinit var fit: SyncFit
+    private val mapped = LongArray(TRACE_SIZE)
+    private var i = 0
+
+    @Setup
+    fun setup() {
+        trace = SyntheticTrace(TRACE_SIZE)
+        for (k in 0 until TRACE_SIZE) {
+            cheepSync.addSample(trace.beaconTimeUs[k], trace.receiverTimeNs[k])
+            kalman.addSample(trace.beaconTimeUs[k], trace.receiverTimeNs[k])
+        }
+        fit = cheepSync.getFit()
+    }
+
+    // Vary the input so the JIT cannot fold the call
+    private fun nextTb(): Long {
+        i = (i + 1) and (TRACE_SIZE - 1)
+        return trace.beaconTimeUs[i]
+    }
+
+    private fun nextRx(): Long {
+        i = (i + 1) and (TRACE_SIZE - 1)
+        return trace.receiverTimeNs[i]
+    }
+
+    @Benchmark
+    fun cheepSyncMap(): Long = cheepSync.mapBeaconToReceiverNs(nextTb())
+
+    @Benchmark
+    fun syncFitMap(): Long = fit.mapBeaconToReceiverNs(nextTb())
+
+    @Benchmark
+    @OperationsPerInvocation(TRACE_SIZE)
+    fun syncFitMapBulk(): LongArray {
+        fit.mapBeaconToReceiverNs(trace.beaconTimeUs, mapped)
+        return mapped
+    }
+
+    @Benchmark
+    fun syncFitInverse(): Long = fit.mapReceiverToBeaconUs(nextRx())
+
+    @Benchmark
+    fun kalmanMap(): Long = kalman.mapBeaconToReceiverNs(nextTb())
+
+    companion object {
+        const val TRACE_SIZE = 1 shl 12
+    }
+}
@@ -0,0 +1,58 @@
+package com.example.ble_sync_suite_app.bench
+
+import com.example.ble_sync_suite_app.sync.CheepSync
+import com.example.ble_sync_suite_app.sync.ClockSync
+import com.example.ble_sync_suite_app.sync.Estimator
+import com.example.ble_sync_suite_app.sync.KalmanSync
+import kotlin.math.abs
+import kotlin.math.sqrt
+
+// Convergence error of every estimator on synthetic traces with a known truth.
+// Error = fit's prediction of the current tick minus its noise-free receiver time, after each sample.
+
+private class Result(val rmsMs: Double, val p99Ms: Double, val maxMs: Double, val settleS: Double)
+
+private fun score(sync: ClockSync, trace: SyntheticTrace, warmup: Int): Result {
+    val errors = DoubleArray(trace.size - warmup)
+    var settled = -1
+    for (i in 0 until trace.size) {
+        sync.addSample(trace.beaconTimeUs[i], trace.receiverTimeNs[i])
+        if (i < warmup) continue
+        val e = abs(sync.mapBeaconToReceiverNs(trace.beaconTimeUs[i]) - trace.trueReceiverTimeNs[i]) / 1e6
+        errors[i - warmup] = e
+        if (e < SETTLED_MS) { if (settled < 0) settled = i } else settled = -1
+    }
+    val sorted = errors.sortedArray()
+    val rms = sqrt(errors.sumOf { it * it } / errors.size)
+    val settleS = if (settled < 0) Double.NaN else settled * trace.intervalUs / 1e6
+    return Result(rms, sorted[(sorted.size * 0.99).toInt().coerceAtMost(sorted.size - 1)], sorted.last(), settleS)
+}
+
+private const val SETTLED_MS = 1.0
+
+private val estimators: List<Pair<String, () -> ClockSync>> = buildList {
+    for (w in listOf(10, 50, 500)) {
+        for (e in Estimator.entries) add("CheepSync w=$w ${e.name}" to { CheepSync(windowSize = w, estimator = e) })
+    }
+    add("KalmanSync default" to { KalmanSync() })
+    add("KalmanSync fast-skew" to { KalmanSync(processNoiseSkewPpm = 0.5) })
+}
+
+fun main() {
+    val hour = 3600 * 50
+    val traces = listOf(
+        "steady, 0.5 ms jitter" to SyntheticTrace(hour),
+        "warm-up drift +20 ppm" to SyntheticTrace(hour, warmupPpm = 20.0),
+        "5% late by ~20 ms" to SyntheticTrace(hour, lateProbability = 0.05),
+        "drift + late" to SyntheticTrace(hour, warmupPpm = 20.0, lateProbability = 0.05)
+    )
+    for ((traceName, trace) in traces) {
+        println("== $traceName (${trace.size} samples at ${trace.intervalUs / 1000} ms)")
+        println("%-32s %10s %10s %10s %12s".format("estimator", "rms ms", "p99 ms", "max ms", "settled s"))
+        for ((name, make) in estimators) {
+            val r = score(make(), trace, warmup = 10)
+            println("%-32s %10.3f %10.3f %10.3f %12.1f".format(name, r.rmsMs, r.p99Ms, r.maxMs, r.settleS))
+        }
+        println()
+    }
+}
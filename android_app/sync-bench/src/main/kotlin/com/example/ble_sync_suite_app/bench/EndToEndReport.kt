@@ -0,0 +1,286 @@
+package com.example.ble_sync_suite_app.bench
+
+import java.io.File
+import java.util.zip.GZIPInputStream
+import kotlin.math.abs
+import kotlin.math.roundToLong
+import kotlin.math.sqrt
+
+// End-to-end report for one benchmark run (esp32_ble/Bluedroid_GATT_Server/bench): beacons built with
+// SENSOR_BENCH toggle a GPIO at every capture, a logic analyser records those edges on one clock, and the app
+// exports each beacon's session (CSV). From that this prints:
+//  - alignment error: for two beacons, the mapped phone-time difference of records captured close together
+//    minus the analyser's difference of their edges. This is the "sub-millisecond alignment" figure;
+//  - capture stamp jitter: each beacon's edges against its own t_us, after removing a linear fit;
+//  - one-way latency above the fit: receive time minus mapped capture time (the link's delay beyond the
+//    fastest packets the fit leans on; the absolute one-way delay needs a phone-side ground truth too);
+//  - CPU and radio duty from the firmware's BENCH console lines.
+//
+// Usage: --analyser a.csv --beacon A.csv.gz:0 --beacon B.csv.gz:1 [--bench-log A.log ...]
+//        [--conn-interval-ms 7.5] [--phy 1M|2M] [--profile name]
+// Analyser CSV: time in seconds, then one 0/1 column per channel, a row per change (Saleae, sigrok);
+// :N picks channel column N (0-based). Header lines are skipped.
+
+private class Beacon(val name: String, val channel: Int) {
+    val tUs = ArrayList<Long>()
+    val receivedNs = ArrayList<Long>()
+    val mappedNs = ArrayList<Long>()  // NO_FIT before the first fit
+    var edges = LongArray(0)
+    var edgeIndex = IntArray(0)       // per record, relative to record 0's edge; -1 when unmatched
+}
+
+private const val NO_FIT = Long.MIN_VALUE
+
+private fun readExport(b: Beacon, file: File) {
+    GZIPInputStream(file.inputStream()).bufferedReader(Charsets.US_ASCII).useLines { lines ->
+        for (line in lines) {
+            if (line.isEmpty() || !line[0].isDigit()) continue  // "# address=…" and the column header
+            val f = line.split(',')
+            if (f.size < 4) continue
+            b.tUs.add(f[1].toLong())
+            b.receivedNs.add(f[2].toLong())
+            b.mappedNs.add(if (f[3].isEmpty()) NO_FIT else f[3].toLong())
+        }
+    }
+}
+
+// Edge times (ns) per channel column, rising and falling alike
+private fun readAnalyser(file: File, channels: Int): Array<LongArray> {
+    val edges = Array(channels) { ArrayList<Long>() }
+    val level = IntArray(channels) { -1 }
+    file.bufferedReader().useLines { lines ->
+        for (line in lines) {
+            val f = line.split(',')
+            val t = f[0].trim().toDoubleOrNull() ?: continue
+            val tNs = (t * 1e9).roundToLong()
+            for (c in 0 until channels) {
+                val v = f.getOrNull(c + 1)?.trim()?.toIntOrNull() ?: continue
+                if (level[c] >= 0 && v != level[c]) edges[c].add(tNs)
+                level[c] = v
+            }
+        }
+    }
+    return Array(channels) { edges[it].toLongArray() }
+}
+
+// Pair records with edges by walking both in time order: each record's edge is predicted from the previous
+// match plus its t_us interval (drift between neighbours is well under a μs). Indices are relative to the edge
+// record 0 was given; which edge that really is, ownShift and bestShift settle.
+private fun matchEdges(b: Beacon) {
+    val order = b.tUs.indices.sortedBy { b.tUs[it] }
+    val index = IntArray(b.tUs.size) { -1 }
+    val e = b.edges
+    if (e.size < 2 || order.isEmpty()) { b.edgeIndex = index; return }
+    val spacing = LongArray(e.size - 1) { e[it + 1] - e[it] }.sorted()[(e.size - 1) / 2]
+    val tolerance = spacing / 4
+    var lastEdge = 0
+    var lastUs = b.tUs[order[0]]
+    index[order[0]] = 0
+    for (k in 1 until order.size) {
+        val i = order[k]
+        val predicted = e[lastEdge] + (b.tUs[i] - lastUs) * 1000
+        var j = lastEdge
+        while (j + 1 < e.size && abs(e[j + 1] - predicted) <= abs(e[j] - predicted)) j++
+        if (abs(e[j] - predicted) > tolerance || j == lastEdge && b.tUs[i] != lastUs) continue
+        index[i] = j
+        lastEdge = j
+        lastUs = b.tUs[i]
+    }
+    b.edgeIndex = index
+}
+
+private fun percentile(sorted: DoubleArray, p: Double) =
+    if (sorted.isEmpty()) Double.NaN else sorted[((sorted.size - 1) * p).roundToLong().toInt()]
+
+private fun summary(label: String, values: DoubleArray, unit: String) {
+    if (values.isEmpty()) { println("  %-28s no samples".format(label)); return }
+    val s = values.sortedArray()
+    val rms = sqrt(values.sumOf { it * it } / values.size)
+    println("  %-28s n=%-7d rms %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f %s".format(
+        label, values.size, rms, percentile(s, 0.5), percentile(s, 0.9), percentile(s, 0.99), s.last(), unit))
+}
+
+// How many edges past its relative index every record of b may be shifted and still have one
+private fun shiftRange(b: Beacon) = 0 until (b.edges.size - (b.edgeIndex.maxOrNull() ?: 0)).coerceAtLeast(1)
+
+private fun sampled(indices: List<Int>, n: Int = 256) =
+    if (indices.size <= n) indices else List(n) { indices[it * indices.size / n] }
+
+// Capture jitter at an edge offset: edges against a least-squares line through (t_us, edge)
+private fun stampJitterUs(b: Beacon, shift: Int, records: List<Int> = b.tUs.indices.toList()): DoubleArray {
+    val idx = records.filter { b.edgeIndex[it] >= 0 && b.edgeIndex[it] + shift < b.edges.size }
+    if (idx.size < 3) return DoubleArray(0)
+    val x0 = b.tUs[idx[0]].toDouble()
+    val y0 = b.edges[b.edgeIndex[idx[0]] + shift].toDouble()
+    var sx = 0.0; var sy = 0.0; var sxx = 0.0; var sxy = 0.0
+    for (i in idx) {
+        val x = b.tUs[i] - x0
+        val y = (b.edges[b.edgeIndex[i] + shift] - y0) / 1000.0
+        sx += x; sy += y; sxx += x * x; sxy += x * y
+    }
+    val n = idx.size.toDouble()
+    val slope = (n * sxy - sx * sy) / (n * sxx - sx * sx)
+    val intercept = (sy - slope * sx) / n
+    return DoubleArray(idx.size) {
+        val i = idx[it]
+        abs((b.edges[b.edgeIndex[i] + shift] - y0) / 1000.0 - (intercept + slope * (b.tUs[i] - x0)))
+    }
+}
+
+// Which edge is record 0's: t_us and its edge come from one capture, so the right offset leaves the least
+// jitter. Weak for a near-perfect period (esp_timer captures); alignment against another beacon (bestShift)
+// does not depend on it.
+private fun ownShift(b: Beacon): Int {
+    val sample = sampled(b.tUs.indices.filter { b.edgeIndex[it] >= 0 })
+    var best = 0
+    var bestRms = Double.MAX_VALUE
+    for (shift in shiftRange(b)) {
+        val r = stampJitterUs(b, shift, sample)
+        if (r.size < 3) continue
+        val rms = sqrt(r.sumOf { it * it } / r.size)
+        if (rms < bestRms) { bestRms = rms; best = shift }
+    }
+    return best
+}
+
+// For each record of a with a fit, b's mapped record nearest in phone time (within maxGapNs), as index pairs
+private fun nearestPairs(a: Beacon, b: Beacon, maxGapNs: Long): List<Pair<Int, Int>> {
+    val bOrder = b.mappedNs.indices.filter { b.mappedNs[it] != NO_FIT && b.edgeIndex[it] >= 0 }
+        .sortedBy { b.mappedNs[it] }
+    if (bOrder.isEmpty()) return emptyList()
+    val bMapped = LongArray(bOrder.size) { b.mappedNs[bOrder[it]] }
+    val pairs = ArrayList<Pair<Int, Int>>()
+    for (i in a.mappedNs.indices) {
+        if (a.mappedNs[i] == NO_FIT || a.edgeIndex[i] < 0) continue
+        var k = bMapped.binarySearch(a.mappedNs[i]).let { if (it < 0) -it - 1 else it }
+        if (k == bMapped.size || k > 0 && a.mappedNs[i] - bMapped[k - 1] < bMapped[k] - a.mappedNs[i]) k--
+        if (abs(bMapped[k] - a.mappedNs[i]) <= maxGapNs) pairs.add(i to bOrder[k])
+    }
+    return pairs
+}
+
+private fun pairErrorUs(a: Beacon, aShift: Int, b: Beacon, bShift: Int, i: Int, j: Int): Double? {
+    val ea = a.edgeIndex[i] + aShift
+    val eb = b.edgeIndex[j] + bShift
+    if (ea !in a.edges.indices || eb !in b.edges.indices) return null
+    val estimated = a.mappedNs[i] - b.mappedNs[j]
+    val truth = a.edges[ea] - b.edges[eb]
+    return (estimated - truth) / 1000.0
+}
+
+// The edge offset of b (against a at aShift) whose pairs agree best; wrong offsets are off by whole periods
+private fun bestShift(a: Beacon, aShift: Int, b: Beacon, pairs: List<Pair<Int, Int>>): Int {
+    val sample = sampled(pairs.indices.toList()).map { pairs[it] }
+    var best = 0
+    var bestScore = Double.MAX_VALUE
+    for (shift in shiftRange(b)) {
+        val errors = sample.mapNotNull { (i, j) -> pairErrorUs(a, aShift, b, shift, i, j)?.let(::abs) }
+        if (errors.size < sample.size / 2) continue
+        val median = errors.sorted()[errors.size / 2]
+        if (median < bestScore) { bestScore = median; best = shift }
+    }
+    return best
+}
+
+private class BenchStats(val busyPm: List<DoubleArray>, val notifiesPerS: DoubleArray, val bytesPerS: DoubleArray)
+
+private val benchLine = Regex("""BENCH: (.*)$""")
+
+private fun readBenchLog(file: File): BenchStats {
+    val busy = ArrayList<DoubleArray>()
+    val notifies = ArrayList<Double>()
+    val bytes = ArrayList<Double>()
+    file.forEachLine { line ->
+        val fields = benchLine.find(line)?.groupValues?.get(1)?.split(' ')
+            ?.mapNotNull { kv -> kv.split('=', limit = 2).takeIf { it.size == 2 }?.let { it[0] to it[1] } }
+            ?.toMap() ?: return@forEachLine
+        val windowS = (fields["window_ms"]?.toDoubleOrNull() ?: return@forEachLine) / 1000.0
+        if (windowS <= 0.0) return@forEachLine
+        fields["busy_pm"]?.split(',')?.mapNotNull { it.toDoubleOrNull() }?.let { busy.add(it.toDoubleArray()) }
+        notifies.add((fields["notifies"]?.toDoubleOrNull() ?: 0.0) / windowS)
+        bytes.add((fields["att_bytes"]?.toDoubleOrNull() ?: 0.0) / windowS)
+    }
+    return BenchStats(busy, notifies.toDoubleArray(), bytes.toDoubleArray())
+}
+
+// Estimated radio time per second, slave latency 0: every connection event exchanges an empty PDU each way
+// (T_IFS between), and each notification adds its L2CAP header and ATT bytes. Encryption, retransmissions and
+// receive-window widening are not counted.
+private fun radioDuty(notifiesPerS: Double, attBytesPerS: Double, connIntervalMs: Double, phy2M: Boolean): Double {
+    val byteUs = if (phy2M) 4.0 else 8.0
+    val emptyPduUs = (if (phy2M) 11 else 10) * byteUs  // preamble + access address + header + CRC
+    val eventsPerS = 1000.0 / connIntervalMs
+    val onAirUs = eventsPerS * (2 * emptyPduUs + 150.0) + (attBytesPerS + notifiesPerS * 4) * byteUs
+    return onAirUs / 1e6
+}
+
+fun main(args: Array<String>) {
+    var analyser: File? = null
+    val beacons = ArrayList<Pair<Beacon, File>>()
+    val benchLogs = ArrayList<File>()
+    var connIntervalMs = 7.5
+    var phy2M = false
+    var profile = "run"
+    var i = 0
+    fun value(): String = args.getOrNull(++i) ?: error("${args[i - 1]} needs a value")
+    while (i < args.size) {
+        when (args[i]) {
+            "--analyser" -> analyser = File(value())
+            "--beacon" -> {
+                val spec = value()
+                val path = spec.substringBeforeLast(':')
+                val channel = spec.substringAfterLast(':').toIntOrNull() ?: error("--beacon file.csv.gz:channel")
+                beacons.add(Beacon(File(path).name.substringBefore('.'), channel) to File(path))
+            }
+            "--bench-log" -> benchLogs.add(File(value()))
+            "--conn-interval-ms" -> connIntervalMs = value().toDouble()
+            "--phy" -> phy2M = value().equals("2M", ignoreCase = true)
+            "--profile" -> profile = value()
+            else -> error("unknown argument ${args[i]}")
+        }
+        i++
+    }
+
+    println("== $profile")
+    if (beacons.isNotEmpty()) {
+        for ((b, file) in beacons) readExport(b, file)
+        val edges = analyser?.let { readAnalyser(it, beacons.maxOf { (b, _) -> b.channel } + 1) }
+        for ((b, _) in beacons) {
+            println("${b.name}: ${b.tUs.size} records")
+            if (edges != null) {
+                b.edges = edges[b.channel]
+                matchEdges(b)
+                println("  ${b.edges.size} edges on channel ${b.channel}, ${b.edgeIndex.count { it >= 0 }} records matched")
+                summary("capture stamp jitter", stampJitterUs(b, ownShift(b)), "μs")
+            }
+            val latency = b.tUs.indices.filter { b.mappedNs[it] != NO_FIT }
+                .map { (b.receivedNs[it] - b.mappedNs[it]) / 1e6 }.toDoubleArray()
+            summary("latency above the fit", latency, "ms")
+        }
+        if (edges != null && beacons.size >= 2) {
+            val (ref, _) = beacons[0]
+            val refShift = ownShift(ref)
+            for ((b, _) in beacons.drop(1)) {
+                val spacingNs = if (b.edges.size > 1) (b.edges.last() - b.edges.first()) / (b.edges.size - 1) else 0L
+                val pairs = nearestPairs(ref, b, spacingNs)
+                val shift = bestShift(ref, refShift, b, pairs)
+                val errors = pairs.mapNotNull { (x, y) -> pairErrorUs(ref, refShift, b, shift, x, y) }
+                println("${ref.name} vs ${b.name}:")
+                summary("alignment error", errors.map(::abs).toDoubleArray(), "μs")
+                if (errors.isNotEmpty()) println("  %-28s %.1f μs".format("mean (signed)", errors.average()))
+            }
+        }
+    }
+    for (log in benchLogs) {
+        val s = readBenchLog(log)
+        println("${log.name}: ${s.notifiesPerS.size} BENCH windows")
+        val cores = s.busyPm.maxOfOrNull { it.size } ?: 0
+        for (c in 0 until cores) {
+            summary("CPU busy core $c", s.busyPm.mapNotNull { it.getOrNull(c) }.map { it / 10.0 }.toDoubleArray(), "%")
+        }
+        summary("notifications", s.notifiesPerS, "/s")
+        summary("ATT bytes", s.bytesPerS, "B/s")
+        val duty = s.notifiesPerS.indices.map { radioDuty(s.notifiesPerS[it], s.bytesPerS[it], connIntervalMs, phy2M) * 100 }
+        summary("radio on (estimate)", duty.toDoubleArray(), "%")
+    }
+}
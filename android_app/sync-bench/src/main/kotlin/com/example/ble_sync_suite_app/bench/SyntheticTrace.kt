@@ -0,0 +1,54 @@
+package com.example.ble_sync_suite_app.bench
+
+import java.util.Random
+import kotlin.math.exp
+import kotlin.math.ln
+
+/**
+ * Precomputed (beaconTimeUs, receiverTimeNs) samples with a known ground truth, so benchmarks
+ * spend no time generating data and convergence can be scored exactly.
+ *
+ * Beacon clock ticks every [intervalUs]. The true receiver time is
+ *   offsetNs + tb·(1 + skew(t)),  skew(t) = skewPpm + warmupPpm·(1 − e^(−t/warmupTauS))
+ * (a crystal settling after boot), integrated per step. Each observation adds Gaussian jitter and,
+ * with probability [lateProbability], an exponentially distributed late delivery (one-sided, like a
+ * BLE retransmission).
+ */
+class SyntheticTrace(
+    val size: Int,
+    val intervalUs: Long = 20_000,
+    skewPpm: Double = 40.0,
+    warmupPpm: Double = 0.0,
+    warmupTauS: Double = 600.0,
+    jitterMs: Double = 0.5,
+    lateProbability: Double = 0.0,
+    lateMeanMs: Double = 20.0,
+    offsetNs: Long = 3_600_000_000_000L,
+    startUs: Long = 86_400_000_000L,
+    seed: Long = 1
+) {
+    val beaconTimeUs = LongArray(size)
+    val receiverTimeNs = LongArray(size)
+    /** Noise-free receiver time of each beacon tick. */
+    val trueReceiverTimeNs = LongArray(size)
+
+    init {
+        val random = Random(seed)
+        var trueNs = (offsetNs + startUs * 1000L).toDouble()
+        for (i in 0 until size) {
+            val tb = startUs + i * intervalUs
+            if (i > 0) {
+                val tS = i * intervalUs / 1e6
+                val skew = (skewPpm + warmupPpm * (1.0 - exp(-tS / warmupTauS))) * 1e-6
+                trueNs += intervalUs * 1000.0 * (1.0 + skew)
+            }
+            var noise = random.nextGaussian() * jitterMs * 1e6
+            if (lateProbability > 0 && random.nextDouble() < lateProbability) {
+                noise += -ln(1.0 - random.nextDouble()) * lateMeanMs * 1e6
+            }
+            beaconTimeUs[i] = tb
+            trueReceiverTimeNs[i] = trueNs.toLong()
+            receiverTimeNs[i] = (trueNs + noise).toLong()
+        }
+    }
+}
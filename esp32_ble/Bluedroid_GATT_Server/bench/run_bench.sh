@@ -0,0 +1,90 @@
+#!/bin/sh
+# End-to-end benchmark run (README.md in this folder). Needs ESP-IDF in the environment (idf.py), Linux serial
+# ports, and for the report the Android project's Gradle wrapper; adb is used to pull the app's exports if present.
+#
+#   bench/run_bench.sh capture <profile> <seconds> <port>...   build, flash every beacon, record consoles
+#   bench/run_bench.sh report <run dir> <export.csv.gz>:<channel>...
+#
+# capture writes bench/results/<profile>-<date>/ with one console log per port. Put the analyser export next to
+# them as analyser.csv (time in seconds, one 0/1 column per channel), then run report with each beacon's app
+# export and the analyser channel its marker GPIO is wired to.
+set -eu
+
+here=$(cd "$(dirname "$0")" && pwd)
+project=$(dirname "$here")
+android="$project/../../android_app"
+
+usage() {
+    sed -n '5,6p' "$0" >&2
+    exit 2
+}
+
+capture() {
+    [ $# -ge 3 ] || usage
+    profile=$1; seconds=$2; shift 2
+    defaults="$here/profiles/$profile.defaults"
+    [ -f "$defaults" ] || { echo "no profile $defaults" >&2; exit 2; }
+    run="$here/results/$profile-$(date +%Y%m%d-%H%M%S)"
+    build="$here/build/$profile"
+    mkdir -p "$run"
+    echo "$profile" > "$run/profile"
+
+    cd "$project"
+    idf.py -B "$build" -D SDKCONFIG="$build/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig.defaults;sdkconfig.defaults.bench;$defaults" build
+    n=0
+    for port in "$@"; do
+        idf.py -B "$build" -p "$port" flash
+        echo "beacon $n: $port -> analyser channel $n (suggested)"
+        n=$((n + 1))
+    done
+
+    echo "Start the analyser capture, connect the app and start recording, then press Enter."
+    read -r _
+    n=0
+    for port in "$@"; do
+        stty -F "$port" 115200 raw -echo
+        timeout "$seconds" cat "$port" > "$run/beacon$n.log" &
+        n=$((n + 1))
+    done
+    echo "Recording consoles for $seconds s..."
+    wait || true
+
+    echo "Stop the app recording and export each session as CSV, stop the analyser, then press Enter."
+    read -r _
+    if command -v adb > /dev/null 2>&1; then
+        adb pull /sdcard/Android/data/com.example.ble_sync_suite_app/files/exports "$run/" || true
+    fi
+    echo "Results in $run: add analyser.csv, then"
+    echo "  $0 report $run <export.csv.gz>:<channel>..."
+}
+
+report() {
+    [ $# -ge 2 ] || usage
+    run=$(cd "$1" && pwd); shift
+    profile=$(cat "$run/profile" 2>/dev/null || basename "$run")
+    defaults="$here/profiles/$profile.defaults"
+    # The requested interval; the central may have picked another (the app shows the negotiated one)
+    units=$(sed -n 's/^CONFIG_SENSOR_CONN_INT_MAX=//p' "$defaults" 2>/dev/null)
+    interval=$(awk "BEGIN { print ${units:-6} * 1.25 }")
+
+    args="--profile $profile --conn-interval-ms $interval"
+    [ -f "$run/analyser.csv" ] && args="$args --analyser $run/analyser.csv"
+    for spec in "$@"; do
+        file=${spec%:*}
+        case "$file" in /*) ;; *) file="$PWD/$file" ;; esac
+        args="$args --beacon $file:${spec##*:}"
+    done
+    for log in "$run"/beacon*.log; do
+        [ -f "$log" ] && args="$args --bench-log $log"
+    done
+    (cd "$android" && ./gradlew -q :sync-bench:e2eReport --args="$args") | tee "$run/report.txt"
+}
+
+[ $# -ge 1 ] || usage
+cmd=$1; shift
+case "$cmd" in
+    capture) capture "$@" ;;
+    report) report "$@" ;;
+    *) usage ;;
+esac
@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef ACOUSTIC_EVENTS_H
+#define ACOUSTIC_EVENTS_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#include "sensor_payload.h"
+
+/* Defines */
+#define ACOUSTIC_EVENTS_RING_LEN  16  // power of two; recent events kept for subscribers that fall behind
+
+#define ACOUSTIC_EVENTS_CONFIG_VERSION    0x01
+#define ACOUSTIC_EVENTS_CONFIG_WRITE_LEN  13  // version(1) + k_x10(2) + release_x10(2) + min_level(4) + hold_ms(2) + floor_ms(2)
+#define ACOUSTIC_EVENTS_CONFIG_LEN        21  // write layout + noise_floor(4) + noise_sigma(4)
+
+/* Public function declarations */
+// Start the I2S capture and the detector task (SENSOR_ACOUSTIC_EVENTS). Call once, after nvs_flash_init():
+// the detector starts from the thresholds saved in NVS, or the Kconfig defaults.
+esp_err_t acoustic_events_start(void);
+
+// Block until an event is detected or the timeout passes. Returns true on a new event. One waiter only.
+bool acoustic_events_wait(TickType_t timeout);
+
+// seq the next detected event will get; a subscriber starting now reads from here.
+uint32_t acoustic_events_next_seq(void);
+
+// Copy up to max events with seq >= from_seq into out, oldest first. Events already overwritten in the
+// ring are skipped; the receiver sees the jump in seq. Returns the number copied. Safe from any task.
+size_t acoustic_events_read(uint32_t from_seq, sensor_event_t *out, size_t max);
+
+// Detector characteristic value, little-endian:
+//   [0] version u8 = 0x01  [1] k_x10 u16  [3] release_x10 u16  [5] min_level u32  [9] hold_ms u16  [11] floor_ms u16
+//   [13] noise_floor u32   [17] noise_sigma u32   (envelope, 24-bit |sample| units; read only)
+// Fields as in acoustic_detector_config_t. Returns bytes written (ACOUSTIC_EVENTS_CONFIG_LEN).
+size_t acoustic_events_build_config(uint8_t *buf);
+
+// A client write of the first ACOUSTIC_EVENTS_CONFIG_WRITE_LEN bytes of the layout above (longer writes may
+// echo the read-only tail). The detector task applies it before its next buffer and saves it to NVS.
+// ESP_ERR_INVALID_SIZE for a short value, ESP_ERR_INVALID_ARG for an unknown version or unusable thresholds.
+esp_err_t acoustic_events_set_config(const uint8_t *value, size_t len);
+
+#endif // ACOUSTIC_EVENTS_H
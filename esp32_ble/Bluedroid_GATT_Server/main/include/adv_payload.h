@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef ADV_PAYLOAD_H
+#define ADV_PAYLOAD_H
+
+/* Includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Defines */
+#define ADV_PAYLOAD_MAX_LEN     31  // legacy advertising / scan response PDU payload
+#define ADV_FIELD_HEADER_LEN    2   // length(1) + AD type(1)
+
+// AD types used here (Core Spec Supplement, Part A)
+#define ADV_TYPE_FLAGS          0x01
+#define ADV_TYPE_UUID16_CMPL    0x03
+#define ADV_TYPE_NAME_SHORT     0x08
+#define ADV_TYPE_NAME_CMPL      0x09
+#define ADV_TYPE_CONN_INT_RANGE 0x12
+#define ADV_TYPE_MANUFACTURER   0xFF
+
+/* Public function declarations */
+// Append one AD structure [len = 1 + data_len][type][data] at buf[off].
+// Returns the new offset, or 0 if it does not fit in cap.
+size_t adv_payload_put_field(uint8_t *buf, size_t cap, size_t off, uint8_t type, const void *data, size_t data_len);
+
+// Append the device name: complete if it fits, otherwise shortened to the space left.
+// Returns the new offset, or 0 if not even one character fits.
+size_t adv_payload_put_name(uint8_t *buf, size_t cap, size_t off, const char *name);
+
+#endif // ADV_PAYLOAD_H
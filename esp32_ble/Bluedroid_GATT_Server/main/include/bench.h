@@ -0,0 +1,26 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Includes */
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/* Public function declarations */
+// SENSOR_BENCH: end-to-end benchmark probes. A marker GPIO (SENSOR_BENCH_GPIO) toggles at every capture, so
+// a logic analyser sees one edge per t_us, and every SENSOR_BENCH_REPORT_MS a console line reports
+//   BENCH t_us=<u64> window_ms=<u32> busy_pm=<core0>[,<core1>] captures=<u32> notifies=<u32> att_bytes=<u32>
+// with the CPU time not spent in the idle task (per mille, per core) and the sensor notifications and their
+// ATT bytes (header included) over the window. Call once at startup.
+esp_err_t bench_init(void);
+
+// Right after t_us is read: toggle the marker. IRAM-safe, callable from the sample timer ISR.
+void bench_capture_mark(void);
+
+// A sensor notification of len value bytes was handed to the stack.
+void bench_record_notify(size_t len);
+
+#endif // BENCH_H
@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+/* Defines */
+#define DIAG_PAYLOAD_VERSION   0x04
+#define DIAG_LATENCY_BUCKETS   16  // log2 buckets: [0] < 2 us, [i] = [2^i, 2^(i+1)) us, [15] >= 32768 us
+#define DIAG_ERR_SLOTS         4   // distinct send error codes tracked; later codes count in send_failures only
+#define DIAG_PAYLOAD_LEN       (56 + DIAG_LATENCY_BUCKETS * 4 + DIAG_ERR_SLOTS * 8 + 8 + 4 + 8)  // 172
+
+/* Public types */
+// Wake-up lateness of a periodic task, measured against its vTaskDelayUntil() schedule
+typedef struct {
+    bool       anchored;
+    TickType_t anchor_tick;
+    uint64_t   anchor_us;
+} diag_wake_t;
+
+/* Public function declarations */
+// All counters are cumulative since boot; a client diffs two reads (t_us is in the payload).
+// Safe to call from any task.
+
+// One esp_ble_gatts_send_indicate() call: how long it took and what it returned.
+void diag_record_send(uint32_t latency_us, esp_err_t err);
+
+// Notify scheduler: records dropped from a connection's queue, and records that waited for the link and
+// went out coalesced with a later period's.
+void diag_record_queue(uint32_t dropped, uint32_t coalesced);
+
+// ESP_GATTS_CONGEST_EVT: counts transitions into congestion and accumulates time spent congested.
+void diag_record_congest(bool now_congested);
+
+// How late a periodic task started its work after the moment it was due.
+void diag_record_wake_lateness(uint32_t late_us);
+
+// Call right after vTaskDelayUntil(&last_wake, ...) returns, with the updated last_wake.
+// The first call anchors the schedule; later ones record (diag_record_wake_lateness) how far the
+// wake-up trailed it.
+void diag_task_woke(diag_wake_t *w, TickType_t scheduled_tick);
+
+// Random per-boot ID (never 0), drawn on first use, so a client can tell a reboot from a reconnect.
+uint32_t diag_boot_id(void);
+
+// Diagnostics characteristic value, little-endian. Returns bytes written (DIAG_PAYLOAD_LEN).
+//   [0] version u8 = 0x04   [1] latency bucket count u8   [2] error slot count u8   [3] reserved
+//   [4]  t_us u64 (snapshot time)
+//   [12] send_calls u32     [16] send_failures u32        [20] send_max_us u32
+//   [24] congest_events u32 [28] congested_ms u32
+//   [32] wake_count u32     [36] wake_late_max_us u32     [40] wake_late_sum_us u64
+//   [48] free_heap u32      [52] min_free_heap u32
+//   [56] latency buckets, count x u32
+//   then error slots, count x [err:i32][count:u32] (unused slots are 0/0)
+//   then (version 2) [queue_dropped:u32][queue_coalesced:u32]
+//   then (version 3) [boot_id:u32]
+//   then (version 4) [sleep_clock_ppm:u16][power_flags:u8][reserved:u8][slept_ms:u32]: with light sleep
+//   (SENSOR_LOW_POWER, power.h flags) t_us ran on a clock of that tolerance for slept_ms; all 0 without
+size_t diag_build_payload(uint8_t *buf);
+
+#endif // DIAGNOSTICS_H
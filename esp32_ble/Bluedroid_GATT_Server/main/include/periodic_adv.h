@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef PERIODIC_ADV_H
+#define PERIODIC_ADV_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_gap_ble_api.h"
+
+/* Public function declarations */
+// SENSOR_PERIODIC_ADV: bring up one non-connectable extended advertising set (ext_data, with flags and
+// name; its AUX PDU carries the SyncInfo) and a periodic train on it every interval (1.25 ms units)
+// carrying periodic_data. Steps run one after another from the GAP events fed to periodic_adv_gap_event;
+// both buffers are copied by the stack. Call after Bluedroid is enabled.
+esp_err_t periodic_adv_start(const uint8_t *ext_data, uint16_t ext_len, const uint8_t *periodic_data,
+                             uint16_t periodic_len, uint16_t interval);
+
+// Extended and periodic advertising events, forwarded from the application's GAP callback.
+void periodic_adv_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+// True once the train is running: updates before that would race the setup steps.
+bool periodic_adv_running(void);
+
+// Replace the data of both: the periodic train (deterministic timing, for receivers synced to it) and
+// the extended set (for scanners that cannot sync to a train). Each takes effect at its next event.
+esp_err_t periodic_adv_update(const uint8_t *ext_data, uint16_t ext_len, const uint8_t *periodic_data,
+                              uint16_t periodic_len);
+
+#endif // PERIODIC_ADV_H
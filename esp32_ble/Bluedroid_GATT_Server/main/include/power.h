@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef POWER_H
+#define POWER_H
+
+/* Includes */
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Defines */
+// Diagnostics power flags
+#define POWER_FLAG_LIGHT_SLEEP   0x01  // automatic light sleep configured
+#define POWER_FLAG_SLEEP_COUNTED 0x02  // slept_ms is measured (PM_LIGHT_SLEEP_CALLBACKS)
+
+/* Public function declarations */
+// SENSOR_LOW_POWER: configure esp_pm for frequency scaling and automatic light sleep, and count the
+// time slept. Call once at startup, before the BT controller is enabled.
+esp_err_t power_init(void);
+
+// POWER_FLAG_* of the running configuration; 0 before power_init() succeeds.
+uint8_t power_flags(void);
+
+// Time spent in light sleep since boot (ms, wraps after ~49 days); 0 unless POWER_FLAG_SLEEP_COUNTED.
+// esp_timer ran on the sleep clock (SENSOR_SLEEP_CLOCK_PPM) for that long.
+uint32_t power_slept_ms(void);
+
+#endif // POWER_H
@@ -0,0 +1,23 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef SYNC_RECEIVER_H
+#define SYNC_RECEIVER_H
+
+/* Includes */
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Public function declarations */
+// SENSOR_RECEIVER hub: register the GAP and GATTC callbacks (instead of the GATT server's) and start
+// scanning. Every beacon advertising the sensor service is connected, up to SENSOR_RECEIVER_MAX_BEACONS,
+// and subscribed to its sensor characteristic; each notification is stamped with esp_timer_get_time() on
+// arrival and fitted on-device (cheepsync, lower envelope). Call once Bluedroid is enabled.
+esp_err_t sync_receiver_start(uint16_t local_mtu);
+
+// Logs every beacon's fit each SENSOR_RECEIVER_REPORT_MS: skew, RMS residual, and its clock against
+// the first beacon's at the same hub instant. Run as a low-priority task.
+void sync_receiver_report_task(void *param);
+
+#endif // SYNC_RECEIVER_H
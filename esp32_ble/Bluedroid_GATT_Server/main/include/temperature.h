@@ -0,0 +1,25 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef TEMPERATURE_H
+#define TEMPERATURE_H
+
+/* Includes */
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Defines */
+#define TEMPERATURE_UNKNOWN INT16_MIN  // no reading yet (or the sensor failed), in centi-degrees C
+
+/* Public function declarations */
+// SENSOR_TEMPERATURE: install and enable the on-chip temperature sensor. Call once at startup.
+esp_err_t temperature_init(void);
+
+// Reads the sensor every SENSOR_TEMPERATURE_PERIOD_MS. Run as a low-priority task after temperature_init().
+void temperature_task(void *param);
+
+// Latest die temperature in centi-degrees C, or TEMPERATURE_UNKNOWN. Safe from any task.
+int16_t temperature_latest_cdeg(void);
+
+#endif // TEMPERATURE_H
@@ -0,0 +1,35 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef TIME_DIST_H
+#define TIME_DIST_H
+
+/* Includes */
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_gap_ble_api.h"
+
+/* Public types */
+// What a beacon advertises in its root-time payload for one local instant
+typedef struct {
+    uint64_t t_us;    // root time
+    uint8_t  hop;     // 0 at the root, SENSOR_ROOT_TIME_HOP_UNSYNCED without a parent
+    uint16_t err_us;  // error estimate accumulated from the root
+} time_dist_stamp_t;
+
+/* Public function declarations */
+// Root time for local esp_timer time local_us. The root reports its own clock at hop 0; a relay converts
+// through the fit to its parent, or reports itself unsynced (its own clock) while it has none.
+void time_dist_stamp(uint64_t local_us, time_dist_stamp_t *out);
+
+#if CONFIG_SENSOR_TIME_ROLE_RELAY
+// Start the passive scan for parents, next to the broadcast advertising. Call once Bluedroid is enabled.
+esp_err_t time_dist_start(void);
+
+// Scan events, forwarded from the application's GAP callback (Bluedroid has one per application).
+void time_dist_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+#endif
+
+#endif // TIME_DIST_H
@@ -4,14 +4,73 @@
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  *
  * Minimal ESP-IDF BLE GATT server:
- * - Advertises
- * - Exposes 1 service (0x181A) with 1 NOTIFY characteristic (128-bit UUID) + CCCD
- * - Sends notifications at a fixed rate: once per second (SENSOR_PERIOD_MS = 1000)
- *   payload (12 bytes, little-endian):
+ * - Advertises (structured esp_ble_adv_data_t, or precomputed raw bytes with EXAMPLE_SET_RAW_ADV_DATA)
+ *   with the service UUID, so scanners can filter on it
+ * - Exposes 1 service (0x181A) with 1 NOTIFY characteristic (128-bit UUID) + CCCD, and a
+ *   READ/NOTIFY connection-parameter characteristic + CCCD:
+ *     [0..1] = interval (1.25 ms units), [2..3] = latency, [4..5] = timeout (10 ms units)
+ * - Round-trip characteristic (WRITE/WRITE_NR/NOTIFY) + CCCD: the client writes 8 bytes (its send time),
+ *   the ESP32 notifies [0..7] = echo, [8..15] = rx_us, [16..19] = turnaround_us (NTP-style exchange)
+ * - Diagnostics characteristic (READ): send_indicate latency histogram and error counts, congestion,
+ *   notify-task wake-up lateness and free heap, cumulative since boot (layout in diagnostics.h)
+ * - Capabilities characteristic (READ/WRITE), little-endian:
+ *     [0] = caps version (0x01), [1] = this connection's sensor format (payload version, 0x00 = legacy),
+ *     [2] = record length (12), [3] = batch size, [4] = queue length, [5] = timestamp unit (0x00 = us since boot),
+ *     [6..7] = selectable formats (bit per payload version), [8..9] = feature flags, [10..13] = period_us
+ *   A client writes one payload version to switch its connection to that format (legacy, batch and delta always;
+ *   timed and thermal in builds that have them); the Kconfig format below is only the default
+ * - SENSOR_ACOUSTIC_EVENTS: event characteristic (READ/NOTIFY) + CCCD; acoustic onsets from an INMP441
+ *   (blink/components/acoustic) stamped in esp_timer time, little-endian:
+ *     [0] = version (0x04), [1] = count N, then N x [event_seq u32][t_us u64][peak u32][flags u8]
+ *   and a detector characteristic (READ/WRITE): adaptive onset thresholds, tunable at run time and kept
+ *   in NVS, plus the live noise floor (layout in acoustic_events.h)
+ * - SENSOR_ADAPTIVE_RATE: rate-control characteristic (WRITE/WRITE_NR): each central writes its fit quality,
+ *     [0..3] = rms_us (uint32), [4..5] = samples (uint16)
+ *   and the sample period stretches by SENSOR_RATE_MAINTENANCE_DIV while every subscribed central's fit is stable
+ * - Up to SENSOR_MAX_CONNECTIONS centrals at once, each with its own CCCD state, MTU and seq counter;
+ *   advertising continues while a connection slot is free
+ * - SENSOR_CONN_PARAMS_UPDATE: requests a short connection interval on connect
+ * - Samples t_us every SENSOR_PERIOD_MS (Kconfig, default 1000 ms) and notifies every subscribed central;
+ *   SENSOR_TIMING_ESP_TIMER samples from a periodic esp_timer instead (SENSOR_TIMER_PERIOD_US, sub-ms possible)
+ *   legacy payload (12 bytes, little-endian):
  *     [0..3]  = seq (uint32)
  *     [4..11] = t_us (uint64) microseconds since boot
+ *   batched payload (SENSOR_PAYLOAD_FORMAT_BATCH), little-endian:
+ *     [0] = version (0x01), [1] = count N, then N x 12-byte records as above
+ *   delta payload (SENSOR_PAYLOAD_FORMAT_DELTA), little-endian:
+ *     [0] = version (0x05), [1] = count N, [2..5] = period_us (uint32), [6..17] = first record,
+ *     then N - 1 zigzag varints: each record's interval minus period_us (seq + 1 each)
+ *   thermal payload (SENSOR_TEMPERATURE, legacy or batch format), little-endian:
+ *     [0] = version (0x07), [1] = count N, [2..3] = die temperature (int16, centi-degrees C), then N records
+ *   Other formats also fall back to the batched payload to deliver a backlog after congestion
+ *   timed payload (SENSOR_PAYLOAD_FORMAT_TIMED), little-endian:
+ *     [0] = version (0x02), [1] = flags, [2..13] = record, [14..17] = prev_seq,
+ *     [18..21] = prev_delay_us (capture -> ESP_GATTS_CONF_EVT of prev_seq)
+ * - SENSOR_BROADCAST: instead of notifying, advertises non-connectable with manufacturer data
+ *   (company 0xFFFF) [0] = version (0x03), [1..12] = record, refreshed every SENSOR_PERIOD_MS
+ * - SENSOR_PERIODIC_ADV (broadcast, BLE 5 targets, sdkconfig.defaults.periodic): the same manufacturer data
+ *   rides a periodic advertising train at a fixed SENSOR_PERIOD_MS interval (periodic_adv.c), announced by
+ *   a non-connectable extended set that mirrors it for scanners that do not sync to the train
+ * - SENSOR_TIME_ROLE (broadcast only): hierarchical time distribution (time_dist.c). The root advertises
+ *   its own clock, relays fit the closest parent they hear and advertise root time converted through it:
+ *     [0] = version (0x06), [1] = hop (0xFF = unsynced), [2..13] = record in root time, [14..15] = err_us
+ * - SENSOR_RECEIVER: runs as a GATT client sync node instead (sync_receiver.c): connects to up to
+ *   SENSOR_RECEIVER_MAX_BEACONS sensor beacons, fits each one's t_us against this board's esp_timer
+ *   and logs the fits and inter-beacon offsets; the GATT server is not started
+ * - SENSOR_LOW_POWER (PM_ENABLE + tickless idle, sdkconfig.defaults.lowpower): automatic light sleep with BLE
+ *   modem sleep between samples (power.c); diagnostics report the sleep clock's tolerance and the time slept
+ * - SENSOR_BENCH (bench/): a marker GPIO toggles at every capture for a logic analyser, and a BENCH console
+ *   line reports CPU load and notify traffic per window (bench.c)
+ * - SENSOR_READ_AUTO_RSP (single connection): sensor characteristic reads are answered by the stack
+ *   (ESP_GATT_AUTO_RSP) from the newest payload sent, handed to it as sent, with no GATTS callback work;
+ *   otherwise each read returns the payload last sent to the reading connection
+ * - SENSOR_GATT_ATTR_TABLE: the service comes up from one static attribute table (esp_ble_gatts_create_attr_tab)
+ *   instead of the chain of ADD_CHAR / ADD_CHAR_DESCR events, with the same handles
  * - RGB LED (WS2812 via led_strip) "pulses" GREEN on each successful send:
- *     ON for LED_PULSE_MS (250 ms), then OFF.
+ *     ON for LED_PULSE_MS (250 ms), then OFF. Driven by a low-priority LED task fed by a
+ *     queue, so the notify loop and GATT callbacks never wait on the LED.
+ * - Task topology (Kconfig "Task topology"): sampling task and LED worker are pinned by core and priority;
+ *   by default the sampling task has core 1 to itself, the BT stack and LED share core 0
  */
 
 #include <stdio.h>
@@ -20,8 +79,10 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 
 #include "esp_system.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "nvs_flash.h"
@@ -35,11 +96,128 @@
 #include "esp_gatt_common_api.h"
 
 #include "led_strip.h"
+#include "sensor_payload.h"
+#include "sensor_sched.h"
+#include "diagnostics.h"
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+#include "acoustic_events.h"
+#endif
+#if CONFIG_SENSOR_RECEIVER
+#include "sync_receiver.h"
+#endif
+#if CONFIG_SENSOR_TIME_DIST
+#include "time_dist.h"
+#endif
+#if CONFIG_SENSOR_PERIODIC_ADV
+#include "periodic_adv.h"
+#endif
+#if CONFIG_SENSOR_LOW_POWER
+#include "power.h"
+#endif
+#if CONFIG_SENSOR_TEMPERATURE
+#include "temperature.h"
+#endif
+#if CONFIG_SENSOR_BENCH
+#include "bench.h"
+#endif
+#if CONFIG_EXAMPLE_SET_RAW_ADV_DATA
+#include "adv_payload.h"
+#endif
+
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED && !CONFIG_BT_BLE_42_FEATURES_SUPPORTED && !CONFIG_SENSOR_PERIODIC_ADV
+#error "Legacy advertising needs BT_BLE_42_FEATURES_SUPPORTED; only SENSOR_PERIODIC_ADV runs on BLE 5.0 features alone"
+#endif
 
 // -------------------- Tunables --------------------
-#define SENSOR_PERIOD_MS   1000  // once per second
+#define SENSOR_PERIOD_MS   CONFIG_SENSOR_PERIOD_MS
+#if CONFIG_SENSOR_TIMING_ESP_TIMER
+#define SENSOR_NOMINAL_PERIOD_US CONFIG_SENSOR_TIMER_PERIOD_US  // delta payload reference interval
+#else
+#define SENSOR_NOMINAL_PERIOD_US (SENSOR_PERIOD_MS * 1000)
+#endif
 #define LED_PULSE_MS       250   // LED on for 250ms after send
-#define SENSOR_PAYLOAD_LEN 12    // seq(4) + t_us(8)
+#define LED_QUEUE_LEN      4
+#define LED_TASK_PRIO      CONFIG_SENSOR_LED_TASK_PRIO
+#define LED_TASK_CORE      CONFIG_SENSOR_LED_TASK_CORE
+#define SENSOR_TASK_PRIO   CONFIG_SENSOR_TASK_PRIO
+#define SENSOR_TASK_CORE   CONFIG_SENSOR_TASK_CORE
+#define EVENT_TASK_PRIO    (LED_TASK_PRIO + 1)  // delivery only: the detector has already stamped the events
+#define EVENT_TASK_CORE    LED_TASK_CORE
+#define TEMP_TASK_PRIO     LED_TASK_PRIO
+#define TEMP_TASK_CORE     LED_TASK_CORE
+
+// With SENSOR_TEMPERATURE the legacy and batch formats go out as thermal payloads: batched plus the temperature
+#if CONFIG_SENSOR_TEMPERATURE
+#define SENSOR_BATCHED_HEADER_LEN SENSOR_THERMAL_HEADER_LEN
+#else
+#define SENSOR_BATCHED_HEADER_LEN SENSOR_BATCH_HEADER_LEN
+#endif
+
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_BATCH
+#define SENSOR_BATCH_SIZE      CONFIG_SENSOR_BATCH_SIZE
+#define SENSOR_FORMAT_LEN      (SENSOR_BATCHED_HEADER_LEN + SENSOR_BATCH_SIZE * SENSOR_RECORD_LEN)
+#elif CONFIG_SENSOR_PAYLOAD_FORMAT_DELTA
+#define SENSOR_BATCH_SIZE      CONFIG_SENSOR_BATCH_SIZE
+#define SENSOR_FORMAT_LEN      (SENSOR_DELTA_HEADER_LEN + (SENSOR_BATCH_SIZE - 1) * SENSOR_DELTA_MAX_VARINT)
+#elif CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+#define SENSOR_BATCH_SIZE      1
+#define SENSOR_FORMAT_LEN      SENSOR_TIMED_PAYLOAD_LEN
+#elif CONFIG_SENSOR_TEMPERATURE
+#define SENSOR_BATCH_SIZE      1
+#define SENSOR_FORMAT_LEN      (SENSOR_THERMAL_HEADER_LEN + SENSOR_RECORD_LEN)
+#else
+#define SENSOR_BATCH_SIZE      1
+#define SENSOR_FORMAT_LEN      SENSOR_LEGACY_PAYLOAD_LEN
+#endif
+
+// Pending records per connection (at least one batch); a backlog goes out as one batched payload
+#define SENSOR_QUEUE_LEN       (CONFIG_SENSOR_NOTIFY_QUEUE_LEN > SENSOR_BATCH_SIZE ? \
+                                CONFIG_SENSOR_NOTIFY_QUEUE_LEN : SENSOR_BATCH_SIZE)
+#define SENSOR_COALESCED_LEN   (SENSOR_BATCHED_HEADER_LEN + SENSOR_QUEUE_LEN * SENSOR_RECORD_LEN)
+#define SENSOR_PAYLOAD_MAX_LEN (SENSOR_COALESCED_LEN > SENSOR_FORMAT_LEN ? SENSOR_COALESCED_LEN : SENSOR_FORMAT_LEN)
+
+// Sensor format per connection: the Kconfig one until the client selects another on the capabilities
+// characteristic. Legacy, batch and delta are always built in; timed and thermal need their Kconfig state.
+// Single-record formats coalesce a backlog into SENSOR_COALESCED_FORMAT.
+#if CONFIG_SENSOR_TEMPERATURE
+#define SENSOR_COALESCED_FORMAT SENSOR_PAYLOAD_VERSION_THERMAL
+#else
+#define SENSOR_COALESCED_FORMAT SENSOR_PAYLOAD_VERSION_BATCH
+#endif
+
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_DELTA
+#define SENSOR_DEFAULT_FORMAT  SENSOR_PAYLOAD_VERSION_DELTA
+#elif CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+#define SENSOR_DEFAULT_FORMAT  SENSOR_PAYLOAD_VERSION_TIMED
+#elif CONFIG_SENSOR_PAYLOAD_FORMAT_BATCH || CONFIG_SENSOR_TEMPERATURE
+#define SENSOR_DEFAULT_FORMAT  SENSOR_COALESCED_FORMAT
+#else
+#define SENSOR_DEFAULT_FORMAT  SENSOR_PAYLOAD_VERSION_LEGACY
+#endif
+
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+#define SENSOR_FORMATS_TIMED   SENSOR_CAPS_FORMAT_BIT(SENSOR_PAYLOAD_VERSION_TIMED)
+#else
+#define SENSOR_FORMATS_TIMED   0
+#endif
+#if CONFIG_SENSOR_TEMPERATURE
+#define SENSOR_FORMATS_THERMAL SENSOR_CAPS_FORMAT_BIT(SENSOR_PAYLOAD_VERSION_THERMAL)
+#else
+#define SENSOR_FORMATS_THERMAL 0
+#endif
+#define SENSOR_FORMATS         (SENSOR_CAPS_FORMAT_BIT(SENSOR_PAYLOAD_VERSION_LEGACY) | \
+                                SENSOR_CAPS_FORMAT_BIT(SENSOR_PAYLOAD_VERSION_BATCH) | \
+                                SENSOR_CAPS_FORMAT_BIT(SENSOR_PAYLOAD_VERSION_DELTA) | \
+                                SENSOR_FORMATS_TIMED | SENSOR_FORMATS_THERMAL)
+
+// Notifications per connection handed to the stack but not yet reported by ESP_GATTS_CONF_EVT
+#define NOTIFY_MAX_INFLIGHT    CONFIG_SENSOR_NOTIFY_MAX_INFLIGHT
+#define NOTIFY_CONF_TIMEOUT_US (1000 * 1000)  // no CONF for this long: release the credits
+
+#define MAX_CONNECTIONS    CONFIG_SENSOR_MAX_CONNECTIONS
+
+#define LOCAL_MTU          500
+#define DEFAULT_ATT_MTU    23
 
 // -------------------- RGB LED (WS2812) --------------------
 #define LED_GPIO   2
@@ -47,6 +225,13 @@
 
 static led_strip_handle_t strip = NULL;
 
+typedef enum {
+    LED_CMD_PULSE,  // green for LED_PULSE_MS, then off
+    LED_CMD_OFF,
+} led_cmd_t;
+
+static QueueHandle_t led_queue = NULL;
+
 // -------------------- UUIDs --------------------
 #define SENSOR_SVC_UUID 0x181A  // Environmental Sensing (convenient 16-bit service UUID)
 
@@ -57,7 +242,56 @@ static const uint8_t sensor_chr_uuid128[16] = {
     0xDE, 0xEF, 0x12, 0x12, 0xA1, 0xA1, 0x15, 0x00
 };
 
-#define SENSOR_NUM_HANDLE 6
+// Connection-parameter characteristic: 0015a1a2-1212-efde-1523-785feabcd123
+static const uint8_t conn_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA2, 0xA1, 0x15, 0x00
+};
+
+// Round-trip characteristic: 0015a1a3-1212-efde-1523-785feabcd123
+static const uint8_t rtt_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA3, 0xA1, 0x15, 0x00
+};
+
+// Diagnostics characteristic: 0015a1a4-1212-efde-1523-785feabcd123
+static const uint8_t diag_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA4, 0xA1, 0x15, 0x00
+};
+
+// Capabilities characteristic: 0015a1a8-1212-efde-1523-785feabcd123
+static const uint8_t caps_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA8, 0xA1, 0x15, 0x00
+};
+
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+// Acoustic event characteristic: 0015a1a5-1212-efde-1523-785feabcd123
+static const uint8_t event_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA5, 0xA1, 0x15, 0x00
+};
+
+// Detector configuration characteristic: 0015a1a6-1212-efde-1523-785feabcd123
+static const uint8_t detector_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA6, 0xA1, 0x15, 0x00
+};
+#endif
+
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+// Rate-control characteristic: 0015a1a7-1212-efde-1523-785feabcd123
+static const uint8_t rate_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA7, 0xA1, 0x15, 0x00
+};
+#endif
+
+// service + 4 x (char decl + value + CCCD) + diag, capabilities, detector and rate control (decl + value) + spare
+#define SENSOR_NUM_HANDLE 23
+
+#define DEVICE_NAME "ESP32"
 
 // Advertising config flags
 #define ADV_CONFIG_FLAG      (1 << 0)
@@ -69,24 +303,540 @@ static const char *TAG = "BLE_SENSOR_RGB";
 static uint8_t adv_config_done = 0;
 
 static bool sensor_ready = false;
-static bool notify_enabled = false;
 
 static esp_gatt_if_t g_gatts_if = ESP_GATT_IF_NONE;
-static uint16_t g_conn_id = 0xFFFF;
 
 static uint16_t g_service_handle = 0;
 static uint16_t g_char_handle = 0;
 static uint16_t g_cccd_handle = 0;
+static uint16_t g_conn_char_handle = 0;
+static uint16_t g_conn_cccd_handle = 0;
+static uint16_t g_rtt_char_handle = 0;
+static uint16_t g_rtt_cccd_handle = 0;
+static uint16_t g_diag_char_handle = 0;
+static uint16_t g_caps_char_handle = 0;
+static uint16_t g_event_char_handle = 0;
+static uint16_t g_event_cccd_handle = 0;
+static uint16_t g_detector_char_handle = 0;
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+static uint16_t g_rate_char_handle = 0;
+#endif
+
+// Initial value only: reads are answered per connection from peer_t.conn_value
+static uint8_t conn_value_none[SENSOR_CONN_PARAMS_LEN] = {0};
+
+static esp_attr_value_t conn_attr = {
+    .attr_max_len = SENSOR_CONN_PARAMS_LEN,
+    .attr_len     = SENSOR_CONN_PARAMS_LEN,
+    .attr_value   = conn_value_none,
+};
+
+// Last round-trip response (also returned on READ)
+static uint8_t rtt_value[SENSOR_RTT_RESPONSE_LEN] = {0};
+
+static esp_attr_value_t rtt_attr = {
+    .attr_max_len = SENSOR_RTT_RESPONSE_LEN,
+    .attr_len     = SENSOR_RTT_RESPONSE_LEN,
+    .attr_value   = rtt_value,
+};
+
+// Initial value only: reads are answered per connection from peer_t.diag_value
+static uint8_t diag_value[DIAG_PAYLOAD_LEN] = {0};
+
+static esp_attr_value_t diag_attr = {
+    .attr_max_len = DIAG_PAYLOAD_LEN,
+    .attr_len     = DIAG_PAYLOAD_LEN,
+    .attr_value   = diag_value,
+};
+
+// Initial value only: reads are answered per connection, with the format it currently receives
+static uint8_t caps_value[SENSOR_CAPS_LEN] = {0};
+
+static esp_attr_value_t caps_attr = {
+    .attr_max_len = SENSOR_CAPS_LEN,
+    .attr_len     = SENSOR_CAPS_LEN,
+    .attr_value   = caps_value,
+};
+
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+// Last event notification (also returned on READ); room for the whole ring in one payload. The event task
+// builds into event_build and publishes value and length together under event_mux, where READ_EVT copies them.
+#define EVENT_PAYLOAD_MAX_LEN (SENSOR_BATCH_HEADER_LEN + ACOUSTIC_EVENTS_RING_LEN * SENSOR_EVENT_RECORD_LEN)
+
+static uint8_t event_value[EVENT_PAYLOAD_MAX_LEN] = {SENSOR_PAYLOAD_VERSION_EVENTS, 0};
+static uint16_t event_value_len = SENSOR_BATCH_HEADER_LEN;
+static uint8_t event_build[EVENT_PAYLOAD_MAX_LEN];  // event task only
+static portMUX_TYPE event_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_attr_value_t event_attr = {
+    .attr_max_len = EVENT_PAYLOAD_MAX_LEN,
+    .attr_len     = SENSOR_BATCH_HEADER_LEN,
+    .attr_value   = event_value,
+};
+
+// Initial value only: reads are answered from the detector's current state
+static uint8_t detector_value[ACOUSTIC_EVENTS_CONFIG_LEN] = {0};
+
+static esp_attr_value_t detector_attr = {
+    .attr_max_len = ACOUSTIC_EVENTS_CONFIG_LEN,
+    .attr_len     = ACOUSTIC_EVENTS_CONFIG_LEN,
+    .attr_value   = detector_value,
+};
+#endif
+
+// Initial value only: reads are answered per connection from the payload it was last sent (peer_t slots), or
+// by the stack from its own copy with SENSOR_READ_AUTO_RSP
+static uint8_t sensor_value_none[SENSOR_FORMAT_LEN] = {0};
+
+// SENSOR_READ_AUTO_RSP (single connection): the stack answers sensor reads from the copy the notify task
+// sets with each payload sent
+#if CONFIG_SENSOR_READ_AUTO_RSP
+#if CONFIG_SENSOR_MAX_CONNECTIONS != 1
+#error "SENSOR_READ_AUTO_RSP: the stack keeps one value for all connections"
+#endif
+#define SENSOR_VALUE_RSP ESP_GATT_AUTO_RSP
+#else
+#define SENSOR_VALUE_RSP ESP_GATT_RSP_BY_APP
+#endif
 
-static uint8_t sensor_value[SENSOR_PAYLOAD_LEN] = {0};
+static esp_attr_control_t sensor_attr_control = {
+    .auto_rsp = SENSOR_VALUE_RSP,
+};
 
 static esp_attr_value_t sensor_attr = {
-    .attr_max_len = SENSOR_PAYLOAD_LEN,
-    .attr_len     = SENSOR_PAYLOAD_LEN,
-    .attr_value   = sensor_value,
+    .attr_max_len = SENSOR_PAYLOAD_MAX_LEN,
+    .attr_len     = SENSOR_FORMAT_LEN,
+    .attr_value   = sensor_value_none,
+};
+
+#if CONFIG_SENSOR_GATT_ATTR_TABLE
+// -------------------- Attribute table --------------------
+// The service in one esp_ble_gatts_create_attr_tab() call, in the order the step-by-step chain below adds it,
+// so clients get the same handles in both modes. Values and CCCDs are answered by the app, as in the chain
+// (the sensor value by the stack with SENSOR_READ_AUTO_RSP); the stack answers the declarations.
+enum {
+    SENSOR_IDX_SVC,
+    SENSOR_IDX_SENSOR_CHAR,
+    SENSOR_IDX_SENSOR_VAL,
+    SENSOR_IDX_SENSOR_CCCD,
+    SENSOR_IDX_CONN_CHAR,
+    SENSOR_IDX_CONN_VAL,
+    SENSOR_IDX_CONN_CCCD,
+    SENSOR_IDX_RTT_CHAR,
+    SENSOR_IDX_RTT_VAL,
+    SENSOR_IDX_RTT_CCCD,
+    SENSOR_IDX_DIAG_CHAR,
+    SENSOR_IDX_DIAG_VAL,
+    SENSOR_IDX_CAPS_CHAR,
+    SENSOR_IDX_CAPS_VAL,
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+    SENSOR_IDX_RATE_CHAR,
+    SENSOR_IDX_RATE_VAL,
+#endif
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+    SENSOR_IDX_EVENT_CHAR,
+    SENSOR_IDX_EVENT_VAL,
+    SENSOR_IDX_EVENT_CCCD,
+    SENSOR_IDX_DETECTOR_CHAR,
+    SENSOR_IDX_DETECTOR_VAL,
+#endif
+    SENSOR_IDX_NB,
 };
 
+static const uint16_t primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t char_declare_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t cccd_uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint16_t sensor_svc_uuid = SENSOR_SVC_UUID;
+
+static const uint8_t prop_read = ESP_GATT_CHAR_PROP_BIT_READ;
+static const uint8_t prop_read_notify = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t prop_read_write = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+static const uint8_t prop_rtt = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE |
+                                ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+static const uint8_t prop_write = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+#endif
+static const uint8_t cccd_off[SENSOR_CCCD_LEN] = {0};
+
+#define ATTR_CHAR(prop) \
+    {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&char_declare_uuid, ESP_GATT_PERM_READ, \
+                           sizeof(uint8_t), sizeof(uint8_t), (uint8_t *)&(prop)}}
+#define ATTR_VALUE(uuid128, perm, max_len, len, value) \
+    {{ESP_GATT_RSP_BY_APP}, {ESP_UUID_LEN_128, (uint8_t *)(uuid128), (perm), (max_len), (len), (uint8_t *)(value)}}
+#define ATTR_CCCD \
+    {{ESP_GATT_RSP_BY_APP}, {ESP_UUID_LEN_16, (uint8_t *)&cccd_uuid16, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, \
+                             SENSOR_CCCD_LEN, SENSOR_CCCD_LEN, (uint8_t *)cccd_off}}
+
+static const esp_gatts_attr_db_t sensor_gatt_db[SENSOR_IDX_NB] = {
+    [SENSOR_IDX_SVC] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid, ESP_GATT_PERM_READ,
+                                              sizeof(uint16_t), sizeof(sensor_svc_uuid), (uint8_t *)&sensor_svc_uuid}},
+
+    [SENSOR_IDX_SENSOR_CHAR] = ATTR_CHAR(prop_read_notify),
+    [SENSOR_IDX_SENSOR_VAL]  = {{SENSOR_VALUE_RSP}, {ESP_UUID_LEN_128, (uint8_t *)sensor_chr_uuid128, ESP_GATT_PERM_READ,
+                                                      SENSOR_PAYLOAD_MAX_LEN, SENSOR_FORMAT_LEN, sensor_value_none}},
+    [SENSOR_IDX_SENSOR_CCCD] = ATTR_CCCD,
+
+    [SENSOR_IDX_CONN_CHAR] = ATTR_CHAR(prop_read_notify),
+    [SENSOR_IDX_CONN_VAL]  = ATTR_VALUE(conn_chr_uuid128, ESP_GATT_PERM_READ,
+                                        SENSOR_CONN_PARAMS_LEN, SENSOR_CONN_PARAMS_LEN, conn_value_none),
+    [SENSOR_IDX_CONN_CCCD] = ATTR_CCCD,
+
+    [SENSOR_IDX_RTT_CHAR] = ATTR_CHAR(prop_rtt),
+    [SENSOR_IDX_RTT_VAL]  = ATTR_VALUE(rtt_chr_uuid128, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                       SENSOR_RTT_RESPONSE_LEN, SENSOR_RTT_RESPONSE_LEN, rtt_value),
+    [SENSOR_IDX_RTT_CCCD] = ATTR_CCCD,
+
+    [SENSOR_IDX_DIAG_CHAR] = ATTR_CHAR(prop_read),
+    [SENSOR_IDX_DIAG_VAL]  = ATTR_VALUE(diag_chr_uuid128, ESP_GATT_PERM_READ,
+                                        DIAG_PAYLOAD_LEN, DIAG_PAYLOAD_LEN, diag_value),
+
+    [SENSOR_IDX_CAPS_CHAR] = ATTR_CHAR(prop_read_write),
+    [SENSOR_IDX_CAPS_VAL]  = ATTR_VALUE(caps_chr_uuid128, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                        SENSOR_CAPS_LEN, SENSOR_CAPS_LEN, caps_value),
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+
+    [SENSOR_IDX_RATE_CHAR] = ATTR_CHAR(prop_write),
+    [SENSOR_IDX_RATE_VAL]  = ATTR_VALUE(rate_chr_uuid128, ESP_GATT_PERM_WRITE, 0, 0, NULL),
+#endif
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+
+    [SENSOR_IDX_EVENT_CHAR] = ATTR_CHAR(prop_read_notify),
+    [SENSOR_IDX_EVENT_VAL]  = ATTR_VALUE(event_chr_uuid128, ESP_GATT_PERM_READ,
+                                         EVENT_PAYLOAD_MAX_LEN, SENSOR_BATCH_HEADER_LEN, event_value),
+    [SENSOR_IDX_EVENT_CCCD] = ATTR_CCCD,
+
+    [SENSOR_IDX_DETECTOR_CHAR] = ATTR_CHAR(prop_read_write),
+    [SENSOR_IDX_DETECTOR_VAL]  = ATTR_VALUE(detector_chr_uuid128, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                            ACOUSTIC_EVENTS_CONFIG_LEN, ACOUSTIC_EVENTS_CONFIG_LEN, detector_value),
+#endif
+};
+#endif
+
+// -------------------- Connections --------------------
+// One slot per connected central. Slots are claimed and released on the Bluedroid callback task, which
+// also owns the CCCD flags and conn_value; fields the notify task reads are written under peer_mux.
+typedef struct {
+    bool     in_use;
+    uint16_t conn_id;
+    esp_bd_addr_t bda;
+    uint16_t mtu;
+    bool     notify_enabled;        // sensor CCCD
+    bool     conn_notify_enabled;
+    bool     rtt_notify_enabled;
+    bool     event_notify_enabled;  // event CCCD
+    bool     congested;             // ESP_GATTS_CONGEST_EVT: records queue up until it clears
+    uint8_t  inflight;              // sensor notifications sent, CONF_EVT not yet seen
+    uint64_t conf_progress_us;      // last CONF_EVT (or first send with none in flight)
+    uint32_t epoch;                 // bumped on connect, so the notify task restarts seq and queue
+    uint8_t  conn_value[SENSOR_CONN_PARAMS_LEN];  // last negotiated parameters (UPDATE_CONN_PARAMS_EVT)
+    uint8_t  diag_value[DIAG_PAYLOAD_LEN];  // snapshot of its last offset-0 diagnostics read, for the blob reads after it
+    uint8_t  format;                // sensor payload version it receives (SENSOR_FORMATS)
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+    bool     rate_stable;           // its fit is settled: maintenance rate is enough
+    uint64_t rate_feedback_us;      // last rate-control write
+#endif
+
+    // Notify task only
+    uint32_t seen_epoch;
+    sensor_queue_t queue;           // over records, seq restarted per connection
+    sensor_record_t records[SENSOR_QUEUE_LEN];
+
+#if !CONFIG_SENSOR_READ_AUTO_RSP
+    // Sensor payloads sent to it, for its reads (sensor_slot_*): written by the notify task only
+    uint8_t  slots[2][SENSOR_PAYLOAD_MAX_LEN];
+    uint16_t slot_len[2];
+    uint32_t slot_epoch[2];         // epoch of the connection the payload was sent to
+    uint32_t published;             // atomics: the slot reads use is published & 1
+    uint32_t building;
+#endif
+
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+    // Event notify task only
+    uint32_t event_seen_epoch;
+    uint32_t event_next_seq;        // first event this connection has not been sent yet
+#endif
+
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+    // Send-delay capture, under peer_mux: the notify task arms it before each send, ESP_GATTS_CONF_EVT
+    // completes it, and the next payload reports the result for the previous seq.
+    bool     tx_pending;            // waiting for CONF of tx_seq
+    uint32_t tx_seq;
+    uint64_t tx_t_us;               // capture time of tx_seq
+    uint32_t tx_delay_us;
+    uint8_t  tx_flags;              // SENSOR_TIMED_FLAG_*; 0 = nothing to report
+#endif
+} peer_t;
+
+static peer_t peers[MAX_CONNECTIONS];
+static portMUX_TYPE peer_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t peer_count = 0;      // callback task only
+
+#if CONFIG_SENSOR_READ_AUTO_RSP
+// The stack's attribute value is the only copy reads see: payloads are built here (notify task only) and
+// handed to it once sent
+static uint8_t sensor_build[SENSOR_PAYLOAD_MAX_LEN];
+#else
+// Payload slots: the notify task builds each payload once, into the slot of the peer readers are not using,
+// and publishes it by advancing published. building is advanced before a slot is rewritten, so a reader that
+// raced the writer sees it and copies again.
+
+// Notify task: the slot to build p's next payload in
+static inline uint8_t *sensor_slot_begin(peer_t *p)
+{
+    uint32_t next = p->published + 1;
+    __atomic_store_n(&p->building, next, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // announced before the slot's old contents are overwritten
+    return p->slots[next & 1];
+}
+
+// Notify task: the slot from sensor_slot_begin() holds a payload of len bytes sent on connection epoch
+static inline void sensor_slot_publish(peer_t *p, uint16_t len, uint32_t epoch)
+{
+    uint32_t next = p->published + 1;
+    p->slot_len[next & 1] = len;
+    p->slot_epoch[next & 1] = epoch;
+    __atomic_store_n(&p->published, next, __ATOMIC_RELEASE);
+}
+
+// Callback task: copy the latest payload sent to this connection (the initial value before the first one, or
+// from a new connection in the slot); returns its length
+static uint16_t sensor_slot_read(const peer_t *p, uint8_t *out)
+{
+    uint32_t seq;
+    uint16_t len;
+    bool current;
+    do {
+        seq = __atomic_load_n(&p->published, __ATOMIC_ACQUIRE);
+        current = seq != 0 && p->slot_epoch[seq & 1] == p->epoch;
+        len = current ? p->slot_len[seq & 1] : SENSOR_FORMAT_LEN;
+        memcpy(out, current ? p->slots[seq & 1] : sensor_value_none, len);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&p->building, __ATOMIC_RELAXED) - seq >= 2);
+    return len;
+}
+#endif
+
+static peer_t *peer_find(uint16_t conn_id)
+{
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        if (peers[i].in_use && peers[i].conn_id == conn_id) {
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+static peer_t *peer_find_bda(const uint8_t *bda)
+{
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        if (peers[i].in_use && memcmp(peers[i].bda, bda, sizeof(esp_bd_addr_t)) == 0) {
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+// Claim a free slot for a new connection; NULL if all are taken
+static peer_t *peer_open(uint16_t conn_id, const uint8_t *bda)
+{
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        peer_t *p = &peers[i];
+        if (p->in_use) {
+            continue;
+        }
+        memcpy(p->bda, bda, sizeof(esp_bd_addr_t));
+        p->conn_notify_enabled = false;
+        p->rtt_notify_enabled = false;
+        memset(p->conn_value, 0, sizeof(p->conn_value));
+        memset(p->diag_value, 0, sizeof(p->diag_value));
+
+        portENTER_CRITICAL(&peer_mux);
+        p->conn_id = conn_id;
+        p->mtu = DEFAULT_ATT_MTU;
+        p->notify_enabled = false; // require CCCD write after connect
+        p->event_notify_enabled = false;
+        p->congested = false;
+        p->inflight = 0;
+        p->format = SENSOR_DEFAULT_FORMAT;
+        p->epoch++;
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+        p->rate_stable = false;
+#endif
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+        p->tx_pending = false;
+        p->tx_flags = 0;
+#endif
+        p->in_use = true;
+        portEXIT_CRITICAL(&peer_mux);
+
+        peer_count++;
+        return p;
+    }
+    return NULL;
+}
+
+static void peer_close(peer_t *p)
+{
+    portENTER_CRITICAL(&peer_mux);
+    p->in_use = false;
+    p->notify_enabled = false;
+    p->event_notify_enabled = false;
+    portEXIT_CRITICAL(&peer_mux);
+    peer_count--;
+}
+
+static bool peer_any_congested(void)
+{
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        if (peers[i].in_use && peers[i].congested) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// -------------------- Capabilities --------------------
+// Read before subscribing: the record layout and timestamp unit, the sensor formats this build can send and the
+// optional features built in. A one-byte write of a payload version from SENSOR_FORMATS switches the connection
+// to that format from its next notification; anything else is refused and the format stays.
+static uint16_t caps_features(void)
+{
+    uint16_t features = 0;
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+    features |= SENSOR_CAPS_FEATURE_EVENTS;
+#endif
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+    features |= SENSOR_CAPS_FEATURE_ADAPTIVE_RATE;
+#endif
+#if CONFIG_SENSOR_TEMPERATURE
+    features |= SENSOR_CAPS_FEATURE_TEMPERATURE;
+#endif
+#if CONFIG_SENSOR_LOW_POWER
+    features |= SENSOR_CAPS_FEATURE_LOW_POWER;
+#endif
+#if CONFIG_SENSOR_TIMING_ESP_TIMER
+    features |= SENSOR_CAPS_FEATURE_TIMER;
+#endif
+    return features;
+}
+
+static size_t peer_build_caps(uint8_t *buf, peer_t *p)
+{
+    uint8_t format = SENSOR_DEFAULT_FORMAT;
+    if (p != NULL) {
+        portENTER_CRITICAL(&peer_mux);
+        format = p->format;
+        portEXIT_CRITICAL(&peer_mux);
+    }
+    return sensor_payload_build_caps(buf, format, SENSOR_BATCH_SIZE, SENSOR_QUEUE_LEN, SENSOR_FORMATS,
+                                     caps_features(), SENSOR_NOMINAL_PERIOD_US);
+}
+
+static esp_gatt_status_t peer_select_format(peer_t *p, const uint8_t *value, uint16_t len)
+{
+    if (len != 1) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    if (value[0] >= 16 || (SENSOR_FORMATS & SENSOR_CAPS_FORMAT_BIT(value[0])) == 0) {
+        return ESP_GATT_OUT_OF_RANGE;
+    }
+    portENTER_CRITICAL(&peer_mux);
+    p->format = value[0];
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+    p->tx_pending = false;  // a delay measured under another format is not reported
+    p->tx_flags = 0;
+#endif
+    portEXIT_CRITICAL(&peer_mux);
+    ESP_LOGI(TAG, "conn %u sensor format 0x%02x", p->conn_id, value[0]);
+    return ESP_GATT_OK;
+}
+
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+// -------------------- Rate control --------------------
+// Each central reports its fit on the rate-control characteristic. A settled fit only needs to follow slow
+// skew drift, so once every subscribed central is in maintenance the notify task samples one period in
+// RATE_MAINTENANCE_DIV: fewer captures, notifications and radio events. Any central in acquisition (or one
+// that never reports) gets the full rate back from the next period on.
+#define RATE_MAINTENANCE_DIV      CONFIG_SENSOR_RATE_MAINTENANCE_DIV
+#define RATE_STABLE_RMS_US        CONFIG_SENSOR_RATE_STABLE_RMS_US
+#define RATE_MIN_SAMPLES          CONFIG_SENSOR_RATE_MIN_SAMPLES
+#define RATE_FEEDBACK_TIMEOUT_US  ((uint64_t)CONFIG_SENSOR_RATE_FEEDBACK_TIMEOUT_MS * 1000)
+
+static uint32_t rate_div = 1;       // notify task only: periods per capture
+
+// Periods per capture the subscribed centrals call for: RATE_MAINTENANCE_DIV only if all of them are in
+// maintenance with recent feedback. 1 with none subscribed, so the next one starts at the full rate.
+static uint32_t rate_divisor(uint64_t now_us)
+{
+    uint32_t div = 1;
+    portENTER_CRITICAL(&peer_mux);
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        const peer_t *p = &peers[i];
+        if (!p->in_use || !p->notify_enabled) {
+            continue;
+        }
+        if (!p->rate_stable || now_us - p->rate_feedback_us > RATE_FEEDBACK_TIMEOUT_US) {
+            div = 1;
+            break;
+        }
+        div = RATE_MAINTENANCE_DIV;
+    }
+    portEXIT_CRITICAL(&peer_mux);
+    return div;
+}
+
+// A rate-control write (callback task). Hysteresis: stable at RATE_STABLE_RMS_US, unsettled again above twice
+// that or when the sample count falls short (the fit was reset). Returns true if the central just left maintenance.
+static bool peer_rate_feedback(peer_t *p, uint32_t rms_us, uint16_t samples)
+{
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    portENTER_CRITICAL(&peer_mux);
+    bool was_stable = p->rate_stable;
+    if (samples < RATE_MIN_SAMPLES || rms_us > 2u * RATE_STABLE_RMS_US) {
+        p->rate_stable = false;
+    } else if (rms_us <= RATE_STABLE_RMS_US) {
+        p->rate_stable = true;
+    }
+    p->rate_feedback_us = now_us;
+    bool stable = p->rate_stable;
+    portEXIT_CRITICAL(&peer_mux);
+
+    if (stable != was_stable) {
+        ESP_LOGI(TAG, "conn %u fit %s (rms %" PRIu32 " us, %u samples)", p->conn_id,
+                 stable ? "stable: maintenance rate" : "unsettled: acquisition rate", rms_us, samples);
+    }
+    return was_stable && !stable;
+}
+#define SAMPLE_RATE_DIV rate_div
+#else
+#define SAMPLE_RATE_DIV 1
+#endif
+
 // -------------------- Advertising --------------------
+#if CONFIG_EXAMPLE_SET_RAW_ADV_DATA
+// Built once by adv_raw_init() before Bluedroid starts; REG_EVT passes them to the stack as-is.
+static uint8_t raw_adv_data[ADV_PAYLOAD_MAX_LEN];
+static uint8_t raw_adv_len = 0;
+static uint8_t raw_scan_rsp_data[ADV_PAYLOAD_MAX_LEN];
+static uint8_t raw_scan_rsp_len = 0;
+#if CONFIG_SENSOR_BROADCAST
+static size_t raw_adv_beacon_off = 0;  // where the beacon payload sits in raw_adv_data
+static volatile bool adv_started = false;
+#endif
+#if CONFIG_SENSOR_PERIODIC_ADV
+// The periodic train's data: the same manufacturer field alone (flags are not allowed in periodic data)
+static uint8_t periodic_adv_data[ADV_PAYLOAD_MAX_LEN];
+static uint8_t periodic_adv_len = 0;
+static size_t periodic_beacon_off = 0;
+#endif
+#else
+// Sensor service in 128-bit Bluetooth base form, which Bluedroid advertises as the 16-bit UUID: lets scanners
+// filter on it in hardware (the raw path carries it in the scan response)
+static uint8_t adv_service_uuid128[16] = {
+    0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00,
+    SENSOR_SVC_UUID & 0xFF, SENSOR_SVC_UUID >> 8, 0x00, 0x00,
+};
+
 static esp_ble_adv_data_t adv_data = {
     .set_scan_rsp = false,
     .include_name = true,
@@ -98,72 +848,590 @@ static esp_ble_adv_data_t adv_data = {
     .p_manufacturer_data = NULL,
     .service_data_len = 0,
     .p_service_data = NULL,
-    .service_uuid_len = 0,
-    .p_service_uuid = NULL,
+    .service_uuid_len = sizeof(adv_service_uuid128),
+    .p_service_uuid = adv_service_uuid128,
     .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
 };
+#endif
+
+#if CONFIG_SENSOR_BROADCAST
+// Manufacturer data after the company ID: plain beacon record, or the record in root time with hop and error
+#if CONFIG_SENSOR_TIME_DIST
+#define BEACON_PAYLOAD_LEN SENSOR_ROOT_TIME_PAYLOAD_LEN
+#else
+#define BEACON_PAYLOAD_LEN SENSOR_BEACON_PAYLOAD_LEN
+#endif
 
+// One advertising event per sample: SENSOR_PERIOD_MS in 0.625 ms units, clamped to 20 ms..10.24 s
+#define BROADCAST_ADV_INT_RAW ((SENSOR_PERIOD_MS * 8) / 5)
+#define BROADCAST_ADV_INT     (BROADCAST_ADV_INT_RAW < 0x20 ? 0x20 : \
+                               BROADCAST_ADV_INT_RAW > 0x4000 ? 0x4000 : BROADCAST_ADV_INT_RAW)
+#endif
+
+#if CONFIG_SENSOR_PERIODIC_ADV
+// Periodic interval: SENSOR_PERIOD_MS in 1.25 ms units, clamped to 7.5 ms..81.91 s
+#define PERIODIC_ADV_INT_RAW ((SENSOR_PERIOD_MS * 4) / 5)
+#define PERIODIC_ADV_INT     (PERIODIC_ADV_INT_RAW < 0x06 ? 0x06 : \
+                              PERIODIC_ADV_INT_RAW > 0xFFFF ? 0xFFFF : PERIODIC_ADV_INT_RAW)
+#else
 static esp_ble_adv_params_t adv_params = {
+#if CONFIG_SENSOR_BROADCAST
+    .adv_int_min        = BROADCAST_ADV_INT,
+    .adv_int_max        = BROADCAST_ADV_INT,
+    .adv_type           = ADV_TYPE_NONCONN_IND,
+#else
     .adv_int_min        = 0x20,  // 20ms
     .adv_int_max        = 0x40,  // 40ms
     .adv_type           = ADV_TYPE_IND,
+#endif
     .own_addr_type      = BLE_ADDR_TYPE_PUBLIC,
     .channel_map        = ADV_CHNL_ALL,
     .adv_filter_policy  = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
 };
+#endif
+
+// (Re)start legacy advertising. SENSOR_PERIODIC_ADV has no legacy set: its extended set runs until reboot.
+static void adv_start(void)
+{
+#if !CONFIG_SENSOR_PERIODIC_ADV
+    esp_ble_gap_start_advertising(&adv_params);
+#endif
+}
+
+#if CONFIG_EXAMPLE_SET_RAW_ADV_DATA
+// Same content as the structured path (flags, connection interval range 7.5-20 ms, name), plus the
+// sensor service UUID in the scan response. SENSOR_BROADCAST swaps the interval range for the
+// beacon manufacturer data (zeroed here, filled by sensor_broadcast_task).
+static void adv_raw_init(void)
+{
+    const uint8_t flags = ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT;
+    const uint8_t svc_uuid[2] = { SENSOR_SVC_UUID & 0xFF, SENSOR_SVC_UUID >> 8 };
+
+    size_t off = adv_payload_put_field(raw_adv_data, sizeof(raw_adv_data), 0, ADV_TYPE_FLAGS, &flags, sizeof(flags));
+#if CONFIG_SENSOR_BROADCAST
+    uint8_t mfg[2 + BEACON_PAYLOAD_LEN] = { SENSOR_BEACON_COMPANY_ID & 0xFF, SENSOR_BEACON_COMPANY_ID >> 8 };
+    if (off) {
+        raw_adv_beacon_off = off + ADV_FIELD_HEADER_LEN + 2;
+        off = adv_payload_put_field(raw_adv_data, sizeof(raw_adv_data), off, ADV_TYPE_MANUFACTURER, mfg, sizeof(mfg));
+    }
+#if CONFIG_SENSOR_PERIODIC_ADV
+    periodic_beacon_off = ADV_FIELD_HEADER_LEN + 2;
+    periodic_adv_len = (uint8_t)adv_payload_put_field(periodic_adv_data, sizeof(periodic_adv_data), 0,
+                                                      ADV_TYPE_MANUFACTURER, mfg, sizeof(mfg));
+#endif
+#else
+    const uint8_t conn_int[4] = { 0x06, 0x00, 0x10, 0x00 };  // min, max in 1.25 ms units (u16 LE)
+    if (off) off = adv_payload_put_field(raw_adv_data, sizeof(raw_adv_data), off, ADV_TYPE_CONN_INT_RANGE, conn_int, sizeof(conn_int));
+#endif
+    if (off) off = adv_payload_put_name(raw_adv_data, sizeof(raw_adv_data), off, DEVICE_NAME);
+    if (off == 0) {
+        ESP_LOGE(TAG, "raw adv data does not fit in %d bytes", ADV_PAYLOAD_MAX_LEN);
+    }
+    raw_adv_len = (uint8_t)off;
+
+    raw_scan_rsp_len = (uint8_t)adv_payload_put_field(raw_scan_rsp_data, sizeof(raw_scan_rsp_data), 0,
+                                                      ADV_TYPE_UUID16_CMPL, svc_uuid, sizeof(svc_uuid));
+}
+#endif
+
+// -------------------- LED Helpers --------------------
+static void led_init_rgb(void)
+{
+    led_strip_config_t strip_cfg = {
+        .strip_gpio_num = LED_GPIO,
+        .max_leds = LED_COUNT,
+    };
+
+#if CONFIG_EXAMPLE_BLINK_LED_STRIP_BACKEND_RMT
+    led_strip_rmt_config_t rmt_cfg = {
+        .resolution_hz = 10 * 1000 * 1000, // 10MHz
+        .flags.with_dma = false,
+        .flags.double_buffer = true,  // set the next color while the async refresh still sends the last one
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip));
+#elif CONFIG_EXAMPLE_BLINK_LED_STRIP_BACKEND_SPI
+    led_strip_spi_config_t spi_cfg = {
+        .spi_bus = SPI2_HOST,
+        .flags.with_dma = true,
+    };
+    ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_cfg, &spi_cfg, &strip));
+#else
+#error "LED strip backend not set. Enable RMT or SPI backend in menuconfig."
+#endif
+
+    led_strip_clear(strip);
+    led_strip_refresh(strip);
+}
+
+// Queues the frame and returns (RMT backend); the SPI backend still blocks for the frame
+static void led_set_green(bool on)
+{
+    if (!strip) return;
+
+    led_strip_set_pixel(strip, 0, 0, on ? 255 : 0, 0); // GREEN or off
+    led_strip_refresh_async(strip);
+}
+
+// Non-blocking: drop the command if the LED task is behind (feedback only, never worth a stall)
+static void led_post(led_cmd_t cmd)
+{
+    if (led_queue) {
+        (void)xQueueSend(led_queue, &cmd, 0);
+    }
+}
+
+static void led_task(void *param)
+{
+    led_cmd_t cmd;
+    while (1) {
+        if (xQueueReceive(led_queue, &cmd, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (cmd == LED_CMD_PULSE) {
+            led_set_green(true);
+            vTaskDelay(pdMS_TO_TICKS(LED_PULSE_MS));
+        }
+        led_set_green(false);
+    }
+}
+
+// -------------------- Task topology --------------------
+// Kconfig core -1 means no affinity
+static BaseType_t task_create(TaskFunction_t fn, const char *name, uint32_t stack, UBaseType_t prio, int core)
+{
+    BaseType_t affinity = core < 0 ? tskNO_AFFINITY : (BaseType_t)core;
+    BaseType_t ok = xTaskCreatePinnedToCore(fn, name, stack, NULL, prio, NULL, affinity);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "task %s create failed", name);
+    } else {
+        ESP_LOGI(TAG, "task %s: prio %u, core %d", name, (unsigned)prio, core);
+    }
+    return ok;
+}
+
+static void task_topology_check(void)
+{
+#if defined(CONFIG_BT_BLUEDROID_PINNED_TO_CORE) && !CONFIG_FREERTOS_UNICORE
+    if (SENSOR_TASK_CORE == CONFIG_BT_BLUEDROID_PINNED_TO_CORE) {
+        ESP_LOGW(TAG, "sampling task shares core %d with the Bluedroid host: expect more timestamp jitter",
+                 SENSOR_TASK_CORE);
+    }
+#endif
+    if (SENSOR_TASK_CORE >= 0 && SENSOR_TASK_CORE == LED_TASK_CORE) {
+        ESP_LOGW(TAG, "sampling task shares core %d with the LED worker", SENSOR_TASK_CORE);
+    }
+}
+
+static void write_rsp_if_needed(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    if (param->write.need_rsp) {
+        esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, NULL);
+    }
+}
+
+#if !CONFIG_SENSOR_BROADCAST
+// -------------------- Periodic notify task --------------------
+// Scheduler, per connection: each period's record joins a bounded queue. It is sent when due (one record,
+// or a full batch) unless the link is congested or NOTIFY_MAX_INFLIGHT notifications await their CONF_EVT.
+// A backlog leaves in one batched payload, newest record last (stamped right before the send, the one the
+// receiver pairs with its receive time); what the queue or the MTU cannot hold is dropped oldest first.
+// The queue and the decisions are sensor_sched (components/sensor_protocol, also built and benchmarked on
+// a host); this task adds the link state, the send and the diagnostics.
+
+// Queue new captures (oldest first) for one peer and send if due. Returns true if a notification went out.
+static bool peer_notify(peer_t *p, const uint64_t *t_us, size_t count)
+{
+    uint64_t now_us = t_us[count - 1];
+    portENTER_CRITICAL(&peer_mux);
+    bool subscribed = p->in_use && p->notify_enabled;
+    uint16_t conn_id = p->conn_id;
+    uint16_t mtu = p->mtu;
+    uint32_t epoch = p->epoch;
+    uint8_t format = p->format;
+    if (p->inflight >= NOTIFY_MAX_INFLIGHT && now_us - p->conf_progress_us > NOTIFY_CONF_TIMEOUT_US) {
+        p->inflight = 0;  // CONF_EVTs lost (or not reported on this link); do not stall forever
+    }
+    bool blocked = p->congested || p->inflight >= NOTIFY_MAX_INFLIGHT;
+    portEXIT_CRITICAL(&peer_mux);
+
+    if (epoch != p->seen_epoch) {
+        // New connection in this slot: its seq starts from 0
+        p->seen_epoch = epoch;
+        sensor_queue_init(&p->queue, p->records, SENSOR_QUEUE_LEN);
+    }
+    if (!subscribed) {
+        p->queue.queued = 0; // never deliver samples taken before the client subscribed
+        return false;
+    }
+
+    size_t dropped = sensor_queue_push(&p->queue, t_us, count);
+    if (dropped > 0) {
+        diag_record_queue((uint32_t)dropped, 0);
+    }
+
+    // Batched formats send a full batch; single-record ones send each record, a backlog coalesced
+    const sensor_sched_config_t sched = {
+        .coalesced_format = SENSOR_COALESCED_FORMAT,
+        .batch_size = SENSOR_BATCH_SIZE,
+        .period_us = SENSOR_NOMINAL_PERIOD_US * SAMPLE_RATE_DIV,
+    };
+    sensor_plan_t plan;
+    sensor_sched_plan(&sched, &p->queue, format, mtu, &plan);
+    if (blocked || p->queue.queued < plan.due) {
+        return false;
+    }
+    dropped = sensor_sched_trim(&p->queue, &plan);
+
+    const sensor_timed_report_t *timed = NULL;
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+    bool batched = sensor_sched_batched(&plan, p->queue.queued);
+    sensor_timed_report_t report;
+    if (!batched && format == SENSOR_PAYLOAD_VERSION_TIMED) {
+        portENTER_CRITICAL(&peer_mux);
+        report.flags = p->tx_flags;
+        report.prev_seq = p->tx_seq;
+        report.prev_delay_us = p->tx_delay_us;
+        // Arm before sending: the CONF callback can run before send_indicate() returns
+        p->tx_pending = true;
+        p->tx_seq = p->queue.records[0].seq;
+        p->tx_t_us = p->queue.records[0].t_us;
+        p->tx_flags = 0;
+        portEXIT_CRITICAL(&peer_mux);
+        timed = &report;
+    }
+#endif
+#if CONFIG_SENSOR_TEMPERATURE
+    int16_t temp_cdeg = temperature_latest_cdeg();
+#else
+    int16_t temp_cdeg = INT16_MIN;  // thermal is not selectable without the sensor
+#endif
+#if CONFIG_SENSOR_READ_AUTO_RSP
+    uint8_t *value = sensor_build;
+#else
+    uint8_t *value = sensor_slot_begin(p);
+#endif
+    size_t len = sensor_sched_build(value, SENSOR_PAYLOAD_MAX_LEN, &p->queue, &sched, &plan, timed, temp_cdeg,
+                                    &dropped);
+    if (dropped > 0) {
+        diag_record_queue((uint32_t)dropped, 0);
+    }
+    size_t n = p->queue.queued;
+
+    // Send NOTIFY (confirm=false)
+    int64_t t_send_us = esp_timer_get_time();
+    esp_err_t err = esp_ble_gatts_send_indicate(
+        g_gatts_if,
+        conn_id,
+        g_char_handle,
+        (uint16_t)len,
+        value,
+        false
+    );
+    int64_t t_sent_us = esp_timer_get_time();
+    diag_record_send((uint32_t)(t_sent_us - t_send_us), err);
+#if CONFIG_SENSOR_BENCH
+    if (err == ESP_OK) {
+        bench_record_notify(len);
+    }
+#endif
+
+    portENTER_CRITICAL(&peer_mux);
+    if (err == ESP_OK) {
+        if (p->inflight++ == 0) {
+            p->conf_progress_us = (uint64_t)t_sent_us;
+        }
+    }
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+    if (!batched && p->tx_pending && p->tx_seq == p->queue.records[0].seq) {
+        if (err == ESP_OK) {
+            // Lower bound until CONF_EVT arrives with the real hand-off time
+            p->tx_delay_us = (uint32_t)((uint64_t)t_sent_us - p->tx_t_us);
+            p->tx_flags = SENSOR_TIMED_FLAG_DELAY_CALL;
+        } else {
+            p->tx_pending = false;
+        }
+    }
+#endif
+    portEXIT_CRITICAL(&peer_mux);
+
+    if (err != ESP_OK) {
+        // Keep the records: they go out with the next period's, coalesced
+        ESP_LOGW(TAG, "send notify to conn %u failed: %s", conn_id, esp_err_to_name(err));
+        return false;
+    }
+    // What its reads return from now on
+#if CONFIG_SENSOR_READ_AUTO_RSP
+    (void)esp_ble_gatts_set_attr_value(g_char_handle, (uint16_t)len, value);  // the one connection (Kconfig)
+#else
+    sensor_slot_publish(p, (uint16_t)len, epoch);
+#endif
+    // Records beyond what was due had waited for the link
+    diag_record_queue(0, (uint32_t)(n > plan.due ? n - plan.due : 0));
+    p->queue.queued = 0;
+    return true;
+}
+
+// Fan captures out to every subscribed peer in one pass
+static void notify_captures(const uint64_t *t_us, size_t count)
+{
+    if (!sensor_ready || g_gatts_if == ESP_GATT_IF_NONE) {
+        return;
+    }
+    bool sent = false;
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        sent |= peer_notify(&peers[i], t_us, count);
+    }
+    if (sent) {
+        led_post(LED_CMD_PULSE);
+    }
+}
+
+#if CONFIG_SENSOR_TIMING_ESP_TIMER
+// -------------------- Sample timer --------------------
+// A periodic esp_timer stamps t_us in its callback and wakes the notify task with a task notification, so
+// the period is not bound to the FreeRTOS tick and the capture does not wait for the task to be scheduled.
+// Captures pass through a single-producer ring; the task drains all of them on each wake-up.
+#define SAMPLE_PERIOD_US  CONFIG_SENSOR_TIMER_PERIOD_US
+#define SAMPLE_RING_LEN   8  // power of two
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define SAMPLE_TIMER_ISR  1  // callback runs in the timer ISR: no wait for the esp_timer task either
+#else
+#define SAMPLE_TIMER_ISR  0
+#endif
+
+static TaskHandle_t notify_task_handle = NULL;
+static uint64_t sample_ring[SAMPLE_RING_LEN];
+static uint32_t sample_head = 0;      // timer callback only
+static uint32_t sample_tail = 0;      // notify task only
+static volatile uint32_t sample_overruns = 0;  // captures lost to a full ring (timer callback only)
+
+static void IRAM_ATTR sample_timer_cb(void *arg)
+{
+    uint64_t t_us = (uint64_t)esp_timer_get_time();
+#if CONFIG_SENSOR_BENCH
+    bench_capture_mark();
+#endif
+    uint32_t head = sample_head;
+    if (head - __atomic_load_n(&sample_tail, __ATOMIC_ACQUIRE) < SAMPLE_RING_LEN) {
+        sample_ring[head % SAMPLE_RING_LEN] = t_us;
+        __atomic_store_n(&sample_head, head + 1, __ATOMIC_RELEASE);
+    } else {
+        sample_overruns++;
+    }
+#if SAMPLE_TIMER_ISR
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(notify_task_handle, &woken);
+    if (woken == pdTRUE) {
+        esp_timer_isr_dispatch_need_yield();
+    }
+#else
+    xTaskNotifyGive(notify_task_handle);
+#endif
+}
+
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+// A central needs the full rate again: wake the task now rather than after a stretched period
+static void sample_rate_kick(void)
+{
+    if (notify_task_handle != NULL) {
+        xTaskNotifyGive(notify_task_handle);
+    }
+}
+#endif
 
-// -------------------- LED Helpers --------------------
-static void led_init_rgb(void)
+static void sensor_notify_task(void *param)
 {
-    led_strip_config_t strip_cfg = {
-        .strip_gpio_num = LED_GPIO,
-        .max_leds = LED_COUNT,
+    ESP_LOGI(TAG, "Notify task start. Timer period=%d us (%s dispatch), batch=%d, connections=%d, LED pulse=%d ms",
+             SAMPLE_PERIOD_US, SAMPLE_TIMER_ISR ? "ISR" : "task", SENSOR_BATCH_SIZE, MAX_CONNECTIONS, LED_PULSE_MS);
+
+    notify_task_handle = xTaskGetCurrentTaskHandle();
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .dispatch_method = SAMPLE_TIMER_ISR ? ESP_TIMER_ISR : ESP_TIMER_TASK,
+        .name = "sample",
+        .skip_unhandled_events = true,  // after a stall, resume the cadence instead of firing a burst
     };
+    esp_timer_handle_t timer = NULL;
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, SAMPLE_PERIOD_US));
 
-#if CONFIG_EXAMPLE_BLINK_LED_STRIP_BACKEND_RMT
-    led_strip_rmt_config_t rmt_cfg = {
-        .resolution_hz = 10 * 1000 * 1000, // 10MHz
-        .flags.with_dma = false,
-    };
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip));
-#elif CONFIG_EXAMPLE_BLINK_LED_STRIP_BACKEND_SPI
-    led_strip_spi_config_t spi_cfg = {
-        .spi_bus = SPI2_HOST,
-        .flags.with_dma = true,
-    };
-    ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_cfg, &spi_cfg, &strip));
+    uint64_t captures[SAMPLE_RING_LEN];
+    uint32_t overruns_seen = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        size_t n = 0;
+        uint32_t head = __atomic_load_n(&sample_head, __ATOMIC_ACQUIRE);
+        while (sample_tail != head) {
+            captures[n++] = sample_ring[sample_tail % SAMPLE_RING_LEN];
+            __atomic_store_n(&sample_tail, sample_tail + 1, __ATOMIC_RELEASE);
+        }
+        uint32_t overruns = sample_overruns;
+        if (overruns != overruns_seen) {
+            diag_record_queue(overruns - overruns_seen, 0);
+            overruns_seen = overruns;
+        }
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+        // The timer itself slows down, so the stretched periods cost no wake-ups either
+        uint32_t div = rate_divisor((uint64_t)esp_timer_get_time());
+        if (div != rate_div) {
+            rate_div = div;
+            ESP_ERROR_CHECK(esp_timer_restart(timer, (uint64_t)SAMPLE_PERIOD_US * div));
+            ESP_LOGI(TAG, "Sample period %" PRIu64 " us", (uint64_t)SAMPLE_PERIOD_US * div);
+        }
+#endif
+        if (n == 0) {
+            continue;
+        }
+        // Lateness here is capture -> task running; the capture itself is on time
+        diag_record_wake_lateness((uint32_t)((uint64_t)esp_timer_get_time() - captures[n - 1]));
+        notify_captures(captures, n);
+    }
+}
 #else
-#error "LED strip backend not set. Enable RMT or SPI backend in menuconfig."
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+// The task wakes every SENSOR_PERIOD_MS in any case and picks the new rate up there
+static inline void sample_rate_kick(void)
+{
+}
 #endif
 
-    led_strip_clear(strip);
-    led_strip_refresh(strip);
+static void sensor_notify_task(void *param)
+{
+    ESP_LOGI(TAG, "Notify task start. Period=%d ms, batch=%d, connections=%d, LED pulse=%d ms",
+             SENSOR_PERIOD_MS, SENSOR_BATCH_SIZE, MAX_CONNECTIONS, LED_PULSE_MS);
+
+    TickType_t last_wake = xTaskGetTickCount();
+    diag_wake_t wake = {0};
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+    uint32_t idle_periods = 0;
+#endif
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SENSOR_PERIOD_MS));
+        diag_task_woke(&wake, last_wake);
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+        // Keep the tick cadence and skip captures, so a return to the full rate takes at most one period
+        uint32_t div = rate_divisor((uint64_t)esp_timer_get_time());
+        if (div != rate_div) {
+            rate_div = div;
+            idle_periods = div;  // capture now, on the new cadence
+            ESP_LOGI(TAG, "Sample period %" PRIu32 " ms", (uint32_t)SENSOR_PERIOD_MS * div);
+        }
+        if (++idle_periods < rate_div) {
+            continue;
+        }
+        idle_periods = 0;
+#endif
+
+        // One capture per period
+        uint64_t t_us = (uint64_t)esp_timer_get_time();
+#if CONFIG_SENSOR_BENCH
+        bench_capture_mark();
+#endif
+        notify_captures(&t_us, 1);
+    }
 }
+#endif
 
-static void led_set_green(bool on)
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+// -------------------- Acoustic event notify task --------------------
+// Detected events wait in the acoustic_events ring. Each subscribed connection keeps its read position
+// and gets everything past it in one notification, as many events as its MTU holds. Events share the
+// connection's NOTIFY_MAX_INFLIGHT credits with the sensor stream, so a burst of them cannot pile up
+// inside the stack ahead of the sync samples; a blocked link is retried every EVENT_RETRY_MS.
+#define EVENT_RETRY_MS  100
+
+// Send one batch of this peer's pending events if the link has room. Returns true if a notification went out.
+static bool peer_notify_events(peer_t *p)
 {
-    if (!strip) return;
+    portENTER_CRITICAL(&peer_mux);
+    bool subscribed = p->in_use && p->event_notify_enabled;
+    uint16_t conn_id = p->conn_id;
+    uint16_t mtu = p->mtu;
+    uint32_t epoch = p->epoch;
+    bool blocked = p->congested || p->inflight >= NOTIFY_MAX_INFLIGHT;
+    portEXIT_CRITICAL(&peer_mux);
+
+    if (!subscribed || epoch != p->event_seen_epoch) {
+        // Only events detected after the client subscribed
+        p->event_seen_epoch = epoch;
+        p->event_next_seq = acoustic_events_next_seq();
+        return false;
+    }
+    if (blocked) {
+        return false;
+    }
 
-    if (on) {
-        led_strip_set_pixel(strip, 0, 0, 255, 0); // GREEN
-        led_strip_refresh(strip);
-    } else {
-        led_strip_clear(strip);
-        led_strip_refresh(strip);
+    size_t capacity = sensor_payload_event_capacity(mtu);
+    if (capacity > ACOUSTIC_EVENTS_RING_LEN) capacity = ACOUSTIC_EVENTS_RING_LEN;
+    if (capacity == 0) capacity = 1;
+    sensor_event_t events[ACOUSTIC_EVENTS_RING_LEN];
+    size_t n = acoustic_events_read(p->event_next_seq, events, capacity);
+    if (n == 0) {
+        return false;
+    }
+    uint16_t len = (uint16_t)sensor_payload_build_events(event_build, sizeof(event_build), events, n);
+    portENTER_CRITICAL(&event_mux);
+    memcpy(event_value, event_build, len);
+    event_value_len = len;
+    portEXIT_CRITICAL(&event_mux);
+    (void)esp_ble_gatts_set_attr_value(g_event_char_handle, len, event_build);
+
+    int64_t t_send_us = esp_timer_get_time();
+    esp_err_t err = esp_ble_gatts_send_indicate(
+        g_gatts_if,
+        conn_id,
+        g_event_char_handle,
+        len,
+        event_build,
+        false
+    );
+    int64_t t_sent_us = esp_timer_get_time();
+    diag_record_send((uint32_t)(t_sent_us - t_send_us), err);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "send event notify to conn %u failed: %s", conn_id, esp_err_to_name(err));
+        return false;  // the events stay pending for the next pass
     }
+
+    portENTER_CRITICAL(&peer_mux);
+    if (p->inflight++ == 0) {
+        p->conf_progress_us = (uint64_t)t_sent_us;
+    }
+    portEXIT_CRITICAL(&peer_mux);
+    p->event_next_seq = events[n - 1].seq + 1;
+    return true;
 }
 
-static void write_rsp_if_needed(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+static void acoustic_event_task(void *param)
 {
-    if (param->write.need_rsp) {
-        esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, NULL);
+    ESP_LOGI(TAG, "Event notify task start. Ring=%d events, retry=%d ms", ACOUSTIC_EVENTS_RING_LEN, EVENT_RETRY_MS);
+
+    while (1) {
+        acoustic_events_wait(pdMS_TO_TICKS(EVENT_RETRY_MS));
+        if (!sensor_ready || g_gatts_if == ESP_GATT_IF_NONE) {
+            continue;
+        }
+        for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+            // More pending than one payload holds: keep going while the link takes them
+            while (peer_notify_events(&peers[i])) {
+            }
+        }
     }
 }
+#endif
 
-// -------------------- Periodic notify task --------------------
-static void sensor_notify_task(void *param)
+#endif // !CONFIG_SENSOR_BROADCAST
+
+#if CONFIG_SENSOR_BROADCAST
+// -------------------- Periodic broadcast task --------------------
+// Rewrites the beacon record in the precomputed adv bytes and hands them to the stack each period.
+static void sensor_broadcast_task(void *param)
 {
-    ESP_LOGI(TAG, "Notify task start. Period=%d ms, LED pulse=%d ms", SENSOR_PERIOD_MS, LED_PULSE_MS);
+    ESP_LOGI(TAG, "Broadcast task start. Period=%d ms, adv interval=%d x 0.625 ms",
+             SENSOR_PERIOD_MS, BROADCAST_ADV_INT);
 
     uint32_t seq = 0;
     TickType_t last_wake = xTaskGetTickCount();
@@ -171,52 +1439,38 @@ static void sensor_notify_task(void *param)
     while (1) {
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SENSOR_PERIOD_MS));
 
-        if (!sensor_ready || !notify_enabled || g_gatts_if == ESP_GATT_IF_NONE) {
+        if (!adv_started) {
             continue;
         }
 
-        // Build payload: [seq:u32 LE][t_us:u64 LE]
         uint64_t t_us = (uint64_t)esp_timer_get_time();
-
-        sensor_value[0] = (uint8_t)(seq);
-        sensor_value[1] = (uint8_t)(seq >> 8);
-        sensor_value[2] = (uint8_t)(seq >> 16);
-        sensor_value[3] = (uint8_t)(seq >> 24);
-
-        sensor_value[4]  = (uint8_t)(t_us);
-        sensor_value[5]  = (uint8_t)(t_us >> 8);
-        sensor_value[6]  = (uint8_t)(t_us >> 16);
-        sensor_value[7]  = (uint8_t)(t_us >> 24);
-        sensor_value[8]  = (uint8_t)(t_us >> 32);
-        sensor_value[9]  = (uint8_t)(t_us >> 40);
-        sensor_value[10] = (uint8_t)(t_us >> 48);
-        sensor_value[11] = (uint8_t)(t_us >> 56);
-
-        // Keep attribute value consistent for reads
-        (void)esp_ble_gatts_set_attr_value(g_char_handle, SENSOR_PAYLOAD_LEN, sensor_value);
-
-        // Send NOTIFY (confirm=false)
-        esp_err_t err = esp_ble_gatts_send_indicate(
-            g_gatts_if,
-            g_conn_id,
-            g_char_handle,
-            SENSOR_PAYLOAD_LEN,
-            sensor_value,
-            false
-        );
+#if CONFIG_SENSOR_BENCH
+        bench_capture_mark();
+#endif
+#if CONFIG_SENSOR_TIME_DIST
+        time_dist_stamp_t stamp;
+        time_dist_stamp(t_us, &stamp);
+        sensor_record_t rec = { .seq = seq++, .t_us = stamp.t_us };
+        sensor_payload_build_root_time(raw_adv_data + raw_adv_beacon_off, &rec, stamp.hop, stamp.err_us);
+#else
+        sensor_record_t rec = { .seq = seq++, .t_us = t_us };
+        sensor_payload_build_beacon(raw_adv_data + raw_adv_beacon_off, &rec);
+#endif
+#if CONFIG_SENSOR_PERIODIC_ADV
+        memcpy(periodic_adv_data + periodic_beacon_off, raw_adv_data + raw_adv_beacon_off, BEACON_PAYLOAD_LEN);
+        esp_err_t err = periodic_adv_update(raw_adv_data, raw_adv_len, periodic_adv_data, periodic_adv_len);
+#else
+        esp_err_t err = esp_ble_gap_config_adv_data_raw(raw_adv_data, raw_adv_len);
+#endif
 
         if (err == ESP_OK) {
-            // Pulse LED ON for LED_PULSE_MS, then OFF
-            led_set_green(true);
-            vTaskDelay(pdMS_TO_TICKS(LED_PULSE_MS));
-            led_set_green(false);
+            led_post(LED_CMD_PULSE);
         } else {
-            ESP_LOGW(TAG, "send notify failed: %s", esp_err_to_name(err));
+            ESP_LOGW(TAG, "beacon adv update failed: %s", esp_err_to_name(err));
         }
-
-        seq++;
     }
 }
+#endif
 
 // -------------------- GAP callback --------------------
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
@@ -226,7 +1480,7 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
         ESP_LOGI(TAG, "Adv data set complete, status=%d", param->adv_data_cmpl.status);
         adv_config_done &= (~ADV_CONFIG_FLAG);
         if (adv_config_done == 0) {
-            esp_ble_gap_start_advertising(&adv_params);
+            adv_start();
         }
         break;
 
@@ -234,15 +1488,80 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
         ESP_LOGI(TAG, "Scan rsp data set complete, status=%d", param->scan_rsp_data_cmpl.status);
         adv_config_done &= (~SCAN_RSP_CONFIG_FLAG);
         if (adv_config_done == 0) {
-            esp_ble_gap_start_advertising(&adv_params);
+            adv_start();
+        }
+        break;
+
+    case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
+        if (!(adv_config_done & ADV_CONFIG_FLAG)) {
+            break; // periodic beacon refresh while already advertising
+        }
+        ESP_LOGI(TAG, "Raw adv data set complete, status=%d", param->adv_data_raw_cmpl.status);
+        adv_config_done &= (~ADV_CONFIG_FLAG);
+        if (adv_config_done == 0) {
+            adv_start();
+        }
+        break;
+
+    case ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT:
+        ESP_LOGI(TAG, "Raw scan rsp data set complete, status=%d", param->scan_rsp_data_raw_cmpl.status);
+        adv_config_done &= (~SCAN_RSP_CONFIG_FLAG);
+        if (adv_config_done == 0) {
+            adv_start();
+        }
+        break;
+
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: {
+        ESP_LOGI(TAG, "Conn params status=%d interval=%u latency=%u timeout=%u",
+                 param->update_conn_params.status, param->update_conn_params.conn_int,
+                 param->update_conn_params.latency, param->update_conn_params.timeout);
+        if (param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) {
+            break;
+        }
+        peer_t *peer = peer_find_bda(param->update_conn_params.bda);
+        if (peer == NULL) {
+            break;
+        }
+        sensor_payload_build_conn_params(peer->conn_value, param->update_conn_params.conn_int,
+                                         param->update_conn_params.latency, param->update_conn_params.timeout);
+        if (peer->conn_notify_enabled && g_gatts_if != ESP_GATT_IF_NONE) {
+            esp_ble_gatts_send_indicate(g_gatts_if, peer->conn_id, g_conn_char_handle,
+                                        sizeof(peer->conn_value), peer->conn_value, false);
         }
         break;
+    }
+
+#if CONFIG_SENSOR_PERIODIC_ADV
+    case ESP_GAP_BLE_EXT_ADV_SET_PARAMS_COMPLETE_EVT:
+    case ESP_GAP_BLE_EXT_ADV_DATA_SET_COMPLETE_EVT:
+    case ESP_GAP_BLE_PERIODIC_ADV_SET_PARAMS_COMPLETE_EVT:
+    case ESP_GAP_BLE_PERIODIC_ADV_DATA_SET_COMPLETE_EVT:
+    case ESP_GAP_BLE_PERIODIC_ADV_START_COMPLETE_EVT:
+        periodic_adv_gap_event(event, param);
+        break;
+
+    case ESP_GAP_BLE_EXT_ADV_START_COMPLETE_EVT:
+        periodic_adv_gap_event(event, param);
+        adv_started = periodic_adv_running();
+        break;
+#endif
+
+#if CONFIG_SENSOR_TIME_ROLE_RELAY
+    case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
+    case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+    case ESP_GAP_BLE_SCAN_RESULT_EVT:
+        time_dist_gap_event(event, param);
+        break;
+#endif
 
     case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
         if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
             ESP_LOGE(TAG, "Adv start failed, status=%d", param->adv_start_cmpl.status);
         } else {
             ESP_LOGI(TAG, "Advertising started");
+#if CONFIG_SENSOR_BROADCAST
+            adv_started = true;
+#endif
         }
         break;
 
@@ -252,6 +1571,33 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
 }
 
 // -------------------- GATTS callback --------------------
+// Without SENSOR_GATT_ATTR_TABLE the service is built one attribute per GATTS event: CREATE_EVT adds the sensor
+// characteristic, and each ADD_CHAR_EVT and ADD_CHAR_DESCR_EVT adds the next attribute.
+// Last of the characteristics without a CCCD: the acoustic event characteristic follows (its CCCD leads on to
+// the detector configuration), or the table is complete
+static void add_event_char_or_finish(void)
+{
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+    esp_bt_uuid_t char_uuid = {0};
+    char_uuid.len = ESP_UUID_LEN_128;
+    memcpy(char_uuid.uuid.uuid128, event_chr_uuid128, ESP_UUID_LEN_128);
+
+    esp_err_t ret = esp_ble_gatts_add_char(
+        g_service_handle,
+        &char_uuid,
+        ESP_GATT_PERM_READ,
+        ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+        &event_attr,
+        NULL
+    );
+    if (ret) {
+        ESP_LOGE(TAG, "add event char failed: %s", esp_err_to_name(ret));
+    }
+#else
+    sensor_ready = true;
+#endif
+}
+
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
 {
     switch (event) {
@@ -260,14 +1606,52 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         ESP_LOGI(TAG, "REG_EVT status=%d app_id=%d", param->reg.status, param->reg.app_id);
         g_gatts_if = gatts_if;
 
+        esp_ble_gap_set_device_name(DEVICE_NAME);
+
         // Configure advertising
+#if CONFIG_SENSOR_PERIODIC_ADV
+        // Extended set plus periodic train, brought up step by step from the GAP events
+        esp_err_t ret = periodic_adv_start(raw_adv_data, raw_adv_len, periodic_adv_data, periodic_adv_len, PERIODIC_ADV_INT);
+        if (ret) {
+            ESP_LOGE(TAG, "periodic advertising start failed: %s", esp_err_to_name(ret));
+            break;
+        }
+#elif CONFIG_SENSOR_BROADCAST
+        // Non-connectable, non-scannable: no scan response
+        adv_config_done = ADV_CONFIG_FLAG;
+        esp_err_t ret = esp_ble_gap_config_adv_data_raw(raw_adv_data, raw_adv_len);
+        if (ret) {
+            ESP_LOGE(TAG, "config raw adv data failed: %s", esp_err_to_name(ret));
+            break;
+        }
+#elif CONFIG_EXAMPLE_SET_RAW_ADV_DATA
+        adv_config_done = ADV_CONFIG_FLAG | SCAN_RSP_CONFIG_FLAG;
+        esp_err_t ret = esp_ble_gap_config_adv_data_raw(raw_adv_data, raw_adv_len);
+        if (ret) {
+            ESP_LOGE(TAG, "config raw adv data failed: %s", esp_err_to_name(ret));
+            break;
+        }
+        ret = esp_ble_gap_config_scan_rsp_data_raw(raw_scan_rsp_data, raw_scan_rsp_len);
+        if (ret) {
+            ESP_LOGE(TAG, "config raw scan rsp data failed: %s", esp_err_to_name(ret));
+            break;
+        }
+#else
         adv_config_done = ADV_CONFIG_FLAG;
         esp_err_t ret = esp_ble_gap_config_adv_data(&adv_data);
         if (ret) {
             ESP_LOGE(TAG, "config adv data failed: %s", esp_err_to_name(ret));
             break;
         }
+#endif
 
+#if CONFIG_SENSOR_GATT_ATTR_TABLE
+        // The whole service at once: ESP_GATTS_CREAT_ATTR_TAB_EVT hands back every handle
+        ret = esp_ble_gatts_create_attr_tab(sensor_gatt_db, gatts_if, SENSOR_IDX_NB, 0);
+        if (ret) {
+            ESP_LOGE(TAG, "create attr table failed: %s", esp_err_to_name(ret));
+        }
+#else
         // Create service (0x181A)
         esp_gatt_srvc_id_t service_id = {0};
         service_id.is_primary = true;
@@ -276,8 +1660,41 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         service_id.id.uuid.uuid.uuid16 = SENSOR_SVC_UUID;
 
         esp_ble_gatts_create_service(gatts_if, &service_id, SENSOR_NUM_HANDLE);
+#endif
+        break;
+    }
+
+#if CONFIG_SENSOR_GATT_ATTR_TABLE
+    case ESP_GATTS_CREAT_ATTR_TAB_EVT: {
+        ESP_LOGI(TAG, "CREAT_ATTR_TAB_EVT status=%d num_handle=%d",
+                 param->add_attr_tab.status, param->add_attr_tab.num_handle);
+        if (param->add_attr_tab.status != ESP_GATT_OK || param->add_attr_tab.num_handle != SENSOR_IDX_NB) {
+            ESP_LOGE(TAG, "attribute table incomplete (%d of %d handles)", param->add_attr_tab.num_handle, SENSOR_IDX_NB);
+            break;
+        }
+        const uint16_t *handles = param->add_attr_tab.handles;
+        g_service_handle = handles[SENSOR_IDX_SVC];
+        g_char_handle = handles[SENSOR_IDX_SENSOR_VAL];
+        g_cccd_handle = handles[SENSOR_IDX_SENSOR_CCCD];
+        g_conn_char_handle = handles[SENSOR_IDX_CONN_VAL];
+        g_conn_cccd_handle = handles[SENSOR_IDX_CONN_CCCD];
+        g_rtt_char_handle = handles[SENSOR_IDX_RTT_VAL];
+        g_rtt_cccd_handle = handles[SENSOR_IDX_RTT_CCCD];
+        g_diag_char_handle = handles[SENSOR_IDX_DIAG_VAL];
+        g_caps_char_handle = handles[SENSOR_IDX_CAPS_VAL];
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+        g_rate_char_handle = handles[SENSOR_IDX_RATE_VAL];
+#endif
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+        g_event_char_handle = handles[SENSOR_IDX_EVENT_VAL];
+        g_event_cccd_handle = handles[SENSOR_IDX_EVENT_CCCD];
+        g_detector_char_handle = handles[SENSOR_IDX_DETECTOR_VAL];
+#endif
+        esp_ble_gatts_start_service(g_service_handle);
+        sensor_ready = true;
         break;
     }
+#endif
 
     case ESP_GATTS_CREATE_EVT: {
         ESP_LOGI(TAG, "CREATE_EVT status=%d service_handle=%d", param->create.status, param->create.service_handle);
@@ -298,7 +1715,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             ESP_GATT_PERM_READ,
             prop,
             &sensor_attr,
-            NULL
+            &sensor_attr_control
         );
         if (ret) {
             ESP_LOGE(TAG, "add char failed: %s", esp_err_to_name(ret));
@@ -308,7 +1725,72 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
 
     case ESP_GATTS_ADD_CHAR_EVT: {
         ESP_LOGI(TAG, "ADD_CHAR_EVT status=%d attr_handle=%d", param->add_char.status, param->add_char.attr_handle);
-        g_char_handle = param->add_char.attr_handle;
+        if (g_char_handle == 0) {
+            g_char_handle = param->add_char.attr_handle;
+        } else if (g_conn_char_handle == 0) {
+            g_conn_char_handle = param->add_char.attr_handle;
+        } else if (g_rtt_char_handle == 0) {
+            g_rtt_char_handle = param->add_char.attr_handle;
+        } else if (g_diag_char_handle == 0) {
+            // Diagnostics is read-only: no CCCD
+            g_diag_char_handle = param->add_char.attr_handle;
+
+            // Then the capabilities characteristic
+            esp_bt_uuid_t char_uuid = {0};
+            char_uuid.len = ESP_UUID_LEN_128;
+            memcpy(char_uuid.uuid.uuid128, caps_chr_uuid128, ESP_UUID_LEN_128);
+
+            esp_err_t ret = esp_ble_gatts_add_char(
+                g_service_handle,
+                &char_uuid,
+                ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
+                &caps_attr,
+                NULL
+            );
+            if (ret) {
+                ESP_LOGE(TAG, "add caps char failed: %s", esp_err_to_name(ret));
+            }
+            break;
+        } else if (g_caps_char_handle == 0) {
+            // Capabilities are read and written, never notified: no CCCD
+            g_caps_char_handle = param->add_char.attr_handle;
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+            // Then the rate-control characteristic
+            esp_bt_uuid_t char_uuid = {0};
+            char_uuid.len = ESP_UUID_LEN_128;
+            memcpy(char_uuid.uuid.uuid128, rate_chr_uuid128, ESP_UUID_LEN_128);
+
+            esp_err_t ret = esp_ble_gatts_add_char(
+                g_service_handle,
+                &char_uuid,
+                ESP_GATT_PERM_WRITE,
+                ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR,
+                NULL,
+                NULL
+            );
+            if (ret) {
+                ESP_LOGE(TAG, "add rate char failed: %s", esp_err_to_name(ret));
+            }
+#else
+            add_event_char_or_finish();
+#endif
+            break;
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+        } else if (g_rate_char_handle == 0) {
+            // Rate control is write-only: no CCCD
+            g_rate_char_handle = param->add_char.attr_handle;
+            add_event_char_or_finish();
+            break;
+#endif
+        } else if (g_event_char_handle == 0) {
+            g_event_char_handle = param->add_char.attr_handle;
+        } else {
+            // Detector configuration is read/write without notifications: it completes the table
+            g_detector_char_handle = param->add_char.attr_handle;
+            sensor_ready = true;
+            break;
+        }
 
         // Add CCCD (0x2902)
         esp_bt_uuid_t cccd_uuid = {0};
@@ -331,40 +1813,248 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     case ESP_GATTS_ADD_CHAR_DESCR_EVT: {
         ESP_LOGI(TAG, "ADD_DESCR_EVT status=%d descr_handle=%d",
                  param->add_char_descr.status, param->add_char_descr.attr_handle);
-        g_cccd_handle = param->add_char_descr.attr_handle;
-        sensor_ready = true;
+        if (g_conn_char_handle == 0) {
+            g_cccd_handle = param->add_char_descr.attr_handle;
+
+            // Then the connection-parameter characteristic (its CCCD follows via ADD_CHAR_EVT)
+            esp_bt_uuid_t char_uuid = {0};
+            char_uuid.len = ESP_UUID_LEN_128;
+            memcpy(char_uuid.uuid.uuid128, conn_chr_uuid128, ESP_UUID_LEN_128);
+
+            esp_err_t ret = esp_ble_gatts_add_char(
+                g_service_handle,
+                &char_uuid,
+                ESP_GATT_PERM_READ,
+                ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+                &conn_attr,
+                NULL
+            );
+            if (ret) {
+                ESP_LOGE(TAG, "add conn char failed: %s", esp_err_to_name(ret));
+            }
+        } else if (g_rtt_char_handle == 0) {
+            g_conn_cccd_handle = param->add_char_descr.attr_handle;
+
+            // Then the round-trip characteristic
+            esp_bt_uuid_t char_uuid = {0};
+            char_uuid.len = ESP_UUID_LEN_128;
+            memcpy(char_uuid.uuid.uuid128, rtt_chr_uuid128, ESP_UUID_LEN_128);
+
+            esp_err_t ret = esp_ble_gatts_add_char(
+                g_service_handle,
+                &char_uuid,
+                ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE |
+                ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+                &rtt_attr,
+                NULL
+            );
+            if (ret) {
+                ESP_LOGE(TAG, "add rtt char failed: %s", esp_err_to_name(ret));
+            }
+        } else if (g_diag_char_handle == 0) {
+            g_rtt_cccd_handle = param->add_char_descr.attr_handle;
+
+            // Then the diagnostics characteristic
+            esp_bt_uuid_t char_uuid = {0};
+            char_uuid.len = ESP_UUID_LEN_128;
+            memcpy(char_uuid.uuid.uuid128, diag_chr_uuid128, ESP_UUID_LEN_128);
+
+            esp_err_t ret = esp_ble_gatts_add_char(
+                g_service_handle,
+                &char_uuid,
+                ESP_GATT_PERM_READ,
+                ESP_GATT_CHAR_PROP_BIT_READ,
+                &diag_attr,
+                NULL
+            );
+            if (ret) {
+                ESP_LOGE(TAG, "add diag char failed: %s", esp_err_to_name(ret));
+            }
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+        } else {
+            g_event_cccd_handle = param->add_char_descr.attr_handle;
+
+            // Then the detector configuration characteristic
+            esp_bt_uuid_t char_uuid = {0};
+            char_uuid.len = ESP_UUID_LEN_128;
+            memcpy(char_uuid.uuid.uuid128, detector_chr_uuid128, ESP_UUID_LEN_128);
+
+            esp_err_t ret = esp_ble_gatts_add_char(
+                g_service_handle,
+                &char_uuid,
+                ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE,
+                &detector_attr,
+                NULL
+            );
+            if (ret) {
+                ESP_LOGE(TAG, "add detector char failed: %s", esp_err_to_name(ret));
+            }
+#endif
+        }
         break;
     }
 
     case ESP_GATTS_READ_EVT: {
-        esp_gatt_rsp_t rsp;
-        memset(&rsp, 0, sizeof(rsp));
+        if (!param->read.need_rsp) {
+            break;  // an ESP_GATT_AUTO_RSP attribute: the stack has answered
+        }
+        // One response for every read instead of ~600 bytes of stack each: READ_EVTs run one at a time on the
+        // Bluedroid task, and send_response copies it. Only the fields below are ever written.
+        static esp_gatt_rsp_t rsp;
         rsp.attr_value.handle = param->read.handle;
-        rsp.attr_value.len = SENSOR_PAYLOAD_LEN;
-        memcpy(rsp.attr_value.value, sensor_value, SENSOR_PAYLOAD_LEN);
+        rsp.attr_value.offset = 0;
+        rsp.attr_value.len = 0;
+        esp_gatt_status_t status = ESP_GATT_OK;
+        if (param->read.handle == g_diag_char_handle) {
+            // Longer than a default-MTU response: the client continues with blob reads at an offset. Each
+            // connection has its own snapshot, so another central's read cannot change it mid-way.
+            peer_t *peer = peer_find(param->read.conn_id);
+            if (peer == NULL) {
+                status = ESP_GATT_INSUF_RESOURCE;  // not a tracked connection (closed as over the limit)
+            } else if (param->read.offset > sizeof(peer->diag_value)) {
+                status = ESP_GATT_INVALID_OFFSET;
+            } else {
+                if (param->read.offset == 0) {
+                    diag_build_payload(peer->diag_value);
+                }
+                rsp.attr_value.offset = param->read.offset;
+                rsp.attr_value.len = sizeof(peer->diag_value) - param->read.offset;
+                memcpy(rsp.attr_value.value, peer->diag_value + param->read.offset, rsp.attr_value.len);
+            }
+        } else if (param->read.handle == g_conn_char_handle) {
+            peer_t *peer = peer_find(param->read.conn_id);
+            rsp.attr_value.len = SENSOR_CONN_PARAMS_LEN;
+            memcpy(rsp.attr_value.value, peer ? peer->conn_value : conn_value_none, SENSOR_CONN_PARAMS_LEN);
+        } else if (param->read.handle == g_rtt_char_handle) {
+            rsp.attr_value.len = sizeof(rtt_value);
+            memcpy(rsp.attr_value.value, rtt_value, sizeof(rtt_value));
+        } else if (param->read.handle == g_caps_char_handle) {
+            rsp.attr_value.len = (uint16_t)peer_build_caps(rsp.attr_value.value, peer_find(param->read.conn_id));
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+        } else if (param->read.handle == g_event_char_handle) {
+            portENTER_CRITICAL(&event_mux);
+            rsp.attr_value.len = event_value_len;
+            memcpy(rsp.attr_value.value, event_value, event_value_len);
+            portEXIT_CRITICAL(&event_mux);
+        } else if (param->read.handle == g_detector_char_handle) {
+            rsp.attr_value.len = (uint16_t)acoustic_events_build_config(rsp.attr_value.value);
+#endif
+        } else {
+#if CONFIG_SENSOR_READ_AUTO_RSP
+            // Not the sensor value: the stack answers that one
+            rsp.attr_value.len = 0;
+#else
+            // The payload this connection was last sent, in its format and seq
+            peer_t *peer = peer_find(param->read.conn_id);
+            if (peer != NULL) {
+                rsp.attr_value.len = sensor_slot_read(peer, rsp.attr_value.value);
+            } else {
+                rsp.attr_value.len = sizeof(sensor_value_none);
+                memcpy(rsp.attr_value.value, sensor_value_none, sizeof(sensor_value_none));
+            }
+#endif
+        }
 
         esp_ble_gatts_send_response(gatts_if,
                                     param->read.conn_id,
                                     param->read.trans_id,
-                                    ESP_GATT_OK,
+                                    status,
                                     &rsp);
         break;
     }
 
     case ESP_GATTS_WRITE_EVT: {
-        // CCCD write enables/disables notifications
-        if (param->write.handle == g_cccd_handle && param->write.len == 2) {
-            uint16_t cccd = (uint16_t)((param->write.value[1] << 8) | param->write.value[0]);
-
-            if (cccd == 0x0001) {
-                notify_enabled = true;
-                ESP_LOGI(TAG, "Notifications ENABLED");
-            } else if (cccd == 0x0000) {
-                notify_enabled = false;
-                ESP_LOGI(TAG, "Notifications DISABLED");
+        peer_t *peer = peer_find(param->write.conn_id);
+
+        // Round-trip request: stamp receive time first, answer right after the write response
+        if (param->write.handle == g_rtt_char_handle) {
+            uint64_t rx_us = (uint64_t)esp_timer_get_time();
+            write_rsp_if_needed(gatts_if, param);
+            if (param->write.len != SENSOR_RTT_REQUEST_LEN || peer == NULL || !peer->rtt_notify_enabled) {
+                break;
+            }
+            uint64_t tx_us = (uint64_t)esp_timer_get_time();
+            sensor_payload_build_rtt(rtt_value, param->write.value, rx_us, (uint32_t)(tx_us - rx_us));
+            esp_ble_gatts_send_indicate(gatts_if, param->write.conn_id, g_rtt_char_handle,
+                                        sizeof(rtt_value), rtt_value, false);
+            break;
+        }
+
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+        // Detector thresholds: the response tells the client whether they were accepted
+        if (param->write.handle == g_detector_char_handle) {
+            esp_err_t err = acoustic_events_set_config(param->write.value, param->write.len);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "detector config rejected: %s", esp_err_to_name(err));
+            }
+            if (param->write.need_rsp) {
+                esp_gatt_status_t status = err == ESP_OK ? ESP_GATT_OK :
+                                           err == ESP_ERR_INVALID_SIZE ? ESP_GATT_INVALID_ATTR_LEN : ESP_GATT_OUT_OF_RANGE;
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+            }
+            break;
+        }
+#endif
+
+        if (peer == NULL) {
+            write_rsp_if_needed(gatts_if, param);
+            break; // not a tracked connection (closed as over the limit)
+        }
+
+        // Format selection: the response tells the client whether it took effect
+        if (param->write.handle == g_caps_char_handle) {
+            esp_gatt_status_t status = peer_select_format(peer, param->write.value, param->write.len);
+            if (status != ESP_GATT_OK) {
+                ESP_LOGW(TAG, "conn %u format selection of %u bytes refused", peer->conn_id, param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+            }
+            break;
+        }
+
+        // CCCD write enables/disables notifications for this connection
+        if (param->write.handle == g_cccd_handle && param->write.len == SENSOR_CCCD_LEN) {
+            bool enable;
+            if (sensor_payload_parse_cccd(param->write.value, param->write.len, &enable)) {
+                portENTER_CRITICAL(&peer_mux);
+                peer->notify_enabled = enable;
+                portEXIT_CRITICAL(&peer_mux);
+                ESP_LOGI(TAG, "conn %u notifications %s", peer->conn_id, enable ? "ENABLED" : "DISABLED");
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+                if (enable) {
+                    sample_rate_kick();  // a new subscriber starts in acquisition
+                }
+#endif
             } else {
-                ESP_LOGW(TAG, "Unknown CCCD value: 0x%04x", cccd);
+                ESP_LOGW(TAG, "Unknown CCCD value: 0x%02x%02x", param->write.value[1], param->write.value[0]);
+            }
+        } else if (param->write.handle == g_conn_cccd_handle && param->write.len == 2) {
+            peer->conn_notify_enabled = (param->write.value[0] & 0x01) != 0;
+            ESP_LOGI(TAG, "conn %u conn param notifications %s", peer->conn_id,
+                     peer->conn_notify_enabled ? "ENABLED" : "DISABLED");
+        } else if (param->write.handle == g_rtt_cccd_handle && param->write.len == 2) {
+            peer->rtt_notify_enabled = (param->write.value[0] & 0x01) != 0;
+            ESP_LOGI(TAG, "conn %u round-trip notifications %s", peer->conn_id,
+                     peer->rtt_notify_enabled ? "ENABLED" : "DISABLED");
+        } else if (param->write.handle == g_event_cccd_handle && param->write.len == 2) {
+            portENTER_CRITICAL(&peer_mux);
+            peer->event_notify_enabled = (param->write.value[0] & 0x01) != 0;
+            portEXIT_CRITICAL(&peer_mux);
+            ESP_LOGI(TAG, "conn %u event notifications %s", peer->conn_id,
+                     peer->event_notify_enabled ? "ENABLED" : "DISABLED");
+#if CONFIG_SENSOR_ADAPTIVE_RATE
+        } else if (param->write.handle == g_rate_char_handle) {
+            uint32_t rms_us;
+            uint16_t samples;
+            if (!sensor_payload_parse_rate_feedback(param->write.value, param->write.len, &rms_us, &samples)) {
+                ESP_LOGW(TAG, "conn %u rate feedback of %u bytes ignored", peer->conn_id, param->write.len);
+            } else if (peer_rate_feedback(peer, rms_us, samples)) {
+                sample_rate_kick();
             }
+#endif
         }
 
         write_rsp_if_needed(gatts_if, param);
@@ -374,21 +2064,103 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     case ESP_GATTS_CONNECT_EVT: {
         ESP_LOGI(TAG, "CONNECT conn_id=%u remote " ESP_BD_ADDR_STR,
                  param->connect.conn_id, ESP_BD_ADDR_HEX(param->connect.remote_bda));
-        g_conn_id = param->connect.conn_id;
-        notify_enabled = false; // require CCCD write after connect
+        if (peer_open(param->connect.conn_id, param->connect.remote_bda) == NULL) {
+            // The controller allows more links than SENSOR_MAX_CONNECTIONS
+            ESP_LOGW(TAG, "No free connection slot (max %d); closing conn %u", MAX_CONNECTIONS, param->connect.conn_id);
+            esp_ble_gatts_close(gatts_if, param->connect.conn_id);
+            break;
+        }
+#if CONFIG_SENSOR_READ_AUTO_RSP
+        // The stack's copy still holds the previous connection's last payload
+        (void)esp_ble_gatts_set_attr_value(g_char_handle, sizeof(sensor_value_none), sensor_value_none);
+#endif
+        // Connectable advertising stops on connect; resume it while another central fits
+        if (peer_count < MAX_CONNECTIONS) {
+            adv_start();
+        }
+
+#if CONFIG_SENSOR_CONN_PARAMS_UPDATE
+        // Ask for a short interval; the fit's spread follows the connection interval
+        esp_ble_conn_update_params_t conn_params = {0};
+        memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+        conn_params.min_int = CONFIG_SENSOR_CONN_INT_MIN;
+        conn_params.max_int = CONFIG_SENSOR_CONN_INT_MAX;
+        conn_params.latency = CONFIG_SENSOR_CONN_LATENCY;
+        conn_params.timeout = CONFIG_SENSOR_CONN_TIMEOUT;
+        esp_err_t ret = esp_ble_gap_update_conn_params(&conn_params);
+        if (ret) {
+            ESP_LOGW(TAG, "conn params update failed: %s", esp_err_to_name(ret));
+        }
+#endif
+        break;
+    }
+
+    case ESP_GATTS_CONF_EVT: {
+        // For notifications Bluedroid reports CONF once the PDU has been handed to the controller:
+        // it returns the notify scheduler's credit (and, for timed payloads, completes the delay capture).
+        // Event notifications draw on the same credits.
+        peer_t *peer = peer_find(param->conf.conn_id);
+        bool sensor = param->conf.handle == g_char_handle;
+        if (peer == NULL || (!sensor && param->conf.handle != g_event_char_handle)) {
+            break;
+        }
+        uint64_t now_us = (uint64_t)esp_timer_get_time();
+        portENTER_CRITICAL(&peer_mux);
+        if (peer->inflight > 0) {
+            peer->inflight--;
+        }
+        peer->conf_progress_us = now_us;
+#if CONFIG_SENSOR_PAYLOAD_FORMAT_TIMED
+        if (sensor && peer->tx_pending && param->conf.status == ESP_GATT_OK) {
+            peer->tx_delay_us = (uint32_t)(now_us - peer->tx_t_us);
+            peer->tx_flags = SENSOR_TIMED_FLAG_DELAY_CONF;
+            peer->tx_pending = false;
+        }
+#endif
+        portEXIT_CRITICAL(&peer_mux);
+        break;
+    }
+
+    case ESP_GATTS_CONGEST_EVT: {
+        peer_t *peer = peer_find(param->congest.conn_id);
+        if (peer != NULL) {
+            portENTER_CRITICAL(&peer_mux);
+            peer->congested = param->congest.congested;
+            portEXIT_CRITICAL(&peer_mux);
+        }
+        diag_record_congest(peer_any_congested());
+        break;
+    }
+
+    case ESP_GATTS_MTU_EVT: {
+        ESP_LOGI(TAG, "MTU conn_id=%u mtu=%u", param->mtu.conn_id, param->mtu.mtu);
+        peer_t *peer = peer_find(param->mtu.conn_id);
+        if (peer != NULL) {
+            portENTER_CRITICAL(&peer_mux);
+            peer->mtu = param->mtu.mtu;
+            portEXIT_CRITICAL(&peer_mux);
+        }
         break;
     }
 
     case ESP_GATTS_DISCONNECT_EVT: {
         ESP_LOGI(TAG, "DISCONNECT remote " ESP_BD_ADDR_STR " reason=0x%02x",
                  ESP_BD_ADDR_HEX(param->disconnect.remote_bda), param->disconnect.reason);
-        notify_enabled = false;
-        esp_ble_gap_start_advertising(&adv_params);
+        peer_t *peer = peer_find(param->disconnect.conn_id);
+        if (peer == NULL) {
+            break; // a connection closed for lack of a slot
+        }
+        bool was_full = peer_count == MAX_CONNECTIONS;
+        peer_close(peer);
+        diag_record_congest(peer_any_congested());
+        // Below the limit advertising is still running; only a full table had stopped it
+        if (was_full) {
+            adv_start();
+        }
 
-        // Turn LED off on disconnect
-        if (strip) {
-            led_strip_clear(strip);
-            led_strip_refresh(strip);
+        // Turn LED off once the last central is gone
+        if (peer_count == 0) {
+            led_post(LED_CMD_OFF);
         }
         break;
     }
@@ -401,8 +2173,21 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
 // -------------------- app_main --------------------
 void app_main(void)
 {
+    task_topology_check();
+
     // RGB LED init (no mic logic)
     led_init_rgb();
+    led_queue = xQueueCreate(LED_QUEUE_LEN, sizeof(led_cmd_t));
+    if (led_queue) {
+        task_create(led_task, "led", 2 * 1024, LED_TASK_PRIO, LED_TASK_CORE);
+    } else {
+        ESP_LOGW(TAG, "LED queue alloc failed; LED feedback disabled");
+    }
+
+#if CONFIG_EXAMPLE_SET_RAW_ADV_DATA
+    // Precompute adv/scan-response bytes now, so REG_EVT goes straight to advertising
+    adv_raw_init();
+#endif
 
     // NVS is required for BLE
     esp_err_t ret = nvs_flash_init();
@@ -412,6 +2197,18 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+#if CONFIG_SENSOR_LOW_POWER
+    // Before the controller starts, so its modem sleep comes up with light sleep already allowed
+    if (power_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep unavailable; running at full power");
+    }
+#endif
+#if CONFIG_SENSOR_BENCH
+    if (bench_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Benchmark probes unavailable");
+    }
+#endif
+
     // BLE only
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
 
@@ -442,6 +2239,16 @@ void app_main(void)
         return;
     }
 
+#if CONFIG_SENSOR_RECEIVER
+    ret = sync_receiver_start(LOCAL_MTU);
+    if (ret) {
+        ESP_LOGE(TAG, "sync receiver start failed: %s", esp_err_to_name(ret));
+        return;
+    }
+    task_create(sync_receiver_report_task, "sync_report", 3 * 1024, LED_TASK_PRIO, LED_TASK_CORE);
+    return;
+#endif
+
     // Register callbacks
     ret = esp_ble_gap_register_callback(gap_event_handler);
     if (ret) {
@@ -463,11 +2270,41 @@ void app_main(void)
     }
 
     // Optional MTU
-    ret = esp_ble_gatt_set_local_mtu(500);
+    ret = esp_ble_gatt_set_local_mtu(LOCAL_MTU);
     if (ret) {
         ESP_LOGW(TAG, "set local MTU failed: %s", esp_err_to_name(ret));
     }
 
+#if CONFIG_SENSOR_BROADCAST
+#if CONFIG_SENSOR_TIME_ROLE_RELAY
+    // Scan for a parent next to the broadcast; until one is fitted the beacon advertises itself unsynced
+    ret = time_dist_start();
+    if (ret) {
+        ESP_LOGE(TAG, "time relay start failed: %s; advertising unsynced", esp_err_to_name(ret));
+    }
+#endif
+    // Start periodic broadcast task (connectionless; the GATT service stays registered but is not advertised)
+    task_create(sensor_broadcast_task, "sensor_bcast", 3 * 1024, SENSOR_TASK_PRIO, SENSOR_TASK_CORE);
+#else
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+    // Acoustic capture and detector first, then the task that delivers their events
+    ret = acoustic_events_start();
+    if (ret) {
+        ESP_LOGE(TAG, "acoustic events start failed: %s; event characteristic stays silent", esp_err_to_name(ret));
+    } else {
+        task_create(acoustic_event_task, "event_notify", 3 * 1024, EVENT_TASK_PRIO, EVENT_TASK_CORE);
+    }
+#endif
+#if CONFIG_SENSOR_TEMPERATURE
+    ret = temperature_init();
+    if (ret) {
+        ESP_LOGW(TAG, "temperature sensor init failed: %s; payloads report it unknown", esp_err_to_name(ret));
+    } else {
+        task_create(temperature_task, "temperature", 2 * 1024, TEMP_TASK_PRIO, TEMP_TASK_CORE);
+    }
+#endif
+
     // Start periodic notify task
-    xTaskCreate(sensor_notify_task, "sensor_notify", 3 * 1024, NULL, 5, NULL);
+    task_create(sensor_notify_task, "sensor_notify", 3 * 1024, SENSOR_TASK_PRIO, SENSOR_TASK_CORE);
+#endif
 }
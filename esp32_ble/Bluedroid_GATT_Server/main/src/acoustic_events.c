@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_ACOUSTIC_EVENTS
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "acoustic_capture.h"
+#include "acoustic_detector.h"
+#include "acoustic_events.h"
+
+/* Private types */
+#define RING_LEN       ACOUSTIC_EVENTS_RING_LEN
+#define DETECTOR_CORE  CONFIG_ACOUSTIC_READER_CORE
+#define DETECTOR_PRIO  (CONFIG_ACOUSTIC_READER_PRIO - 1)  // below the reader, so detection never delays the DMA drain
+#define NVS_NAMESPACE  "acoustic"
+#define NVS_KEY_CONFIG "detector"
+
+/* Private variables */
+static const char *TAG = "acoustic_events";
+
+// Written by the detector task, read by whatever task delivers the events
+static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+static sensor_event_t ring[RING_LEN];
+static uint32_t next_seq = 0;
+
+static SemaphoreHandle_t event_sem = NULL;
+
+// Thresholds: written by a client (peer callback task), picked up by the detector task before its next
+// buffer; the detector task publishes its noise estimate back after each buffer
+static portMUX_TYPE cfg_mux = portMUX_INITIALIZER_UNLOCKED;
+static acoustic_detector_config_t cfg_active;
+static acoustic_detector_config_t cfg_pending;
+static bool cfg_changed = false;
+static uint32_t noise_floor = 0;
+static uint32_t noise_sigma = 0;
+
+/* Private functions */
+static inline uint16_t get_u16_le(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put_u16_le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32_le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Saved thresholds, or the Kconfig defaults if there are none (or they no longer validate)
+static void config_load(acoustic_detector_config_t *cfg)
+{
+    *cfg = (acoustic_detector_config_t)ACOUSTIC_DETECTOR_CONFIG_DEFAULT();
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    acoustic_detector_config_t saved;
+    size_t len = sizeof(saved);
+    if (nvs_get_blob(nvs, NVS_KEY_CONFIG, &saved, &len) == ESP_OK && len == sizeof(saved) &&
+        acoustic_detector_config_valid(&saved)) {
+        *cfg = saved;
+    }
+    nvs_close(nvs);
+}
+
+static void config_save(const acoustic_detector_config_t *cfg)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, NVS_KEY_CONFIG, cfg, sizeof(*cfg));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "saving detector config failed: %s", esp_err_to_name(err));
+    }
+}
+
+static void push_event(const acoustic_event_t *ev, bool gap)
+{
+    portENTER_CRITICAL(&ring_mux);
+    sensor_event_t *e = &ring[next_seq % RING_LEN];
+    e->seq = next_seq;
+    e->t_us = (uint64_t)ev->t_us;
+    e->peak = (uint32_t)ev->peak;
+    e->flags = gap ? SENSOR_EVENT_FLAG_GAP : 0;
+    next_seq++;
+    portEXIT_CRITICAL(&ring_mux);
+    xSemaphoreGive(event_sem);
+}
+
+static void detector_task(void *param)
+{
+    acoustic_detector_t det;
+    acoustic_detector_init(&det, &cfg_active);
+
+    acoustic_capture_stats_t stats = {0};
+    uint32_t overruns_seen = 0;
+
+    while (1) {
+        acoustic_buf_t *buf = acoustic_capture_receive(portMAX_DELAY);
+        if (buf == NULL) {
+            continue;
+        }
+
+        portENTER_CRITICAL(&cfg_mux);
+        bool changed = cfg_changed;
+        acoustic_detector_config_t cfg = cfg_pending;
+        cfg_changed = false;
+        portEXIT_CRITICAL(&cfg_mux);
+        if (changed) {
+            // Flash write off the BT callback task; applied with the floor kept
+            acoustic_detector_set_config(&det, &cfg);
+            config_save(&cfg);
+            ESP_LOGI(TAG, "detector k %u.%u sigma, release %u.%u sigma, min %" PRIu32 ", hold %u ms, floor %u ms",
+                     cfg.k_x10 / 10, cfg.k_x10 % 10, cfg.release_x10 / 10, cfg.release_x10 % 10,
+                     cfg.min_level, cfg.hold_ms, cfg.floor_ms);
+        }
+
+        acoustic_event_t ev;
+        if (acoustic_detector_process(&det, buf, &ev)) {
+            push_event(&ev, buf->gap);
+            ESP_LOGI(TAG, "event at %" PRId64 " us, peak %ld, threshold %" PRIu32 "%s", ev.t_us, (long)ev.peak,
+                     ev.threshold, buf->gap ? " (timing uncertain: overrun)" : "");
+        }
+        acoustic_capture_release(buf);
+
+        uint32_t floor, sigma;
+        acoustic_detector_noise(&det, &floor, &sigma);
+        portENTER_CRITICAL(&cfg_mux);
+        noise_floor = floor;
+        noise_sigma = sigma;
+        portEXIT_CRITICAL(&cfg_mux);
+
+        acoustic_capture_get_stats(&stats);
+        if (stats.dma_overruns != overruns_seen) {
+            ESP_LOGW(TAG, "I2S DMA overrun: %" PRIu32 " buffers lost so far", stats.dma_overruns);
+            overruns_seen = stats.dma_overruns;
+        }
+    }
+}
+
+/* Public functions */
+esp_err_t acoustic_events_start(void)
+{
+    ESP_RETURN_ON_FALSE(event_sem == NULL, ESP_ERR_INVALID_STATE, TAG, "already started");
+    event_sem = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(event_sem, ESP_ERR_NO_MEM, TAG, "event semaphore");
+
+    config_load(&cfg_active);
+    cfg_pending = cfg_active;
+
+    ESP_RETURN_ON_ERROR(acoustic_capture_start(), TAG, "capture start");
+
+    BaseType_t ok = xTaskCreatePinnedToCore(detector_task, "acoustic_det", 3 * 1024, NULL, DETECTOR_PRIO, NULL,
+                                            DETECTOR_CORE < 0 ? tskNO_AFFINITY : DETECTOR_CORE);
+    ESP_RETURN_ON_FALSE(ok == pdPASS, ESP_ERR_NO_MEM, TAG, "detector task");
+
+    ESP_LOGI(TAG, "detector k %u.%u sigma, release %u.%u sigma, min %" PRIu32 ", hold %u ms, floor %u ms",
+             cfg_active.k_x10 / 10, cfg_active.k_x10 % 10, cfg_active.release_x10 / 10, cfg_active.release_x10 % 10,
+             cfg_active.min_level, cfg_active.hold_ms, cfg_active.floor_ms);
+    return ESP_OK;
+}
+
+bool acoustic_events_wait(TickType_t timeout)
+{
+    return event_sem != NULL && xSemaphoreTake(event_sem, timeout) == pdTRUE;
+}
+
+uint32_t acoustic_events_next_seq(void)
+{
+    portENTER_CRITICAL(&ring_mux);
+    uint32_t seq = next_seq;
+    portEXIT_CRITICAL(&ring_mux);
+    return seq;
+}
+
+size_t acoustic_events_read(uint32_t from_seq, sensor_event_t *out, size_t max)
+{
+    portENTER_CRITICAL(&ring_mux);
+    uint32_t stored = next_seq < RING_LEN ? next_seq : RING_LEN;
+    uint32_t pending = next_seq - from_seq;
+    if (pending > stored) {
+        pending = stored;  // the older ones were overwritten
+    }
+    size_t n = pending < max ? pending : max;
+    uint32_t seq = next_seq - pending;
+    for (size_t i = 0; i < n; i++, seq++) {
+        out[i] = ring[seq % RING_LEN];
+    }
+    portEXIT_CRITICAL(&ring_mux);
+    return n;
+}
+
+size_t acoustic_events_build_config(uint8_t *buf)
+{
+    portENTER_CRITICAL(&cfg_mux);
+    acoustic_detector_config_t cfg = cfg_active;
+    uint32_t floor = noise_floor;
+    uint32_t sigma = noise_sigma;
+    portEXIT_CRITICAL(&cfg_mux);
+
+    buf[0] = ACOUSTIC_EVENTS_CONFIG_VERSION;
+    put_u16_le(buf + 1, cfg.k_x10);
+    put_u16_le(buf + 3, cfg.release_x10);
+    put_u32_le(buf + 5, cfg.min_level);
+    put_u16_le(buf + 9, cfg.hold_ms);
+    put_u16_le(buf + 11, cfg.floor_ms);
+    put_u32_le(buf + 13, floor);
+    put_u32_le(buf + 17, sigma);
+    return ACOUSTIC_EVENTS_CONFIG_LEN;
+}
+
+esp_err_t acoustic_events_set_config(const uint8_t *value, size_t len)
+{
+    if (len < ACOUSTIC_EVENTS_CONFIG_WRITE_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    acoustic_detector_config_t cfg = {
+        .k_x10       = get_u16_le(value + 1),
+        .release_x10 = get_u16_le(value + 3),
+        .min_level   = get_u32_le(value + 5),
+        .hold_ms     = get_u16_le(value + 9),
+        .floor_ms    = get_u16_le(value + 11),
+    };
+    if (value[0] != ACOUSTIC_EVENTS_CONFIG_VERSION || !acoustic_detector_config_valid(&cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&cfg_mux);
+    cfg_pending = cfg;
+    cfg_active = cfg;
+    cfg_changed = true;
+    portEXIT_CRITICAL(&cfg_mux);
+    return ESP_OK;
+}
+#endif // CONFIG_SENSOR_ACOUSTIC_EVENTS
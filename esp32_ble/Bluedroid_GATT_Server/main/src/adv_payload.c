@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include <string.h>
+
+#include "adv_payload.h"
+
+/* Public functions */
+size_t adv_payload_put_field(uint8_t *buf, size_t cap, size_t off, uint8_t type, const void *data, size_t data_len)
+{
+    if (data_len > UINT8_MAX - 1 || off + ADV_FIELD_HEADER_LEN + data_len > cap) {
+        return 0;
+    }
+    buf[off] = (uint8_t)(1 + data_len);
+    buf[off + 1] = type;
+    if (data_len > 0) {
+        memcpy(buf + off + ADV_FIELD_HEADER_LEN, data, data_len);
+    }
+    return off + ADV_FIELD_HEADER_LEN + data_len;
+}
+
+size_t adv_payload_put_name(uint8_t *buf, size_t cap, size_t off, const char *name)
+{
+    size_t len = strlen(name);
+    if (off + ADV_FIELD_HEADER_LEN + len <= cap) {
+        return adv_payload_put_field(buf, cap, off, ADV_TYPE_NAME_CMPL, name, len);
+    }
+    if (off + ADV_FIELD_HEADER_LEN >= cap) {
+        return 0;
+    }
+    return adv_payload_put_field(buf, cap, off, ADV_TYPE_NAME_SHORT, name, cap - off - ADV_FIELD_HEADER_LEN);
+}
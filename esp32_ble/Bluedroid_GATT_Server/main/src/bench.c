@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_BENCH
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sensor_payload.h"
+#include "bench.h"
+
+/* Defines */
+#define BENCH_GPIO       CONFIG_SENSOR_BENCH_GPIO
+#define BENCH_REPORT_MS  CONFIG_SENSOR_BENCH_REPORT_MS
+#define BENCH_TASK_PRIO  (tskIDLE_PRIORITY + 1)  // below everything it measures
+
+/* Private variables */
+static const char *TAG = "BENCH";
+
+static uint32_t marker_level = 0;   // sample task or timer ISR only, never both
+static uint32_t captures = 0;       // atomics: the ISR and the notify tasks add, the report task reads
+static uint32_t notifies = 0;
+static uint32_t att_bytes = 0;
+
+/* Private functions */
+static uint32_t idle_counter(BaseType_t core)
+{
+    return (uint32_t)ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+}
+
+// Counters are only ever diffed between reports, which also absorbs their wrap
+static void bench_report_task(void *param)
+{
+    uint32_t last_wall = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t last_idle[portNUM_PROCESSORS];
+    for (BaseType_t c = 0; c < portNUM_PROCESSORS; c++) {
+        last_idle[c] = idle_counter(c);
+    }
+    uint32_t last_captures = 0, last_notifies = 0, last_bytes = 0;
+    uint64_t last_us = (uint64_t)esp_timer_get_time();
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BENCH_REPORT_MS));
+        uint64_t now_us = (uint64_t)esp_timer_get_time();
+        uint32_t wall = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+        uint32_t wall_delta = wall - last_wall;
+        char busy[8 * portNUM_PROCESSORS];
+        size_t off = 0;
+        for (BaseType_t c = 0; c < portNUM_PROCESSORS; c++) {
+            uint32_t idle = idle_counter(c);
+            uint32_t idle_delta = idle - last_idle[c];
+            last_idle[c] = idle;
+            uint32_t busy_pm = wall_delta && idle_delta < wall_delta
+                               ? (uint32_t)(1000 - (uint64_t)idle_delta * 1000 / wall_delta) : 0;
+            off += (size_t)snprintf(busy + off, sizeof(busy) - off, c ? ",%" PRIu32 : "%" PRIu32, busy_pm);
+        }
+        last_wall = wall;
+
+        uint32_t n_captures = __atomic_load_n(&captures, __ATOMIC_RELAXED);
+        uint32_t n_notifies = __atomic_load_n(&notifies, __ATOMIC_RELAXED);
+        uint32_t n_bytes = __atomic_load_n(&att_bytes, __ATOMIC_RELAXED);
+        ESP_LOGI(TAG, "t_us=%" PRIu64 " window_ms=%" PRIu32 " busy_pm=%s captures=%" PRIu32 " notifies=%" PRIu32
+                 " att_bytes=%" PRIu32, now_us, (uint32_t)((now_us - last_us) / 1000), busy,
+                 n_captures - last_captures, n_notifies - last_notifies, n_bytes - last_bytes);
+        last_captures = n_captures;
+        last_notifies = n_notifies;
+        last_bytes = n_bytes;
+        last_us = now_us;
+    }
+}
+
+/* Public functions */
+esp_err_t bench_init(void)
+{
+    esp_err_t err = gpio_reset_pin(BENCH_GPIO);
+    if (err == ESP_OK) {
+        err = gpio_set_direction(BENCH_GPIO, GPIO_MODE_OUTPUT);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "marker GPIO %d: %s", BENCH_GPIO, esp_err_to_name(err));
+        return err;
+    }
+    (void)gpio_set_level(BENCH_GPIO, 0);
+    if (xTaskCreatePinnedToCore(bench_report_task, "bench", 3 * 1024, NULL, BENCH_TASK_PRIO, NULL,
+                                tskNO_AFFINITY) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Capture marker on GPIO %d, report every %d ms", BENCH_GPIO, BENCH_REPORT_MS);
+    return ESP_OK;
+}
+
+void IRAM_ATTR bench_capture_mark(void)
+{
+    marker_level ^= 1;
+    (void)gpio_set_level(BENCH_GPIO, marker_level);
+    __atomic_fetch_add(&captures, 1, __ATOMIC_RELAXED);
+}
+
+void bench_record_notify(size_t len)
+{
+    __atomic_fetch_add(&notifies, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&att_bytes, (uint32_t)(len + SENSOR_ATT_NOTIFY_OVERHEAD), __ATOMIC_RELAXED);
+}
+#endif // CONFIG_SENSOR_BENCH
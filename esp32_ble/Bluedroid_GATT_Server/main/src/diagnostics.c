@@ -0,0 +1,224 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "diagnostics.h"
+#if CONFIG_SENSOR_LOW_POWER
+#include "power.h"
+#endif
+
+/* Private types */
+typedef struct {
+    esp_err_t err;
+    uint32_t  count;
+} diag_err_slot_t;
+
+/* Private variables */
+// Written by the notify task and the Bluedroid callback task, read on ESP_GATTS_READ_EVT
+static portMUX_TYPE diag_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t send_calls = 0;
+static uint32_t send_failures = 0;
+static uint32_t send_max_us = 0;
+static uint32_t latency_buckets[DIAG_LATENCY_BUCKETS] = {0};
+static diag_err_slot_t err_slots[DIAG_ERR_SLOTS] = {0};
+
+static uint32_t queue_dropped = 0;
+static uint32_t queue_coalesced = 0;
+
+static uint32_t congest_events = 0;
+static bool     congested = false;
+static uint64_t congested_since_us = 0;
+static uint64_t congested_total_us = 0;
+
+static uint32_t boot_id = 0;
+
+static uint32_t wake_count = 0;
+static uint32_t wake_late_max_us = 0;
+static uint64_t wake_late_sum_us = 0;
+
+/* Private functions */
+static inline void put_u16_le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32_le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void put_u64_le(uint8_t *p, uint64_t v)
+{
+    put_u32_le(p, (uint32_t)v);
+    put_u32_le(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline size_t latency_bucket(uint32_t us)
+{
+    if (us < 2) {
+        return 0;
+    }
+    size_t b = 31 - (size_t)__builtin_clz(us);
+    return b < DIAG_LATENCY_BUCKETS ? b : DIAG_LATENCY_BUCKETS - 1;
+}
+
+// Caller holds diag_mux
+static void count_error(esp_err_t err)
+{
+    for (size_t i = 0; i < DIAG_ERR_SLOTS; i++) {
+        if (err_slots[i].count == 0) {
+            err_slots[i].err = err;
+        }
+        if (err_slots[i].err == err) {
+            err_slots[i].count++;
+            return;
+        }
+    }
+}
+
+/* Public functions */
+void diag_record_send(uint32_t latency_us, esp_err_t err)
+{
+    portENTER_CRITICAL(&diag_mux);
+    send_calls++;
+    latency_buckets[latency_bucket(latency_us)]++;
+    if (latency_us > send_max_us) {
+        send_max_us = latency_us;
+    }
+    if (err != ESP_OK) {
+        send_failures++;
+        count_error(err);
+    }
+    portEXIT_CRITICAL(&diag_mux);
+}
+
+void diag_record_queue(uint32_t dropped, uint32_t coalesced)
+{
+    portENTER_CRITICAL(&diag_mux);
+    queue_dropped += dropped;
+    queue_coalesced += coalesced;
+    portEXIT_CRITICAL(&diag_mux);
+}
+
+void diag_record_congest(bool now_congested)
+{
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    portENTER_CRITICAL(&diag_mux);
+    if (now_congested && !congested) {
+        congest_events++;
+        congested_since_us = now_us;
+    } else if (!now_congested && congested) {
+        congested_total_us += now_us - congested_since_us;
+    }
+    congested = now_congested;
+    portEXIT_CRITICAL(&diag_mux);
+}
+
+void diag_task_woke(diag_wake_t *w, TickType_t scheduled_tick)
+{
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    if (!w->anchored) {
+        // Tick-aligned wake-ups: anchoring on one keeps the tick phase out of later readings
+        w->anchored = true;
+        w->anchor_tick = scheduled_tick;
+        w->anchor_us = now_us;
+        return;
+    }
+    uint64_t due_us = w->anchor_us + (uint64_t)(TickType_t)(scheduled_tick - w->anchor_tick) * portTICK_PERIOD_MS * 1000;
+    diag_record_wake_lateness(now_us > due_us ? (uint32_t)(now_us - due_us) : 0);
+}
+
+void diag_record_wake_lateness(uint32_t late_us)
+{
+    portENTER_CRITICAL(&diag_mux);
+    wake_count++;
+    wake_late_sum_us += late_us;
+    if (late_us > wake_late_max_us) {
+        wake_late_max_us = late_us;
+    }
+    portEXIT_CRITICAL(&diag_mux);
+}
+
+uint32_t diag_boot_id(void)
+{
+    portENTER_CRITICAL(&diag_mux);
+    uint32_t id = boot_id;
+    portEXIT_CRITICAL(&diag_mux);
+    if (id != 0) {
+        return id;
+    }
+
+    // First asked for once a client is connected, so the RNG has the radio as entropy source by then
+    uint32_t fresh;
+    do {
+        fresh = esp_random();
+    } while (fresh == 0);
+    portENTER_CRITICAL(&diag_mux);
+    if (boot_id == 0) {
+        boot_id = fresh;
+    }
+    id = boot_id;
+    portEXIT_CRITICAL(&diag_mux);
+    return id;
+}
+
+size_t diag_build_payload(uint8_t *buf)
+{
+    uint32_t id = diag_boot_id();
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    uint32_t free_heap = esp_get_free_heap_size();
+    uint32_t min_free_heap = esp_get_minimum_free_heap_size();
+
+    memset(buf, 0, DIAG_PAYLOAD_LEN);
+    buf[0] = DIAG_PAYLOAD_VERSION;
+    buf[1] = DIAG_LATENCY_BUCKETS;
+    buf[2] = DIAG_ERR_SLOTS;
+    put_u64_le(buf + 4, now_us);
+
+    portENTER_CRITICAL(&diag_mux);
+    uint64_t congested_us = congested_total_us + (congested ? now_us - congested_since_us : 0);
+    put_u32_le(buf + 12, send_calls);
+    put_u32_le(buf + 16, send_failures);
+    put_u32_le(buf + 20, send_max_us);
+    put_u32_le(buf + 24, congest_events);
+    put_u32_le(buf + 28, (uint32_t)(congested_us / 1000));
+    put_u32_le(buf + 32, wake_count);
+    put_u32_le(buf + 36, wake_late_max_us);
+    put_u64_le(buf + 40, wake_late_sum_us);
+    uint8_t *p = buf + 56;
+    for (size_t i = 0; i < DIAG_LATENCY_BUCKETS; i++, p += 4) {
+        put_u32_le(p, latency_buckets[i]);
+    }
+    for (size_t i = 0; i < DIAG_ERR_SLOTS; i++, p += 8) {
+        put_u32_le(p, (uint32_t)err_slots[i].err);
+        put_u32_le(p + 4, err_slots[i].count);
+    }
+    put_u32_le(p, queue_dropped);
+    put_u32_le(p + 4, queue_coalesced);
+    put_u32_le(p + 8, id);
+    portEXIT_CRITICAL(&diag_mux);
+#if CONFIG_SENSOR_LOW_POWER
+    if (power_flags() & POWER_FLAG_LIGHT_SLEEP) {
+        put_u16_le(p + 12, CONFIG_SENSOR_SLEEP_CLOCK_PPM);
+        p[14] = power_flags();
+        put_u32_le(p + 16, power_slept_ms());
+    }
+#endif
+
+    put_u32_le(buf + 48, free_heap);
+    put_u32_le(buf + 52, min_free_heap);
+    return DIAG_PAYLOAD_LEN;
+}
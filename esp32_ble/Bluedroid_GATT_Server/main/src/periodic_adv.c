@@ -0,0 +1,182 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_PERIODIC_ADV
+#include "esp_log.h"
+
+#include "periodic_adv.h"
+
+/* Defines */
+#define PERIODIC_ADV_INSTANCE  0
+#define PERIODIC_ADV_SID       0
+#define PERIODIC_EXT_ADV_INT   0x00A0  // 100 ms: extended events only announce the train and the SyncInfo
+
+/* Private types */
+typedef enum {
+    STEP_IDLE,
+    STEP_EXT_PARAMS,       // esp_ble_gap_ext_adv_set_params
+    STEP_EXT_DATA,         // esp_ble_gap_config_ext_adv_data_raw
+    STEP_PERIODIC_PARAMS,  // esp_ble_gap_periodic_adv_set_params
+    STEP_PERIODIC_DATA,    // esp_ble_gap_config_periodic_adv_data_raw
+    STEP_PERIODIC_START,   // esp_ble_gap_periodic_adv_start
+    STEP_EXT_START,        // esp_ble_gap_ext_adv_start
+    STEP_RUNNING,
+} periodic_step_t;
+
+/* Private variables */
+static const char *TAG = "PERIODIC_ADV";
+
+static esp_ble_gap_ext_adv_params_t ext_adv_params = {
+    .type          = ESP_BLE_GAP_SET_EXT_ADV_PROP_NONCONN_NONSCANNABLE_UNDIRECTED,
+    .interval_min  = PERIODIC_EXT_ADV_INT,
+    .interval_max  = PERIODIC_EXT_ADV_INT,
+    .channel_map   = ADV_CHNL_ALL,
+    .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+    .filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+    .tx_power      = EXT_ADV_TX_PWR_NO_PREFERENCE,
+    .primary_phy   = ESP_BLE_GAP_PHY_1M,
+    .max_skip      = 0,
+    .secondary_phy = ESP_BLE_GAP_PHY_1M,  // the train inherits it: 1M reaches every BLE 5 receiver
+    .sid           = PERIODIC_ADV_SID,
+    .scan_req_notif = false,
+};
+
+static esp_ble_gap_periodic_adv_params_t periodic_params = {
+    .properties = 0,  // no TX power in the periodic PDUs
+};
+
+static const esp_ble_gap_ext_adv_t ext_adv_start = {
+    .instance   = PERIODIC_ADV_INSTANCE,
+    .duration   = 0,  // until stopped
+    .max_events = 0,
+};
+
+// Setup state: GAP events only (BTC task), plus the flag the broadcast task polls
+static periodic_step_t step = STEP_IDLE;
+static const uint8_t *setup_ext_data;
+static uint16_t setup_ext_len;
+static const uint8_t *setup_periodic_data;
+static uint16_t setup_periodic_len;
+static volatile bool running = false;
+
+/* Private functions */
+static void step_fail(const char *what, int status)
+{
+    ESP_LOGE(TAG, "%s failed, status=%d; no periodic advertising", what, status);
+    step = STEP_IDLE;
+}
+
+// Run one setup step; its completion event runs the next
+static void step_run(periodic_step_t next)
+{
+    esp_err_t err = ESP_OK;
+    step = next;
+    switch (next) {
+    case STEP_EXT_PARAMS:
+        err = esp_ble_gap_ext_adv_set_params(PERIODIC_ADV_INSTANCE, &ext_adv_params);
+        break;
+    case STEP_EXT_DATA:
+        err = esp_ble_gap_config_ext_adv_data_raw(PERIODIC_ADV_INSTANCE, setup_ext_len, setup_ext_data);
+        break;
+    case STEP_PERIODIC_PARAMS:
+        err = esp_ble_gap_periodic_adv_set_params(PERIODIC_ADV_INSTANCE, &periodic_params);
+        break;
+    case STEP_PERIODIC_DATA:
+        err = esp_ble_gap_config_periodic_adv_data_raw(PERIODIC_ADV_INSTANCE, setup_periodic_len, setup_periodic_data, false);
+        break;
+    case STEP_PERIODIC_START:
+        err = esp_ble_gap_periodic_adv_start(PERIODIC_ADV_INSTANCE);
+        break;
+    case STEP_EXT_START:
+        err = esp_ble_gap_ext_adv_start(1, &ext_adv_start);
+        break;
+    default:
+        break;
+    }
+    if (err != ESP_OK) {
+        step_fail("setup call", err);
+    }
+}
+
+// Completion of the current setup step: advance, or give up on an error status
+static void step_done(periodic_step_t done, esp_bt_status_t status, periodic_step_t next)
+{
+    if (step != done) {
+        return;  // a data update while running, or a stale event
+    }
+    if (status != ESP_BT_STATUS_SUCCESS) {
+        step_fail("setup step", status);
+        return;
+    }
+    if (next == STEP_RUNNING) {
+        step = STEP_RUNNING;
+        running = true;
+        ESP_LOGI(TAG, "Periodic advertising started, interval=%u x 1.25 ms", periodic_params.interval_min);
+        return;
+    }
+    step_run(next);
+}
+
+/* Public functions */
+esp_err_t periodic_adv_start(const uint8_t *ext_data, uint16_t ext_len, const uint8_t *periodic_data,
+                             uint16_t periodic_len, uint16_t interval)
+{
+    if (step != STEP_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    setup_ext_data = ext_data;
+    setup_ext_len = ext_len;
+    setup_periodic_data = periodic_data;
+    setup_periodic_len = periodic_len;
+    // Fixed interval: min = max, so the controller cannot pick another one
+    periodic_params.interval_min = interval;
+    periodic_params.interval_max = interval;
+    step_run(STEP_EXT_PARAMS);
+    return step == STEP_IDLE ? ESP_FAIL : ESP_OK;
+}
+
+void periodic_adv_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    switch (event) {
+    case ESP_GAP_BLE_EXT_ADV_SET_PARAMS_COMPLETE_EVT:
+        step_done(STEP_EXT_PARAMS, param->ext_adv_set_params.status, STEP_EXT_DATA);
+        break;
+    case ESP_GAP_BLE_EXT_ADV_DATA_SET_COMPLETE_EVT:
+        step_done(STEP_EXT_DATA, param->ext_adv_data_set.status, STEP_PERIODIC_PARAMS);
+        break;
+    case ESP_GAP_BLE_PERIODIC_ADV_SET_PARAMS_COMPLETE_EVT:
+        step_done(STEP_PERIODIC_PARAMS, param->peroid_adv_set_params.status, STEP_PERIODIC_DATA);
+        break;
+    case ESP_GAP_BLE_PERIODIC_ADV_DATA_SET_COMPLETE_EVT:
+        step_done(STEP_PERIODIC_DATA, param->period_adv_data_set.status, STEP_PERIODIC_START);
+        break;
+    case ESP_GAP_BLE_PERIODIC_ADV_START_COMPLETE_EVT:
+        step_done(STEP_PERIODIC_START, param->period_adv_start.status, STEP_EXT_START);
+        break;
+    case ESP_GAP_BLE_EXT_ADV_START_COMPLETE_EVT:
+        step_done(STEP_EXT_START, param->ext_adv_start.status, STEP_RUNNING);
+        break;
+    default:
+        break;
+    }
+}
+
+bool periodic_adv_running(void)
+{
+    return running;
+}
+
+esp_err_t periodic_adv_update(const uint8_t *ext_data, uint16_t ext_len, const uint8_t *periodic_data,
+                              uint16_t periodic_len)
+{
+    // Periodic train first: it is the timing reference
+    esp_err_t err = esp_ble_gap_config_periodic_adv_data_raw(PERIODIC_ADV_INSTANCE, periodic_len, periodic_data, false);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_ble_gap_config_ext_adv_data_raw(PERIODIC_ADV_INSTANCE, ext_len, ext_data);
+}
+#endif // CONFIG_SENSOR_PERIODIC_ADV
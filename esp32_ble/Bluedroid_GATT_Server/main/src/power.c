@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_LOW_POWER
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+
+#include "power.h"
+
+/* Private variables */
+static const char *TAG = "POWER";
+
+static uint8_t flags = 0;
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+// Sleep callbacks run on the idle task with interrupts off; the diagnostics read only needs slept_ms
+static int64_t sleep_enter_us = 0;
+static uint32_t slept_rem_us = 0;
+static volatile uint32_t slept_ms = 0;
+#endif
+
+/* Private functions */
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static esp_err_t IRAM_ATTR sleep_enter_cb(int64_t sleep_time_us, void *arg)
+{
+    sleep_enter_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+// Measured rather than taken from sleep_time_us: a wake-up source can end the sleep early
+static esp_err_t IRAM_ATTR sleep_exit_cb(int64_t sleep_time_us, void *arg)
+{
+    slept_rem_us += (uint32_t)(esp_timer_get_time() - sleep_enter_us);
+    slept_ms += slept_rem_us / 1000;
+    slept_rem_us %= 1000;
+    return ESP_OK;
+}
+#endif
+
+/* Public functions */
+esp_err_t power_init(void)
+{
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_SENSOR_PM_MIN_FREQ_MHZ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    flags = POWER_FLAG_LIGHT_SLEEP;
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {
+        .enter_cb = sleep_enter_cb,
+        .exit_cb = sleep_exit_cb,
+    };
+    err = esp_pm_light_sleep_register_cbs(&cbs);
+    if (err == ESP_OK) {
+        flags |= POWER_FLAG_SLEEP_COUNTED;
+    } else {
+        ESP_LOGW(TAG, "sleep callbacks not registered: %s", esp_err_to_name(err));
+    }
+#endif
+
+    ESP_LOGI(TAG, "Light sleep on: CPU %d..%d MHz, sleep clock %d ppm", CONFIG_SENSOR_PM_MIN_FREQ_MHZ,
+             CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, CONFIG_SENSOR_SLEEP_CLOCK_PPM);
+    return ESP_OK;
+}
+
+uint8_t power_flags(void)
+{
+    return flags;
+}
+
+uint32_t power_slept_ms(void)
+{
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    return slept_ms;
+#else
+    return 0;
+#endif
+}
+#endif // CONFIG_SENSOR_LOW_POWER
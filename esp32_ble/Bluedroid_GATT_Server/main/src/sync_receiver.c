@@ -0,0 +1,448 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_RECEIVER
+#include <inttypes.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_common_api.h"
+#include "esp_gattc_api.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "cheepsync.h"
+#include "sensor_payload.h"
+#include "sync_receiver.h"
+
+/* Defines */
+#define RECEIVER_MAX_BEACONS   CONFIG_SENSOR_RECEIVER_MAX_BEACONS
+#define RECEIVER_WINDOW        CONFIG_SENSOR_RECEIVER_WINDOW
+#define RECEIVER_REPORT_MS     CONFIG_SENSOR_RECEIVER_REPORT_MS
+#define RECEIVER_APP_ID        0
+#define RECEIVER_SVC_UUID      0x181A  // same service as the server side
+#define RECEIVER_RESTART_US    1000000 // t_us this far behind the last one: the beacon rebooted
+
+/* Private types */
+typedef enum {
+    SLOT_FREE,
+    SLOT_OPENING,    // esp_ble_gattc_open() issued
+    SLOT_SETUP,      // connected: MTU, discovery, subscription
+    SLOT_STREAMING,  // CCCD written; notifications feed the fit
+} slot_state_t;
+
+// What the report task reads: copied out of the BTC task under rx_mux after every sample
+typedef struct {
+    cheepsync_fit_t fit;
+    double   rms_ns;
+    uint32_t samples;
+    uint32_t restarts;
+    uint32_t malformed;
+    bool     has_fit;
+} beacon_report_t;
+
+typedef struct {
+    slot_state_t    state;
+    esp_bd_addr_t   bda;
+    uint16_t        conn_id;
+    uint16_t        svc_start;
+    uint16_t        svc_end;
+    uint16_t        char_handle;
+    bool            have_t;
+    uint64_t        last_t_us;
+    cheepsync_t     sync;       // BTC task only
+    beacon_report_t report;     // under rx_mux
+} beacon_t;
+
+/* Private variables */
+static const char *TAG = "SYNC_RX";
+
+// 0015a1a1-1212-efde-1523-785feabcd123, as served by main.c
+static const uint8_t sensor_chr_uuid128[16] = {
+    0x23, 0xD1, 0xBC, 0xEA, 0x5F, 0x78, 0x23, 0x15,
+    0xDE, 0xEF, 0x12, 0x12, 0xA1, 0xA1, 0x15, 0x00
+};
+
+static esp_ble_scan_params_t scan_params = {
+    .scan_type          = BLE_SCAN_TYPE_ACTIVE,  // the raw advertising path has the service UUID in the scan response
+    .own_addr_type      = BLE_ADDR_TYPE_PUBLIC,
+    .scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL,
+    .scan_interval      = 0x50,  // 50 ms
+    .scan_window        = 0x30,  // 30 ms: leaves room for the connection events of beacons already streaming
+    .scan_duplicate     = BLE_SCAN_DUPLICATE_DISABLE,
+};
+
+// Callbacks and slot state run in the Bluedroid BTC task; only the reports cross to another task
+static portMUX_TYPE rx_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static beacon_t beacons[RECEIVER_MAX_BEACONS];
+static esp_gatt_if_t rx_gattc_if = ESP_GATT_IF_NONE;
+static beacon_t *setting_up = NULL;  // one connection set up at a time: REG_FOR_NOTIFY_EVT names no connection
+static bool scanning = false;
+
+/* Private functions */
+static beacon_t *beacon_by_conn(uint16_t conn_id)
+{
+    for (size_t i = 0; i < RECEIVER_MAX_BEACONS; i++) {
+        if (beacons[i].state >= SLOT_SETUP && beacons[i].conn_id == conn_id) {
+            return &beacons[i];
+        }
+    }
+    return NULL;
+}
+
+static beacon_t *beacon_by_bda(const uint8_t *bda)
+{
+    for (size_t i = 0; i < RECEIVER_MAX_BEACONS; i++) {
+        if (beacons[i].state != SLOT_FREE && memcmp(beacons[i].bda, bda, sizeof(esp_bd_addr_t)) == 0) {
+            return &beacons[i];
+        }
+    }
+    return NULL;
+}
+
+static beacon_t *beacon_free_slot(void)
+{
+    for (size_t i = 0; i < RECEIVER_MAX_BEACONS; i++) {
+        if (beacons[i].state == SLOT_FREE) {
+            return &beacons[i];
+        }
+    }
+    return NULL;
+}
+
+static void beacon_release(beacon_t *b)
+{
+    portENTER_CRITICAL(&rx_mux);
+    memset(&b->report, 0, sizeof(b->report));
+    b->state = SLOT_FREE;
+    portEXIT_CRITICAL(&rx_mux);
+    if (setting_up == b) {
+        setting_up = NULL;
+    }
+}
+
+// Scan while a slot is free and no connection is being set up (Bluedroid connects more reliably
+// with the scanner off)
+static void scan_update(void)
+{
+    bool want = setting_up == NULL && beacon_free_slot() != NULL;
+    if (want && !scanning) {
+        esp_err_t err = esp_ble_gap_start_scanning(0);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "start scanning failed: %s", esp_err_to_name(err));
+            return;
+        }
+        scanning = true;
+    } else if (!want && scanning) {
+        esp_ble_gap_stop_scanning();
+        scanning = false;
+    }
+}
+
+static bool adv_has_sensor_service(esp_ble_gap_cb_param_t *param)
+{
+    uint16_t len = param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len;
+    static const esp_ble_adv_data_type types[] = { ESP_BLE_AD_TYPE_16SRV_CMPL, ESP_BLE_AD_TYPE_16SRV_PART };
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        uint8_t field_len = 0;
+        uint8_t *p = esp_ble_resolve_adv_data_by_type(param->scan_rst.ble_adv, len, types[t], &field_len);
+        for (uint8_t i = 0; p != NULL && i + 1 < field_len; i += 2) {
+            if ((uint16_t)(p[i] | (p[i + 1] << 8)) == RECEIVER_SVC_UUID) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Close a link whose setup failed; DISCONNECT_EVT frees the slot
+static void beacon_abort(beacon_t *b, const char *why)
+{
+    ESP_LOGW(TAG, "[" ESP_BD_ADDR_STR "] %s; disconnecting", ESP_BD_ADDR_HEX(b->bda), why);
+    esp_ble_gattc_close(rx_gattc_if, b->conn_id);
+}
+
+static void beacon_receive(beacon_t *b, const uint8_t *value, uint16_t len, int64_t rx_us)
+{
+    sensor_record_t rec;
+    if (!sensor_payload_parse_newest(value, len, &rec)) {
+        portENTER_CRITICAL(&rx_mux);
+        b->report.malformed++;
+        portEXIT_CRITICAL(&rx_mux);
+        return;
+    }
+
+    bool restarted = false;
+    if (b->have_t && rec.t_us <= b->last_t_us) {
+        if (b->last_t_us - rec.t_us < RECEIVER_RESTART_US) {
+            return;  // repeat of a stamp already fitted (same newest record after a coalesced backlog)
+        }
+        // The beacon's clock started over: its old fit maps nothing any more
+        cheepsync_reset(&b->sync);
+        restarted = true;
+    }
+    b->have_t = true;
+    b->last_t_us = rec.t_us;
+    cheepsync_add(&b->sync, (int64_t)rec.t_us, rx_us * 1000);
+
+    portENTER_CRITICAL(&rx_mux);
+    b->report.fit = cheepsync_get_fit(&b->sync);
+    b->report.rms_ns = b->sync.rms_ns;
+    b->report.has_fit = b->sync.has_fit;
+    b->report.samples++;
+    if (restarted) {
+        b->report.restarts++;
+    }
+    portEXIT_CRITICAL(&rx_mux);
+}
+
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    switch (event) {
+    case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
+        scan_update();
+        break;
+
+    case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+        if (param->scan_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGE(TAG, "scan start failed, status=%d", param->scan_start_cmpl.status);
+            scanning = false;
+        }
+        break;
+
+    case ESP_GAP_BLE_SCAN_RESULT_EVT: {
+        if (param->scan_rst.search_evt != ESP_GAP_SEARCH_INQ_RES_EVT || setting_up != NULL) {
+            break;
+        }
+        if (beacon_by_bda(param->scan_rst.bda) != NULL || !adv_has_sensor_service(param)) {
+            break;
+        }
+        beacon_t *b = beacon_free_slot();
+        if (b == NULL) {
+            break;
+        }
+        memset(b, 0, sizeof(*b));
+        memcpy(b->bda, param->scan_rst.bda, sizeof(esp_bd_addr_t));
+        cheepsync_init(&b->sync, RECEIVER_WINDOW, CHEEPSYNC_LOWER_ENVELOPE);
+        b->state = SLOT_OPENING;
+        setting_up = b;
+        scan_update();
+        ESP_LOGI(TAG, "[" ESP_BD_ADDR_STR "] sensor beacon found (rssi %d), connecting",
+                 ESP_BD_ADDR_HEX(b->bda), param->scan_rst.rssi);
+        esp_err_t err = esp_ble_gattc_open(rx_gattc_if, b->bda, param->scan_rst.ble_addr_type, true);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "open failed: %s", esp_err_to_name(err));
+            beacon_release(b);
+            scan_update();
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+static void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param)
+{
+    // First thing: the receive time of a notification, before any lookup
+    int64_t rx_us = esp_timer_get_time();
+
+    switch (event) {
+    case ESP_GATTC_REG_EVT:
+        if (param->reg.status != ESP_GATT_OK) {
+            ESP_LOGE(TAG, "GATTC app register failed, status=%d", param->reg.status);
+            break;
+        }
+        rx_gattc_if = gattc_if;
+        esp_ble_gap_set_scan_params(&scan_params);
+        break;
+
+    case ESP_GATTC_OPEN_EVT: {
+        beacon_t *b = beacon_by_bda(param->open.remote_bda);
+        if (b == NULL) {
+            break;
+        }
+        if (param->open.status != ESP_GATT_OK) {
+            ESP_LOGW(TAG, "[" ESP_BD_ADDR_STR "] connect failed, status=%d", ESP_BD_ADDR_HEX(b->bda), param->open.status);
+            beacon_release(b);
+            scan_update();
+            break;
+        }
+        b->conn_id = param->open.conn_id;
+        b->state = SLOT_SETUP;
+        esp_ble_gattc_send_mtu_req(gattc_if, b->conn_id);
+        break;
+    }
+
+    case ESP_GATTC_CFG_MTU_EVT: {
+        beacon_t *b = beacon_by_conn(param->cfg_mtu.conn_id);
+        if (b == NULL || b->state != SLOT_SETUP) {
+            break;
+        }
+        // Search even if the MTU exchange failed: at 23 bytes the beacon falls back to single records
+        esp_bt_uuid_t svc = { .len = ESP_UUID_LEN_16, .uuid = { .uuid16 = RECEIVER_SVC_UUID } };
+        esp_ble_gattc_search_service(gattc_if, b->conn_id, &svc);
+        break;
+    }
+
+    case ESP_GATTC_SEARCH_RES_EVT: {
+        beacon_t *b = beacon_by_conn(param->search_res.conn_id);
+        if (b != NULL && param->search_res.srvc_id.uuid.len == ESP_UUID_LEN_16 &&
+            param->search_res.srvc_id.uuid.uuid.uuid16 == RECEIVER_SVC_UUID) {
+            b->svc_start = param->search_res.start_handle;
+            b->svc_end = param->search_res.end_handle;
+        }
+        break;
+    }
+
+    case ESP_GATTC_SEARCH_CMPL_EVT: {
+        beacon_t *b = beacon_by_conn(param->search_cmpl.conn_id);
+        if (b == NULL || b->state != SLOT_SETUP) {
+            break;
+        }
+        if (param->search_cmpl.status != ESP_GATT_OK || b->svc_start == 0) {
+            beacon_abort(b, "sensor service not found");
+            break;
+        }
+        esp_bt_uuid_t chr = { .len = ESP_UUID_LEN_128 };
+        memcpy(chr.uuid.uuid128, sensor_chr_uuid128, sizeof(sensor_chr_uuid128));
+        esp_gattc_char_elem_t elem;
+        uint16_t count = 1;
+        if (esp_ble_gattc_get_char_by_uuid(gattc_if, b->conn_id, b->svc_start, b->svc_end, chr, &elem, &count) != ESP_GATT_OK ||
+            count == 0) {
+            beacon_abort(b, "sensor characteristic not found");
+            break;
+        }
+        b->char_handle = elem.char_handle;
+        esp_ble_gattc_register_for_notify(gattc_if, b->bda, b->char_handle);
+        break;
+    }
+
+    case ESP_GATTC_REG_FOR_NOTIFY_EVT: {
+        beacon_t *b = setting_up;
+        if (b == NULL || b->state != SLOT_SETUP || param->reg_for_notify.handle != b->char_handle) {
+            break;
+        }
+        esp_bt_uuid_t cccd_uuid = { .len = ESP_UUID_LEN_16, .uuid = { .uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG } };
+        esp_gattc_descr_elem_t cccd;
+        uint16_t count = 1;
+        if (param->reg_for_notify.status != ESP_GATT_OK ||
+            esp_ble_gattc_get_descr_by_char_handle(gattc_if, b->conn_id, b->char_handle, cccd_uuid, &cccd, &count) != ESP_GATT_OK ||
+            count == 0) {
+            beacon_abort(b, "cannot subscribe to the sensor characteristic");
+            break;
+        }
+        uint8_t enable[2] = { 0x01, 0x00 };
+        esp_ble_gattc_write_char_descr(gattc_if, b->conn_id, cccd.handle, sizeof(enable), enable,
+                                       ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE);
+        break;
+    }
+
+    case ESP_GATTC_WRITE_DESCR_EVT: {
+        beacon_t *b = beacon_by_conn(param->write.conn_id);
+        if (b == NULL || b->state != SLOT_SETUP) {
+            break;
+        }
+        if (param->write.status != ESP_GATT_OK) {
+            beacon_abort(b, "CCCD write failed");
+            break;
+        }
+        b->state = SLOT_STREAMING;
+        setting_up = NULL;
+        ESP_LOGI(TAG, "[" ESP_BD_ADDR_STR "] streaming (conn_id %u)", ESP_BD_ADDR_HEX(b->bda), b->conn_id);
+        scan_update();
+        break;
+    }
+
+    case ESP_GATTC_NOTIFY_EVT: {
+        beacon_t *b = beacon_by_conn(param->notify.conn_id);
+        if (b != NULL && b->char_handle != 0 && param->notify.handle == b->char_handle) {
+            beacon_receive(b, param->notify.value, param->notify.value_len, rx_us);
+        }
+        break;
+    }
+
+    case ESP_GATTC_DISCONNECT_EVT: {
+        beacon_t *b = beacon_by_conn(param->disconnect.conn_id);
+        if (b == NULL) {
+            break;
+        }
+        ESP_LOGI(TAG, "[" ESP_BD_ADDR_STR "] disconnected, reason=0x%x", ESP_BD_ADDR_HEX(b->bda), param->disconnect.reason);
+        beacon_release(b);
+        scan_update();
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+/* Public functions */
+esp_err_t sync_receiver_start(uint16_t local_mtu)
+{
+    esp_err_t err = esp_ble_gap_register_callback(gap_event_handler);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_ble_gattc_register_callback(gattc_event_handler);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_ble_gattc_app_register(RECEIVER_APP_ID);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // Room for a full batch or delta notification from each beacon
+    if (esp_ble_gatt_set_local_mtu(local_mtu) != ESP_OK) {
+        ESP_LOGW(TAG, "set local MTU failed");
+    }
+    return ESP_OK;
+}
+
+void sync_receiver_report_task(void *param)
+{
+    static beacon_report_t reports[RECEIVER_MAX_BEACONS];
+    static esp_bd_addr_t addrs[RECEIVER_MAX_BEACONS];
+    TickType_t last_wake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(RECEIVER_REPORT_MS));
+
+        size_t n = 0;
+        portENTER_CRITICAL(&rx_mux);
+        for (size_t i = 0; i < RECEIVER_MAX_BEACONS; i++) {
+            if (beacons[i].state == SLOT_STREAMING && beacons[i].report.samples > 0) {
+                reports[n] = beacons[i].report;
+                memcpy(addrs[n], beacons[i].bda, sizeof(esp_bd_addr_t));
+                n++;
+            }
+        }
+        portEXIT_CRITICAL(&rx_mux);
+
+        // Each beacon's clock against the first one's, both read at this hub instant through their fits
+        int64_t now_ns = esp_timer_get_time() * 1000;
+        const beacon_report_t *ref = n > 0 && reports[0].has_fit ? &reports[0] : NULL;
+        int64_t ref_us = ref != NULL ? cheepsync_fit_unmap(&ref->fit, now_ns) : 0;
+        for (size_t i = 0; i < n; i++) {
+            const beacon_report_t *r = &reports[i];
+            if (!r->has_fit) {
+                ESP_LOGI(TAG, "[" ESP_BD_ADDR_STR "] %" PRIu32 " samples, no fit yet", ESP_BD_ADDR_HEX(addrs[i]), r->samples);
+                continue;
+            }
+            int64_t to_ref_us = ref != NULL ? cheepsync_fit_unmap(&r->fit, now_ns) - ref_us : 0;
+            ESP_LOGI(TAG, "[" ESP_BD_ADDR_STR "] %" PRIu32 " samples, skew %+.3f ppm, rms %.3f ms, vs first %+.3f ms"
+                     " (restarts %" PRIu32 ", malformed %" PRIu32 ")",
+                     ESP_BD_ADDR_HEX(addrs[i]), r->samples, (r->fit.beta - 1.0) * 1e6, r->rms_ns / 1e6,
+                     to_ref_us / 1000.0, r->restarts, r->malformed);
+        }
+    }
+}
+#endif // CONFIG_SENSOR_RECEIVER
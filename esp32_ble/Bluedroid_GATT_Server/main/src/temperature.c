@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_TEMPERATURE
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "driver/temperature_sensor.h"
+
+#include "temperature.h"
+
+/* Defines */
+// Measurement range: the driver picks the sensor's offset setting with the least error inside it
+#define TEMPERATURE_RANGE_MIN_C  (-10)
+#define TEMPERATURE_RANGE_MAX_C  80
+
+/* Private variables */
+static const char *TAG = "TEMPERATURE";
+
+static temperature_sensor_handle_t sensor = NULL;
+static volatile int16_t latest_cdeg = TEMPERATURE_UNKNOWN;  // 16-bit: read and written whole on every target
+
+/* Public functions */
+esp_err_t temperature_init(void)
+{
+    temperature_sensor_config_t config = TEMPERATURE_SENSOR_CONFIG_DEFAULT(TEMPERATURE_RANGE_MIN_C,
+                                                                           TEMPERATURE_RANGE_MAX_C);
+    esp_err_t err = temperature_sensor_install(&config, &sensor);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "temperature_sensor_install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = temperature_sensor_enable(sensor);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "temperature_sensor_enable failed: %s", esp_err_to_name(err));
+        temperature_sensor_uninstall(sensor);
+        sensor = NULL;
+    }
+    return err;
+}
+
+void temperature_task(void *param)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    for (;;) {
+        float celsius;
+        if (temperature_sensor_get_celsius(sensor, &celsius) == ESP_OK) {
+            latest_cdeg = (int16_t)lroundf(celsius * 100.0f);
+        } else {
+            latest_cdeg = TEMPERATURE_UNKNOWN;
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_SENSOR_TEMPERATURE_PERIOD_MS));
+    }
+}
+
+int16_t temperature_latest_cdeg(void)
+{
+    return latest_cdeg;
+}
+
+#endif // CONFIG_SENSOR_TEMPERATURE
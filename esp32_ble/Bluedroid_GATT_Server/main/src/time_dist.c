@@ -0,0 +1,233 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "sdkconfig.h"
+
+#if CONFIG_SENSOR_TIME_DIST
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sensor_payload.h"
+#include "time_dist.h"
+
+#if CONFIG_SENSOR_TIME_ROLE_RELAY
+#include "cheepsync.h"
+
+/* Defines */
+#define RELAY_MAX_HOPS        CONFIG_SENSOR_TIME_MAX_HOPS
+#define RELAY_WINDOW          CONFIG_SENSOR_TIME_WINDOW
+#define RELAY_PARENT_TIMEOUT_US ((int64_t)CONFIG_SENSOR_TIME_PARENT_TIMEOUT_MS * 1000)
+#define RELAY_HOP_LATENCY_US  CONFIG_SENSOR_TIME_HOP_LATENCY_US
+#define RELAY_RESTART_US      1000000  // root time this far behind the last sample: the timeline started over
+
+/* Private types */
+// Published by the BTC task after every parent sample, read by the broadcast task
+typedef struct {
+    bool            synced;
+    cheepsync_fit_t fit;
+    uint8_t         hop;         // own hop: parent's + 1
+    uint16_t        err_us;      // parent's error plus this fit's RMS
+    int64_t         last_rx_us;  // parent heard last
+} relay_snapshot_t;
+
+/* Private variables */
+static const char *TAG = "TIME_DIST";
+
+static esp_ble_scan_params_t relay_scan_params = {
+    .scan_type          = BLE_SCAN_TYPE_PASSIVE,  // the root-time payload is in the advertising PDU itself
+    .own_addr_type      = BLE_ADDR_TYPE_PUBLIC,
+    .scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL,
+    .scan_interval      = 0x50,  // 50 ms
+    .scan_window        = 0x30,  // 30 ms: leaves airtime for this beacon's own advertising events
+    .scan_duplicate     = BLE_SCAN_DUPLICATE_DISABLE,  // every advertising event is a sample
+};
+
+// Parent state: BTC task only
+static struct {
+    bool          valid;
+    esp_bd_addr_t bda;
+    uint8_t       hop;
+    uint16_t      err_us;
+    uint64_t      last_t_us;
+    int64_t       last_rx_us;
+    cheepsync_t   sync;
+} parent;
+
+// Hop of the last parent lost, while the hold-down lasts: see relay_acceptable()
+static int lost_hop = -1;
+static int64_t holddown_until_us = 0;
+
+static portMUX_TYPE relay_mux = portMUX_INITIALIZER_UNLOCKED;
+static relay_snapshot_t relay_snap;  // under relay_mux
+
+/* Private functions */
+static void relay_publish(void)
+{
+    relay_snapshot_t s = { .synced = false };
+    if (parent.valid && parent.sync.has_fit) {
+        double err = parent.err_us + ceil(parent.sync.rms_ns / 1000.0);
+        s.synced = true;
+        s.fit = cheepsync_get_fit(&parent.sync);
+        s.hop = (uint8_t)(parent.hop + 1);
+        s.err_us = err > UINT16_MAX ? UINT16_MAX : (uint16_t)err;
+        s.last_rx_us = parent.last_rx_us;
+    }
+    portENTER_CRITICAL(&relay_mux);
+    relay_snap = s;
+    portEXIT_CRITICAL(&relay_mux);
+}
+
+static void relay_drop_parent(int64_t now_us, const char *why)
+{
+    ESP_LOGW(TAG, "parent " ESP_BD_ADDR_STR " (hop %u) %s; unsynced", ESP_BD_ADDR_HEX(parent.bda), parent.hop, why);
+    lost_hop = parent.hop;
+    holddown_until_us = now_us + RELAY_PARENT_TIMEOUT_US;
+    parent.valid = false;
+    relay_publish();
+}
+
+// Count-to-infinity guard: right after losing a parent, this beacon's own children may still advertise
+// their old hop (at least lost_hop + 2). Until every child has timed out, only a parent at lost_hop or
+// closer to the root is taken, which no descendant can be.
+static bool relay_acceptable(uint8_t hop, int64_t now_us)
+{
+    if (hop >= RELAY_MAX_HOPS) {
+        return false;
+    }
+    if (parent.valid) {
+        return hop < parent.hop;  // strictly closer to the root
+    }
+    return now_us >= holddown_until_us || (int)hop <= lost_hop;
+}
+
+static void relay_on_frame(const uint8_t *bda, const sensor_record_t *rec, uint8_t hop, uint16_t err_us, int64_t rx_us)
+{
+    bool from_parent = parent.valid && memcmp(parent.bda, bda, sizeof(esp_bd_addr_t)) == 0;
+
+    if (parent.valid && !from_parent && rx_us - parent.last_rx_us > RELAY_PARENT_TIMEOUT_US) {
+        relay_drop_parent(rx_us, "timed out");
+    }
+    if (hop == SENSOR_ROOT_TIME_HOP_UNSYNCED) {
+        if (from_parent) {
+            relay_drop_parent(rx_us, "lost its own parent");
+        }
+        return;
+    }
+    if (from_parent && hop >= RELAY_MAX_HOPS) {
+        relay_drop_parent(rx_us, "moved past the hop limit");
+        return;
+    }
+
+    if (!from_parent) {
+        if (!relay_acceptable(hop, rx_us)) {
+            return;
+        }
+        // New (or closer) parent: its timeline is the root's too, but its path error differs, so refit
+        memcpy(parent.bda, bda, sizeof(esp_bd_addr_t));
+        parent.valid = true;
+        parent.last_t_us = 0;
+        cheepsync_reset(&parent.sync);
+        lost_hop = -1;
+        ESP_LOGI(TAG, "parent " ESP_BD_ADDR_STR " at hop %u", ESP_BD_ADDR_HEX(bda), hop);
+    } else if (rec->t_us <= parent.last_t_us) {
+        if (parent.last_t_us - rec->t_us < RELAY_RESTART_US) {
+            return;  // same advertising data again (the parent refreshes once per period)
+        }
+        ESP_LOGW(TAG, "root time went back %" PRIu64 " us; refitting", parent.last_t_us - rec->t_us);
+        cheepsync_reset(&parent.sync);
+    }
+
+    parent.hop = hop;
+    parent.err_us = err_us;
+    parent.last_t_us = rec->t_us;
+    parent.last_rx_us = rx_us;
+    cheepsync_add(&parent.sync, (int64_t)rec->t_us, rx_us * 1000);
+    relay_publish();
+}
+#endif // CONFIG_SENSOR_TIME_ROLE_RELAY
+
+/* Public functions */
+void time_dist_stamp(uint64_t local_us, time_dist_stamp_t *out)
+{
+#if CONFIG_SENSOR_TIME_ROLE_ROOT
+    out->t_us = local_us;
+    out->hop = 0;
+    out->err_us = 0;
+#else
+    relay_snapshot_t s;
+    portENTER_CRITICAL(&relay_mux);
+    s = relay_snap;
+    portEXIT_CRITICAL(&relay_mux);
+
+    if (!s.synced || (int64_t)local_us - s.last_rx_us > RELAY_PARENT_TIMEOUT_US) {
+        out->t_us = local_us;
+        out->hop = SENSOR_ROOT_TIME_HOP_UNSYNCED;
+        out->err_us = UINT16_MAX;
+        return;
+    }
+    // The lower envelope pairs each parent stamp with its fastest arrival, so it maps to root time
+    // minus the minimum advertising-to-scan delay; add that delay back
+    out->t_us = (uint64_t)(cheepsync_fit_unmap(&s.fit, (int64_t)local_us * 1000) + RELAY_HOP_LATENCY_US);
+    out->hop = s.hop;
+    out->err_us = s.err_us;
+#endif
+}
+
+#if CONFIG_SENSOR_TIME_ROLE_RELAY
+esp_err_t time_dist_start(void)
+{
+    cheepsync_init(&parent.sync, RELAY_WINDOW, CHEEPSYNC_LOWER_ENVELOPE);
+    return esp_ble_gap_set_scan_params(&relay_scan_params);
+}
+
+void time_dist_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    // First thing: the receive time of an advertising report
+    int64_t rx_us = esp_timer_get_time();
+
+    switch (event) {
+    case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
+        esp_ble_gap_start_scanning(0);  // permanent
+        break;
+
+    case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+        if (param->scan_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGE(TAG, "parent scan start failed, status=%d", param->scan_start_cmpl.status);
+        } else {
+            ESP_LOGI(TAG, "Scanning for parents (max hop %d)", RELAY_MAX_HOPS);
+        }
+        break;
+
+    case ESP_GAP_BLE_SCAN_RESULT_EVT: {
+        if (param->scan_rst.search_evt != ESP_GAP_SEARCH_INQ_RES_EVT) {
+            break;
+        }
+        uint8_t len = 0;
+        const uint8_t *mfg = esp_ble_resolve_adv_data_by_type(param->scan_rst.ble_adv, param->scan_rst.adv_data_len,
+                                                              ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE, &len);
+        if (mfg == NULL || len != 2 + SENSOR_ROOT_TIME_PAYLOAD_LEN ||
+            (uint16_t)(mfg[0] | (mfg[1] << 8)) != SENSOR_BEACON_COMPANY_ID) {
+            break;
+        }
+        sensor_record_t rec;
+        uint8_t hop;
+        uint16_t err_us;
+        if (sensor_payload_parse_root_time(mfg + 2, len - 2, &rec, &hop, &err_us)) {
+            relay_on_frame(param->scan_rst.bda, &rec, hop, err_us, rx_us);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+#endif // CONFIG_SENSOR_TIME_ROLE_RELAY
+#endif // CONFIG_SENSOR_TIME_DIST
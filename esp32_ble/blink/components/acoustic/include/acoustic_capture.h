@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef ACOUSTIC_CAPTURE_H
+#define ACOUSTIC_CAPTURE_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+/* Defines */
+#define ACOUSTIC_SAMPLE_RATE   CONFIG_ACOUSTIC_SAMPLE_RATE
+#define ACOUSTIC_FRAMES        CONFIG_ACOUSTIC_DMA_FRAME_NUM  // frames per buffer
+#if CONFIG_ACOUSTIC_MONO
+#define ACOUSTIC_SLOTS         1                              // left 32-bit slot only
+#else
+#define ACOUSTIC_SLOTS         2                              // stereo 32-bit slots: [L, R, L, R, ...]
+#endif
+
+/* Public types */
+// One DMA buffer's worth of samples. Owned by the consumer from acoustic_capture_receive() until
+// acoustic_capture_release(); the reader task does not touch it in between.
+typedef struct {
+    int32_t  *slots;        // frames x ACOUSTIC_SLOTS raw 32-bit slots
+    size_t    frames;
+    uint32_t  index;        // running count of buffers handed out since start
+    uint64_t  first_frame;  // frames captured before slots[0] since start, dropped DMA buffers included
+    int64_t   t_us;         // ACOUSTIC_TIMESTAMP_SAMPLE: when the last frame was captured (DMA receive-done);
+                            // ACOUSTIC_TIMESTAMP_BUFFER: when the reader got the buffer from the driver
+    bool      gap;          // a DMA overrun raced this read: first_frame and t_us may be one buffer off
+} acoustic_buf_t;
+
+typedef struct {
+    uint32_t buffers;        // handed to the consumer
+    uint32_t dma_overruns;   // DMA buffers the I2S driver dropped (reader too slow)
+    uint32_t ring_waits;     // times the reader found no free ring buffer (consumer too slow)
+} acoustic_capture_stats_t;
+
+/* Public function declarations */
+// esp_timer time of frame i of buf (the buffer's stamp with ACOUSTIC_TIMESTAMP_BUFFER).
+static inline int64_t acoustic_frame_time_us(const acoustic_buf_t *buf, size_t i)
+{
+#if CONFIG_ACOUSTIC_TIMESTAMP_SAMPLE
+    return buf->t_us - (int64_t)(buf->frames - 1 - i) * 1000000 / ACOUSTIC_SAMPLE_RATE;
+#else
+    return buf->t_us;
+#endif
+}
+
+// Configure the I2S RX channel (INMP441 on the Kconfig pins) and start the reader task.
+esp_err_t acoustic_capture_start(void);
+
+// Next filled buffer, oldest first. Returns NULL on timeout.
+acoustic_buf_t *acoustic_capture_receive(TickType_t wait);
+
+// Hand a buffer from acoustic_capture_receive() back to the reader.
+void acoustic_capture_release(acoustic_buf_t *buf);
+
+void acoustic_capture_get_stats(acoustic_capture_stats_t *out);
+
+#endif // ACOUSTIC_CAPTURE_H
@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef ACOUSTIC_DETECTOR_H
+#define ACOUSTIC_DETECTOR_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "acoustic_capture.h"
+
+/* Defines */
+#define ACOUSTIC_ENV_SHIFT  2  // envelope: one-pole average of |sample| over ~4 samples (250 us at 16 kHz)
+
+// Kconfig defaults ("Onset detector defaults")
+#define ACOUSTIC_DETECTOR_CONFIG_DEFAULT() {                  \
+    .k_x10       = CONFIG_ACOUSTIC_DETECT_K_X10,              \
+    .release_x10 = CONFIG_ACOUSTIC_DETECT_RELEASE_X10,        \
+    .min_level   = CONFIG_ACOUSTIC_DETECT_MIN_LEVEL,          \
+    .hold_ms     = CONFIG_ACOUSTIC_DETECT_HOLD_MS,            \
+    .floor_ms    = CONFIG_ACOUSTIC_DETECT_FLOOR_MS,           \
+}
+
+/* Public types */
+typedef struct {
+    uint16_t k_x10;        // onset: envelope above floor + k * sigma (tenths)
+    uint16_t release_x10;  // re-arm: envelope below floor + release * sigma (tenths); lower than k_x10
+    uint32_t min_level;    // onset threshold never below this (24-bit |sample|)
+    uint16_t hold_ms;      // shortest time from one onset to the next
+    uint16_t floor_ms;     // noise floor time constant
+} acoustic_detector_config_t;
+
+// Streaming state, O(1) per sample: envelope, noise floor mean/variance, arm/hold
+typedef struct {
+    acoustic_detector_config_t cfg;
+    bool     armed;
+    int32_t  env;          // envelope of |sample|
+    float    floor;        // noise floor: EMA of the envelope while armed
+    float    var;          // EMA variance of the envelope around the floor
+    uint32_t floor_n;      // cfg.floor_ms in samples: the floor EMA weight is 1 / floor_n
+    uint32_t learned;      // samples averaged into the floor, up to floor_n (then it is trusted)
+    uint32_t hold;         // cfg.hold_ms in samples
+    uint32_t quiet;        // samples since the last onset (while disarmed)
+} acoustic_detector_t;
+
+// One clap/chirp onset
+typedef struct {
+    int64_t  t_us;        // esp_timer time of the onset (see acoustic_frame_time_us for the resolution)
+    uint64_t frame;       // frame index of the first envelope sample over the threshold, since capture start
+    int32_t  peak;        // peak |sample| of the buffer with the onset
+    uint32_t rms;         // RMS of that buffer
+    uint32_t zero_crossings;  // in that buffer: low for a thump, high for a clap or chirp
+    uint32_t threshold;   // onset threshold at the time (24-bit |sample|)
+    uint32_t buf_index;   // acoustic_buf_t.index
+} acoustic_event_t;
+
+/* Public function declarations */
+// cfg may be NULL for the Kconfig defaults. No onset fires until the noise floor has had cfg->floor_ms to settle.
+void acoustic_detector_init(acoustic_detector_t *det, const acoustic_detector_config_t *cfg);
+
+// Change the thresholds of a running detector. Keeps the learned noise floor.
+void acoustic_detector_set_config(acoustic_detector_t *det, const acoustic_detector_config_t *cfg);
+
+// true if cfg is usable (release below k, floor time constant set)
+bool acoustic_detector_config_valid(const acoustic_detector_config_t *cfg);
+
+// Current noise floor and sigma of the envelope (24-bit |sample| units)
+void acoustic_detector_noise(const acoustic_detector_t *det, uint32_t *floor, uint32_t *sigma);
+
+// Run the detector over one buffer. Returns true and fills *event on an onset; at most one per
+// buffer, and none again until the hold time has passed and the envelope is below the re-arm level.
+bool acoustic_detector_process(acoustic_detector_t *det, const acoustic_buf_t *buf, acoustic_event_t *event);
+
+#endif // ACOUSTIC_DETECTOR_H
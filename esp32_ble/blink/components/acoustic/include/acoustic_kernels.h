@@ -0,0 +1,25 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef ACOUSTIC_KERNELS_H
+#define ACOUSTIC_KERNELS_H
+
+/* Includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Public types */
+typedef struct {
+    int32_t  peak;            // max |sample|
+    uint64_t energy;          // sum of sample^2 (RMS = sqrt(energy / n))
+    uint32_t zero_crossings;  // sign changes between consecutive samples
+} acoustic_frame_stats_t;
+
+/* Public function declarations */
+// Frame kernel over n INMP441 slots (24-bit sample left-aligned in 32 bits), every stride-th slot.
+// The loop is branchless, so Xtensa uses its single-cycle ABS/MAX/MIN instead of compare-and-branch.
+
+// Peak, energy and zero crossings in one pass over memory.
+void acoustic_frame_stats(const int32_t *slots, size_t n, size_t stride, acoustic_frame_stats_t *out);
+
+#endif // ACOUSTIC_KERNELS_H
@@ -0,0 +1,173 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/i2s_std.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "acoustic_capture.h"
+
+/* Private types */
+#define RING_LEN     CONFIG_ACOUSTIC_RING_LEN
+#define BUF_BYTES    (ACOUSTIC_FRAMES * ACOUSTIC_SLOTS * sizeof(int32_t))
+#define READER_CORE  CONFIG_ACOUSTIC_READER_CORE
+#define STAMP_LEN    32  // power of two, above the driver's DMA buffer queue
+
+/* Private variables */
+static const char *TAG = "acoustic";
+
+static i2s_chan_handle_t rx_chan = NULL;
+
+// Buffers travel by pointer: free_q (reader takes) -> full_q (consumer takes) -> free_q
+static int32_t ring_mem[RING_LEN][ACOUSTIC_FRAMES * ACOUSTIC_SLOTS];
+static acoustic_buf_t ring[RING_LEN];
+static QueueHandle_t free_q = NULL;
+static QueueHandle_t full_q = NULL;
+
+static volatile uint32_t dma_overruns = 0;  // I2S ISR
+#if CONFIG_ACOUSTIC_TIMESTAMP_SAMPLE
+// Receive-done stamp of every DMA buffer, indexed by completion count (I2S ISR writes, reader reads)
+static int64_t dma_stamps[STAMP_LEN];
+static volatile uint32_t dma_completed = 0;
+#endif
+static uint32_t buffers = 0;                // reader task
+static uint32_t ring_waits = 0;             // reader task
+
+/* Private functions */
+#if CONFIG_ACOUSTIC_TIMESTAMP_SAMPLE
+static bool IRAM_ATTR on_recv(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    dma_stamps[dma_completed % STAMP_LEN] = esp_timer_get_time();
+    dma_completed++;
+    return false;
+}
+#endif
+
+static bool IRAM_ATTR on_recv_q_ovf(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    dma_overruns++;
+    return false;
+}
+
+static void reader_task(void *param)
+{
+    uint32_t index = 0;
+    while (1) {
+        acoustic_buf_t *buf = NULL;
+        if (xQueueReceive(free_q, &buf, 0) != pdTRUE) {
+            // Block rather than overwrite: the DMA buffers absorb the stall, the overrun count shows if not
+            ring_waits++;
+            xQueueReceive(free_q, &buf, portMAX_DELAY);
+        }
+
+        // The driver drops its oldest queued DMA buffer on overflow, so the n-th buffer read is DMA
+        // completion n + (drops before it). Drops are only ambiguous if one lands during the read itself.
+        uint32_t ovf_before = dma_overruns;
+        size_t got = 0;
+        esp_err_t err = i2s_channel_read(rx_chan, buf->slots, BUF_BYTES, &got, portMAX_DELAY);
+        if (err != ESP_OK || got != BUF_BYTES) {
+            ESP_LOGW(TAG, "i2s read: %s, %u of %u bytes", esp_err_to_name(err), (unsigned)got, (unsigned)BUF_BYTES);
+        }
+        uint32_t ovf_after = dma_overruns;
+        uint32_t seq = index + ovf_after;
+        buf->gap = ovf_after != ovf_before;
+        buf->first_frame = (uint64_t)seq * ACOUSTIC_FRAMES;
+#if CONFIG_ACOUSTIC_TIMESTAMP_SAMPLE
+        buf->t_us = dma_stamps[seq % STAMP_LEN];
+#else
+        buf->t_us = esp_timer_get_time();
+#endif
+        buf->frames = got / (ACOUSTIC_SLOTS * sizeof(int32_t));
+        buf->index = index++;
+        buffers++;
+        xQueueSend(full_q, &buf, portMAX_DELAY);  // never blocks: at most RING_LEN buffers exist
+    }
+}
+
+/* Public functions */
+esp_err_t acoustic_capture_start(void)
+{
+    ESP_RETURN_ON_FALSE(rx_chan == NULL, ESP_ERR_INVALID_STATE, TAG, "already started");
+
+    free_q = xQueueCreate(RING_LEN, sizeof(acoustic_buf_t *));
+    full_q = xQueueCreate(RING_LEN, sizeof(acoustic_buf_t *));
+    ESP_RETURN_ON_FALSE(free_q && full_q, ESP_ERR_NO_MEM, TAG, "ring queues");
+    for (size_t i = 0; i < RING_LEN; i++) {
+        ring[i].slots = ring_mem[i];
+        acoustic_buf_t *buf = &ring[i];
+        xQueueSend(free_q, &buf, 0);
+    }
+
+    // One DMA buffer = one ring buffer, so each read returns as soon as the hardware fills one
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = CONFIG_ACOUSTIC_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = ACOUSTIC_FRAMES;
+    ESP_RETURN_ON_ERROR(i2s_new_channel(&chan_cfg, NULL, &rx_chan), TAG, "i2s channel");
+
+    // INMP441: 24-bit sample left-aligned in a 32-bit slot, L/R tied to GND (left slot)
+    i2s_std_config_t std_cfg = {
+        .clk_cfg  = I2S_STD_CLK_DEFAULT_CONFIG(ACOUSTIC_SAMPLE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT,
+                                                        ACOUSTIC_SLOTS == 1 ? I2S_SLOT_MODE_MONO : I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .bclk = CONFIG_ACOUSTIC_I2S_BCLK,
+            .ws   = CONFIG_ACOUSTIC_I2S_WS,
+            .din  = CONFIG_ACOUSTIC_I2S_DIN,
+            .dout = I2S_GPIO_UNUSED,
+            .mclk = I2S_GPIO_UNUSED,
+        },
+    };
+#if CONFIG_ACOUSTIC_MONO
+    std_cfg.slot_cfg.slot_mask = I2S_STD_SLOT_LEFT;
+#endif
+    ESP_RETURN_ON_ERROR(i2s_channel_init_std_mode(rx_chan, &std_cfg), TAG, "i2s std mode");
+
+    i2s_event_callbacks_t cbs = {
+#if CONFIG_ACOUSTIC_TIMESTAMP_SAMPLE
+        .on_recv = on_recv,
+#endif
+        .on_recv_q_ovf = on_recv_q_ovf,
+    };
+    ESP_RETURN_ON_ERROR(i2s_channel_register_event_callback(rx_chan, &cbs, NULL), TAG, "i2s callbacks");
+    ESP_RETURN_ON_ERROR(i2s_channel_enable(rx_chan), TAG, "i2s enable");
+
+    BaseType_t ok = xTaskCreatePinnedToCore(reader_task, "i2s_reader", 3 * 1024, NULL, CONFIG_ACOUSTIC_READER_PRIO, NULL,
+                                            READER_CORE < 0 ? tskNO_AFFINITY : READER_CORE);
+    ESP_RETURN_ON_FALSE(ok == pdPASS, ESP_ERR_NO_MEM, TAG, "reader task");
+
+    ESP_LOGI(TAG, "capture %d Hz, %d frames x %d DMA buffers (%d ms each), ring %d",
+             ACOUSTIC_SAMPLE_RATE, ACOUSTIC_FRAMES, CONFIG_ACOUSTIC_DMA_DESC_NUM,
+             ACOUSTIC_FRAMES * 1000 / ACOUSTIC_SAMPLE_RATE, RING_LEN);
+    return ESP_OK;
+}
+
+acoustic_buf_t *acoustic_capture_receive(TickType_t wait)
+{
+    acoustic_buf_t *buf = NULL;
+    if (full_q == NULL || xQueueReceive(full_q, &buf, wait) != pdTRUE) {
+        return NULL;
+    }
+    return buf;
+}
+
+void acoustic_capture_release(acoustic_buf_t *buf)
+{
+    if (buf) {
+        xQueueSend(free_q, &buf, 0);
+    }
+}
+
+void acoustic_capture_get_stats(acoustic_capture_stats_t *out)
+{
+    out->buffers = buffers;
+    out->dma_overruns = dma_overruns;
+    out->ring_waits = ring_waits;
+}
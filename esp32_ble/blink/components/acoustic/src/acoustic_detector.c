@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include <math.h>
+
+#include "acoustic_detector.h"
+#include "acoustic_kernels.h"
+
+/* Private functions */
+static inline uint32_t ms_to_samples(uint32_t ms)
+{
+    return (uint32_t)((uint64_t)ms * ACOUSTIC_SAMPLE_RATE / 1000);
+}
+
+static void apply_config(acoustic_detector_t *det, const acoustic_detector_config_t *cfg)
+{
+    det->cfg = *cfg;
+    uint32_t n = ms_to_samples(cfg->floor_ms);
+    det->floor_n = n > 0 ? n : 1;
+    if (det->learned > det->floor_n) {
+        det->learned = det->floor_n;
+    }
+    det->hold = ms_to_samples(cfg->hold_ms);
+}
+
+/* Public functions */
+void acoustic_detector_init(acoustic_detector_t *det, const acoustic_detector_config_t *cfg)
+{
+    static const acoustic_detector_config_t defaults = ACOUSTIC_DETECTOR_CONFIG_DEFAULT();
+    det->armed = true;
+    det->env = 0;
+    det->floor = 0.0f;
+    det->var = 0.0f;
+    det->learned = 0;
+    det->quiet = 0;
+    apply_config(det, cfg ? cfg : &defaults);
+}
+
+void acoustic_detector_set_config(acoustic_detector_t *det, const acoustic_detector_config_t *cfg)
+{
+    apply_config(det, cfg);
+}
+
+bool acoustic_detector_config_valid(const acoustic_detector_config_t *cfg)
+{
+    return cfg->k_x10 > 0 && cfg->release_x10 < cfg->k_x10 && cfg->floor_ms > 0 && cfg->min_level <= 0x7FFFFF;
+}
+
+void acoustic_detector_noise(const acoustic_detector_t *det, uint32_t *floor, uint32_t *sigma)
+{
+    *floor = (uint32_t)det->floor;
+    *sigma = (uint32_t)sqrtf(det->var);
+}
+
+bool acoustic_detector_process(acoustic_detector_t *det, const acoustic_buf_t *buf, acoustic_event_t *event)
+{
+    // Thresholds from the floor as of the buffer start: one sqrt per buffer, then O(1) per sample.
+    // The floor moves by at most one buffer's worth of its time constant in between.
+    float sigma = sqrtf(det->var);
+    float trigger = det->floor + (float)det->cfg.k_x10 * 0.1f * sigma;
+    if (trigger < (float)det->cfg.min_level) {
+        trigger = (float)det->cfg.min_level;
+    }
+    float release = det->floor + (float)det->cfg.release_x10 * 0.1f * sigma;
+    if (release > trigger) {
+        release = trigger;
+    }
+    int32_t trig = (int32_t)trigger;
+    int32_t rel = (int32_t)release;
+
+    const int32_t *slots = buf->slots;
+    int32_t env = det->env;
+    float alpha = 1.0f / (float)det->floor_n;
+    size_t onset = buf->frames;
+    for (size_t i = 0; i < buf->frames; i++) {
+        int32_t s = slots[i * ACOUSTIC_SLOTS] >> 8;  // 24-bit sample, left-aligned in its slot
+        env += ((s < 0 ? -s : s) - env) >> ACOUSTIC_ENV_SHIFT;
+
+        if (det->armed) {
+            if (env > trig && det->learned == det->floor_n) {
+                onset = i;
+                det->armed = false;
+                det->quiet = 0;
+                continue;
+            }
+            // Learn the floor only while armed, so an event never raises its own threshold.
+            // Until floor_n samples are in, a plain running mean: the EMA would start biased towards 0.
+            float a = alpha;
+            if (det->learned < det->floor_n) {
+                a = 1.0f / (float)++det->learned;
+            }
+            float d = (float)env - det->floor;
+            float inc = a * d;
+            det->floor += inc;
+            det->var = (1.0f - a) * (det->var + d * inc);
+        } else if (++det->quiet >= det->hold && env < rel && onset == buf->frames) {
+            // Hysteresis: once the hold time is over, re-arm as soon as the envelope is back near the floor
+            det->armed = true;
+        }
+    }
+    det->env = env;
+
+    if (onset == buf->frames) {
+        return false;
+    }
+    acoustic_frame_stats_t st;
+    acoustic_frame_stats(buf->slots, buf->frames, ACOUSTIC_SLOTS, &st);
+    event->t_us = acoustic_frame_time_us(buf, onset);
+    event->frame = buf->first_frame + onset;
+    event->peak = st.peak;
+    event->rms = (uint32_t)sqrtf((float)st.energy / (float)buf->frames);
+    event->zero_crossings = st.zero_crossings;
+    event->threshold = (uint32_t)trig;
+    event->buf_index = buf->index;
+    return true;
+}
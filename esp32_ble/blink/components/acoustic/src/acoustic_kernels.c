@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include "acoustic_kernels.h"
+
+/* Private functions */
+// INMP441: 24-bit sample in 32-bit slot -> shift right 8
+static inline int32_t s24(int32_t slot32)
+{
+    return slot32 >> 8;
+}
+
+static inline int32_t max_i32(int32_t a, int32_t b)
+{
+    return a > b ? a : b;
+}
+
+/* Public functions */
+void acoustic_frame_stats(const int32_t *slots, size_t n, size_t stride, acoustic_frame_stats_t *out)
+{
+    int32_t peak = 0;
+    uint64_t energy = 0;
+    uint32_t crossings = 0;
+    int32_t prev = n ? s24(slots[0]) : 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t s = s24(slots[i * stride]);
+        peak = max_i32(peak, s < 0 ? -s : s);
+        energy += (uint64_t)((int64_t)s * s);
+        crossings += (uint32_t)((s ^ prev) < 0);  // sign bits differ
+        prev = s;
+    }
+    out->peak = peak;
+    out->energy = energy;
+    out->zero_crossings = crossings;
+}
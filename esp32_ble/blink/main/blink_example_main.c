@@ -1,36 +1,20 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#include "driver/i2s_std.h"
 #include "led_strip.h"
 #include "esp_timer.h"
 
+#include "acoustic_capture.h"
+#include "acoustic_detector.h"
+
 #define LED_GPIO   2
 #define LED_COUNT  1
 
-#define I2S_BCLK 26
-#define I2S_WS   25
-#define I2S_DIN  33
-
-#define SAMPLE_RATE 16000
-
-// Trigger / release thresholds (tune these)
-#define SOUND_THRESHOLD    500000
-#define RELEASE_THRESHOLD  200000   // must be LOWER than SOUND_THRESHOLD
-
 static led_strip_handle_t strip;
-static i2s_chan_handle_t rx_chan;
-
-// INMP441: 24-bit sample in 32-bit slot -> shift right 8
-static inline int32_t abs_s24_from_slot32(int32_t slot32)
-{
-    int32_t s = slot32 >> 8;
-    if (s < 0) s = -s;
-    return s;
-}
 
 void app_main(void)
 {
@@ -48,61 +32,42 @@ void app_main(void)
     led_strip_clear(strip);
     led_strip_refresh(strip);
 
-    // ----- I2S RX init -----
-    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-    i2s_new_channel(&chan_cfg, NULL, &rx_chan);
-
-    i2s_std_config_t i2s_cfg = {
-        .clk_cfg  = I2S_STD_CLK_DEFAULT_CONFIG(SAMPLE_RATE),
-        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(
-                        I2S_DATA_BIT_WIDTH_32BIT,
-                        I2S_SLOT_MODE_STEREO),
-        .gpio_cfg = {
-            .bclk = I2S_BCLK,
-            .ws   = I2S_WS,
-            .din  = I2S_DIN,
-            .dout = I2S_GPIO_UNUSED,
-            .mclk = I2S_GPIO_UNUSED,
-        },
-    };
-    i2s_channel_init_std_mode(rx_chan, &i2s_cfg);
-    i2s_channel_enable(rx_chan);
+    // ----- I2S capture: pinned reader task fills DMA-sized buffers, this task is the detector stage -----
+    ESP_ERROR_CHECK(acoustic_capture_start());
 
-    // We read stereo frames: [L(32), R(32), ...]
-    int32_t samples[64];
+    // Adaptive thresholds: k sigma over the learned noise floor (tune in menuconfig, "Onset detector defaults")
+    acoustic_detector_t det;
+    acoustic_detector_init(&det, NULL);
 
-    // "Armed" means we're ready to detect a new clap.
-    bool armed = true;
+    acoustic_capture_stats_t stats = {0};
+    uint32_t overruns_seen = 0;
 
     while (1) {
-        size_t bytes_read = 0;
-        i2s_channel_read(rx_chan, samples, sizeof(samples), &bytes_read, portMAX_DELAY);
-
-        // Compute peak over this chunk (use LEFT channel; L/R pin = GND on INMP441)
-        int32_t peak = 0;
-        int frames = (int)(bytes_read / 8); // 8 bytes per stereo frame
-
-        for (int i = 0; i < frames; i++) {
-            int32_t L_abs = abs_s24_from_slot32(samples[i * 2]); // left slot
-            if (L_abs > peak) peak = L_abs;
+        acoustic_buf_t *buf = acoustic_capture_receive(portMAX_DELAY);
+        if (buf == NULL) {
+            continue;
         }
 
-        // Gate printing: only print on the first chunk that crosses the threshold
-        if (armed && peak > SOUND_THRESHOLD) {
-            int64_t t_us = esp_timer_get_time(); // microseconds since boot
-            printf("[%" PRId64 " us] Sound detected! Peak = %ld\n", t_us, (long)peak);
+        acoustic_event_t ev;
+        bool was_armed = det.armed;
+        if (acoustic_detector_process(&det, buf, &ev)) {
+            printf("[%" PRId64 " us] Sound detected! Peak = %ld, RMS = %" PRIu32 ", ZC = %" PRIu32 ", threshold = %" PRIu32 " (sample %" PRIu64 "%s)\n",
+                   ev.t_us, (long)ev.peak, ev.rms, ev.zero_crossings, ev.threshold, ev.frame,
+                   buf->gap ? ", timing uncertain: overrun" : "");
 
             led_strip_set_pixel(strip, 0, 0, 255, 0); // green
             led_strip_refresh(strip);
-
-            armed = false; // disarm until signal drops
-        }
-
-        // Re-arm once things quiet down
-        if (!armed && peak < RELEASE_THRESHOLD) {
+        } else if (!was_armed && det.armed) {
             led_strip_clear(strip);
             led_strip_refresh(strip);
-            armed = true;
+        }
+        acoustic_capture_release(buf);
+
+        // Lost frames break the event timeline; say so instead of silently skipping
+        acoustic_capture_get_stats(&stats);
+        if (stats.dma_overruns != overruns_seen) {
+            printf("I2S DMA overrun: %" PRIu32 " buffers lost so far\n", stats.dma_overruns);
+            overruns_seen = stats.dma_overruns;
         }
     }
 }
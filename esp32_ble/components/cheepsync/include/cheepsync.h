@@ -0,0 +1,582 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef CHEEPSYNC_H
+#define CHEEPSYNC_H
+
+// CheepSync core in C: the sliding-window fit and the Kalman tracker of the app's sync/ module
+// (CheepSync.kt, KalmanSync.kt), for firmware, host-side C and the Android JNI binding.
+//
+// Model and units as in Kotlin: Tr ≈ α + β·tb, beacon time in μs, receiver time in ns. Fits run on
+// deltas from an exact int64 epoch, refreshed every CHEEPSYNC_REBASE_INTERVAL_US, so doubles never
+// hold a raw ~1e14 ns stamp.
+//
+// Header-only, C99 or C++, no heap: every state lives in a caller-owned struct with a fixed
+// CHEEPSYNC_WINDOW_MAX ring (define it before including to resize). Not thread-safe.
+// Uses double throughout; on chips without a double FPU (ESP32, S3) that is soft-float, a few μs
+// per sample, which is fine at BLE rates but not for an ISR.
+
+/* Includes */
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defines */
+#ifndef CHEEPSYNC_WINDOW_MAX
+#define CHEEPSYNC_WINDOW_MAX        50              // ring capacity (window sizes 1 .. this)
+#endif
+#define CHEEPSYNC_REBASE_INTERVAL_US 60000000LL     // beacon time between epoch refreshes (60 s)
+#define CHEEPSYNC_ENVELOPE_BLOCK    4               // LOWER_ENVELOPE: one minimum kept per block
+#define CHEEPSYNC_HUBER_K           1.345           // HUBER: 95% efficiency under Gaussian noise
+#define CHEEPSYNC_HUBER_ITERATIONS  3               // HUBER: IRLS rounds per re-score
+#define CHEEPSYNC_MAD_TO_SIGMA      1.4826
+#define CHEEPSYNC_MIN_SCALE_NS      100000.0        // Huber scale floor (0.1 ms)
+
+#if CHEEPSYNC_WINDOW_MAX < 1 || CHEEPSYNC_WINDOW_MAX > 32767
+#error "CHEEPSYNC_WINDOW_MAX must be 1..32767"
+#endif
+
+/* Public types */
+// Same numbering as the Kotlin Estimator ordinals. RANSAC is not ported: it needs the RNG sequence of
+// kotlin.random to agree with the app, and LOWER_ENVELOPE is what the app runs.
+typedef enum {
+    CHEEPSYNC_LEAST_SQUARES  = 0,   // plain OLS, every sample weight 1
+    CHEEPSYNC_LOWER_ENVELOPE = 1,   // least-delayed sample of each CHEEPSYNC_ENVELOPE_BLOCK
+    CHEEPSYNC_HUBER          = 2,   // IRLS with Huber weights, scale from the residuals' MAD
+} cheepsync_estimator_t;
+
+// Snapshot of a fit (SyncFit): Tr − receiver_epoch_ns ≈ alpha + beta · (tb − beacon_epoch_us)·1000
+typedef struct {
+    double  alpha;              // offset (ns) at the epoch
+    double  beta;               // skew, dimensionless
+    int64_t beacon_epoch_us;
+    int64_t receiver_epoch_ns;
+} cheepsync_fit_t;
+
+// Sliding-window weighted least squares, running centered sums (O(1) per sample, amortized for HUBER)
+typedef struct {
+    double   tb[CHEEPSYNC_WINDOW_MAX];      // beacon ns from the epoch
+    double   tr[CHEEPSYNC_WINDOW_MAX];      // receiver ns from the epoch
+    double   w[CHEEPSYNC_WINDOW_MAX];       // per-slot fit weight
+    double   scratch[CHEEPSYNC_WINDOW_MAX]; // HUBER residuals
+    int16_t  window;
+    int16_t  head;                          // oldest slot
+    int16_t  count;
+    int16_t  evictions;                     // since the sums were last rebuilt from the window
+    cheepsync_estimator_t estimator;
+
+    double   w_sum, tb_mean, tr_mean, sxx, sxy, syy;
+
+    int16_t  envelope_fill;
+    int16_t  envelope_slot;                 // -1: none in this block
+    double   envelope_delay_ns;
+    double   envelope_beta;
+    double   huber_scale_ns;
+    int16_t  since_reweight;
+    int16_t  reweight_interval;
+
+    int64_t  beacon_epoch_us;
+    int64_t  receiver_epoch_ns;
+    double   offset_ns;                     // fitted offset at the epoch
+    double   beta;
+    double   rms_ns;                        // (weighted) RMS residual
+    bool     has_fit;
+} cheepsync_t;
+
+// 2-state (offset, skew) Kalman tracker: no window, O(1) per sample
+typedef struct {
+    double  r;                      // measurement variance (ns²)
+    double  q_offset;               // offset random walk (ns² per s)
+    double  q_skew;                 // skew random walk (1/s)
+    double  p0_skew;                // prior skew variance
+    int64_t offset_epoch_ns;        // first sample's exact Tr − tb
+    double  offset_ns;              // offset relative to offset_epoch_ns
+    double  skew;                   // β − 1
+    double  p_oo, p_os, p_ss;
+    int64_t last_tb_us;
+    double  innovation_mean_sq;
+    uint32_t count;
+} cheepsync_kalman_t;
+
+/* Private functions */
+static inline int cheepsync_impl_slot(const cheepsync_t *s, int i)
+{
+    int j = s->head + i;
+    return j >= s->window ? j - s->window : j;
+}
+
+static inline void cheepsync_impl_include(cheepsync_t *s, double x, double y, double w)
+{
+    if (w <= 0.0) {
+        return;
+    }
+    s->w_sum += w;
+    double dx = x - s->tb_mean;
+    double dy_old = y - s->tr_mean;
+    s->tb_mean += w * dx / s->w_sum;
+    s->tr_mean += w * dy_old / s->w_sum;
+    double dy_new = y - s->tr_mean;
+    s->sxx += w * dx * (x - s->tb_mean);
+    s->sxy += w * dx * dy_new;
+    s->syy += w * dy_old * dy_new;
+}
+
+static inline void cheepsync_impl_exclude(cheepsync_t *s, double x, double y, double w)
+{
+    if (w <= 0.0) {
+        return;
+    }
+    s->w_sum -= w;
+    if (s->w_sum <= 0.0) {
+        s->w_sum = s->tb_mean = s->tr_mean = s->sxx = s->sxy = s->syy = 0.0;
+        return;
+    }
+    double tb_mean_old = s->tb_mean;
+    double tr_mean_old = s->tr_mean;
+    s->tb_mean -= w * (x - tb_mean_old) / s->w_sum;
+    s->tr_mean -= w * (y - tr_mean_old) / s->w_sum;
+    double dx_new = x - s->tb_mean;
+    s->sxx -= w * dx_new * (x - tb_mean_old);
+    s->sxy -= w * dx_new * (y - tr_mean_old);
+    s->syy -= w * (y - s->tr_mean) * (y - tr_mean_old);
+}
+
+// Exact sums from the window: once per window evictions, and after a HUBER re-score
+static inline void cheepsync_impl_rebuild(cheepsync_t *s)
+{
+    double w = 0.0, x_sum = 0.0, y_sum = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        int k = cheepsync_impl_slot(s, i);
+        w += s->w[k];
+        x_sum += s->w[k] * s->tb[k];
+        y_sum += s->w[k] * s->tr[k];
+    }
+    s->w_sum = w;
+    s->tb_mean = w > 0.0 ? x_sum / w : 0.0;
+    s->tr_mean = w > 0.0 ? y_sum / w : 0.0;
+    s->sxx = s->sxy = s->syy = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        int k = cheepsync_impl_slot(s, i);
+        double x = s->tb[k] - s->tb_mean;
+        double y = s->tr[k] - s->tr_mean;
+        s->sxx += s->w[k] * x * x;
+        s->sxy += s->w[k] * x * y;
+        s->syy += s->w[k] * y * y;
+    }
+    s->evictions = 0;
+}
+
+static inline void cheepsync_impl_incremental_fit(cheepsync_t *s)
+{
+    if (s->sxx <= 0.0 || s->w_sum <= 0.0) {
+        return;
+    }
+    s->beta = s->sxy / s->sxx;
+    s->offset_ns = s->tr_mean - s->beta * s->tb_mean;
+    double rss = s->syy - s->sxy * s->sxy / s->sxx;
+    s->rms_ns = sqrt((rss > 0.0 ? rss : 0.0) / s->w_sum);
+    s->has_fit = true;
+}
+
+// Full rescan of the window; the HUBER re-score fits through it
+static inline void cheepsync_impl_batch_fit(cheepsync_t *s)
+{
+    double n = 0.0, tb_mean = 0.0, tr_mean = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        int k = cheepsync_impl_slot(s, i);
+        n += s->w[k];
+        tb_mean += s->w[k] * s->tb[k];
+        tr_mean += s->w[k] * s->tr[k];
+    }
+    if (n <= 0.0) {
+        return;
+    }
+    tb_mean /= n;
+    tr_mean /= n;
+    double cov = 0.0, var_tb = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        int k = cheepsync_impl_slot(s, i);
+        double x = s->tb[k] - tb_mean;
+        cov += s->w[k] * x * (s->tr[k] - tr_mean);
+        var_tb += s->w[k] * x * x;
+    }
+    if (var_tb == 0.0) {
+        return;
+    }
+    s->beta = cov / var_tb;
+    s->offset_ns = tr_mean - s->beta * tb_mean;
+    s->has_fit = true;
+    double rss = 0.0;
+    for (int i = 0; i < s->count; i++) {
+        int k = cheepsync_impl_slot(s, i);
+        double r = s->tr[k] - (s->offset_ns + s->beta * s->tb[k]);
+        rss += s->w[k] * r * r;
+    }
+    s->rms_ns = sqrt(rss / n);
+}
+
+static inline void cheepsync_impl_set_weight(cheepsync_t *s, int k, double w)
+{
+    cheepsync_impl_exclude(s, s->tb[k], s->tr[k], s->w[k]);
+    cheepsync_impl_include(s, s->tb[k], s->tr[k], w);
+    s->w[k] = w;
+}
+
+static inline double cheepsync_impl_huber_weight(const cheepsync_t *s, double abs_residual_ns)
+{
+    if (s->huber_scale_ns <= 0.0) {
+        return 1.0;
+    }
+    double c = CHEEPSYNC_HUBER_K * s->huber_scale_ns;
+    return abs_residual_ns <= c ? 1.0 : c / abs_residual_ns;
+}
+
+// Weight of a new sample against the current fit (LEAST_SQUARES, HUBER)
+static inline double cheepsync_impl_arrival_weight(const cheepsync_t *s, double x, double y)
+{
+    if (s->estimator != CHEEPSYNC_HUBER || !s->has_fit) {
+        return 1.0;
+    }
+    return cheepsync_impl_huber_weight(s, fabs(y - (s->offset_ns + s->beta * x)));
+}
+
+static inline void cheepsync_impl_envelope_add(cheepsync_t *s, int k)
+{
+    s->w[k] = 0.0;
+    if (s->envelope_fill == 0) {
+        s->envelope_beta = s->beta;
+        s->envelope_slot = -1;
+    }
+    double delay = s->tr[k] - s->envelope_beta * s->tb[k];
+    if (s->envelope_slot < 0 || delay < s->envelope_delay_ns) {
+        if (s->envelope_slot >= 0) {
+            cheepsync_impl_set_weight(s, s->envelope_slot, 0.0);
+        }
+        s->envelope_slot = (int16_t)k;
+        s->envelope_delay_ns = delay;
+        cheepsync_impl_set_weight(s, k, 1.0);
+    }
+    int block = s->window < CHEEPSYNC_ENVELOPE_BLOCK ? s->window : CHEEPSYNC_ENVELOPE_BLOCK;
+    if (++s->envelope_fill == block) {
+        s->envelope_fill = 0;
+    }
+}
+
+// k-th smallest of v[0 .. n) (Hoare quickselect, reorders v)
+static inline double cheepsync_impl_select(double *v, int n, int k)
+{
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        double pivot = v[(lo + hi) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (v[i] < pivot) {
+                i++;
+            }
+            while (v[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                double t = v[i];
+                v[i] = v[j];
+                v[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return v[k];
+        }
+    }
+    return v[k];
+}
+
+// IRLS from the plain OLS fit; weights only, the caller rebuilds the sums
+static inline void cheepsync_impl_huber_reweight(cheepsync_t *s)
+{
+    for (int i = 0; i < s->count; i++) {
+        s->w[cheepsync_impl_slot(s, i)] = 1.0;
+    }
+    if (s->count < 3) {
+        cheepsync_impl_batch_fit(s);
+        return;
+    }
+    for (int round = 0; round < CHEEPSYNC_HUBER_ITERATIONS; round++) {
+        cheepsync_impl_batch_fit(s);
+        for (int i = 0; i < s->count; i++) {
+            int k = cheepsync_impl_slot(s, i);
+            s->scratch[i] = s->tr[k] - (s->offset_ns + s->beta * s->tb[k]);
+        }
+        double med = cheepsync_impl_select(s->scratch, s->count, s->count / 2);
+        for (int i = 0; i < s->count; i++) {
+            s->scratch[i] = fabs(s->scratch[i] - med);
+        }
+        double scale = CHEEPSYNC_MAD_TO_SIGMA * cheepsync_impl_select(s->scratch, s->count, s->count / 2);
+        s->huber_scale_ns = scale > CHEEPSYNC_MIN_SCALE_NS ? scale : CHEEPSYNC_MIN_SCALE_NS;
+        for (int i = 0; i < s->count; i++) {
+            int k = cheepsync_impl_slot(s, i);
+            s->w[k] = cheepsync_impl_huber_weight(s, fabs(s->tr[k] - (s->offset_ns + s->beta * s->tb[k])));
+        }
+    }
+    cheepsync_impl_batch_fit(s);
+}
+
+// Shift the epoch: centered sums, β and weights are unchanged by a constant shift
+static inline void cheepsync_impl_rebase(cheepsync_t *s, int64_t tb_us, int64_t tr_ns)
+{
+    double dx = (double)(tb_us - s->beacon_epoch_us) * 1000.0;
+    double dy = (double)(tr_ns - s->receiver_epoch_ns);
+    for (int i = 0; i < s->count; i++) {
+        int k = cheepsync_impl_slot(s, i);
+        s->tb[k] -= dx;
+        s->tr[k] -= dy;
+    }
+    s->tb_mean -= dx;
+    s->tr_mean -= dy;
+    s->offset_ns += s->beta * dx - dy;
+    s->envelope_delay_ns += s->envelope_beta * dx - dy;
+    s->beacon_epoch_us = tb_us;
+    s->receiver_epoch_ns = tr_ns;
+}
+
+static inline double cheepsync_impl_square(double x)
+{
+    return x * x;
+}
+
+/* Public functions */
+// Beacon μs → receiver ns through a fit snapshot.
+static inline int64_t cheepsync_fit_map(const cheepsync_fit_t *f, int64_t beacon_us)
+{
+    double x = (double)(beacon_us - f->beacon_epoch_us) * 1000.0;
+    return f->receiver_epoch_ns + (int64_t)(f->alpha + f->beta * x);
+}
+
+// Receiver ns → beacon μs (inverse of the fit).
+static inline int64_t cheepsync_fit_unmap(const cheepsync_fit_t *f, int64_t receiver_ns)
+{
+    return f->beacon_epoch_us + (int64_t)(((double)(receiver_ns - f->receiver_epoch_ns) - f->alpha) / f->beta / 1000.0);
+}
+
+// Forget every sample: α = 0, β = 1, no fit.
+static inline void cheepsync_reset(cheepsync_t *s)
+{
+    s->head = s->count = s->evictions = 0;
+    s->w_sum = s->tb_mean = s->tr_mean = s->sxx = s->sxy = s->syy = 0.0;
+    s->envelope_fill = 0;
+    s->envelope_slot = -1;
+    s->envelope_delay_ns = 0.0;
+    s->envelope_beta = 1.0;
+    s->huber_scale_ns = 0.0;
+    s->since_reweight = 0;
+    s->reweight_interval = 1;
+    s->beacon_epoch_us = 0;
+    s->receiver_epoch_ns = 0;
+    s->offset_ns = 0.0;
+    s->beta = 1.0;
+    s->rms_ns = 0.0;
+    s->has_fit = false;
+}
+
+// Returns false (and leaves s untouched) unless 1 <= window <= CHEEPSYNC_WINDOW_MAX.
+static inline bool cheepsync_init(cheepsync_t *s, int window, cheepsync_estimator_t estimator)
+{
+    if (window < 1 || window > CHEEPSYNC_WINDOW_MAX ||
+        (estimator != CHEEPSYNC_LEAST_SQUARES && estimator != CHEEPSYNC_LOWER_ENVELOPE && estimator != CHEEPSYNC_HUBER)) {
+        return false;
+    }
+    s->window = (int16_t)window;
+    s->estimator = estimator;
+    cheepsync_reset(s);
+    return true;
+}
+
+// Add one (beacon μs, receiver ns) sample and refit. Same arithmetic as CheepSync.addSample in
+// INCREMENTAL mode, so both produce the same α, β for the same samples.
+static inline void cheepsync_add(cheepsync_t *s, int64_t beacon_us, int64_t receiver_ns)
+{
+    if (s->count == 0) {
+        s->beacon_epoch_us = beacon_us;
+        s->receiver_epoch_ns = receiver_ns;
+    } else if (beacon_us - s->beacon_epoch_us > CHEEPSYNC_REBASE_INTERVAL_US) {
+        cheepsync_impl_rebase(s, beacon_us, receiver_ns);
+    }
+    double x = (double)(beacon_us - s->beacon_epoch_us) * 1000.0;
+    double y = (double)(receiver_ns - s->receiver_epoch_ns);
+    if (s->count == s->window) {
+        // Full: evict the oldest slot, then reuse it
+        int h = s->head;
+        if (h == s->envelope_slot) {
+            s->envelope_slot = -1;
+        }
+        s->head = (int16_t)(h + 1 == s->window ? 0 : h + 1);
+        s->count--;
+        cheepsync_impl_exclude(s, s->tb[h], s->tr[h], s->w[h]);
+        s->evictions++;
+    }
+    int k = cheepsync_impl_slot(s, s->count);
+    s->tb[k] = x;
+    s->tr[k] = y;
+    s->w[k] = 0.0;
+    s->count++;
+    if (s->estimator == CHEEPSYNC_LOWER_ENVELOPE) {
+        cheepsync_impl_envelope_add(s, k);
+    } else {
+        cheepsync_impl_set_weight(s, k, cheepsync_impl_arrival_weight(s, x, y));
+    }
+
+    // HUBER: re-score the window once the samples since the last pass reach the fill at that pass
+    if (s->estimator == CHEEPSYNC_HUBER && ++s->since_reweight >= s->reweight_interval) {
+        s->since_reweight = 0;
+        s->reweight_interval = s->count;
+        cheepsync_impl_huber_reweight(s);
+        cheepsync_impl_rebuild(s);
+    }
+
+    if (s->count < 2) {
+        return;
+    }
+    if (s->evictions >= s->window) {
+        cheepsync_impl_rebuild(s);
+    }
+    cheepsync_impl_incremental_fit(s);
+}
+
+static inline cheepsync_fit_t cheepsync_get_fit(const cheepsync_t *s)
+{
+    cheepsync_fit_t f = { s->offset_ns, s->beta, s->beacon_epoch_us, s->receiver_epoch_ns };
+    return f;
+}
+
+static inline int64_t cheepsync_map(const cheepsync_t *s, int64_t beacon_us)
+{
+    double x = (double)(beacon_us - s->beacon_epoch_us) * 1000.0;
+    return s->receiver_epoch_ns + (int64_t)(s->offset_ns + s->beta * x);
+}
+
+// |actual − predicted| for one sample, in ns.
+static inline double cheepsync_residual_ns(const cheepsync_t *s, int64_t beacon_us, int64_t receiver_ns)
+{
+    double x = (double)(beacon_us - s->beacon_epoch_us) * 1000.0;
+    return fabs((double)(receiver_ns - s->receiver_epoch_ns) - (s->offset_ns + s->beta * x));
+}
+
+// Forget every sample; keeps the noise settings.
+static inline void cheepsync_kalman_reset(cheepsync_kalman_t *k)
+{
+    k->offset_epoch_ns = 0;
+    k->offset_ns = 0.0;
+    k->skew = 0.0;
+    k->p_oo = k->p_os = k->p_ss = 0.0;
+    k->last_tb_us = 0;
+    k->innovation_mean_sq = 0.0;
+    k->count = 0;
+}
+
+// Noise settings as in KalmanSync: offset ns/√s, skew ppm/√s, one sample's std dev in ms, skew prior in ppm.
+static inline void cheepsync_kalman_init(cheepsync_kalman_t *k, double process_noise_offset_ns,
+                                         double process_noise_skew_ppm, double measurement_noise_ms,
+                                         double initial_skew_ppm)
+{
+    k->r = cheepsync_impl_square(measurement_noise_ms * 1e6);
+    k->q_offset = cheepsync_impl_square(process_noise_offset_ns);
+    k->q_skew = cheepsync_impl_square(process_noise_skew_ppm * 1e-6);
+    k->p0_skew = cheepsync_impl_square(initial_skew_ppm * 1e-6);
+    cheepsync_kalman_reset(k);
+}
+
+// Track one sample. Samples older than the latest one are ignored.
+static inline void cheepsync_kalman_add(cheepsync_kalman_t *k, int64_t beacon_us, int64_t receiver_ns)
+{
+    int64_t z_abs = receiver_ns - beacon_us * 1000;
+    if (k->count == 0) {
+        k->offset_epoch_ns = z_abs;
+        k->offset_ns = 0.0;
+        k->skew = 0.0;
+        k->p_oo = k->r;
+        k->p_os = 0.0;
+        k->p_ss = k->p0_skew;
+        k->last_tb_us = beacon_us;
+        k->count = 1;
+        return;
+    }
+    if (beacon_us < k->last_tb_us) {
+        return;
+    }
+
+    // Predict with F = [[1, Δ], [0, 1]] plus random-walk Q
+    double dt_ns = (double)(beacon_us - k->last_tb_us) * 1000.0;
+    double dt_s = dt_ns / 1e9;
+    k->offset_ns += k->skew * dt_ns;
+    k->p_oo += 2.0 * dt_ns * k->p_os + dt_ns * dt_ns * k->p_ss;
+    k->p_os += dt_ns * k->p_ss;
+    k->p_oo += k->q_offset * dt_s + k->q_skew * dt_s * dt_ns * dt_ns / 3.0;
+    k->p_os += k->q_skew * dt_s * dt_ns / 2.0;
+    k->p_ss += k->q_skew * dt_s;
+    k->last_tb_us = beacon_us;
+
+    // Update with H = [1, 0]
+    double innovation = (double)(z_abs - k->offset_epoch_ns) - k->offset_ns;
+    double s = k->p_oo + k->r;
+    double k_o = k->p_oo / s;
+    double k_s = k->p_os / s;
+    k->offset_ns += k_o * innovation;
+    k->skew += k_s * innovation;
+    double oo = k->p_oo, os = k->p_os;
+    k->p_oo = (1.0 - k_o) * oo;
+    k->p_os = (1.0 - k_o) * os;
+    k->p_ss -= k_s * os;
+
+    uint32_t n = k->count < 50 ? k->count : 50;  // CheepSync.DEFAULT_WINDOW_SIZE, as in KalmanSync
+    k->innovation_mean_sq += (innovation * innovation - k->innovation_mean_sq) / (double)n;
+    k->count++;
+}
+
+static inline bool cheepsync_kalman_has_fit(const cheepsync_kalman_t *k)
+{
+    return k->count >= 2;
+}
+
+static inline int64_t cheepsync_kalman_map(const cheepsync_kalman_t *k, int64_t beacon_us)
+{
+    double dt_ns = (double)(beacon_us - k->last_tb_us) * 1000.0;
+    return beacon_us * 1000 + k->offset_epoch_ns + (int64_t)(k->offset_ns + k->skew * dt_ns);
+}
+
+// Fit with its epoch at the latest sample (maps like cheepsync_kalman_map).
+static inline cheepsync_fit_t cheepsync_kalman_get_fit(const cheepsync_kalman_t *k)
+{
+    cheepsync_fit_t f = { k->offset_ns, 1.0 + k->skew, k->last_tb_us, k->last_tb_us * 1000 + k->offset_epoch_ns };
+    return f;
+}
+
+// RMS of recent innovations, in ns.
+static inline double cheepsync_kalman_rms_ns(const cheepsync_kalman_t *k)
+{
+    return sqrt(k->innovation_mean_sq);
+}
+
+static inline double cheepsync_kalman_offset_stddev_ns(const cheepsync_kalman_t *k)
+{
+    return sqrt(k->p_oo);
+}
+
+static inline double cheepsync_kalman_skew_stddev_ppm(const cheepsync_kalman_t *k)
+{
+    return sqrt(k->p_ss) * 1e6;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHEEPSYNC_H
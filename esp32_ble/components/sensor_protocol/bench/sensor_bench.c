@@ -0,0 +1,242 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+// Host benchmark of the notify hot path: payload build cost per format, batching throughput through the
+// scheduler and the per-period cost spread (scheduler jitter) of the notify loop, on a synthetic capture
+// stream with jitter and congestion. Host numbers are not ESP32 numbers; compare runs on one machine.
+//
+//   sensor_bench [--mtu N] [--batch N] [--periods N] [--budget-ns N]
+//
+// --budget-ns fails the run (exit 1) if any format's p99 period cost exceeds it.
+
+/* Includes */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sensor_payload.h"
+#include "sensor_sched.h"
+
+/* Defines */
+#define BENCH_QUEUE_LEN     32      // CONFIG_SENSOR_NOTIFY_QUEUE_LEN default
+#define BENCH_PERIOD_US     10000   // CONFIG_SENSOR_PERIOD_MS default
+#define BENCH_JITTER_US     40      // capture jitter: inside the 1-byte delta range
+#define BENCH_CONGEST_EVERY 50      // one blocked stretch per this many periods...
+#define BENCH_CONGEST_LEN   5       // ...this many periods long
+#define BENCH_BUILD_ITERS   200000
+#define BENCH_PAYLOAD_MAX   512
+
+/* Private types */
+typedef struct {
+    const char *name;
+    uint8_t format;
+    uint8_t coalesced_format;
+} bench_format_t;
+
+static const bench_format_t formats[] = {
+    { "legacy",  SENSOR_PAYLOAD_VERSION_LEGACY,  SENSOR_PAYLOAD_VERSION_BATCH },
+    { "timed",   SENSOR_PAYLOAD_VERSION_TIMED,   SENSOR_PAYLOAD_VERSION_BATCH },
+    { "batch",   SENSOR_PAYLOAD_VERSION_BATCH,   SENSOR_PAYLOAD_VERSION_BATCH },
+    { "thermal", SENSOR_PAYLOAD_VERSION_THERMAL, SENSOR_PAYLOAD_VERSION_THERMAL },
+    { "delta",   SENSOR_PAYLOAD_VERSION_DELTA,   SENSOR_PAYLOAD_VERSION_BATCH },
+};
+#define FORMAT_COUNT (sizeof(formats) / sizeof(formats[0]))
+
+/* Private functions */
+static volatile size_t sink;  // keeps the builds from being optimized away
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Deterministic xorshift, so every run sees the same stream
+static uint32_t rng_state = 0x2545F491u;
+static inline uint32_t rng_next(void)
+{
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+static inline uint64_t next_capture_us(uint64_t t_us)
+{
+    return t_us + BENCH_PERIOD_US + (rng_next() % (2 * BENCH_JITTER_US + 1)) - BENCH_JITTER_US;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Build cost of one payload of count records (1 for the single-record formats)
+static void bench_build(const bench_format_t *f, size_t count)
+{
+    sensor_record_t recs[UINT8_MAX];
+    uint64_t t_us = 1000000;
+    for (size_t i = 0; i < count; i++) {
+        t_us = next_capture_us(t_us);
+        recs[i].seq = (uint32_t)i;
+        recs[i].t_us = t_us;
+    }
+    uint8_t buf[BENCH_PAYLOAD_MAX];
+    size_t len = 0;
+    size_t first = 0;
+
+    uint64_t start = now_ns();
+    for (int it = 0; it < BENCH_BUILD_ITERS; it++) {
+        recs[count - 1].seq = (uint32_t)it;  // a changing input each round
+        switch (f->format) {
+        case SENSOR_PAYLOAD_VERSION_LEGACY:
+            len = sensor_payload_build_legacy(buf, &recs[count - 1]);
+            break;
+        case SENSOR_PAYLOAD_VERSION_TIMED:
+            len = sensor_payload_build_timed(buf, &recs[count - 1], SENSOR_TIMED_FLAG_DELAY_CONF, (uint32_t)it, 1500);
+            break;
+        case SENSOR_PAYLOAD_VERSION_THERMAL:
+            len = sensor_payload_build_thermal(buf, sizeof(buf), recs, count, 3125);
+            break;
+        case SENSOR_PAYLOAD_VERSION_DELTA:
+            len = sensor_payload_build_delta(buf, sizeof(buf), recs, count, BENCH_PERIOD_US, &first);
+            break;
+        default:
+            len = sensor_payload_build_batch(buf, sizeof(buf), recs, count);
+            break;
+        }
+        sink += len + buf[len - 1];
+    }
+    uint64_t elapsed = now_ns() - start;
+    printf("  %-8s %3zu records  %8.1f ns/payload  %6.2f ns/record  %3zu bytes\n", f->name, count,
+           (double)elapsed / BENCH_BUILD_ITERS, (double)elapsed / BENCH_BUILD_ITERS / (double)count, len);
+}
+
+// The notify loop of one connection: a capture per period, the link blocked for a stretch every
+// BENCH_CONGEST_EVERY periods. Per-period cost goes into cost_ns; returns its p99.
+static uint64_t bench_loop(const bench_format_t *f, uint16_t mtu, size_t batch, size_t periods, uint64_t *cost_ns)
+{
+    sensor_record_t storage[BENCH_QUEUE_LEN];
+    sensor_queue_t q;
+    sensor_queue_init(&q, storage, BENCH_QUEUE_LEN);
+    const sensor_sched_config_t cfg = {
+        .coalesced_format = f->coalesced_format,
+        .batch_size = batch,
+        .period_us = BENCH_PERIOD_US,
+    };
+    const sensor_timed_report_t report = { SENSOR_TIMED_FLAG_DELAY_CONF, 0, 1500 };
+    uint8_t buf[BENCH_PAYLOAD_MAX];
+    size_t cap = (size_t)(mtu - SENSOR_ATT_NOTIFY_OVERHEAD) < sizeof(buf) ? (size_t)(mtu - SENSOR_ATT_NOTIFY_OVERHEAD)
+                                                                          : sizeof(buf);
+    uint64_t t_us = 1000000;
+    size_t sent = 0, delivered = 0, dropped = 0, bytes = 0;
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < periods; i++) {
+        t_us = next_capture_us(t_us);
+        bool blocked = i % BENCH_CONGEST_EVERY >= BENCH_CONGEST_EVERY - BENCH_CONGEST_LEN;
+
+        uint64_t t0 = now_ns();
+        dropped += sensor_queue_push(&q, &t_us, 1);
+        sensor_plan_t plan;
+        sensor_sched_plan(&cfg, &q, f->format, mtu, &plan);
+        if (!blocked && q.queued >= plan.due) {
+            dropped += sensor_sched_trim(&q, &plan);
+            const sensor_timed_report_t *timed =
+                f->format == SENSOR_PAYLOAD_VERSION_TIMED && !sensor_sched_batched(&plan, q.queued) ? &report : NULL;
+            size_t len = sensor_sched_build(buf, cap, &q, &cfg, &plan, timed, 3125, &dropped);
+            if (len > 0) {
+                sink += buf[len - 1];
+                sent++;
+                delivered += q.queued;
+                bytes += len + SENSOR_ATT_NOTIFY_OVERHEAD;
+                q.queued = 0;
+            }
+        }
+        cost_ns[i] = now_ns() - t0;
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    qsort(cost_ns, periods, sizeof(cost_ns[0]), cmp_u64);
+    uint64_t p50 = cost_ns[periods / 2];
+    uint64_t p99 = cost_ns[periods * 99 / 100];
+    uint64_t max = cost_ns[periods - 1];
+    printf("  %-8s %7zu notifications  %5.2f records each  %6.1f B/record on air  %5zu dropped  "
+           "%7.2f M records/s  period p50 %4" PRIu64 " p99 %5" PRIu64 " max %6" PRIu64 " ns\n",
+           f->name, sent, sent ? (double)delivered / (double)sent : 0.0,
+           delivered ? (double)bytes / (double)delivered : 0.0, dropped,
+           elapsed ? (double)delivered * 1e3 / (double)elapsed : 0.0, p50, p99, max);
+    return p99;
+}
+
+static long arg_value(int argc, char **argv, int *i)
+{
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "%s needs a value\n", argv[*i]);
+        exit(2);
+    }
+    return strtol(argv[++*i], NULL, 0);
+}
+
+/* Public functions */
+int main(int argc, char **argv)
+{
+    long mtu = 247;      // LE data length extension with a 251-byte PDU
+    long batch = 10;     // CONFIG_SENSOR_BATCH_SIZE default
+    long periods = 1000000;
+    long budget_ns = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mtu") == 0) {
+            mtu = arg_value(argc, argv, &i);
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = arg_value(argc, argv, &i);
+        } else if (strcmp(argv[i], "--periods") == 0) {
+            periods = arg_value(argc, argv, &i);
+        } else if (strcmp(argv[i], "--budget-ns") == 0) {
+            budget_ns = arg_value(argc, argv, &i);
+        } else {
+            fprintf(stderr, "usage: %s [--mtu N] [--batch N] [--periods N] [--budget-ns N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (mtu < 23 || mtu > BENCH_PAYLOAD_MAX || batch < 1 || batch > BENCH_QUEUE_LEN || periods < 100) {
+        fprintf(stderr, "mtu 23..%d, batch 1..%d, periods >= 100\n", BENCH_PAYLOAD_MAX, BENCH_QUEUE_LEN);
+        return 2;
+    }
+
+#if SENSOR_PAYLOAD_PACKED
+    printf("Payload build (%d rounds, packed stores)\n", BENCH_BUILD_ITERS);
+#else
+    printf("Payload build (%d rounds, byte stores)\n", BENCH_BUILD_ITERS);
+#endif
+    for (size_t f = 0; f < FORMAT_COUNT; f++) {
+        bool single = formats[f].format == SENSOR_PAYLOAD_VERSION_LEGACY ||
+                      formats[f].format == SENSOR_PAYLOAD_VERSION_TIMED;
+        bench_build(&formats[f], single ? 1 : (size_t)batch);
+    }
+
+    printf("\nNotify loop (MTU %ld, batch %ld, queue %d, %ld periods, %d of every %d congested)\n", mtu, batch,
+           BENCH_QUEUE_LEN, periods, BENCH_CONGEST_LEN, BENCH_CONGEST_EVERY);
+    uint64_t *cost_ns = malloc((size_t)periods * sizeof(uint64_t));
+    if (!cost_ns) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    int status = 0;
+    for (size_t f = 0; f < FORMAT_COUNT; f++) {
+        uint64_t p99 = bench_loop(&formats[f], (uint16_t)mtu, (size_t)batch, (size_t)periods, cost_ns);
+        if (budget_ns > 0 && p99 > (uint64_t)budget_ns) {
+            fprintf(stderr, "%s: p99 period cost %" PRIu64 " ns over the %ld ns budget\n", formats[f].name, p99,
+                    budget_ns);
+            status = 1;
+        }
+    }
+    free(cost_ns);
+    return status;
+}
@@ -0,0 +1,162 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef SENSOR_PAYLOAD_H
+#define SENSOR_PAYLOAD_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Defines */
+#define SENSOR_RECORD_LEN            12  // seq(4) + t_us(8)
+#define SENSOR_LEGACY_PAYLOAD_LEN    SENSOR_RECORD_LEN
+#define SENSOR_BATCH_HEADER_LEN      2   // version(1) + count(1)
+#define SENSOR_PAYLOAD_VERSION_LEGACY 0x00  // format ID only: the legacy payload carries no version byte
+#define SENSOR_PAYLOAD_VERSION_BATCH 0x01
+#define SENSOR_PAYLOAD_VERSION_TIMED 0x02
+#define SENSOR_PAYLOAD_VERSION_BEACON 0x03
+#define SENSOR_PAYLOAD_VERSION_EVENTS 0x04
+#define SENSOR_PAYLOAD_VERSION_DELTA 0x05
+#define SENSOR_PAYLOAD_VERSION_ROOT_TIME 0x06
+#define SENSOR_PAYLOAD_VERSION_THERMAL 0x07
+#define SENSOR_TIMED_PAYLOAD_LEN     22  // version(1) + flags(1) + record(12) + prev_seq(4) + prev_delay_us(4)
+#define SENSOR_ATT_NOTIFY_OVERHEAD   3   // opcode(1) + handle(2)
+#define SENSOR_BEACON_PAYLOAD_LEN    13  // version(1) + record(12)
+#define SENSOR_CONN_PARAMS_LEN       6   // interval(2) + latency(2) + timeout(2)
+#define SENSOR_RTT_REQUEST_LEN       8   // client send time (opaque u64, echoed back)
+#define SENSOR_RTT_RESPONSE_LEN      20  // echo(8) + rx_us(8) + turnaround_us(4); fits the 23-byte default MTU
+#define SENSOR_BEACON_COMPANY_ID     0xFFFF  // "no company" ID reserved for testing by the Bluetooth SIG
+#define SENSOR_EVENT_RECORD_LEN      17  // event_seq(4) + t_us(8) + peak(4) + flags(1)
+#define SENSOR_DELTA_HEADER_LEN      18  // version(1) + count(1) + period_us(4) + seq(4) + t_us(8)
+#define SENSOR_DELTA_MAX_VARINT      10  // zigzag int64 as LEB128
+#define SENSOR_ROOT_TIME_PAYLOAD_LEN 16  // version(1) + hop(1) + record(12) + err_us(2)
+#define SENSOR_ROOT_TIME_HOP_UNSYNCED 0xFF  // relay without a parent: t_us is its own clock, not root time
+#define SENSOR_RATE_FEEDBACK_LEN     6   // rms_us(4) + samples(2)
+#define SENSOR_THERMAL_HEADER_LEN    4   // version(1) + count(1) + temp_cdeg(2)
+#define SENSOR_CAPS_LEN              14  // see sensor_payload_build_caps
+#define SENSOR_CAPS_VERSION          0x01
+#define SENSOR_CAPS_UNIT_US_BOOT     0x00  // timestamp unit: esp_timer microseconds since boot
+#define SENSOR_CCCD_LEN              2
+
+// Flags byte of the timed payload: where prev_delay_us was measured (neither bit = unknown)
+#define SENSOR_TIMED_FLAG_DELAY_CONF 0x01  // capture -> ESP_GATTS_CONF_EVT (handed to controller)
+#define SENSOR_TIMED_FLAG_DELAY_CALL 0x02  // capture -> esp_ble_gatts_send_indicate() return only
+
+// Capabilities: bit SENSOR_PAYLOAD_VERSION_x of the formats mask is set for each selectable sensor format
+#define SENSOR_CAPS_FORMAT_BIT(version) (1u << (version))
+
+// Capabilities: optional features built in (the connection, round-trip and diagnostics characteristics always are)
+#define SENSOR_CAPS_FEATURE_EVENTS       0x0001  // acoustic event and detector characteristics
+#define SENSOR_CAPS_FEATURE_ADAPTIVE_RATE 0x0002 // rate-control characteristic
+#define SENSOR_CAPS_FEATURE_TEMPERATURE  0x0004  // thermal payloads carry a real reading
+#define SENSOR_CAPS_FEATURE_LOW_POWER    0x0008  // light sleep between samples
+#define SENSOR_CAPS_FEATURE_TIMER        0x0010  // sampled from a periodic esp_timer (sub-ms periods)
+
+// Flags byte of an event record
+#define SENSOR_EVENT_FLAG_GAP        0x01  // capture overrun around the onset: t_us may be one DMA buffer off
+
+/* Public types */
+typedef struct {
+    uint32_t seq;
+    uint64_t t_us;
+} sensor_record_t;
+
+// One detected acoustic event
+typedef struct {
+    uint32_t seq;       // event counter since boot; a jump means events were lost
+    uint64_t t_us;      // esp_timer time of the onset
+    uint32_t peak;      // peak |sample| (24-bit) of the buffer with the onset
+    uint8_t  flags;     // SENSOR_EVENT_FLAG_*
+} sensor_event_t;
+
+/* Public function declarations */
+// Legacy payload, little-endian: [seq:u32][t_us:u64]. Returns bytes written (12).
+size_t sensor_payload_build_legacy(uint8_t *buf, const sensor_record_t *rec);
+
+// Batched payload, little-endian: [version:u8 = 0x01][count:u8] then count x [seq:u32][t_us:u64].
+// Returns bytes written, or 0 if the records do not fit in cap.
+size_t sensor_payload_build_batch(uint8_t *buf, size_t cap, const sensor_record_t *recs, size_t count);
+
+// Thermal payload (SENSOR_TEMPERATURE), little-endian: [version:u8 = 0x07][count:u8][temp_cdeg:i16] then
+// count x [seq:u32][t_us:u64]. temp_cdeg is the die temperature in centi-degrees C when the payload was built
+// (INT16_MIN = unknown). Returns bytes written, or 0 if the records do not fit in cap.
+size_t sensor_payload_build_thermal(uint8_t *buf, size_t cap, const sensor_record_t *recs, size_t count,
+                                    int16_t temp_cdeg);
+
+// Delta payload, little-endian: [version:u8 = 0x05][count:u8][period_us:u32][seq:u32][t_us:u64] then count - 1
+// varints. Record 0 is seq/t_us; record i has seq + i and the t_us of record i - 1 plus period_us plus the
+// zigzag-decoded LEB128 varint i. A steady period costs 1 byte per record (|jitter| < 64 us).
+// recs must have consecutive seqs. Only the newest records that fit in cap are encoded (the newest always
+// is); *first is set to the index of the oldest one encoded. Returns bytes written, or 0 if nothing fits.
+size_t sensor_payload_build_delta(uint8_t *buf, size_t cap, const sensor_record_t *recs, size_t count,
+                                  uint32_t period_us, size_t *first);
+
+// Timed payload, little-endian: [version:u8 = 0x02][flags:u8][seq:u32][t_us:u64][prev_seq:u32][prev_delay_us:u32].
+// prev_delay_us is how long the previous notification (prev_seq) took from capture to leaving the host stack.
+size_t sensor_payload_build_timed(uint8_t *buf, const sensor_record_t *rec, uint8_t flags,
+                                  uint32_t prev_seq, uint32_t prev_delay_us);
+
+// Broadcast payload (manufacturer data after the company ID), little-endian:
+// [version:u8 = 0x03][seq:u32][t_us:u64]. Returns bytes written (13).
+size_t sensor_payload_build_beacon(uint8_t *buf, const sensor_record_t *rec);
+
+// Root-time broadcast payload (SENSOR_TIME_ROLE), little-endian:
+// [version:u8 = 0x06][hop:u8][seq:u32][t_us:u64][err_us:u16]. t_us is in the root beacon's timeline: the root's
+// own clock at hop 0, converted through the fit to the parent at hop 1 and up. err_us is the error estimate
+// accumulated along the path (saturating). Returns bytes written (16).
+size_t sensor_payload_build_root_time(uint8_t *buf, const sensor_record_t *rec, uint8_t hop, uint16_t err_us);
+
+// Connection-parameter characteristic value, little-endian:
+// [interval:u16, 1.25 ms units][latency:u16, connection events][timeout:u16, 10 ms units]. Returns bytes written (6).
+size_t sensor_payload_build_conn_params(uint8_t *buf, uint16_t interval, uint16_t latency, uint16_t timeout);
+
+// Capabilities characteristic value, little-endian:
+// [caps_version:u8 = 0x01][format:u8][record_len:u8][batch_size:u8][queue_len:u8][ts_unit:u8][formats:u16]
+// [features:u16][period_us:u32]. format is the sensor payload version this connection receives
+// (SENSOR_PAYLOAD_VERSION_LEGACY = the 12-byte payload), formats the mask of those a client may select,
+// batch_size the records per batched notification and queue_len how many a backlog can coalesce into one.
+// Returns bytes written (SENSOR_CAPS_LEN).
+size_t sensor_payload_build_caps(uint8_t *buf, uint8_t format, uint8_t batch_size, uint8_t queue_len,
+                                 uint16_t formats, uint16_t features, uint32_t period_us);
+
+// Round-trip response, little-endian: [client_t1:u64 echoed][rx_us:u64][turnaround_us:u32].
+// rx_us is when the request was received; rx_us + turnaround_us is when the response was sent. Returns bytes written (20).
+size_t sensor_payload_build_rtt(uint8_t *buf, const uint8_t *client_t1, uint64_t rx_us, uint32_t turnaround_us);
+
+// Event payload, little-endian: [version:u8 = 0x04][count:u8] then count x [event_seq:u32][t_us:u64][peak:u32][flags:u8].
+// Returns bytes written, or 0 if the events do not fit in cap.
+size_t sensor_payload_build_events(uint8_t *buf, size_t cap, const sensor_event_t *events, size_t count);
+
+// How many event records fit in one notification at the given ATT MTU.
+size_t sensor_payload_event_capacity(uint16_t mtu);
+
+// How many batched records fit in one notification at the given ATT MTU.
+size_t sensor_payload_batch_capacity(uint16_t mtu);
+
+// How many thermal records fit in one notification at the given ATT MTU.
+size_t sensor_payload_thermal_capacity(uint16_t mtu);
+
+// How many delta records fit in one notification at the given ATT MTU if every delta takes one byte
+// (an upper bound: sensor_payload_build_delta drops the oldest records that do not fit).
+size_t sensor_payload_delta_capacity(uint16_t mtu);
+
+// Receiver side (SENSOR_RECEIVER): the newest record of a sensor notification in any format above: legacy
+// (told apart by its 12-byte length), batched, thermal, timed or delta. That record is the one stamped right before
+// the send, so it is the one to pair with the receive time. Returns false on a malformed payload.
+bool sensor_payload_parse_newest(const uint8_t *buf, size_t len, sensor_record_t *out);
+
+// Relay side (SENSOR_TIME_ROLE_RELAY): a root-time payload as heard in another beacon's manufacturer data
+// (company ID stripped). Returns false for another version or length.
+bool sensor_payload_parse_root_time(const uint8_t *buf, size_t len, sensor_record_t *out, uint8_t *hop, uint16_t *err_us);
+
+// Client characteristic configuration write, little-endian u16: 0x0001 enables notifications, 0x0000 disables
+// them. Returns false for another length or value (indications are not offered), leaving *notify unchanged.
+bool sensor_payload_parse_cccd(const uint8_t *buf, size_t len, bool *notify);
+
+// Rate-control write (SENSOR_ADAPTIVE_RATE), little-endian: [rms_us:u32][samples:u16], the client's RMS fit
+// residual and how many samples that fit rests on. Returns false for another length.
+bool sensor_payload_parse_rate_feedback(const uint8_t *buf, size_t len, uint32_t *rms_us, uint16_t *samples);
+
+#endif // SENSOR_PAYLOAD_H
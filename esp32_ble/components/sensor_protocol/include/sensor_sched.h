@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+#ifndef SENSOR_SCHED_H
+#define SENSOR_SCHED_H
+
+// Notify scheduling, per connection and without the BLE stack: the bounded record queue, when a send is due,
+// what the MTU holds and which payload the queued records go out in. The firmware's notify loop adds the link
+// state (congestion, in-flight credits), the send and the diagnostics; a host build runs it as is.
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensor_payload.h"
+
+/* Public types */
+// Records waiting for a send, oldest first, in caller-owned storage. Not thread-safe.
+typedef struct {
+    sensor_record_t *records;
+    size_t   len;       // storage capacity
+    size_t   queued;
+    uint32_t seq;       // seq of the next record pushed
+} sensor_queue_t;
+
+// Build-wide settings
+typedef struct {
+    uint8_t  coalesced_format;  // batched format a backlog of a single-record format goes out in
+    size_t   batch_size;        // records per batched notification
+    uint32_t period_us;         // delta payload reference interval
+} sensor_sched_config_t;
+
+// One connection's send decision at its current format and MTU (sensor_sched_plan)
+typedef struct {
+    uint8_t  format;        // the connection's payload version (SENSOR_PAYLOAD_VERSION_LEGACY = 12-byte payload)
+    uint8_t  batch_format;  // what more than one record goes out in
+    bool     single;        // format carries one record (legacy, timed)
+    uint16_t mtu;
+    size_t   capacity;      // most records one notification holds (at least 1, at most the queue length)
+    size_t   due;           // queued records that make a send due
+} sensor_plan_t;
+
+// Timed payload fields reporting the previous notification's send delay
+typedef struct {
+    uint8_t  flags;         // SENSOR_TIMED_FLAG_*
+    uint32_t prev_seq;
+    uint32_t prev_delay_us;
+} sensor_timed_report_t;
+
+/* Public function declarations */
+// Empty queue over storage[len], seq from 0 (a new connection).
+void sensor_queue_init(sensor_queue_t *q, sensor_record_t *storage, size_t len);
+
+// Drop the n oldest records (n <= queued).
+void sensor_queue_drop(sensor_queue_t *q, size_t n);
+
+// Queue count captures (oldest first) with consecutive seqs; a full queue drops its oldest.
+// Returns how many records were dropped.
+size_t sensor_queue_push(sensor_queue_t *q, const uint64_t *t_us, size_t count);
+
+// Capacity and due count for a connection receiving format at mtu. Batched formats are due with a full batch
+// (or as many as the MTU holds), single-record ones with every record.
+void sensor_sched_plan(const sensor_sched_config_t *cfg, const sensor_queue_t *q, uint8_t format, uint16_t mtu,
+                       sensor_plan_t *plan);
+
+// Drop what one notification cannot hold, oldest first. Returns how many records were dropped.
+size_t sensor_sched_trim(sensor_queue_t *q, const sensor_plan_t *plan);
+
+// Whether n queued records go out as plan->batch_format rather than one single-record payload.
+static inline bool sensor_sched_batched(const sensor_plan_t *plan, size_t n)
+{
+    return !plan->single || n > 1;
+}
+
+// Build the notification for the queued records (trimmed) into buf: a single record as legacy, or as timed if
+// timed is set, otherwise plan->batch_format. temp_cdeg goes into thermal payloads (INT16_MIN = unknown).
+// A delta payload that cannot hold the oldest records drops them from q, added to *dropped.
+// Returns bytes written, or 0 if nothing fits in cap.
+size_t sensor_sched_build(uint8_t *buf, size_t cap, sensor_queue_t *q, const sensor_sched_config_t *cfg,
+                          const sensor_plan_t *plan, const sensor_timed_report_t *timed, int16_t temp_cdeg,
+                          size_t *dropped);
+
+#endif // SENSOR_SCHED_H
@@ -0,0 +1,529 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include <string.h>
+
+#include "sensor_payload.h"
+
+/* Defines */
+// SENSOR_PAYLOAD_PACKED (Kconfig under ESP-IDF, a CMake option on a host): fixed layouts are filled as the
+// packed structs below and stored with one memcpy each, instead of byte by byte. The structs hold their fields
+// in CPU order, so this needs a little-endian target (every ESP32 is one).
+#ifndef SENSOR_PAYLOAD_PACKED
+#define SENSOR_PAYLOAD_PACKED 0
+#endif
+
+#if SENSOR_PAYLOAD_PACKED && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "SENSOR_PAYLOAD_PACKED needs a little-endian target"
+#endif
+
+/* Private types */
+// Wire layouts of the records and fixed-size payloads, checked against sensor_payload.h in every build
+typedef struct __attribute__((packed)) {
+    uint32_t seq;
+    uint64_t t_us;
+} wire_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;
+    uint8_t  flags;
+    wire_record_t rec;
+    uint32_t prev_seq;
+    uint32_t prev_delay_us;
+} wire_timed_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;
+    wire_record_t rec;
+} wire_beacon_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;
+    uint8_t  hop;
+    wire_record_t rec;
+    uint16_t err_us;
+} wire_root_time_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t interval;
+    uint16_t latency;
+    uint16_t timeout;
+} wire_conn_params_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;
+    uint8_t  format;
+    uint8_t  record_len;
+    uint8_t  batch_size;
+    uint8_t  queue_len;
+    uint8_t  ts_unit;
+    uint16_t formats;
+    uint16_t features;
+    uint32_t period_us;
+} wire_caps_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  client_t1[SENSOR_RTT_REQUEST_LEN];
+    uint64_t rx_us;
+    uint32_t turnaround_us;
+} wire_rtt_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;
+    uint64_t t_us;
+    uint32_t peak;
+    uint8_t  flags;
+} wire_event_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  version;
+    uint8_t  count;
+    uint32_t period_us;
+    wire_record_t first;
+} wire_delta_header_t;
+
+_Static_assert(sizeof(wire_record_t) == SENSOR_RECORD_LEN, "record layout");
+_Static_assert(sizeof(wire_timed_t) == SENSOR_TIMED_PAYLOAD_LEN, "timed layout");
+_Static_assert(sizeof(wire_beacon_t) == SENSOR_BEACON_PAYLOAD_LEN, "beacon layout");
+_Static_assert(sizeof(wire_root_time_t) == SENSOR_ROOT_TIME_PAYLOAD_LEN, "root time layout");
+_Static_assert(sizeof(wire_conn_params_t) == SENSOR_CONN_PARAMS_LEN, "connection parameter layout");
+_Static_assert(sizeof(wire_caps_t) == SENSOR_CAPS_LEN, "capabilities layout");
+_Static_assert(sizeof(wire_rtt_t) == SENSOR_RTT_RESPONSE_LEN, "round-trip layout");
+_Static_assert(sizeof(wire_event_t) == SENSOR_EVENT_RECORD_LEN, "event record layout");
+_Static_assert(sizeof(wire_delta_header_t) == SENSOR_DELTA_HEADER_LEN, "delta header layout");
+
+/* Private functions */
+#if SENSOR_PAYLOAD_PACKED
+static inline void put_u16_le(uint8_t *p, uint16_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline void put_u32_le(uint8_t *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline void put_record(uint8_t *p, const sensor_record_t *rec)
+{
+    const wire_record_t w = { rec->seq, rec->t_us };
+    memcpy(p, &w, sizeof(w));
+}
+
+static inline uint16_t get_u16_le(const uint8_t *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t get_u32_le(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void get_record(const uint8_t *p, sensor_record_t *rec)
+{
+    wire_record_t w;
+    memcpy(&w, p, sizeof(w));
+    rec->seq = w.seq;
+    rec->t_us = w.t_us;
+}
+#else
+static inline void put_u16_le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32_le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void put_u64_le(uint8_t *p, uint64_t v)
+{
+    put_u32_le(p, (uint32_t)v);
+    put_u32_le(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline void put_record(uint8_t *p, const sensor_record_t *rec)
+{
+    put_u32_le(p, rec->seq);
+    put_u64_le(p + 4, rec->t_us);
+}
+
+static inline uint16_t get_u16_le(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void get_record(const uint8_t *p, sensor_record_t *rec)
+{
+    rec->seq = get_u32_le(p);
+    rec->t_us = (uint64_t)get_u32_le(p + 4) | ((uint64_t)get_u32_le(p + 8) << 32);
+}
+#endif
+
+static inline size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline size_t varint_len(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+// Deviation of record i's interval from the nominal period, zigzag-mapped so small negatives stay short
+static inline uint64_t delta_zigzag(const sensor_record_t *recs, size_t i, uint32_t period_us)
+{
+    int64_t d = (int64_t)(recs[i].t_us - recs[i - 1].t_us) - (int64_t)period_us;
+    return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+}
+
+/* Public functions */
+size_t sensor_payload_build_legacy(uint8_t *buf, const sensor_record_t *rec)
+{
+    put_record(buf, rec);
+    return SENSOR_LEGACY_PAYLOAD_LEN;
+}
+
+size_t sensor_payload_build_batch(uint8_t *buf, size_t cap, const sensor_record_t *recs, size_t count)
+{
+    size_t len = SENSOR_BATCH_HEADER_LEN + count * SENSOR_RECORD_LEN;
+    if (count == 0 || count > UINT8_MAX || len > cap) {
+        return 0;
+    }
+
+    buf[0] = SENSOR_PAYLOAD_VERSION_BATCH;
+    buf[1] = (uint8_t)count;
+    uint8_t *p = buf + SENSOR_BATCH_HEADER_LEN;
+    for (size_t i = 0; i < count; i++, p += SENSOR_RECORD_LEN) {
+        put_record(p, &recs[i]);
+    }
+    return len;
+}
+
+size_t sensor_payload_build_thermal(uint8_t *buf, size_t cap, const sensor_record_t *recs, size_t count,
+                                    int16_t temp_cdeg)
+{
+    size_t len = SENSOR_THERMAL_HEADER_LEN + count * SENSOR_RECORD_LEN;
+    if (count == 0 || count > UINT8_MAX || len > cap) {
+        return 0;
+    }
+
+    buf[0] = SENSOR_PAYLOAD_VERSION_THERMAL;
+    buf[1] = (uint8_t)count;
+    put_u16_le(buf + 2, (uint16_t)temp_cdeg);
+    uint8_t *p = buf + SENSOR_THERMAL_HEADER_LEN;
+    for (size_t i = 0; i < count; i++, p += SENSOR_RECORD_LEN) {
+        put_record(p, &recs[i]);
+    }
+    return len;
+}
+
+size_t sensor_payload_build_delta(uint8_t *buf, size_t cap, const sensor_record_t *recs, size_t count,
+                                  uint32_t period_us, size_t *first)
+{
+    if (count == 0 || cap < SENSOR_DELTA_HEADER_LEN) {
+        return 0;
+    }
+
+    // Walk back from the newest record while the deltas still fit
+    size_t start = count - 1;
+    size_t len = SENSOR_DELTA_HEADER_LEN;
+    while (start > 0 && count - start < UINT8_MAX) {
+        size_t n = varint_len(delta_zigzag(recs, start, period_us));
+        if (len + n > cap) {
+            break;
+        }
+        len += n;
+        start--;
+    }
+
+#if SENSOR_PAYLOAD_PACKED
+    const wire_delta_header_t w = {
+        SENSOR_PAYLOAD_VERSION_DELTA, (uint8_t)(count - start), period_us, { recs[start].seq, recs[start].t_us },
+    };
+    memcpy(buf, &w, sizeof(w));
+#else
+    buf[0] = SENSOR_PAYLOAD_VERSION_DELTA;
+    buf[1] = (uint8_t)(count - start);
+    put_u32_le(buf + 2, period_us);
+    put_record(buf + 6, &recs[start]);
+#endif
+    uint8_t *p = buf + SENSOR_DELTA_HEADER_LEN;
+    for (size_t i = start + 1; i < count; i++) {
+        p += put_varint(p, delta_zigzag(recs, i, period_us));
+    }
+    *first = start;
+    return len;
+}
+
+size_t sensor_payload_build_timed(uint8_t *buf, const sensor_record_t *rec, uint8_t flags,
+                                  uint32_t prev_seq, uint32_t prev_delay_us)
+{
+#if SENSOR_PAYLOAD_PACKED
+    const wire_timed_t w = { SENSOR_PAYLOAD_VERSION_TIMED, flags, { rec->seq, rec->t_us }, prev_seq, prev_delay_us };
+    memcpy(buf, &w, sizeof(w));
+#else
+    buf[0] = SENSOR_PAYLOAD_VERSION_TIMED;
+    buf[1] = flags;
+    put_record(buf + 2, rec);
+    put_u32_le(buf + 14, prev_seq);
+    put_u32_le(buf + 18, prev_delay_us);
+#endif
+    return SENSOR_TIMED_PAYLOAD_LEN;
+}
+
+size_t sensor_payload_build_beacon(uint8_t *buf, const sensor_record_t *rec)
+{
+#if SENSOR_PAYLOAD_PACKED
+    const wire_beacon_t w = { SENSOR_PAYLOAD_VERSION_BEACON, { rec->seq, rec->t_us } };
+    memcpy(buf, &w, sizeof(w));
+#else
+    buf[0] = SENSOR_PAYLOAD_VERSION_BEACON;
+    put_record(buf + 1, rec);
+#endif
+    return SENSOR_BEACON_PAYLOAD_LEN;
+}
+
+size_t sensor_payload_build_root_time(uint8_t *buf, const sensor_record_t *rec, uint8_t hop, uint16_t err_us)
+{
+#if SENSOR_PAYLOAD_PACKED
+    const wire_root_time_t w = { SENSOR_PAYLOAD_VERSION_ROOT_TIME, hop, { rec->seq, rec->t_us }, err_us };
+    memcpy(buf, &w, sizeof(w));
+#else
+    buf[0] = SENSOR_PAYLOAD_VERSION_ROOT_TIME;
+    buf[1] = hop;
+    put_record(buf + 2, rec);
+    put_u16_le(buf + 14, err_us);
+#endif
+    return SENSOR_ROOT_TIME_PAYLOAD_LEN;
+}
+
+size_t sensor_payload_build_conn_params(uint8_t *buf, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+#if SENSOR_PAYLOAD_PACKED
+    const wire_conn_params_t w = { interval, latency, timeout };
+    memcpy(buf, &w, sizeof(w));
+#else
+    put_u16_le(buf, interval);
+    put_u16_le(buf + 2, latency);
+    put_u16_le(buf + 4, timeout);
+#endif
+    return SENSOR_CONN_PARAMS_LEN;
+}
+
+size_t sensor_payload_build_caps(uint8_t *buf, uint8_t format, uint8_t batch_size, uint8_t queue_len,
+                                 uint16_t formats, uint16_t features, uint32_t period_us)
+{
+#if SENSOR_PAYLOAD_PACKED
+    const wire_caps_t w = {
+        SENSOR_CAPS_VERSION, format, SENSOR_RECORD_LEN, batch_size, queue_len, SENSOR_CAPS_UNIT_US_BOOT,
+        formats, features, period_us,
+    };
+    memcpy(buf, &w, sizeof(w));
+#else
+    buf[0] = SENSOR_CAPS_VERSION;
+    buf[1] = format;
+    buf[2] = SENSOR_RECORD_LEN;
+    buf[3] = batch_size;
+    buf[4] = queue_len;
+    buf[5] = SENSOR_CAPS_UNIT_US_BOOT;
+    put_u16_le(buf + 6, formats);
+    put_u16_le(buf + 8, features);
+    put_u32_le(buf + 10, period_us);
+#endif
+    return SENSOR_CAPS_LEN;
+}
+
+size_t sensor_payload_build_rtt(uint8_t *buf, const uint8_t *client_t1, uint64_t rx_us, uint32_t turnaround_us)
+{
+#if SENSOR_PAYLOAD_PACKED
+    wire_rtt_t w = { .rx_us = rx_us, .turnaround_us = turnaround_us };
+    memcpy(w.client_t1, client_t1, SENSOR_RTT_REQUEST_LEN);
+    memcpy(buf, &w, sizeof(w));
+#else
+    memcpy(buf, client_t1, SENSOR_RTT_REQUEST_LEN);
+    put_u64_le(buf + 8, rx_us);
+    put_u32_le(buf + 16, turnaround_us);
+#endif
+    return SENSOR_RTT_RESPONSE_LEN;
+}
+
+size_t sensor_payload_build_events(uint8_t *buf, size_t cap, const sensor_event_t *events, size_t count)
+{
+    size_t len = SENSOR_BATCH_HEADER_LEN + count * SENSOR_EVENT_RECORD_LEN;
+    if (count == 0 || count > UINT8_MAX || len > cap) {
+        return 0;
+    }
+
+    buf[0] = SENSOR_PAYLOAD_VERSION_EVENTS;
+    buf[1] = (uint8_t)count;
+    uint8_t *p = buf + SENSOR_BATCH_HEADER_LEN;
+    for (size_t i = 0; i < count; i++, p += SENSOR_EVENT_RECORD_LEN) {
+#if SENSOR_PAYLOAD_PACKED
+        const wire_event_t w = { events[i].seq, events[i].t_us, events[i].peak, events[i].flags };
+        memcpy(p, &w, sizeof(w));
+#else
+        put_u32_le(p, events[i].seq);
+        put_u64_le(p + 4, events[i].t_us);
+        put_u32_le(p + 12, events[i].peak);
+        p[16] = events[i].flags;
+#endif
+    }
+    return len;
+}
+
+size_t sensor_payload_event_capacity(uint16_t mtu)
+{
+    if (mtu <= SENSOR_ATT_NOTIFY_OVERHEAD + SENSOR_BATCH_HEADER_LEN) {
+        return 0;
+    }
+    return (size_t)(mtu - SENSOR_ATT_NOTIFY_OVERHEAD - SENSOR_BATCH_HEADER_LEN) / SENSOR_EVENT_RECORD_LEN;
+}
+
+size_t sensor_payload_batch_capacity(uint16_t mtu)
+{
+    if (mtu <= SENSOR_ATT_NOTIFY_OVERHEAD + SENSOR_BATCH_HEADER_LEN) {
+        return 0;
+    }
+    return (size_t)(mtu - SENSOR_ATT_NOTIFY_OVERHEAD - SENSOR_BATCH_HEADER_LEN) / SENSOR_RECORD_LEN;
+}
+
+size_t sensor_payload_thermal_capacity(uint16_t mtu)
+{
+    if (mtu <= SENSOR_ATT_NOTIFY_OVERHEAD + SENSOR_THERMAL_HEADER_LEN) {
+        return 0;
+    }
+    return (size_t)(mtu - SENSOR_ATT_NOTIFY_OVERHEAD - SENSOR_THERMAL_HEADER_LEN) / SENSOR_RECORD_LEN;
+}
+
+size_t sensor_payload_delta_capacity(uint16_t mtu)
+{
+    if (mtu < SENSOR_ATT_NOTIFY_OVERHEAD + SENSOR_DELTA_HEADER_LEN) {
+        return 0;
+    }
+    size_t n = 1 + (size_t)(mtu - SENSOR_ATT_NOTIFY_OVERHEAD - SENSOR_DELTA_HEADER_LEN);
+    return n < UINT8_MAX ? n : UINT8_MAX;
+}
+
+bool sensor_payload_parse_newest(const uint8_t *buf, size_t len, sensor_record_t *out)
+{
+    if (len == SENSOR_LEGACY_PAYLOAD_LEN) {
+        get_record(buf, out);
+        return true;
+    }
+    if (len < SENSOR_BATCH_HEADER_LEN) {
+        return false;
+    }
+
+    size_t count = buf[1];
+    switch (buf[0]) {
+    case SENSOR_PAYLOAD_VERSION_BATCH:
+        if (count == 0 || len < SENSOR_BATCH_HEADER_LEN + count * SENSOR_RECORD_LEN) {
+            return false;
+        }
+        get_record(buf + SENSOR_BATCH_HEADER_LEN + (count - 1) * SENSOR_RECORD_LEN, out);
+        return true;
+
+    case SENSOR_PAYLOAD_VERSION_THERMAL:
+        if (count == 0 || len < SENSOR_THERMAL_HEADER_LEN + count * SENSOR_RECORD_LEN) {
+            return false;
+        }
+        get_record(buf + SENSOR_THERMAL_HEADER_LEN + (count - 1) * SENSOR_RECORD_LEN, out);
+        return true;
+
+    case SENSOR_PAYLOAD_VERSION_TIMED:
+        if (len < SENSOR_TIMED_PAYLOAD_LEN) {
+            return false;
+        }
+        get_record(buf + 2, out);
+        return true;
+
+    case SENSOR_PAYLOAD_VERSION_DELTA: {
+        if (count == 0 || len < SENSOR_DELTA_HEADER_LEN) {
+            return false;
+        }
+        uint32_t period_us = get_u32_le(buf + 2);
+        get_record(buf + 6, out);
+        size_t off = SENSOR_DELTA_HEADER_LEN;
+        for (size_t i = 1; i < count; i++) {
+            uint64_t v = 0;
+            unsigned shift = 0;
+            do {
+                if (off >= len || shift >= 64) {
+                    return false;
+                }
+                v |= (uint64_t)(buf[off] & 0x7F) << shift;
+                shift += 7;
+            } while (buf[off++] & 0x80);
+            int64_t d = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            out->seq++;
+            out->t_us += (uint64_t)((int64_t)period_us + d);
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+bool sensor_payload_parse_root_time(const uint8_t *buf, size_t len, sensor_record_t *out, uint8_t *hop, uint16_t *err_us)
+{
+    if (len != SENSOR_ROOT_TIME_PAYLOAD_LEN || buf[0] != SENSOR_PAYLOAD_VERSION_ROOT_TIME) {
+        return false;
+    }
+    *hop = buf[1];
+    get_record(buf + 2, out);
+    *err_us = get_u16_le(buf + 14);
+    return true;
+}
+
+bool sensor_payload_parse_cccd(const uint8_t *buf, size_t len, bool *notify)
+{
+    if (len != SENSOR_CCCD_LEN) {
+        return false;
+    }
+    uint16_t cccd = get_u16_le(buf);
+    if (cccd != 0x0000 && cccd != 0x0001) {
+        return false;
+    }
+    *notify = cccd == 0x0001;
+    return true;
+}
+
+bool sensor_payload_parse_rate_feedback(const uint8_t *buf, size_t len, uint32_t *rms_us, uint16_t *samples)
+{
+    if (len != SENSOR_RATE_FEEDBACK_LEN) {
+        return false;
+    }
+    *rms_us = get_u32_le(buf);
+    *samples = get_u16_le(buf + 4);
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2026 BLE_SyncSuite contributors
+ */
+/* Includes */
+#include <string.h>
+
+#include "sensor_sched.h"
+
+/* Public functions */
+void sensor_queue_init(sensor_queue_t *q, sensor_record_t *storage, size_t len)
+{
+    q->records = storage;
+    q->len = len;
+    q->queued = 0;
+    q->seq = 0;
+}
+
+void sensor_queue_drop(sensor_queue_t *q, size_t n)
+{
+    memmove(q->records, q->records + n, (q->queued - n) * sizeof(q->records[0]));
+    q->queued -= n;
+}
+
+size_t sensor_queue_push(sensor_queue_t *q, const uint64_t *t_us, size_t count)
+{
+    size_t dropped = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (q->queued == q->len) {
+            sensor_queue_drop(q, 1);
+            dropped++;
+        }
+        q->records[q->queued].seq = q->seq++;
+        q->records[q->queued].t_us = t_us[i];
+        q->queued++;
+    }
+    return dropped;
+}
+
+void sensor_sched_plan(const sensor_sched_config_t *cfg, const sensor_queue_t *q, uint8_t format, uint16_t mtu,
+                       sensor_plan_t *plan)
+{
+    plan->format = format;
+    plan->single = format == SENSOR_PAYLOAD_VERSION_LEGACY || format == SENSOR_PAYLOAD_VERSION_TIMED;
+    plan->batch_format = plan->single ? cfg->coalesced_format : format;
+    plan->mtu = mtu;
+
+    size_t capacity;
+    if (plan->batch_format == SENSOR_PAYLOAD_VERSION_DELTA) {
+        capacity = sensor_payload_delta_capacity(mtu);
+    } else if (plan->batch_format == SENSOR_PAYLOAD_VERSION_THERMAL) {
+        capacity = sensor_payload_thermal_capacity(mtu);
+    } else {
+        capacity = sensor_payload_batch_capacity(mtu);
+    }
+    if (capacity > q->len) capacity = q->len;
+    if (capacity == 0) capacity = 1;
+    plan->capacity = capacity;
+    // Send when the batch is full or the MTU cannot hold another record
+    plan->due = plan->single ? 1 : capacity < cfg->batch_size ? capacity : cfg->batch_size;
+}
+
+size_t sensor_sched_trim(sensor_queue_t *q, const sensor_plan_t *plan)
+{
+    if (q->queued <= plan->capacity) {
+        return 0;
+    }
+    size_t n = q->queued - plan->capacity;
+    sensor_queue_drop(q, n);
+    return n;
+}
+
+size_t sensor_sched_build(uint8_t *buf, size_t cap, sensor_queue_t *q, const sensor_sched_config_t *cfg,
+                          const sensor_plan_t *plan, const sensor_timed_report_t *timed, int16_t temp_cdeg,
+                          size_t *dropped)
+{
+    size_t n = q->queued;
+    if (n == 0) {
+        return 0;
+    }
+
+    if (!sensor_sched_batched(plan, n)) {
+        if (timed) {
+            if (cap < SENSOR_TIMED_PAYLOAD_LEN) return 0;
+            return sensor_payload_build_timed(buf, &q->records[0], timed->flags, timed->prev_seq, timed->prev_delay_us);
+        }
+        if (cap < SENSOR_LEGACY_PAYLOAD_LEN) return 0;
+        return sensor_payload_build_legacy(buf, &q->records[0]);
+    }
+
+    if (plan->batch_format == SENSOR_PAYLOAD_VERSION_DELTA) {
+        // Capacity assumed 1-byte deltas; irregular intervals can leave the oldest records out
+        if (plan->mtu > SENSOR_ATT_NOTIFY_OVERHEAD && cap > (size_t)(plan->mtu - SENSOR_ATT_NOTIFY_OVERHEAD)) {
+            cap = (size_t)(plan->mtu - SENSOR_ATT_NOTIFY_OVERHEAD);
+        }
+        size_t first = 0;
+        size_t len = sensor_payload_build_delta(buf, cap, q->records, n, cfg->period_us, &first);
+        if (len > 0 && first > 0) {
+            sensor_queue_drop(q, first);
+            *dropped += first;
+        }
+        return len;
+    }
+    if (plan->batch_format == SENSOR_PAYLOAD_VERSION_THERMAL) {
+        return sensor_payload_build_thermal(buf, cap, q->records, n, temp_cdeg);
+    }
+    return sensor_payload_build_batch(buf, cap, q->records, n);
+}